@@ -38,6 +38,10 @@ public:
     //      to set it to 3*requiredSize to avoid blocking the render thread (usually the UI thread).
     explicit CircularBuffer(size_t bufferSize);
 
+    // Wraps 'bufferSize' bytes of memory owned by the caller. This buffer is not circular,
+    // circularize() must not be called on it.
+    CircularBuffer(void* data, size_t bufferSize) noexcept;
+
     // can't be moved or copy-constructed
     CircularBuffer(CircularBuffer const& rhs) = delete;
     CircularBuffer(CircularBuffer&& rhs) noexcept = delete;
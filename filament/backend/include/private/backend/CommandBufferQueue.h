@@ -35,6 +35,8 @@ class CommandBufferQueue {
     struct Slice {
         void* begin;
         void* end;
+        // secondary buffers whose commands are inserted in this slice
+        std::vector<void*> secondaryBuffers;
     };
 
     const size_t mRequiredSize;
@@ -50,9 +52,17 @@ class CommandBufferQueue {
     size_t mHighWatermark = 0;
     uint32_t mExitRequested = 0;
 
+    // secondary buffers available for recording, and the ones retained since the last flush()
+    utils::Mutex mSecondaryLock;
+    std::vector<void*> mFreeSecondaryBuffers;
+    std::vector<void*> mRetainedSecondaryBuffers;
+
     static constexpr uint32_t EXIT_REQUESTED = 0x31415926;
 
 public:
+    // size of the secondary buffers, see acquireSecondaryBuffer()
+    static constexpr size_t SECONDARY_BUFFER_SIZE = 64 * 1024;
+
     // requiredSize: guaranteed available space after flush()
     CommandBufferQueue(size_t requiredSize, size_t bufferSize);
     ~CommandBufferQueue();
@@ -73,6 +83,15 @@ public:
     // call blocks until the CircularBuffer has at least mRequiredSize bytes available.
     void flush() noexcept;
 
+    // Returns a buffer of SECONDARY_BUFFER_SIZE bytes, used to record commands on another
+    // thread, see SecondaryCommandStream. Can be called from any thread.
+    void* acquireSecondaryBuffer();
+
+    // Keeps 'buffer' alive until the commands written to the circular buffer since the last
+    // flush() are executed, it is then returned to the pool of secondary buffers.
+    // Must be called from the thread calling flush().
+    void retainSecondaryBuffer(void* buffer);
+
     // returns from waitForCommands() immediately.
     void requestExit();
 
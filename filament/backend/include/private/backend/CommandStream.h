@@ -20,6 +20,7 @@
 #define TNT_FILAMENT_DRIVER_COMMANDSTREAM_H
 
 #include "private/backend/CircularBuffer.h"
+#include "private/backend/CommandBufferQueue.h"
 
 #include <backend/BufferDescriptor.h>
 #include <backend/Handle.h>
@@ -57,6 +58,7 @@ namespace backend {
 
 class Driver;
 class CommandBase;
+class SecondaryCommandStream;
 
 /*
  * Dispatcher is a data structure containing only function pointers.
@@ -264,6 +266,12 @@ public:
 
     void execute(void* buffer);
 
+    /*
+     * Inserts the commands recorded by 'secondary' at the current position of this stream,
+     * without copying them. 'secondary' can't be used afterwards.
+     */
+    void insert(SecondaryCommandStream& secondary) noexcept;
+
     /*
      * queueCommand() allows to queue a lambda function as a command.
      * This is much less efficient than using the Driver* API.
@@ -327,6 +335,43 @@ PodType* CommandStream::allocatePod(size_t count, size_t alignment) noexcept {
     return static_cast<PodType*>(allocate(count * sizeof(PodType), alignment));
 }
 
+// ------------------------------------------------------------------------------------------------
+
+/*
+ * SecondaryCommandStream records commands into a secondary buffer of a CommandBufferQueue, which
+ * allows recording commands from several threads concurrently, each using its own
+ * SecondaryCommandStream. The recorded commands are then inserted in order into the primary
+ * CommandStream with CommandStream::insert(), which doesn't copy them.
+ *
+ * A SecondaryCommandStream can hold at most CommandBufferQueue::SECONDARY_BUFFER_SIZE bytes of
+ * commands, it's the caller's responsibility to not record more than getAvailableSize() bytes.
+ * It must be inserted -- or destroyed -- on the thread using the primary CommandStream.
+ */
+class SecondaryCommandStream {
+public:
+    SecondaryCommandStream(Driver& driver, CommandBufferQueue& queue);
+    ~SecondaryCommandStream() noexcept;
+
+    SecondaryCommandStream(SecondaryCommandStream const& rhs) = delete;
+    SecondaryCommandStream& operator=(SecondaryCommandStream const& rhs) = delete;
+
+    // the stream to record commands into, from a single thread at a time
+    CommandStream& getStream() noexcept { return mStream; }
+
+    // number of bytes still available for commands
+    size_t getAvailableSize() const noexcept {
+        return CommandBufferQueue::SECONDARY_BUFFER_SIZE - CommandBase::align(sizeof(NoopCommand))
+                - size_t((char*)mBuffer.getHead() - (char*)mBuffer.getTail());
+    }
+
+private:
+    friend class CommandStream;
+    CommandBufferQueue& mQueue;
+    void* mData;
+    CircularBuffer mBuffer;
+    CommandStream mStream;
+};
+
 } // namespace backend
 } // namespace filament
 
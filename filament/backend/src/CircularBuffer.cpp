@@ -42,6 +42,13 @@ CircularBuffer::CircularBuffer(size_t size) {
     mHead = mData;
 }
 
+CircularBuffer::CircularBuffer(void* data, size_t size) noexcept {
+    // mData stays null, so we never free the caller's memory
+    mSize = size;
+    mTail = data;
+    mHead = data;
+}
+
 CircularBuffer::~CircularBuffer() noexcept {
     dealloc();
 }
@@ -19,6 +19,7 @@
 #include <assert.h>
 
 #include <utils/Log.h>
+#include <utils/memalign.h>
 #include <utils/Systrace.h>
 #include <utils/Panic.h>
 
@@ -38,6 +39,10 @@ CommandBufferQueue::CommandBufferQueue(size_t requiredSize, size_t bufferSize)
 
 CommandBufferQueue::~CommandBufferQueue() {
     assert(mCommandBuffersToExecute.empty());
+    assert(mRetainedSecondaryBuffers.empty());
+    for (void* buffer : mFreeSecondaryBuffers) {
+        utils::aligned_free(buffer);
+    }
 }
 
 void CommandBufferQueue::requestExit() {
@@ -78,7 +83,8 @@ void CommandBufferQueue::flush() noexcept {
     circularBuffer.circularize();
 
     std::unique_lock<utils::Mutex> lock(mLock);
-    mCommandBuffersToExecute.push_back({ tail, head });
+    mCommandBuffersToExecute.push_back({ tail, head, std::move(mRetainedSecondaryBuffers) });
+    mRetainedSecondaryBuffers.clear();
 
     // circular buffer is too small, we corrupted the stream
     assert(used <= mFreeSpace);
@@ -127,11 +133,33 @@ std::vector<CommandBufferQueue::Slice> CommandBufferQueue::waitForCommands() con
 }
 
 void CommandBufferQueue::releaseBuffer(CommandBufferQueue::Slice const& buffer) {
+    if (!buffer.secondaryBuffers.empty()) {
+        std::lock_guard<utils::Mutex> guard(mSecondaryLock);
+        mFreeSecondaryBuffers.insert(mFreeSecondaryBuffers.end(),
+                buffer.secondaryBuffers.begin(), buffer.secondaryBuffers.end());
+    }
+
     std::unique_lock<utils::Mutex> lock(mLock);
     mFreeSpace += uintptr_t(buffer.end) - uintptr_t(buffer.begin);
     lock.unlock();
     mCondition.notify_one();
 }
 
+void* CommandBufferQueue::acquireSecondaryBuffer() {
+    std::unique_lock<utils::Mutex> lock(mSecondaryLock);
+    if (UTILS_LIKELY(!mFreeSecondaryBuffers.empty())) {
+        void* const buffer = mFreeSecondaryBuffers.back();
+        mFreeSecondaryBuffers.pop_back();
+        return buffer;
+    }
+    lock.unlock();
+    return utils::aligned_alloc(SECONDARY_BUFFER_SIZE, alignof(std::max_align_t));
+}
+
+void CommandBufferQueue::retainSecondaryBuffer(void* buffer) {
+    // mRetainedSecondaryBuffers is only accessed from the flush() thread
+    mRetainedSecondaryBuffers.push_back(buffer);
+}
+
 } // namespace backend
 } // namespace filament
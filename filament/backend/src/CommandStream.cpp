@@ -107,6 +107,21 @@ void CommandStream::execute(void* buffer) {
     }
 }
 
+void CommandStream::insert(SecondaryCommandStream& secondary) noexcept {
+    assert(secondary.mData);
+
+    // jump to the commands of the secondary buffer...
+    const size_t size = CommandBase::align(sizeof(NoopCommand));
+    char* const p = static_cast<char*>(allocateCommand(size));
+    new(p) NoopCommand(secondary.mBuffer.getTail());
+
+    // ...which jump back here once executed. getAvailableSize() keeps room for this command.
+    new(secondary.mBuffer.allocate(size)) NoopCommand(p + size);
+
+    secondary.mQueue.retainSecondaryBuffer(secondary.mData);
+    secondary.mData = nullptr;
+}
+
 void CommandStream::queueCommand(std::function<void()> command) {
     new(allocateCommand(CustomCommand::align(sizeof(CustomCommand)))) CustomCommand(std::move(command));
 }
@@ -146,6 +161,22 @@ void CommandType<void (Driver::*)(ARGS...)>::Command<METHOD>::log() noexcept  {
 
 // ------------------------------------------------------------------------------------------------
 
+SecondaryCommandStream::SecondaryCommandStream(Driver& driver, CommandBufferQueue& queue)
+        : mQueue(queue),
+          mData(queue.acquireSecondaryBuffer()),
+          mBuffer(mData, CommandBufferQueue::SECONDARY_BUFFER_SIZE),
+          mStream(driver, mBuffer) {
+}
+
+SecondaryCommandStream::~SecondaryCommandStream() noexcept {
+    if (UTILS_UNLIKELY(mData)) {
+        // never inserted, the buffer just goes back to the queue with the next flush()
+        mQueue.retainSecondaryBuffer(mData);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+
 void CustomCommand::execute(Driver&, CommandBase* base, intptr_t* next) noexcept {
     *next = CustomCommand::align(sizeof(CustomCommand));
     static_cast<CustomCommand*>(base)->mCommand();
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HandleAllocator.h"
+
+#include <utils/memalign.h>
+#include <utils/Panic.h>
+
+#include <mutex>
+
+namespace filament {
+namespace backend {
+
+using namespace utils;
+
+template <size_t P0, size_t P1, size_t P2>
+HandleAllocator<P0, P1, P2>::Allocator::Allocator(const utils::HeapArea& area)
+        : mPool0(area.begin(),
+                 pointermath::add(area.begin(), (1 * area.getSize()) / 16)),
+          mPool1(pointermath::add(area.begin(), (1 * area.getSize()) / 16),
+                 pointermath::add(area.begin(), (6 * area.getSize()) / 16)),
+          mPool2(pointermath::add(area.begin(), (6 * area.getSize()) / 16),
+                 area.end()) {
+}
+
+template <size_t P0, size_t P1, size_t P2>
+void* HandleAllocator<P0, P1, P2>::Allocator::alloc(size_t size, size_t, size_t extra) noexcept {
+    assert(size <= mPool2.getSize());
+    if (size <= mPool0.getSize()) return mPool0.alloc(size, 16, extra);
+    if (size <= mPool1.getSize()) return mPool1.alloc(size, 32, extra);
+    if (size <= mPool2.getSize()) return mPool2.alloc(size, 32, extra);
+    return nullptr;
+}
+
+template <size_t P0, size_t P1, size_t P2>
+void HandleAllocator<P0, P1, P2>::Allocator::free(void* p, size_t size) noexcept {
+    if (size <= mPool0.getSize()) { mPool0.free(p); return; }
+    if (size <= mPool1.getSize()) { mPool1.free(p); return; }
+    if (size <= mPool2.getSize()) { mPool2.free(p); return; }
+}
+
+// ------------------------------------------------------------------------------------------------
+
+template <size_t P0, size_t P1, size_t P2>
+HandleAllocator<P0, P1, P2>::HandleAllocator(const char* name, size_t size) noexcept
+        : mHandleArena(name, size) {
+}
+
+// This is "NOINLINE" because it ends-up generating more code than we'd like because of
+// the locking (unfortunately, mHandleArena is accessed from 2 threads)
+template <size_t P0, size_t P1, size_t P2>
+UTILS_NOINLINE
+HandleBase::HandleId HandleAllocator<P0, P1, P2>::allocateHandleInPool(size_t size) noexcept {
+    void* addr = mHandleArena.alloc(size);
+    if (UTILS_UNLIKELY(!addr)) {
+        return allocateHandleSlow(size);
+    }
+    char* const base = (char*)mHandleArena.getArea().begin();
+    size_t offset = (char*)addr - base;
+    assert(isPoolHandle(HandleBase::HandleId(offset >> MIN_ALIGNMENT_SHIFT)));
+    return HandleBase::HandleId(offset >> MIN_ALIGNMENT_SHIFT);
+}
+
+template <size_t P0, size_t P1, size_t P2>
+UTILS_NOINLINE
+HandleBase::HandleId HandleAllocator<P0, P1, P2>::allocateHandleSlow(size_t size) noexcept {
+    void* addr = utils::aligned_alloc(size, 1u << MIN_ALIGNMENT_SHIFT);
+    ASSERT_POSTCONDITION(addr, "Out of memory allocating a handle (%zu bytes requested)", size);
+
+    std::lock_guard<utils::Mutex> guard(mOverflowLock);
+    if (UTILS_UNLIKELY(mOverflowId == HEAP_HANDLE_FLAG)) {
+        slog.w << "HandleAllocator arena is full, using slower system heap. "
+                  "Please increase the arena size." << io::endl;
+    }
+    // ids are never reused, the flag keeps them apart from the ids of the arena
+    const HandleBase::HandleId id = ++mOverflowId | HEAP_HANDLE_FLAG;
+    ASSERT_POSTCONDITION(id != HandleBase::nullid, "Out of heap handle ids");
+    mOverflowMap.emplace(id, addr);
+    return id;
+}
+
+template <size_t P0, size_t P1, size_t P2>
+UTILS_NOINLINE
+void HandleAllocator<P0, P1, P2>::deallocateHandleSlow(HandleBase::HandleId id, void* p) noexcept {
+    std::lock_guard<utils::Mutex> guard(mOverflowLock);
+    auto pos = mOverflowMap.find(id);
+    assert(pos != mOverflowMap.end() && pos->second == p);
+    mOverflowMap.erase(pos);
+    utils::aligned_free(p);
+}
+
+template <size_t P0, size_t P1, size_t P2>
+UTILS_NOINLINE
+void* HandleAllocator<P0, P1, P2>::handleToPointerSlow(HandleBase::HandleId id) const noexcept {
+    std::lock_guard<utils::Mutex> guard(mOverflowLock);
+    auto pos = mOverflowMap.find(id);
+    return pos != mOverflowMap.end() ? pos->second : nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Explicit template instantiations.
+// ------------------------------------------------------------------------------------------------
+
+template class HandleAllocator<16,  64, 208>;   // HandleAllocatorGL
+template class HandleAllocator<16,  64, 576>;   // HandleAllocatorVK
+
+} // namespace backend
+} // namespace filament
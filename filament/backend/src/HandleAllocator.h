@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+#define TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+
+#include <backend/Handle.h>
+
+#include <utils/Allocator.h>
+#include <utils/compiler.h>
+#include <utils/Log.h>
+#include <utils/Mutex.h>
+
+#include <exception>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace filament {
+namespace backend {
+
+/*
+ * A handle allocator shared by the backends.
+ *
+ * All handles live in a single pre-allocated arena, split in three pools of increasing element
+ * size (P0 < P1 < P2), each backend chooses the sizes that fit its concrete handle types.
+ * A handle id is the offset of its object in the arena, so handle_cast() is a simple addition
+ * and never takes a lock. Only allocation and deallocation are serialized (with a spin-lock),
+ * because handles are allocated on the main thread and freed on the driver thread.
+ *
+ * When a pool is exhausted, handles are allocated on the heap instead. These are flagged in
+ * their id, and handle_cast() looks them up in a map under a lock, which is slower but keeps
+ * working with any number of handles.
+ *
+ * In debug builds with RTTI, the concrete type of each handle is recorded and checked when
+ * the handle is destroyed.
+ */
+template <size_t P0, size_t P1, size_t P2>
+class HandleAllocator {
+public:
+
+    HandleAllocator(const char* name, size_t size) noexcept;
+    HandleAllocator(HandleAllocator const& rhs) = delete;
+    HandleAllocator& operator=(HandleAllocator const& rhs) = delete;
+
+    /*
+     * Allocates a handle and default-constructs (or constructs with the given arguments)
+     * its concrete object in place.
+     */
+    template<typename D, typename ... ARGS>
+    Handle<D> allocateAndConstruct(ARGS&& ... args) noexcept {
+        Handle<D> h{ allocateHandle<D>() };
+        D* addr = handle_cast<D*>(h);
+        new(addr) D(std::forward<ARGS>(args)...);
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+        addr->typeId = typeid(D).name();
+#endif
+        return h;
+    }
+
+    /*
+     * Allocates a handle without constructing its object, construct() must be called before
+     * the handle is used.
+     */
+    template<typename D>
+    Handle<D> allocate() noexcept {
+        return Handle<D>{ allocateHandle<D>() };
+    }
+
+    /*
+     * Constructs the object of a handle returned by allocate().
+     */
+    template<typename D, typename B, typename ... ARGS>
+    typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
+    construct(Handle<B> const& handle, ARGS&& ... args) noexcept {
+        assert(handle);
+        D* addr = handle_cast<D*>(const_cast<Handle<B>&>(handle));
+        new(addr) D(std::forward<ARGS>(args)...);
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+        addr->typeId = typeid(D).name();
+#endif
+        return addr;
+    }
+
+    /*
+     * Replaces the object of a handle returned by allocateAndConstruct().
+     */
+    template<typename D, typename B, typename ... ARGS>
+    typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
+    destroyAndConstruct(Handle<B> const& handle, ARGS&& ... args) noexcept {
+        assert(handle);
+        D* addr = handle_cast<D*>(const_cast<Handle<B>&>(handle));
+        // currently we implement this with dtor+ctor, we could use operator= also
+        // but all our dtors are trivial, ~D() is actually a noop.
+        addr->~D();
+        new(addr) D(std::forward<ARGS>(args)...);
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+        addr->typeId = typeid(D).name();
+#endif
+        return addr;
+    }
+
+    /*
+     * Destroys the object of a handle and returns its storage to the pool. Like operator
+     * delete, this is a no-op for a null object.
+     */
+    template<typename B, typename D,
+            typename = typename std::enable_if<std::is_base_of<B, D>::value, D>::type>
+    void deallocate(Handle<B>& handle, D const* p) noexcept {
+        if (p) {
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+            if (UTILS_UNLIKELY(p->typeId != typeid(D).name())) {
+                utils::slog.e << "Destroying handle " << handle.getId() << ", type "
+                        << typeid(D).name() << ", but handle's actual type is " << p->typeId
+                        << utils::io::endl;
+                std::terminate();
+            }
+            const_cast<D*>(p)->typeId = "(deleted)";
+#endif
+            p->~D();
+            if (UTILS_LIKELY(isPoolHandle(handle.getId()))) {
+                mHandleArena.free(const_cast<D*>(p), sizeof(D));
+            } else {
+                deallocateHandleSlow(handle.getId(), const_cast<D*>(p));
+            }
+        }
+    }
+
+    template<typename D>
+    void deallocate(Handle<D>& handle) noexcept {
+        deallocate(handle, handle_cast<D const*>(handle));
+    }
+
+    /*
+     * handle_cast
+     *
+     * casts a Handle<> to a pointer to the data it refers to. This doesn't take any lock.
+     */
+
+    template<typename Dp, typename B>
+    inline
+    typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
+    handle_cast(Handle<B>& handle) noexcept {
+        assert(handle);
+        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
+        if (UTILS_UNLIKELY(!isPoolHandle(handle.getId()))) {
+            return static_cast<Dp>(handleToPointerSlow(handle.getId()));
+        }
+        char* const base = (char*)mHandleArena.getArea().begin();
+        size_t offset = size_t(handle.getId()) << MIN_ALIGNMENT_SHIFT;
+        // assert that this handle is even a valid one
+        assert(base + offset + sizeof(typename std::remove_pointer<Dp>::type)
+                <= (char*)mHandleArena.getArea().end());
+        return static_cast<Dp>(static_cast<void*>(base + offset));
+    }
+
+    template<typename Dp, typename B>
+    inline
+    typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
+    handle_cast(Handle<B> const& handle) noexcept {
+        return handle_cast<Dp>(const_cast<Handle<B>&>(handle));
+    }
+
+private:
+    static constexpr size_t MIN_ALIGNMENT_SHIFT = 4;
+
+    // set in the id of handles allocated on the heap, see allocateHandleSlow()
+    static constexpr HandleBase::HandleId HEAP_HANDLE_FLAG = 0x80000000u;
+
+    static bool isPoolHandle(HandleBase::HandleId id) noexcept {
+        return (id & HEAP_HANDLE_FLAG) == 0;
+    }
+
+    // handle ids are offsets in units of the minimum alignment
+    static_assert(P0 % (1u << MIN_ALIGNMENT_SHIFT) == 0 &&
+                  P1 % (1u << MIN_ALIGNMENT_SHIFT) == 0 &&
+                  P2 % (1u << MIN_ALIGNMENT_SHIFT) == 0,
+            "pool sizes must be multiples of the minimum alignment");
+    static_assert(P0 < P1 && P1 < P2, "pool sizes must be increasing");
+
+    class Allocator {
+        utils::PoolAllocator<P0, 16> mPool0;
+        utils::PoolAllocator<P1, 32> mPool1;
+        utils::PoolAllocator<P2, 32> mPool2;
+    public:
+        explicit Allocator(const utils::HeapArea& area);
+        void* alloc(size_t size, size_t alignment, size_t extra = 0) noexcept;
+        void free(void* p, size_t size) noexcept;
+    };
+
+    // the arena for handle allocation needs to be thread-safe
+#ifndef NDEBUG
+    using HandleArena = utils::Arena<Allocator,
+            utils::LockingPolicy::SpinLock,
+            utils::TrackingPolicy::Debug>;
+#else
+    using HandleArena = utils::Arena<Allocator,
+            utils::LockingPolicy::SpinLock>;
+#endif
+
+    template<typename D>
+    HandleBase::HandleId allocateHandle() noexcept {
+        static_assert(sizeof(D) <= P2, "Handle<> too large");
+        return allocateHandleInPool(sizeof(D));
+    }
+
+    HandleBase::HandleId allocateHandleInPool(size_t size) noexcept;
+
+    // heap allocation, used when the pool of a handle's size is exhausted
+    HandleBase::HandleId allocateHandleSlow(size_t size) noexcept;
+    void deallocateHandleSlow(HandleBase::HandleId id, void* p) noexcept;
+    void* handleToPointerSlow(HandleBase::HandleId id) const noexcept;
+
+    HandleArena mHandleArena;
+
+    // handles allocated on the heap
+    mutable utils::Mutex mOverflowLock;
+    std::unordered_map<HandleBase::HandleId, void*> mOverflowMap;
+    HandleBase::HandleId mOverflowId = HEAP_HANDLE_FLAG;
+};
+
+// Pool sizes used by each backend, the largest pool must fit the largest concrete handle type.
+using HandleAllocatorGL = HandleAllocator<16,  64, 208>;
+using HandleAllocatorVK = HandleAllocator<16,  64, 576>;
+
+} // namespace backend
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
@@ -290,6 +290,10 @@ void NoopDriver::blit(TargetBufferFlags buffers,
 void NoopDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> rph) {
 }
 
+void NoopDriver::drawInstanced(PipelineState pipelineState, Handle<HwRenderPrimitive> rph,
+        uint32_t instanceCount) {
+}
+
 void NoopDriver::beginTimerQuery(Handle<HwTimerQuery> tqh) {
 }
 
@@ -19,6 +19,7 @@
 
 #include "private/backend/Driver.h"
 #include "DriverBase.h"
+#include "HandleAllocator.h"
 #include "OpenGLContext.h"
 
 #include <utils/compiler.h>
@@ -240,42 +241,24 @@ private:
 
     // Memory management...
 
-    class HandleAllocator {
-        utils::PoolAllocator< 16, 16>   mPool0;
-        utils::PoolAllocator< 64, 32>   mPool1;
-        utils::PoolAllocator<208, 32>   mPool2;
-    public:
-        static constexpr size_t MIN_ALIGNMENT_SHIFT = 4;
-        explicit HandleAllocator(const utils::HeapArea& area);
-        void* alloc(size_t size, size_t alignment, size_t extra = 0) noexcept;
-        void free(void* p, size_t size) noexcept;
-    };
-
-    // the arenas for handle allocation needs to be thread-safe
-#ifndef NDEBUG
-    using HandleArena = utils::Arena<HandleAllocator,
-            utils::LockingPolicy::SpinLock,
-            utils::TrackingPolicy::Debug>;
-#else
-    using HandleArena = utils::Arena<HandleAllocator,
-            utils::LockingPolicy::SpinLock>;
-#endif
-
-    HandleArena mHandleArena;
-
-    backend::HandleBase::HandleId allocateHandle(size_t size) noexcept;
+    backend::HandleAllocatorGL mHandleAllocator;
 
     template<typename D, typename ... ARGS>
-    backend::Handle<D> initHandle(ARGS&& ... args) noexcept;
+    backend::Handle<D> initHandle(ARGS&& ... args) noexcept {
+        return mHandleAllocator.allocateAndConstruct<D>(std::forward<ARGS>(args) ...);
+    }
 
     template<typename D, typename B, typename ... ARGS>
     typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
-            construct(backend::Handle<B> const& handle, ARGS&& ... args) noexcept;
+    construct(backend::Handle<B> const& handle, ARGS&& ... args) noexcept {
+        return mHandleAllocator.destroyAndConstruct<D, B>(handle, std::forward<ARGS>(args) ...);
+    }
 
     template<typename B, typename D,
             typename = typename std::enable_if<std::is_base_of<B, D>::value, D>::type>
-    void destruct(backend::Handle<B>& handle, D const* p) noexcept;
-
+    void destruct(backend::Handle<B>& handle, D const* p) noexcept {
+        mHandleAllocator.deallocate(handle, p);
+    }
 
     /*
      * handle_cast
@@ -289,13 +272,7 @@ private:
             std::is_pointer<Dp>::value &&
             std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
     handle_cast(backend::Handle<B>& handle) noexcept {
-        assert(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        char* const base = (char *)mHandleArena.getArea().begin();
-        size_t offset = handle.getId() << HandleAllocator::MIN_ALIGNMENT_SHIFT;
-        // assert that this handle is even a valid one
-        assert(base + offset + sizeof(typename std::remove_pointer<Dp>::type) <= (char *)mHandleArena.getArea().end());
-        return static_cast<Dp>(static_cast<void *>(base + offset));
+        return mHandleAllocator.handle_cast<Dp>(handle);
     }
 
     template<typename Dp, typename B>
@@ -304,7 +281,7 @@ private:
             std::is_pointer<Dp>::value &&
             std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
     handle_cast(backend::Handle<B> const& handle) noexcept {
-        return handle_cast<Dp>(const_cast<backend::Handle<B>&>(handle));
+        return mHandleAllocator.handle_cast<Dp>(handle);
     }
 
     friend class OpenGLProgram;
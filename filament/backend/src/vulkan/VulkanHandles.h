@@ -61,6 +61,9 @@ struct VulkanRenderTarget : private HwRenderTarget {
     int getColorTargetCount() const;
     bool invalidate();
     uint8_t getSamples() const { return mSamples; }
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+    using HwBase::typeId; // needed by HandleAllocator
+#endif
 private:
     VulkanAttachment mColor[MRT::TARGET_COUNT] = {};
     VulkanAttachment mDepth = {};
@@ -41,6 +41,7 @@ protected:
     std::vector<float3> boxesCenter;
     std::vector<float3> boxesExtent;
     std::vector<float4> spheres;
+    std::vector<Culler::AabbBlock> boxes;
     Culler::result_type* UTILS_RESTRICT visibles = nullptr;
 
 
@@ -56,6 +57,7 @@ public:
         boxesCenter.resize(batch);
         boxesExtent.resize(batch);
         spheres.resize(batch);
+        boxes.resize(Culler::getBlockCount(batch));
         for (size_t i = 0; i < batch; i++) {
             float4& sphere = spheres[i];
             float z = std::fabs(rand(gen));
@@ -70,6 +72,7 @@ public:
                     rand(gen, std::uniform_real_distribution<float>::param_type{ 0.11f, 25.0f }),
                     rand(gen, std::uniform_real_distribution<float>::param_type{ 0.11f, 25.0f })
             };
+            Culler::setAabb(boxes.data(), i, boxesCenter[i], boxesExtent[i]);
         }
 
         visibles = (Culler::result_type*)utils::aligned_alloc(batch * sizeof(*visibles), 32);
@@ -103,3 +106,28 @@ BENCHMARK_F(FilamentFixture, sphereCulling)(benchmark::State& state) {
         state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
     }
 }
+
+// Culling of boxes stored in the SIMD friendly layout, the argument selects the
+// Culler::Implementation to use.
+BENCHMARK_DEFINE_F(FilamentFixture, boxCullingBlocks)(benchmark::State& state) {
+    const auto implementation = Culler::Implementation(state.range(0));
+    if (!Culler::isSupported(implementation)) {
+        state.SkipWithError("implementation not supported on this CPU");
+        return;
+    }
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            Culler::Test::intersects(visibles, frustum, boxes.data(), BATCH_SIZE, implementation);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+    }
+}
+
+BENCHMARK_REGISTER_F(FilamentFixture, boxCullingBlocks)
+        ->ArgName("impl")
+        ->Arg(int(Culler::Implementation::SCALAR))
+        ->Arg(int(Culler::Implementation::AVX2))
+        ->Arg(int(Culler::Implementation::NEON));
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "DriverBase.h"
+#include "HandleAllocator.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace filament;
+using namespace filament::backend;
+
+// Handle types of each of the allocator's size classes, none of them needs a GPU.
+struct SmallHandle : public HwBase {
+    uint32_t value = 0;
+};
+
+struct MediumHandle : public HwBase {
+    uint32_t value = 0;
+    uint8_t padding[40];
+};
+
+struct LargeHandle : public HwBase {
+    uint32_t value = 0;
+    uint8_t padding[160];
+};
+
+// The scheme the Vulkan backend used before: a map of blobs protected by a mutex, kept here as
+// a baseline.
+class HandleMap {
+public:
+    template<typename D>
+    Handle<D> allocateAndConstruct() {
+        std::lock_guard<std::mutex> lock(mLock);
+        Blob& blob = mMap[mNextId];
+        blob.resize(sizeof(D));
+        new(blob.data()) D();
+        return Handle<D>(mNextId++);
+    }
+
+    template<typename Dp, typename D>
+    Dp handle_cast(Handle<D> const& handle) {
+        std::lock_guard<std::mutex> lock(mLock);
+        return reinterpret_cast<Dp>(mMap.find(handle.getId())->second.data());
+    }
+
+    template<typename D>
+    void deallocate(Handle<D> const& handle) {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto iter = mMap.find(handle.getId());
+        reinterpret_cast<D*>(iter->second.data())->~D();
+        mMap.erase(iter);
+    }
+
+private:
+    using Blob = std::vector<uint8_t>;
+    std::unordered_map<HandleBase::HandleId, Blob> mMap;
+    std::mutex mLock;
+    HandleBase::HandleId mNextId = 1;
+};
+
+// A Vulkan allocator whose arena is too small for the benchmarks, so that most handles are
+// allocated on the heap.
+class HandleAllocatorVKOverflow : public HandleAllocatorVK {
+public:
+    HandleAllocatorVKOverflow() : HandleAllocatorVK("Handles", 64 * 1024) { }
+};
+
+template<typename T>
+class HandleAllocatorFixture : public benchmark::Fixture {
+protected:
+    static constexpr size_t COUNT = 4096;
+    T* allocator = nullptr;
+
+public:
+    void SetUp(const benchmark::State&) override;
+
+    void TearDown(const benchmark::State&) override {
+        delete allocator;
+        allocator = nullptr;
+    }
+
+    // allocates and frees COUNT handles of each size class
+    void allocFree(benchmark::State& state) {
+        std::vector<Handle<SmallHandle>> small(COUNT);
+        std::vector<Handle<MediumHandle>> medium(COUNT);
+        std::vector<Handle<LargeHandle>> large(COUNT);
+        {
+            PerformanceCounters pc(state);
+            for (auto _ : state) {
+                for (size_t i = 0; i < COUNT; i++) {
+                    small[i] = allocator->template allocateAndConstruct<SmallHandle>();
+                    medium[i] = allocator->template allocateAndConstruct<MediumHandle>();
+                    large[i] = allocator->template allocateAndConstruct<LargeHandle>();
+                }
+                for (size_t i = 0; i < COUNT; i++) {
+                    allocator->deallocate(small[i]);
+                    allocator->deallocate(medium[i]);
+                    allocator->deallocate(large[i]);
+                }
+            }
+            benchmark::ClobberMemory();
+            pc.stop();
+            state.SetItemsProcessed(state.iterations() * COUNT * 3);
+        }
+    }
+
+    // resolves COUNT handles of each size class, as the driver does when executing commands
+    void cast(benchmark::State& state) {
+        std::vector<Handle<SmallHandle>> small(COUNT);
+        std::vector<Handle<LargeHandle>> large(COUNT);
+        for (size_t i = 0; i < COUNT; i++) {
+            small[i] = allocator->template allocateAndConstruct<SmallHandle>();
+            large[i] = allocator->template allocateAndConstruct<LargeHandle>();
+        }
+        {
+            PerformanceCounters pc(state);
+            for (auto _ : state) {
+                uint32_t sum = 0;
+                for (size_t i = 0; i < COUNT; i++) {
+                    sum += allocator->template handle_cast<SmallHandle*>(small[i])->value;
+                    sum += allocator->template handle_cast<LargeHandle*>(large[i])->value;
+                }
+                benchmark::DoNotOptimize(sum);
+            }
+            benchmark::ClobberMemory();
+            pc.stop();
+            state.SetItemsProcessed(state.iterations() * COUNT * 2);
+        }
+        for (size_t i = 0; i < COUNT; i++) {
+            allocator->deallocate(small[i]);
+            allocator->deallocate(large[i]);
+        }
+    }
+};
+
+template<>
+void HandleAllocatorFixture<HandleAllocatorGL>::SetUp(const benchmark::State&) {
+    allocator = new HandleAllocatorGL("Handles", 8 * 1024 * 1024);
+}
+
+template<>
+void HandleAllocatorFixture<HandleAllocatorVK>::SetUp(const benchmark::State&) {
+    allocator = new HandleAllocatorVK("Handles", 8 * 1024 * 1024);
+}
+
+template<>
+void HandleAllocatorFixture<HandleAllocatorVKOverflow>::SetUp(const benchmark::State&) {
+    allocator = new HandleAllocatorVKOverflow();
+}
+
+template<>
+void HandleAllocatorFixture<HandleMap>::SetUp(const benchmark::State&) {
+    allocator = new HandleMap();
+}
+
+BENCHMARK_TEMPLATE_F(HandleAllocatorFixture, allocFree, HandleAllocatorGL)
+        (benchmark::State& state) {
+    allocFree(state);
+}
+
+BENCHMARK_TEMPLATE_F(HandleAllocatorFixture, allocFreeVK, HandleAllocatorVK)
+        (benchmark::State& state) {
+    allocFree(state);
+}
+
+BENCHMARK_TEMPLATE_F(HandleAllocatorFixture, allocFreeVKOverflow, HandleAllocatorVKOverflow)
+        (benchmark::State& state) {
+    allocFree(state);
+}
+
+BENCHMARK_TEMPLATE_F(HandleAllocatorFixture, allocFreeMap, HandleMap)(benchmark::State& state) {
+    allocFree(state);
+}
+
+BENCHMARK_TEMPLATE_F(HandleAllocatorFixture, cast, HandleAllocatorGL)(benchmark::State& state) {
+    cast(state);
+}
+
+BENCHMARK_TEMPLATE_F(HandleAllocatorFixture, castVK, HandleAllocatorVK)(benchmark::State& state) {
+    cast(state);
+}
+
+BENCHMARK_TEMPLATE_F(HandleAllocatorFixture, castVKOverflow, HandleAllocatorVKOverflow)
+        (benchmark::State& state) {
+    cast(state);
+}
+
+BENCHMARK_TEMPLATE_F(HandleAllocatorFixture, castMap, HandleMap)(benchmark::State& state) {
+    cast(state);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "RenderPass.h"
+
+#include "details/Allocators.h"
+
+#include <utils/JobSystem.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace utils;
+
+using Command = RenderPass::Command;
+using Pass = RenderPass::Pass;
+
+class RenderPassSortFixture : public benchmark::Fixture {
+protected:
+    JobSystem* js = nullptr;
+    LinearAllocatorArena* arena = nullptr;
+    std::vector<Command> commands;
+    std::vector<Command> unsorted;
+
+public:
+    // Generates keys resembling the color and depth passes of a large scene: color commands
+    // keyed by z-bucket and material, depth commands by distance, plus a few sentinels.
+    void SetUp(const benchmark::State& state) override {
+        js = new JobSystem();
+        js->adopt();
+
+        std::default_random_engine gen; // NOLINT
+        std::uniform_int_distribution<uint32_t> material(0, 255);
+        std::uniform_int_distribution<uint32_t> zbucket(0, 1023);
+        std::uniform_int_distribution<uint32_t> distance;
+
+        const size_t count = size_t(state.range(0));
+        unsorted.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            RenderPass::CommandKey key;
+            if (i % 2) {
+                key = uint64_t(Pass::COLOR) | uint64_t(RenderPass::CustomCommand::PASS);
+                key |= RenderPass::makeField(zbucket(gen),
+                        RenderPass::Z_BUCKET_MASK, RenderPass::Z_BUCKET_SHIFT);
+                key |= RenderPass::makeMaterialSortingKey(material(gen), material(gen));
+            } else {
+                key = uint64_t(Pass::DEPTH) | uint64_t(RenderPass::CustomCommand::PASS);
+                key |= RenderPass::makeField(distance(gen),
+                        RenderPass::DISTANCE_BITS_MASK, RenderPass::DISTANCE_BITS_SHIFT);
+            }
+            unsorted[i].key = (i % 4096 == 4095) ? uint64_t(Pass::SENTINEL) : key;
+        }
+        commands.resize(count);
+
+        // the radix sort needs about 36 bytes of scratch memory per command
+        arena = new LinearAllocatorArena("sort", count * 64 + 1024 * 1024);
+    }
+
+    void TearDown(const benchmark::State&) override {
+        delete arena;
+        arena = nullptr;
+        js->emancipate();
+        delete js;
+        js = nullptr;
+        commands.clear();
+        unsorted.clear();
+    }
+};
+
+// Both benchmarks include the cost of restoring the unsorted commands.
+
+BENCHMARK_DEFINE_F(RenderPassSortFixture, stdSort)(benchmark::State& state) {
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            std::copy(unsorted.begin(), unsorted.end(), commands.begin());
+            std::sort(commands.begin(), commands.end());
+            benchmark::DoNotOptimize(std::partition_point(commands.begin(), commands.end(),
+                    [](Command const& c) { return c.key != uint64_t(Pass::SENTINEL); }));
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK_DEFINE_F(RenderPassSortFixture, radixSort)(benchmark::State& state) {
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            std::copy(unsorted.begin(), unsorted.end(), commands.begin());
+            filament::ArenaScope scope(*arena);
+            benchmark::DoNotOptimize(RenderPass::radixSortCommands(*js, scope,
+                    commands.data(), uint32_t(commands.size())));
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK_REGISTER_F(RenderPassSortFixture, stdSort)
+        ->RangeMultiplier(4)->Range(4096, 1 << 20)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_REGISTER_F(RenderPassSortFixture, radixSort)
+        ->RangeMultiplier(4)->Range(4096, 1 << 20)->Unit(benchmark::kMicrosecond);
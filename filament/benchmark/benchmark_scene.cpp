@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <filament/Box.h>
+#include <filament/Engine.h>
+#include <filament/RenderableManager.h>
+#include <filament/Scene.h>
+#include <filament/TransformManager.h>
+
+#include "details/Engine.h"
+#include "details/Scene.h"
+
+#include <utils/EntityManager.h>
+
+#include <vector>
+#include <random>
+
+using namespace filament;
+using namespace filament::math;
+using namespace utils;
+
+class SceneFixture : public benchmark::Fixture {
+protected:
+    static constexpr size_t ENTITY_COUNT = 50000;
+
+    Engine* engine = nullptr;
+    Scene* scene = nullptr;
+    std::vector<Entity> entities;
+    std::vector<mat4f> transforms;
+
+public:
+    void SetUp(const benchmark::State&) override {
+        engine = Engine::create(Engine::Backend::NOOP);
+        scene = engine->createScene();
+
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> rand(-100.0f, 100.0f);
+
+        auto& tcm = engine->getTransformManager();
+        entities.resize(ENTITY_COUNT);
+        transforms.resize(ENTITY_COUNT);
+        EntityManager::get().create(ENTITY_COUNT, entities.data());
+        for (size_t i = 0; i < ENTITY_COUNT; i++) {
+            Entity e = entities[i];
+            transforms[i] = mat4f::translation(float3{ rand(gen), rand(gen), rand(gen) });
+            RenderableManager::Builder(0)
+                    .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+                    .build(*engine, e);
+            tcm.setTransform(tcm.getInstance(e), transforms[i]);
+        }
+        scene->addEntities(entities.data(), entities.size());
+
+        // the first prepare() gathers everything
+        upcast(scene)->prepare({});
+    }
+
+    void TearDown(const benchmark::State&) override {
+        engine->destroy(scene);
+        for (Entity e : entities) {
+            engine->destroy(e);
+        }
+        EntityManager::get().destroy(entities.size(), entities.data());
+        entities.clear();
+        transforms.clear();
+        Engine::destroy(&engine);
+    }
+};
+
+// Measures FScene::prepare() as a function of the percentage of entities which transform
+// changed since the previous call.
+BENCHMARK_DEFINE_F(SceneFixture, prepare)(benchmark::State& state) {
+    auto& tcm = engine->getTransformManager();
+    FScene* const s = upcast(scene);
+    const size_t dirtyPercent = size_t(state.range(0));
+    const size_t stride = dirtyPercent ? 100 / dirtyPercent : 0;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            if (stride) {
+                state.PauseTiming();
+                for (size_t i = 0; i < ENTITY_COUNT; i += stride) {
+                    tcm.setTransform(tcm.getInstance(entities[i]), transforms[i]);
+                }
+                state.ResumeTiming();
+            }
+            s->prepare({});
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * ENTITY_COUNT);
+    }
+}
+
+BENCHMARK_REGISTER_F(SceneFixture, prepare)
+        ->Arg(0)->Arg(1)->Arg(10)->Arg(25)->Arg(50)->Arg(100)
+        ->Unit(benchmark::kMicrosecond);
+
+// Measures FScene::prepare() when everything needs to be gathered again, here by changing
+// the world origin at each call.
+BENCHMARK_F(SceneFixture, prepareAll)(benchmark::State& state) {
+    FScene* const s = upcast(scene);
+    const mat4f origins[2] = { mat4f{}, mat4f::translation(float3{ 1, 0, 0 }) };
+    size_t frame = 0;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            s->prepare(origins[frame++ & 1u]);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * ENTITY_COUNT);
+    }
+}
@@ -24,6 +24,7 @@
 
 #include <backend/DriverEnums.h>
 
+#include <utils/BitmaskEnum.h>
 #include <utils/compiler.h>
 
 #include <math/mathfwd.h>
@@ -128,6 +129,54 @@ public:
      */
     MaterialInstance* createInstance(const char* name = nullptr) const noexcept;
 
+    /**
+     * A callback used with compile(), invoked once all the shader programs of the material
+     * are ready.
+     *
+     * @param material  The material given to compile().
+     * @param user      User provided parameter given in compile().
+     */
+    using CompileCallback = void(*)(Material* material, void* user);
+
+    /**
+     * The features of the variants prepared by compile(). They can be combined.
+     */
+    enum class VariantFeature : uint8_t {
+        NONE                    = 0x00u,
+        DIRECTIONAL_LIGHTING    = 0x01u,    //!< lit by the directional light
+        DYNAMIC_LIGHTING        = 0x02u,    //!< lit by point and spot lights
+        SHADOW_RECEIVER         = 0x04u,    //!< receives shadows
+        SKINNING                = 0x08u,    //!< skinning or morphing
+        DEPTH                   = 0x10u,    //!< depth passes, e.g. shadow maps
+        FOG                     = 0x20u,    //!< fog
+        VSM                     = 0x40u,    //!< variance shadow maps
+        ALL                     = 0x7Fu
+    };
+
+    /**
+     * Prepares the shader programs of variants of this material in the background, so that
+     * drawing it for the first time doesn't stall the application.
+     *
+     * The shaders are extracted from the material package on the engine's JobSystem, and
+     * the programs are then created a few at a time, at each Renderer::beginFrame(). A variant
+     * that is drawn before its program is created is created right away, as if compile() hadn't
+     * been called.
+     *
+     * Calling compile() again while the programs are being prepared adds the variants that
+     * weren't requested yet and the callback.
+     *
+     * @param variants  The variants to prepare, those using only these features. For instance
+     *                  DIRECTIONAL_LIGHTING | SHADOW_RECEIVER prepares the variants used to
+     *                  draw with the directional light only, with or without shadows. Post-process
+     *                  materials always prepare all their variants.
+     * @param callback  Optional callback, invoked from Renderer::beginFrame() once all the
+     *                  programs are created. It is not invoked if the material is destroyed
+     *                  before that.
+     * @param user      A user provided pointer that is given back to callback unmodified.
+     */
+    void compile(VariantFeature variants = VariantFeature::ALL,
+            CompileCallback callback = nullptr, void* user = nullptr) noexcept;
+
     //! Returns the name of this material as a null-terminated string.
     const char* getName() const noexcept;
 
@@ -276,4 +325,7 @@ public:
 
 } // namespace filament
 
+template<> struct utils::EnableBitMaskOperators<filament::Material::VariantFeature>
+        : public std::true_type {};
+
 #endif // TNT_FILAMENT_MATERIAL_H
@@ -156,6 +156,29 @@ public:
      * @return Whether the given entity is in the Scene.
      */
     bool hasEntity(utils::Entity entity) const noexcept;
+
+    /**
+     * Enables or disables the use of a spatial hierarchy for culling the Scene's renderables.
+     *
+     * When enabled, the Scene maintains a bounding volume hierarchy of its renderables' world
+     * space bounding boxes, which allows culling to reject entire groups of renderables at once.
+     * This is beneficial to scenes with a large number of renderables, only a small fraction of
+     * which is visible at any given time, and which are mostly static. For small or very dynamic
+     * scenes, the cost of maintaining the hierarchy can exceed its benefits.
+     *
+     * Disabled by default.
+     *
+     * @param enabled true to enable the culling hierarchy, false to disable it.
+     */
+    void setCullingHierarchyEnabled(bool enabled) noexcept;
+
+    /**
+     * Returns whether the culling hierarchy is enabled.
+     *
+     * @return true if the culling hierarchy is enabled, false otherwise.
+     * @see setCullingHierarchyEnabled
+     */
+    bool isCullingHierarchyEnabled() const noexcept;
 };
 
 } // namespace filament
@@ -202,6 +202,23 @@ public:
      */
     void setTransform(Instance ci, const math::mat4f& localTransform) noexcept;
 
+    /**
+     * Sets the local transform of several transform components at once.
+     *
+     * This is equivalent to calling setTransform() for each component within a local transform
+     * transaction, which is committed before this returns unless one was already open. World
+     * transforms are then updated only once, one level of the hierarchy at a time, and large
+     * levels are updated in parallel.
+     *
+     * @param instances         The instances of the transform components to set the local
+     *                          transform of.
+     * @param localTransforms   The local transforms, one for each instance.
+     * @param count             The number of instances and local transforms.
+     * @see setTransform(), openLocalTransformTransaction()
+     */
+    void setTransforms(Instance const* instances, const math::mat4f* localTransforms,
+            size_t count) noexcept;
+
     /**
      * Returns the local transform of a transform component.
      * @param ci The instance of the transform component to query the local transform from.
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/Bvh.h"
+
+#include <filament/Frustum.h>
+
+#include <utils/Systrace.h>
+
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <limits>
+
+using namespace filament::math;
+
+namespace filament {
+
+using AabbBlock = Culler::AabbBlock;
+using result_type = Culler::result_type;
+
+static inline void getAabb(AabbBlock const* boxes, size_t index,
+        float3& center, float3& extent) noexcept {
+    AabbBlock const& block = boxes[index / Culler::MODULO];
+    const size_t lane = index % Culler::MODULO;
+    center = { block.cx[lane], block.cy[lane], block.cz[lane] };
+    extent = { block.ex[lane], block.ey[lane], block.ez[lane] };
+}
+
+void Bvh::clear() noexcept {
+    mNodes.clear();
+    mIndices.clear();
+    mLeafOf.clear();
+    mPrimitiveCount = 0;
+    mMovedSinceBuild = 0;
+}
+
+void Bvh::build(AabbBlock const* boxes, size_t count) noexcept {
+    SYSTRACE_CALL();
+
+    clear();
+    if (count == 0) {
+        return;
+    }
+
+    mPrimitiveCount = count;
+    mIndices.resize(count);
+    mLeafOf.resize(count);
+    mCenters.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        float3 extent;
+        getAabb(boxes, i, mCenters[i], extent);
+        mIndices[i] = uint32_t(i);
+    }
+
+    // leaves hold at least half of LEAF_SIZE primitives (except for tiny trees)
+    mNodes.reserve(2 * (count / (LEAF_SIZE / 2) + 1));
+    buildNode(boxes, 0, 0, uint32_t(count));
+}
+
+uint32_t Bvh::buildNode(AabbBlock const* boxes,
+        uint32_t parent, uint32_t first, uint32_t count) noexcept {
+    const uint32_t index = uint32_t(mNodes.size());
+    mNodes.push_back({ {}, first, {}, count, 0, parent });
+
+    if (count <= LEAF_SIZE) {
+        for (uint32_t i = first; i < first + count; i++) {
+            mLeafOf[mIndices[i]] = index;
+        }
+        updateLeaf(boxes, mNodes[index]);
+        return index;
+    }
+
+    // split at the median along the largest axis of the centers' bounds
+    float3 cmin{ std::numeric_limits<float>::max() };
+    float3 cmax{ std::numeric_limits<float>::lowest() };
+    for (uint32_t i = first; i < first + count; i++) {
+        float3 const& c = mCenters[mIndices[i]];
+        cmin = min(cmin, c);
+        cmax = max(cmax, c);
+    }
+    const float3 size = cmax - cmin;
+    const size_t axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+
+    const uint32_t half = count / 2;
+    float3 const* const centers = mCenters.data();
+    std::nth_element(mIndices.begin() + first, mIndices.begin() + first + half,
+            mIndices.begin() + first + count, [centers, axis](uint32_t lhs, uint32_t rhs) {
+                return centers[lhs][axis] < centers[rhs][axis];
+            });
+
+    const uint32_t left = buildNode(boxes, index, first, half);
+    const uint32_t right = buildNode(boxes, index, first + half, count - half);
+
+    Node& node = mNodes[index];
+    node.min = min(mNodes[left].min, mNodes[right].min);
+    node.max = max(mNodes[left].max, mNodes[right].max);
+    node.right = right;
+    return index;
+}
+
+void Bvh::updateLeaf(AabbBlock const* boxes, Node& node) noexcept {
+    float3 bmin{ std::numeric_limits<float>::max() };
+    float3 bmax{ std::numeric_limits<float>::lowest() };
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        float3 center, extent;
+        getAabb(boxes, mIndices[i], center, extent);
+        bmin = min(bmin, center - extent);
+        bmax = max(bmax, center + extent);
+    }
+    node.min = bmin;
+    node.max = bmax;
+}
+
+void Bvh::refit(AabbBlock const* boxes, uint8_t* dirty) noexcept {
+    SYSTRACE_CALL();
+
+    Node* const nodes = mNodes.data();
+    for (size_t i = 0, c = mPrimitiveCount; i < c; i++) {
+        if (!dirty[i]) {
+            continue;
+        }
+        dirty[i] = 0;
+        mMovedSinceBuild++;
+
+        uint32_t n = mLeafOf[i];
+        updateLeaf(boxes, nodes[n]);
+
+        // propagate to the ancestors, we can stop as soon as a node's bounds don't change
+        while (n != 0) {
+            n = nodes[n].parent;
+            Node& node = nodes[n];
+            const float3 bmin = min(nodes[n + 1].min, nodes[node.right].min);
+            const float3 bmax = max(nodes[n + 1].max, nodes[node.right].max);
+            if (bmin == node.min && bmax == node.max) {
+                break;
+            }
+            node.min = bmin;
+            node.max = bmax;
+        }
+    }
+}
+
+void Bvh::cull(result_type* UTILS_RESTRICT results, Frustum const& frustum,
+        AabbBlock const* UTILS_RESTRICT boxes, size_t bit) const noexcept {
+    SYSTRACE_CALL();
+
+    if (mNodes.empty()) {
+        return;
+    }
+
+    float4 const* const planes = frustum.getNormalizedPlanes();
+    Node const* const nodes = mNodes.data();
+    uint32_t const* const indices = mIndices.data();
+    const result_type visible = result_type(1u << bit);
+
+    // Each entry carries the set of planes the node still needs to be tested against, planes
+    // are dropped as soon as a node is entirely on their inner side.
+    struct Entry {
+        uint32_t node;
+        uint32_t planes;
+    };
+
+    // the tree is balanced, so its depth is at most log2(primitive count) + 1
+    Entry stack[64];
+    size_t sp = 0;
+    stack[sp++] = { 0, 0x3Fu };
+
+    while (sp) {
+        const Entry entry = stack[--sp];
+        Node const& node = nodes[entry.node];
+
+        const float3 center = (node.max + node.min) * 0.5f;
+        const float3 extent = (node.max - node.min) * 0.5f;
+        uint32_t mask = entry.planes;
+        bool outside = false;
+        for (size_t j = 0; j < 6; j++) {
+            if (mask & (1u << j)) {
+                const float d = dot(planes[j].xyz, center) + planes[j].w;
+                const float r = dot(abs(planes[j].xyz), extent);
+                if (d - r >= 0.0f) {
+                    outside = true;
+                    break;
+                }
+                if (d + r < 0.0f) {
+                    mask &= ~(1u << j);
+                }
+            }
+        }
+
+        if (outside) {
+            continue;
+        }
+
+        if (!mask) {
+            // the whole subtree is inside the frustum
+            for (uint32_t i = node.first, e = node.first + node.count; i < e; i++) {
+                results[indices[i]] |= visible;
+            }
+            continue;
+        }
+
+        if (!node.right) {
+            // leaf, use the same test as Culler::intersects()
+            for (uint32_t i = node.first, e = node.first + node.count; i < e; i++) {
+                const uint32_t index = indices[i];
+                float3 c, h;
+                getAabb(boxes, index, c, h);
+                bool inside = true;
+                for (size_t j = 0; j < 6 && inside; j++) {
+                    if (mask & (1u << j)) {
+                        const float dot =
+                                planes[j].x * c.x - std::abs(planes[j].x) * h.x +
+                                planes[j].y * c.y - std::abs(planes[j].y) * h.y +
+                                planes[j].z * c.z - std::abs(planes[j].z) * h.z +
+                                planes[j].w;
+                        inside = dot < 0.0f;
+                    }
+                }
+                if (inside) {
+                    results[index] |= visible;
+                }
+            }
+            continue;
+        }
+
+        stack[sp++] = { node.right, mask };
+        stack[sp++] = { entry.node + 1, mask };
+    }
+}
+
+} // namespace filament
@@ -20,10 +20,221 @@
 
 #include <math/fast.h>
 
+#include <assert.h>
+
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+#   include <immintrin.h>
+#   define TNT_FILAMENT_CULLER_HAS_AVX2 1
+#else
+#   define TNT_FILAMENT_CULLER_HAS_AVX2 0
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#   define TNT_FILAMENT_CULLER_HAS_NEON 1
+#else
+#   define TNT_FILAMENT_CULLER_HAS_NEON 0
+#endif
+
 using namespace filament::math;
 
 namespace filament {
 
+using AabbBlock = Culler::AabbBlock;
+using result_type = Culler::result_type;
+
+// ------------------------------------------------------------------------------------------------
+// AabbBlock culling kernels
+// ------------------------------------------------------------------------------------------------
+
+static void intersectsScalar(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        AabbBlock const* UTILS_RESTRICT boxes,
+        size_t blockCount, size_t bit) noexcept {
+    for (size_t b = 0; b < blockCount; b++) {
+        AabbBlock const& UTILS_RESTRICT box = boxes[b];
+        result_type* UTILS_RESTRICT const r = results + b * Culler::MODULO;
+        #pragma clang loop vectorize_width(8)
+        for (size_t i = 0; i < Culler::MODULO; i++) {
+            int visible = ~0;
+            #pragma clang loop unroll(full)
+            for (size_t j = 0; j < 6; j++) {
+                const float dot =
+                        planes[j].x * box.cx[i] - std::abs(planes[j].x) * box.ex[i] +
+                        planes[j].y * box.cy[i] - std::abs(planes[j].y) * box.ey[i] +
+                        planes[j].z * box.cz[i] - std::abs(planes[j].z) * box.ez[i] +
+                        planes[j].w;
+                visible &= fast::signbit(dot) << bit;
+            }
+            r[i] |= result_type(visible);
+        }
+    }
+}
+
+#if TNT_FILAMENT_CULLER_HAS_AVX2
+
+__attribute__((target("avx2")))
+static void intersectsAvx2(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        AabbBlock const* UTILS_RESTRICT boxes,
+        size_t blockCount, size_t bit) noexcept {
+
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+    for (size_t j = 0; j < 6; j++) {
+        px[j] = _mm256_set1_ps(planes[j].x);
+        py[j] = _mm256_set1_ps(planes[j].y);
+        pz[j] = _mm256_set1_ps(planes[j].z);
+        pw[j] = _mm256_set1_ps(planes[j].w);
+        ax[j] = _mm256_andnot_ps(signMask, px[j]);
+        ay[j] = _mm256_andnot_ps(signMask, py[j]);
+        az[j] = _mm256_andnot_ps(signMask, pz[j]);
+    }
+    const __m128i shift = _mm_cvtsi32_si128(int(bit));
+
+    for (size_t b = 0; b < blockCount; b++) {
+        AabbBlock const& UTILS_RESTRICT box = boxes[b];
+        const __m256 cx = _mm256_load_ps(box.cx);
+        const __m256 cy = _mm256_load_ps(box.cy);
+        const __m256 cz = _mm256_load_ps(box.cz);
+        const __m256 ex = _mm256_load_ps(box.ex);
+        const __m256 ey = _mm256_load_ps(box.ey);
+        const __m256 ez = _mm256_load_ps(box.ez);
+
+        // the sign bit of 'visible' stays set only if the box is inside all planes
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m256 dot = _mm256_sub_ps(_mm256_mul_ps(px[j], cx), _mm256_mul_ps(ax[j], ex));
+            dot = _mm256_add_ps(dot, _mm256_sub_ps(_mm256_mul_ps(py[j], cy), _mm256_mul_ps(ay[j], ey)));
+            dot = _mm256_add_ps(dot, _mm256_sub_ps(_mm256_mul_ps(pz[j], cz), _mm256_mul_ps(az[j], ez)));
+            dot = _mm256_add_ps(dot, pw[j]);
+            visible = _mm256_and_ps(visible, dot);
+        }
+
+        // narrow the eight sign bits to eight bytes holding 0 or 1, then move them into place
+        const __m256i v = _mm256_srli_epi32(_mm256_castps_si256(visible), 31);
+        const __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(v),
+                _mm256_extracti128_si256(v, 1));
+        const __m128i bytes = _mm_sll_epi16(_mm_packus_epi16(w, w), shift);
+
+        __m128i* const r = reinterpret_cast<__m128i*>(results + b * Culler::MODULO);
+        _mm_storel_epi64(r, _mm_or_si128(_mm_loadl_epi64(r), bytes));
+    }
+}
+
+#endif
+
+#if TNT_FILAMENT_CULLER_HAS_NEON
+
+static void intersectsNeon(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        AabbBlock const* UTILS_RESTRICT boxes,
+        size_t blockCount, size_t bit) noexcept {
+
+    const int8x8_t shift = vdup_n_s8(int8_t(bit));
+
+    for (size_t b = 0; b < blockCount; b++) {
+        AabbBlock const& UTILS_RESTRICT box = boxes[b];
+        uint32x4_t visible[2] = { vdupq_n_u32(~0u), vdupq_n_u32(~0u) };
+
+        #pragma clang loop unroll(full)
+        for (size_t h = 0; h < 2; h++) {
+            const float32x4_t cx = vld1q_f32(box.cx + h * 4);
+            const float32x4_t cy = vld1q_f32(box.cy + h * 4);
+            const float32x4_t cz = vld1q_f32(box.cz + h * 4);
+            const float32x4_t ex = vld1q_f32(box.ex + h * 4);
+            const float32x4_t ey = vld1q_f32(box.ey + h * 4);
+            const float32x4_t ez = vld1q_f32(box.ez + h * 4);
+
+            #pragma clang loop unroll(full)
+            for (size_t j = 0; j < 6; j++) {
+                float32x4_t dot = vdupq_n_f32(planes[j].w);
+                dot = vmlaq_n_f32(dot, cx, planes[j].x);
+                dot = vmlsq_n_f32(dot, ex, std::abs(planes[j].x));
+                dot = vmlaq_n_f32(dot, cy, planes[j].y);
+                dot = vmlsq_n_f32(dot, ey, std::abs(planes[j].y));
+                dot = vmlaq_n_f32(dot, cz, planes[j].z);
+                dot = vmlsq_n_f32(dot, ez, std::abs(planes[j].z));
+                // the sign bit stays set only if the box is inside all planes
+                visible[h] = vandq_u32(visible[h], vreinterpretq_u32_f32(dot));
+            }
+        }
+
+        // narrow the eight sign bits to eight bytes holding 0 or 1, then move them into place
+        const uint16x8_t w = vcombine_u16(
+                vmovn_u32(vshrq_n_u32(visible[0], 31)),
+                vmovn_u32(vshrq_n_u32(visible[1], 31)));
+        const uint8x8_t bytes = vshl_u8(vmovn_u16(w), shift);
+
+        result_type* const r = results + b * Culler::MODULO;
+        vst1_u8(r, vorr_u8(vld1_u8(r), bytes));
+    }
+}
+
+#endif
+
+bool Culler::isSupported(Implementation implementation) noexcept {
+    switch (implementation) {
+        case Implementation::SCALAR:
+            return true;
+        case Implementation::AVX2:
+#if TNT_FILAMENT_CULLER_HAS_AVX2
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        case Implementation::NEON:
+            return TNT_FILAMENT_CULLER_HAS_NEON;
+    }
+    return false;
+}
+
+Culler::Implementation Culler::getImplementation() noexcept {
+    static const Implementation sImplementation = []() {
+        if (isSupported(Implementation::NEON)) {
+            return Implementation::NEON;
+        }
+        if (isSupported(Implementation::AVX2)) {
+            return Implementation::AVX2;
+        }
+        return Implementation::SCALAR;
+    }();
+    return sImplementation;
+}
+
+using IntersectsAabbBlocks = void(*)(result_type*, float4 const*, AabbBlock const*,
+        size_t, size_t) noexcept;
+
+static IntersectsAabbBlocks getKernel(Culler::Implementation implementation) noexcept {
+    switch (implementation) {
+#if TNT_FILAMENT_CULLER_HAS_AVX2
+        case Culler::Implementation::AVX2:
+            return intersectsAvx2;
+#endif
+#if TNT_FILAMENT_CULLER_HAS_NEON
+        case Culler::Implementation::NEON:
+            return intersectsNeon;
+#endif
+        default:
+            return intersectsScalar;
+    }
+}
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        AabbBlock const* UTILS_RESTRICT boxes,
+        size_t count, size_t bit) noexcept {
+    static const IntersectsAabbBlocks sKernel = getKernel(getImplementation());
+    sKernel(results, frustum.mPlanes, boxes, getBlockCount(count), bit);
+}
+
+// ------------------------------------------------------------------------------------------------
+
 void Culler::intersects(
         result_type* UTILS_RESTRICT results,
         Frustum const& UTILS_RESTRICT frustum,
@@ -136,4 +347,13 @@ void Culler::Test::intersects(
     Culler::intersects(results, frustum, b, count);
 }
 
+void Culler::Test::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        AabbBlock const* UTILS_RESTRICT boxes,
+        size_t count, Implementation implementation) noexcept {
+    assert(isSupported(implementation));
+    getKernel(implementation)(results, frustum.mPlanes, boxes, getBlockCount(count), 0);
+}
+
 } // namespace filament
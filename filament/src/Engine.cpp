@@ -166,7 +166,7 @@ FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
         mPostProcessManager(*this),
         mEntityManager(EntityManager::get()),
         mRenderableManager(*this),
-        mTransformManager(),
+        mTransformManager(&mJobSystem),
         mLightManager(*this),
         mCameraManager(*this),
         mCommandBufferQueue(CONFIG_MIN_COMMAND_BUFFERS_SIZE, CONFIG_COMMAND_BUFFERS_SIZE),
@@ -197,6 +197,17 @@ void FEngine::init() {
 
     mResourceAllocator = new ResourceAllocator(driverApi);
 
+    // the budget and max age of the texture cache are tunable, the other properties are
+    // statistics updated by ResourceAllocator::gc()
+    auto& ra = mResourceAllocator->debug;
+    mDebugRegistry.registerProperty("d.resourceAllocator.cacheBudgetInMiB", &ra.cacheBudgetInMiB);
+    mDebugRegistry.registerProperty("d.resourceAllocator.cacheMaxAge", &ra.cacheMaxAge);
+    mDebugRegistry.registerProperty("d.resourceAllocator.cacheHits", &ra.cacheHits);
+    mDebugRegistry.registerProperty("d.resourceAllocator.cacheMisses", &ra.cacheMisses);
+    mDebugRegistry.registerProperty("d.resourceAllocator.cacheEvictions", &ra.cacheEvictions);
+    mDebugRegistry.registerProperty("d.resourceAllocator.cacheSizeInKiB", &ra.cacheSizeInKiB);
+    mDebugRegistry.registerProperty("d.resourceAllocator.cacheEntries", &ra.cacheEntries);
+
     mFullScreenTriangleVb = upcast(VertexBuffer::Builder()
             .vertexCount(3)
             .bufferCount(1)
@@ -302,6 +313,11 @@ void FEngine::shutdown() {
 
     destroy(mDefaultMaterial);
 
+    for (InstanceUbo const& ubo : mInstanceUbos) {
+        driver.destroyUniformBuffer(ubo.handle);
+    }
+    mInstanceUbos.clear();
+
     /*
      * clean-up after the user -- we call terminate on each "leaked" object and clear each list.
      *
@@ -367,16 +383,42 @@ void FEngine::prepare() {
     // UBOs that are visible only. It's not such a big issue because the actual upload() is
     // skipped is the UBO hasn't changed. Still we could have a lot of these.
     FEngine::DriverApi& driver = getDriverApi();
+
+    // the render passes of the previous frame are done with their instance UBOs
+    mInstanceUboUsed = 0;
+
     for (auto& materialInstanceList : mMaterialInstances) {
         for (const auto& item : materialInstanceList.second) {
             item->commit(driver);
         }
     }
 
-    // Commit default material instances.
+    // Commit default material instances, and create some of the programs prepared by
+    // Material::compile(). Their compilation happens on the driver thread, which we can't time
+    // from here, so the budget is a number of programs per frame.
+    size_t programBudget = CONFIG_MAX_COMPILED_PROGRAMS_PER_FRAME;
     for (const auto& material : mMaterials) {
         material->getDefaultInstance()->commit(driver);
+        if (UTILS_UNLIKELY(material->isCompiling())) {
+            programBudget = material->createCompiledPrograms(programBudget);
+        }
+    }
+}
+
+Handle<HwUniformBuffer> FEngine::acquireInstanceUbo(size_t count) noexcept {
+    if (mInstanceUboUsed == mInstanceUbos.size()) {
+        mInstanceUbos.emplace_back();
+    }
+    InstanceUbo& ubo = mInstanceUbos[mInstanceUboUsed++];
+    if (ubo.count < count) {
+        // allocate 1/3 extra, with a minimum of CONFIG_MAX_INSTANCES instances
+        DriverApi& driver = getDriverApi();
+        ubo.count = std::max(size_t(CONFIG_MAX_INSTANCES), (4u * count + 2u) / 3u);
+        driver.destroyUniformBuffer(ubo.handle);
+        ubo.handle = driver.createUniformBuffer(FScene::getRenderableUBOSize(ubo.count),
+                BufferUsage::STREAM);
     }
+    return ubo.handle;
 }
 
 void FEngine::gc() {
@@ -35,7 +35,15 @@
 #include <MaterialParser.h>
 
 #include <utils/CString.h>
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
+#include <utils/bitset.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
 
 using namespace utils;
 using namespace filaflat;
@@ -52,6 +60,40 @@ struct Material::BuilderDetails {
     bool mDefaultMaterial = false;
 };
 
+// The state of a compile() request. The programs are extracted from the package by jobs, and
+// created on the main thread by FEngine::prepare(), a few each frame.
+struct FMaterial::Compilation {
+    struct Slot {
+        std::atomic<bool> ready = { false };   // set by the job that extracted the program
+        Program program;
+    };
+    std::array<Slot, VARIANT_COUNT> slots;
+    std::vector<uint8_t> variants;              // variants being prepared, in order
+    utils::bitset<uint64_t, (VARIANT_COUNT + 63) / 64> pending;   // programs not created yet
+    Material::VariantFeature features = Material::VariantFeature::NONE;   // all the requests
+    std::vector<JobSystem::Job*> jobs;          // one per request
+    std::vector<std::pair<CompileCallback, void*>> callbacks;
+};
+
+// VariantFeature is a public mirror of the Variant bits
+static_assert(uint8_t(Material::VariantFeature::DIRECTIONAL_LIGHTING) ==
+        Variant::DIRECTIONAL_LIGHTING, "VariantFeature doesn't match Variant");
+static_assert(uint8_t(Material::VariantFeature::DYNAMIC_LIGHTING) == Variant::DYNAMIC_LIGHTING,
+        "VariantFeature doesn't match Variant");
+static_assert(uint8_t(Material::VariantFeature::SHADOW_RECEIVER) == Variant::SHADOW_RECEIVER,
+        "VariantFeature doesn't match Variant");
+static_assert(uint8_t(Material::VariantFeature::SKINNING) == Variant::SKINNING_OR_MORPHING,
+        "VariantFeature doesn't match Variant");
+static_assert(uint8_t(Material::VariantFeature::DEPTH) == Variant::DEPTH,
+        "VariantFeature doesn't match Variant");
+static_assert(uint8_t(Material::VariantFeature::FOG) == Variant::FOG,
+        "VariantFeature doesn't match Variant");
+static_assert(uint8_t(Material::VariantFeature::VSM) == Variant::VSM,
+        "VariantFeature doesn't match Variant");
+static_assert(uint8_t(Material::VariantFeature::ALL) == VARIANT_COUNT - 1,
+        "VariantFeature doesn't match Variant");
+
+
 FMaterial::DefaultMaterialBuilder::DefaultMaterialBuilder() : Material::Builder() {
     mImpl->mDefaultMaterial = true;
 }
@@ -283,6 +325,9 @@ FMaterial::~FMaterial() noexcept {
 }
 
 void FMaterial::terminate(FEngine& engine) {
+    if (mCompilation) {
+        finishCompilation(false);
+    }
     destroyPrograms(engine);
     mDefaultInstance.terminate(engine);
 }
@@ -311,18 +356,129 @@ UniformInterfaceBlock::UniformInfo const* FMaterial::reflect(
     return p == list.end() ? nullptr : &static_cast<UniformInterfaceBlock::UniformInfo const&>(*p);
 }
 
+void FMaterial::compile(VariantFeature variants, CompileCallback callback, void* user) noexcept {
+    if (!mCompilation) {
+        mCompilation = std::make_unique<Compilation>();
+        // variants are never removed, so the jobs can read this while variants are added
+        mCompilation->variants.reserve(VARIANT_COUNT);
+    }
+    Compilation* const c = mCompilation.get();
+    c->features |= variants;
+    if (callback) {
+        c->callbacks.emplace_back(callback, user);
+    }
+
+    // find the requested variants present in the package, whose program doesn't exist and
+    // isn't being prepared yet
+    const uint32_t first = uint32_t(c->variants.size());
+    const uint8_t features = uint8_t(variants);
+    const ShaderModel sm = mEngine.getDriver().getShaderModel();
+    for (size_t i = 0; i < VARIANT_COUNT; i++) {
+        const uint8_t variantKey = uint8_t(i);
+        if (mCachedPrograms[variantKey] || c->pending[variantKey]) {
+            continue;
+        }
+        uint8_t vertexVariantKey = variantKey;
+        uint8_t fragmentVariantKey = variantKey;
+        if (mMaterialDomain == MaterialDomain::SURFACE) {
+            if (Variant::isReserved(variantKey) ||
+                    Variant::filterVariant(variantKey, isVariantLit()) != variantKey ||
+                    (variantKey & ~features)) {
+                continue;
+            }
+            vertexVariantKey = Variant::filterVariantVertex(variantKey);
+            fragmentVariantKey = Variant::filterVariantFragment(variantKey);
+        }
+        if (mMaterialParser->hasShader(sm, vertexVariantKey, ShaderType::VERTEX) &&
+                mMaterialParser->hasShader(sm, fragmentVariantKey, ShaderType::FRAGMENT)) {
+            c->variants.push_back(variantKey);
+            c->pending.set(variantKey);
+        }
+    }
+
+    const uint32_t count = uint32_t(c->variants.size()) - first;
+    if (count) {
+        JobSystem& js = mEngine.getJobSystem();
+        auto* job = jobs::parallel_for(js, nullptr, first, count,
+                [this, c](uint32_t first, uint32_t count) {
+                    // the engine's shader builders belong to the main thread
+                    ShaderBuilder vsBuilder;
+                    ShaderBuilder fsBuilder;
+                    for (uint32_t i = first, e = first + count; i != e; i++) {
+                        const uint8_t variantKey = c->variants[i];
+                        Compilation::Slot& slot = c->slots[variantKey];
+                        slot.program = getProgramBuilder(variantKey, vsBuilder, fsBuilder);
+                        slot.ready.store(true, std::memory_order_release);
+                    }
+                }, jobs::CountSplitter<1, 8>());
+        // the programs are needed later than the frame's own jobs
+        c->jobs.push_back(js.runAndRetain(job, JobSystem::BACKGROUND));
+    }
+
+    // the callbacks are invoked by createCompiledPrograms(), even if there was nothing to do
+}
+
+size_t FMaterial::createCompiledPrograms(size_t budget) noexcept {
+    Compilation& c = *mCompilation;
+    for (size_t i = 0, n = c.variants.size(); i < n && budget; i++) {
+        const uint8_t variantKey = c.variants[i];
+        Compilation::Slot& slot = c.slots[variantKey];
+        if (c.pending[variantKey] && slot.ready.load(std::memory_order_acquire)) {
+            createAndCacheProgram(std::move(slot.program), variantKey);
+            c.pending.unset(variantKey);
+            budget--;
+        }
+    }
+    if (c.pending.none()) {
+        finishCompilation(true);
+    }
+    return budget;
+}
+
+bool FMaterial::isProgramPendingSlow(uint8_t variantKey) const noexcept {
+    return mCompilation->pending[variantKey];
+}
+
+void FMaterial::finishCompilation(bool invokeCallbacks) noexcept {
+    // the callbacks may call compile() again
+    std::unique_ptr<Compilation> compilation = std::move(mCompilation);
+    for (JobSystem::Job* job : compilation->jobs) {
+        mEngine.getJobSystem().waitAndRelease(job);
+    }
+    if (invokeCallbacks) {
+        for (auto const& callback : compilation->callbacks) {
+            callback.first(this, callback.second);
+        }
+    }
+}
+
 backend::Handle<backend::HwProgram> FMaterial::getProgramSlow(uint8_t variantKey) const noexcept {
+    Compilation* const c = mCompilation.get();
+    if (UTILS_UNLIKELY(c && c->pending[variantKey])) {
+        // this program is needed before compile() got to it, use what's ready already
+        c->pending.unset(variantKey);
+        Compilation::Slot& slot = c->slots[variantKey];
+        if (slot.ready.load(std::memory_order_acquire)) {
+            return createAndCacheProgram(std::move(slot.program), variantKey);
+        }
+    }
+    return createAndCacheProgram(getProgramBuilder(variantKey,
+            mEngine.getVertexShaderBuilder(), mEngine.getFragmentShaderBuilder()), variantKey);
+}
+
+Program FMaterial::getProgramBuilder(uint8_t variantKey,
+        ShaderBuilder& vsBuilder, ShaderBuilder& fsBuilder) const noexcept {
     switch (getMaterialDomain()) {
         case MaterialDomain::SURFACE:
-            return getSurfaceProgramSlow(variantKey);
+            return getSurfaceProgramBuilder(variantKey, vsBuilder, fsBuilder);
 
         case MaterialDomain::POST_PROCESS:
-            return getPostProcessProgramSlow(variantKey);
+            return getPostProcessProgramBuilder(variantKey, vsBuilder, fsBuilder);
     }
 }
 
-backend::Handle<backend::HwProgram> FMaterial::getSurfaceProgramSlow(uint8_t variantKey)
-    const noexcept {
+Program FMaterial::getSurfaceProgramBuilder(uint8_t variantKey,
+        ShaderBuilder& vsBuilder, ShaderBuilder& fsBuilder) const noexcept {
     // filterVariant() has already been applied in generateCommands(), shouldn't be needed here
     // if we're unlit, we don't have any bits that correspond to lit materials
     assert( variantKey == Variant::filterVariant(variantKey, isVariantLit()) );
@@ -332,7 +488,8 @@ backend::Handle<backend::HwProgram> FMaterial::getSurfaceProgramSlow(uint8_t var
     uint8_t vertexVariantKey = Variant::filterVariantVertex(variantKey);
     uint8_t fragmentVariantKey = Variant::filterVariantFragment(variantKey);
 
-    Program pb = getProgramBuilderWithVariants(variantKey, vertexVariantKey, fragmentVariantKey);
+    Program pb = getProgramBuilderWithVariants(variantKey, vertexVariantKey, fragmentVariantKey,
+            vsBuilder, fsBuilder);
     pb
         .setUniformBlock(BindingPoints::PER_VIEW, UibGenerator::getPerViewUib().getName())
         .setUniformBlock(BindingPoints::LIGHTS, UibGenerator::getLightsUib().getName())
@@ -348,34 +505,35 @@ backend::Handle<backend::HwProgram> FMaterial::getSurfaceProgramSlow(uint8_t var
     addSamplerGroup(pb, BindingPoints::PER_VIEW, SibGenerator::getPerViewSib(variantKey), mSamplerBindings);
     addSamplerGroup(pb, BindingPoints::PER_MATERIAL_INSTANCE, mSamplerInterfaceBlock, mSamplerBindings);
 
-    return createAndCacheProgram(std::move(pb), variantKey);
+    return pb;
 }
 
-backend::Handle<backend::HwProgram> FMaterial::getPostProcessProgramSlow(uint8_t variantKey)
-    const noexcept {
+Program FMaterial::getPostProcessProgramBuilder(uint8_t variantKey,
+        ShaderBuilder& vsBuilder, ShaderBuilder& fsBuilder) const noexcept {
 
-    Program pb = getProgramBuilderWithVariants(variantKey, variantKey, variantKey);
+    Program pb = getProgramBuilderWithVariants(variantKey, variantKey, variantKey,
+            vsBuilder, fsBuilder);
     pb
             .setUniformBlock(BindingPoints::PER_VIEW, UibGenerator::getPerViewUib().getName())
             .setUniformBlock(BindingPoints::PER_MATERIAL_INSTANCE, mUniformInterfaceBlock.getName());
 
     addSamplerGroup(pb, BindingPoints::PER_MATERIAL_INSTANCE, mSamplerInterfaceBlock, mSamplerBindings);
 
-    return createAndCacheProgram(std::move(pb), variantKey);
+    return pb;
 }
 
 Program FMaterial::getProgramBuilderWithVariants(
         uint8_t variantKey,
         uint8_t vertexVariantKey,
-        uint8_t fragmentVariantKey) const noexcept {
+        uint8_t fragmentVariantKey,
+        ShaderBuilder& vsBuilder,
+        ShaderBuilder& fsBuilder) const noexcept {
     const ShaderModel sm = mEngine.getDriver().getShaderModel();
 
     /*
      * Vertex shader
      */
 
-    filaflat::ShaderBuilder& vsBuilder = mEngine.getVertexShaderBuilder();
-
     UTILS_UNUSED_IN_RELEASE bool vsOK = mMaterialParser->getShader(vsBuilder, sm,
             vertexVariantKey, ShaderType::VERTEX);
 
@@ -388,8 +546,6 @@ Program FMaterial::getProgramBuilderWithVariants(
      * Fragment shader
      */
 
-    filaflat::ShaderBuilder& fsBuilder = mEngine.getFragmentShaderBuilder();
-
     UTILS_UNUSED_IN_RELEASE bool fsOK = mMaterialParser->getShader(fsBuilder, sm,
             fragmentVariantKey, ShaderType::FRAGMENT);
 
@@ -451,6 +607,16 @@ size_t FMaterial::getParameters(ParameterInfo* parameters, size_t count) const n
 void FMaterial::applyPendingEdits() noexcept {
     const char* name = mName.c_str();
     slog.d << "Applying edits to " << (name ? name : "(untitled)") << io::endl;
+    // a compilation in progress starts over from the edited package, its callbacks are invoked
+    // once the edited programs are created
+    const bool compiling = mCompilation != nullptr;
+    VariantFeature features = VariantFeature::NONE;
+    std::vector<std::pair<CompileCallback, void*>> callbacks;
+    if (compiling) {
+        features = mCompilation->features;
+        callbacks = std::move(mCompilation->callbacks);
+        finishCompilation(false);
+    }
     destroyPrograms(mEngine);
     for (auto& program : mCachedPrograms) {
         program.clear();
@@ -458,6 +624,10 @@ void FMaterial::applyPendingEdits() noexcept {
     delete mMaterialParser;
     mMaterialParser = mPendingEdits;
     mPendingEdits = nullptr;
+    if (compiling) {
+        compile(features, nullptr, nullptr);
+        mCompilation->callbacks = std::move(callbacks);
+    }
 }
 
 /**
@@ -542,6 +712,10 @@ MaterialInstance* Material::createInstance(const char* name) const noexcept {
     return upcast(this)->createInstance(name);
 }
 
+void Material::compile(VariantFeature variants, CompileCallback callback, void* user) noexcept {
+    upcast(this)->compile(variants, callback, user);
+}
+
 const char* Material::getName() const noexcept {
     return upcast(this)->getName().c_str();
 }
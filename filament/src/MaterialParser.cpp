@@ -259,11 +259,16 @@ bool MaterialParser::getRefractionType(RefractionType* value) const noexcept {
 }
 
 bool MaterialParser::getShader(ShaderBuilder& shader,
-        ShaderModel shaderModel, uint8_t variant, ShaderType stage) noexcept {
+        ShaderModel shaderModel, uint8_t variant, ShaderType stage) const noexcept {
     return mImpl.mMaterialChunk.getShader(shader,
             mImpl.mBlobDictionary, (uint8_t)shaderModel, variant, stage);
 }
 
+bool MaterialParser::hasShader(ShaderModel shaderModel, uint8_t variant,
+        ShaderType stage) const noexcept {
+    return mImpl.mMaterialChunk.hasShader((uint8_t)shaderModel, variant, (uint8_t)stage);
+}
+
 // ------------------------------------------------------------------------------------------------
 
 
@@ -88,8 +88,12 @@ public:
     bool getSpecularAntiAliasingVariance(float* value) const noexcept;
     bool getSpecularAntiAliasingThreshold(float* value) const noexcept;
 
+    // getShader() can be called concurrently, as long as each call uses its own ShaderBuilder
     bool getShader(filaflat::ShaderBuilder& shader, backend::ShaderModel shaderModel,
-            uint8_t variant, backend::ShaderType stage) noexcept;
+            uint8_t variant, backend::ShaderType stage) const noexcept;
+
+    bool hasShader(backend::ShaderModel shaderModel,
+            uint8_t variant, backend::ShaderType stage) const noexcept;
 
 private:
     struct MaterialParserDetails {
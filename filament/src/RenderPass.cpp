@@ -30,7 +30,11 @@
 #include <utils/JobSystem.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
+#include <memory>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 using namespace utils;
 using namespace filament::math;
@@ -39,6 +43,11 @@ namespace filament {
 
 using namespace backend;
 
+// The shaders declare the per-renderable uniform block as an array of CONFIG_MAX_INSTANCES
+// PerRenderableUib, and GLES requires the bound range to cover the whole block, even for
+// non-instanced draws. The UBOs are padded for this, see FScene::getRenderableUBOSize().
+static constexpr size_t PER_RENDERABLE_RANGE_SIZE = CONFIG_MAX_INSTANCES * sizeof(PerRenderableUib);
+
 RenderPass::RenderPass(FEngine& engine,
         GrowingSlice<RenderPass::Command> commands) noexcept
         : mEngine(engine), mCommands(commands),
@@ -159,17 +168,310 @@ RenderPass::Command* RenderPass::sortCommands() noexcept {
 
     GrowingSlice<Command>& commands = mCommands;
 
-    std::sort(commands.begin(), commands.end());
+    if (commands.size() >= RADIX_SORT_MIN_COMMANDS) {
+        // the scratch memory of the sort is released as soon as it's done
+        ArenaScope arena(mEngine.getPerRenderPassAllocator());
+        commands.resize(radixSortCommands(mEngine.getJobSystem(), arena,
+                commands.begin(), uint32_t(commands.size())));
+    } else {
+        commands.resize(sortCommandsSerial(commands.begin(), uint32_t(commands.size())));
+    }
+
+    mInstanceUboHandle.clear();
+    if (mEngine.debug.renderer.instancing) {
+        const uint32_t instanceCount = instanceCommands(commands.begin(), commands.end());
+        if (instanceCount) {
+            updateInstanceUbo(instanceCount);
+        }
+    }
+
+    return commands.end();
+}
+
+void RenderPass::updateInstanceUbo(uint32_t instanceCount) noexcept {
+    SYSTRACE_CALL();
+    assert(mRenderableSoa);
+
+    // The renderables of an instanced run are not contiguous in the per-renderable UBO,
+    // so their data is copied contiguously, in draw order, into a UBO of their own. This
+    // happens here rather than when recording, because UBOs can't be updated within a
+    // render pass on all backends.
+    FEngine& engine = mEngine;
+    DriverApi& driver = engine.getDriverApi();
+
+    // we upload the padding as well, see FScene::getRenderableUBOSize()
+    const size_t size = FScene::getRenderableUBOSize(instanceCount);
+    void* const buffer = driver.allocate(size);
+    size_t offset = 0;
+    for (Command const* c = mCommands.begin(), *e = mCommands.end(); c != e; c++) {
+        for (uint32_t i = 0, n = c->primitive.instanceCount; i < n; i++) {
+            FScene::writeRenderableUib(buffer, offset, *mRenderableSoa, c[i].primitive.index);
+            offset += sizeof(PerRenderableUib);
+        }
+    }
+    assert(offset == instanceCount * sizeof(PerRenderableUib));
+
+    mInstanceUboHandle = engine.acquireInstanceUbo(instanceCount);
+    driver.loadUniformBuffer(mInstanceUboHandle, { buffer, size });
+}
+
+uint32_t RenderPass::instanceCommands(Command* const first, Command* const last) noexcept {
+    SYSTRACE_CALL();
+
+    // Commands with the same key can be drawn in any order, so we group together the ones
+    // drawing the same primitive, which makes the runs below longer.
+    for (Command* curr = first; curr != last;) {
+        Command* const end = std::find_if(curr + 1, last,
+                [key = curr->key](Command const& c) { return c.key != key; });
+        if (end - curr > 1 && (curr->key & CUSTOM_MASK) == uint64_t(CustomCommand::PASS)) {
+            std::sort(curr, end, [](Command const& lhs, Command const& rhs) {
+                PrimitiveInfo const& l = lhs.primitive;
+                PrimitiveInfo const& r = rhs.primitive;
+                return std::make_tuple(l.primitiveHandle.getId(), l.mi, l.materialVariant.key) <
+                       std::make_tuple(r.primitiveHandle.getId(), r.mi, r.materialVariant.key);
+            });
+        }
+        curr = end;
+    }
+
+    auto canInstance = [](Command const& lhs, Command const& rhs) {
+        constexpr uint64_t mask = PASS_MASK | CUSTOM_MASK;
+        PrimitiveInfo const& l = lhs.primitive;
+        PrimitiveInfo const& r = rhs.primitive;
+        return (lhs.key & mask) == (rhs.key & mask) &&
+               l.mi == r.mi &&
+               l.primitiveHandle == r.primitiveHandle &&
+               l.materialVariant.key == r.materialVariant.key &&
+               !(l.rasterState != r.rasterState) &&
+               !r.bonesOffset;
+    };
+
+    uint32_t instancedCount = 0;
+    for (Command* curr = first; curr != last;) {
+        Command* end = curr + 1;
+        // skinned renderables have their own bones, so they can't be instanced
+        if ((curr->key & CUSTOM_MASK) == uint64_t(CustomCommand::PASS) &&
+                !curr->primitive.bonesOffset) {
+            Command* const maxEnd = curr + std::min(last - curr, ptrdiff_t(CONFIG_MAX_INSTANCES));
+            while (end != maxEnd && canInstance(*curr, *end)) {
+                end++;
+            }
+        }
+        const uint32_t count = uint32_t(end - curr);
+        curr->primitive.instanceCount = uint8_t(count > 1 ? count : 0);
+        instancedCount += count > 1 ? count : 0;
+        curr = end;
+    }
+    return instancedCount;
+}
+
+uint32_t RenderPass::sortCommandsSerial(Command* const commands, uint32_t const count) noexcept {
+    std::sort(commands, commands + count);
 
     // find the last command
-    Command const* const last = std::partition_point(commands.begin(), commands.end(),
+    Command const* const last = std::partition_point(commands, commands + count,
             [](Command const& c) {
                 return c.key != uint64_t(Pass::SENTINEL);
             });
 
-    commands.resize(uint32_t(last - commands.begin()));
+    return uint32_t(last - commands);
+}
+
+uint32_t RenderPass::radixSortCommands(JobSystem& js, ArenaScope& arena,
+        Command* const commands, uint32_t const count) noexcept {
+    SYSTRACE_CALL();
 
-    return commands.end();
+    /*
+     * We sort (key, index) pairs rather than the 32 bytes commands, which are permuted only
+     * once at the end. Each pass is a stable counting sort on one byte of the key, done in
+     * parallel over fixed-size chunks: each chunk computes its own histogram, a (serial)
+     * prefix-sum gives each chunk its output locations for every byte value, then chunks
+     * scatter their pairs independently. The result is independent of the number of threads.
+     *
+     * Bytes that have the same value in all keys are skipped, which is common given the
+     * layout of CommandKey (e.g. reserved bits, or the material-id of depth commands).
+     * Sentinels are dropped up front, since they're trimmed anyway, which also keeps them
+     * from preventing this.
+     *
+     * All the scratch memory comes from the given arena, about 36 bytes per command. If it runs
+     * out, we fall back to std::sort().
+     */
+
+    struct SortItem {
+        CommandKey key;
+        uint32_t index;
+    };
+
+    constexpr uint32_t RADIX = 256;
+    constexpr uint32_t BYTES = sizeof(CommandKey);
+    constexpr uint32_t CHUNK_SIZE = RADIX_SORT_CHUNK_SIZE;
+    const uint32_t chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    // the two buffers of (key, index) pairs are later reused to permute the commands
+    static_assert(sizeof(Command) >= 2 * sizeof(SortItem), "SortItem too large");
+
+    // first sorted item of each chunk, and histograms of each byte of each chunk
+    uint32_t* const offsets = arena.allocate<uint32_t>(chunkCount + 1);
+    uint32_t* const histograms = arena.allocate<uint32_t>(
+            size_t(chunkCount) * BYTES * RADIX, CACHELINE_SIZE);
+    if (UTILS_UNLIKELY(!offsets || !histograms)) {
+        return sortCommandsSerial(commands, count);
+    }
+    auto getHistogram = [histograms](uint32_t chunk, uint32_t byte) {
+        return histograms + (size_t(chunk) * BYTES + byte) * RADIX;
+    };
+
+    // count the commands to sort in each chunk, and compute all their histograms at once
+    offsets[0] = 0;
+    auto countKeys = [&](uint32_t first, uint32_t n) {
+        for (uint32_t c = first; c < first + n; c++) {
+            uint32_t* const UTILS_RESTRICT h = getHistogram(c, 0);
+            std::fill_n(h, BYTES * RADIX, 0);
+            uint32_t k = 0;
+            for (uint32_t i = c * CHUNK_SIZE, e = std::min(i + CHUNK_SIZE, count); i < e; i++) {
+                const CommandKey key = commands[i].key;
+                if (key != CommandKey(Pass::SENTINEL)) {
+                    for (uint32_t b = 0; b < BYTES; b++) {
+                        h[b * RADIX + ((key >> (b * 8u)) & 0xFFu)]++;
+                    }
+                    k++;
+                }
+            }
+            offsets[c + 1] = k;
+        }
+    };
+    auto* job = jobs::parallel_for(js, nullptr, 0, chunkCount,
+            std::ref(countKeys), jobs::CountSplitter<1, 8>());
+    js.runAndWait(job);
+
+    for (uint32_t c = 0; c < chunkCount; c++) {
+        offsets[c + 1] += offsets[c];
+    }
+    const uint32_t sortCount = offsets[chunkCount];
+    if (UTILS_UNLIKELY(!sortCount)) {
+        return 0;
+    }
+
+    // find out which bytes need to be sorted
+    uint32_t passes[BYTES];
+    uint32_t passCount = 0;
+    for (uint32_t b = 0; b < BYTES; b++) {
+        for (uint32_t r = 0; r < RADIX; r++) {
+            uint32_t total = 0;
+            for (uint32_t c = 0; c < chunkCount; c++) {
+                total += getHistogram(c, b)[r];
+            }
+            if (total) {
+                if (total != sortCount) {
+                    passes[passCount++] = b;
+                }
+                break;
+            }
+        }
+    }
+
+    void* const scratch = arena.allocate(size_t(sortCount) * sizeof(Command), CACHELINE_SIZE);
+    uint32_t* const indices = arena.allocate<uint32_t>(sortCount);
+    if (UTILS_UNLIKELY(!scratch || !indices)) {
+        return sortCommandsSerial(commands, count);
+    }
+    SortItem* src = static_cast<SortItem*>(scratch);
+    SortItem* dst = src + sortCount;
+
+    auto extractKeys = [&](uint32_t first, uint32_t n) {
+        for (uint32_t c = first; c < first + n; c++) {
+            SortItem* const UTILS_RESTRICT out = src;
+            uint32_t k = offsets[c];
+            for (uint32_t i = c * CHUNK_SIZE, e = std::min(i + CHUNK_SIZE, count); i < e; i++) {
+                const CommandKey key = commands[i].key;
+                if (key != CommandKey(Pass::SENTINEL)) {
+                    out[k++] = { key, i };
+                }
+            }
+        }
+    };
+    job = jobs::parallel_for(js, nullptr, 0, chunkCount,
+            std::ref(extractKeys), jobs::CountSplitter<1, 8>());
+    js.runAndWait(job);
+
+    for (uint32_t p = 0; p < passCount; p++) {
+        const uint32_t byte = passes[p];
+        const uint32_t shift = byte * 8u;
+
+        if (p) {
+            // the items moved since the histograms were computed
+            auto countBytes = [&](uint32_t first, uint32_t n) {
+                for (uint32_t c = first; c < first + n; c++) {
+                    uint32_t* const UTILS_RESTRICT h = getHistogram(c, byte);
+                    std::fill_n(h, RADIX, 0);
+                    SortItem const* const UTILS_RESTRICT in = src;
+                    for (uint32_t i = offsets[c], e = offsets[c + 1]; i < e; i++) {
+                        h[(in[i].key >> shift) & 0xFFu]++;
+                    }
+                }
+            };
+            job = jobs::parallel_for(js, nullptr, 0, chunkCount,
+                    std::ref(countBytes), jobs::CountSplitter<1, 8>());
+            js.runAndWait(job);
+        }
+
+        // each value goes after all smaller values, and after the same value of previous chunks
+        uint32_t sum = 0;
+        for (uint32_t r = 0; r < RADIX; r++) {
+            for (uint32_t c = 0; c < chunkCount; c++) {
+                uint32_t& h = getHistogram(c, byte)[r];
+                const uint32_t n = h;
+                h = sum;
+                sum += n;
+            }
+        }
+
+        auto scatter = [&](uint32_t first, uint32_t n) {
+            for (uint32_t c = first; c < first + n; c++) {
+                uint32_t* const UTILS_RESTRICT h = getHistogram(c, byte);
+                SortItem const* const UTILS_RESTRICT in = src;
+                SortItem* const UTILS_RESTRICT out = dst;
+                for (uint32_t i = offsets[c], e = offsets[c + 1]; i < e; i++) {
+                    out[h[(in[i].key >> shift) & 0xFFu]++] = in[i];
+                }
+            }
+        };
+        job = jobs::parallel_for(js, nullptr, 0, chunkCount,
+                std::ref(scatter), jobs::CountSplitter<1, 8>());
+        js.runAndWait(job);
+
+        std::swap(src, dst);
+    }
+
+    // finally permute the commands, this can't be done in place in parallel, so we copy them
+    // into the memory of the sorted items, which only need to keep their indices.
+    auto extractIndices = [indices, items = src](uint32_t first, uint32_t n) {
+        for (uint32_t i = first; i < first + n; i++) {
+            indices[i] = items[i].index;
+        }
+    };
+    job = jobs::parallel_for(js, nullptr, 0, sortCount,
+            std::ref(extractIndices), jobs::CountSplitter<JOBS_PARALLEL_FOR_COMMANDS_COUNT, 8>());
+    js.runAndWait(job);
+
+    Command* const sorted = static_cast<Command*>(scratch);
+    auto gather = [sorted, commands, indices](uint32_t first, uint32_t n) {
+        for (uint32_t i = first; i < first + n; i++) {
+            sorted[i] = commands[indices[i]];
+        }
+    };
+    job = jobs::parallel_for(js, nullptr, 0, sortCount,
+            std::ref(gather), jobs::CountSplitter<JOBS_PARALLEL_FOR_COMMANDS_COUNT, 8>());
+    js.runAndWait(job);
+
+    auto copy = [sorted, commands](uint32_t first, uint32_t n) {
+        std::copy_n(sorted + first, n, commands + first);
+    };
+    job = jobs::parallel_for(js, nullptr, 0, sortCount,
+            std::ref(copy), jobs::CountSplitter<JOBS_PARALLEL_FOR_COMMANDS_COUNT, 8>());
+    js.runAndWait(job);
+
+    return sortCount;
 }
 
 void RenderPass::execute(const char* name,
@@ -195,51 +497,149 @@ void RenderPass::recordDriverCommands(FEngine::DriverApi& driver, const Command*
     if (first != last) {
         SYSTRACE_VALUE32("commandCount", last - first);
 
-        PolygonOffset dummyPolyOffset;
-        PipelineState pipeline{ .polygonOffset = mPolygonOffset };
-        PolygonOffset* const pPipelinePolygonOffset =
-                mPolygonOffsetOverride ? &dummyPolyOffset : &pipeline.polygonOffset;
-
-        Handle<HwUniformBuffer> uboHandle = mUboHandle;
-        FMaterialInstance const* UTILS_RESTRICT mi = nullptr;
-        FMaterial const* UTILS_RESTRICT ma = nullptr;
-        auto const& customCommands = mCustomCommands;
-
-        first--;
-        while (++first != last) {
-            /*
-             * Be careful when changing code below, this is the hot inner-loop
-             */
-
-            if (UTILS_UNLIKELY((first->key & CUSTOM_MASK) != uint64_t(CustomCommand::PASS))) {
-                uint32_t index = (first->key & CUSTOM_INDEX_MASK) >> CUSTOM_INDEX_SHIFT;
-                customCommands[index]();
-                continue;
-            }
+        // custom commands can record anything, so passes using them are recorded serially
+        if (size_t(last - first) >= PARALLEL_RECORD_MIN_COMMANDS && mCustomCommands.empty()) {
+            recordDriverCommandsParallel(driver, first, last, mInstanceUboHandle);
+        } else {
+            recordCommandRange(driver, first, last, mInstanceUboHandle, 0);
+        }
+        mCustomCommands.clear();
+    }
+}
 
-            // per-renderable uniform
-            const PrimitiveInfo info = first->primitive;
-            pipeline.rasterState = info.rasterState;
-            if (UTILS_UNLIKELY(mi != info.mi)) {
-                // this is always taken the first time
-                mi = info.mi;
-                ma = mi->getMaterial();
-                pipeline.scissor = mi->getScissor();
-                *pPipelinePolygonOffset = mi->getPolygonOffset();
-                mi->use(driver);
-            }
+void RenderPass::recordDriverCommandsParallel(FEngine::DriverApi& driver,
+        const Command* first, const Command* last,
+        Handle<HwUniformBuffer> instanceUboHandle) const noexcept {
+    SYSTRACE_CALL();
+
+    // The most recordCommandRange() records for a single command. This bounds the number of
+    // commands each job can record into a SecondaryCommandStream.
+    constexpr size_t maxCommandSize =
+            2 * CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBuffer))) +
+            CommandBase::align(sizeof(COMMAND_TYPE(bindSamplers))) +
+            CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBufferRange))) +
+            std::max(CommandBase::align(sizeof(COMMAND_TYPE(draw))),
+                    CommandBase::align(sizeof(COMMAND_TYPE(drawInstanced))));
+    constexpr size_t commandsPerJob = (CommandBufferQueue::SECONDARY_BUFFER_SIZE -
+            CommandBase::align(sizeof(NoopCommand))) / maxCommandSize;
+
+    struct Range {
+        Command const* first;
+        Command const* last;
+        size_t instanceOffset;
+    };
+    std::vector<Range> ranges;
+    ranges.reserve((last - first) / commandsPerJob + 1);
+
+    // Split the commands into ranges, without splitting instanced runs. Programs are created
+    // lazily by FMaterial, which isn't thread-safe, so we make sure they exist beforehand.
+    Command const* begin = first;
+    size_t instanceOffset = 0;
+    size_t rangeInstanceOffset = 0;
+    size_t commandCount = 0;
+    FMaterialInstance const* mi = nullptr;
+    uint8_t variant = 0;
+    for (Command const* c = first; c != last;) {
+        PrimitiveInfo const& info = c->primitive;
+        if (mi != info.mi || variant != info.materialVariant.key) {
+            mi = info.mi;
+            variant = info.materialVariant.key;
+            mi->getMaterial()->getProgram(variant);
+        }
+        instanceOffset += info.instanceCount * sizeof(PerRenderableUib);
+        c += std::max(uint32_t(info.instanceCount), 1u);
+        if (++commandCount == commandsPerJob || c == last) {
+            ranges.push_back({ begin, c, rangeInstanceOffset });
+            begin = c;
+            rangeInstanceOffset = instanceOffset;
+            commandCount = 0;
+        }
+    }
+
+    FEngine& engine = mEngine;
+    JobSystem& js = engine.getJobSystem();
+    Driver& backendDriver = engine.getDriver();
+    CommandBufferQueue& queue = engine.getCommandBufferQueue();
+    std::vector<std::unique_ptr<SecondaryCommandStream>> streams(ranges.size());
+
+    auto work = [this, &ranges, &streams, &backendDriver, &queue, instanceUboHandle]
+            (uint32_t start, uint32_t count) {
+        for (uint32_t i = start, e = start + count; i < e; i++) {
+            streams[i] = std::make_unique<SecondaryCommandStream>(backendDriver, queue);
+            recordCommandRange(streams[i]->getStream(), ranges[i].first, ranges[i].last,
+                    instanceUboHandle, ranges[i].instanceOffset);
+            assert(streams[i]->getAvailableSize() < CommandBufferQueue::SECONDARY_BUFFER_SIZE);
+        }
+    };
+    auto* job = jobs::parallel_for(js, nullptr, 0, uint32_t(ranges.size()),
+            std::ref(work), jobs::CountSplitter<1, 8>());
+    js.runAndWait(job);
+
+    // stitch the recorded commands, in order, into the main stream
+    for (auto& stream : streams) {
+        driver.insert(*stream);
+    }
+}
+
+void RenderPass::recordCommandRange(FEngine::DriverApi& driver,
+        const Command* first, const Command* last,
+        Handle<HwUniformBuffer> instanceUboHandle, size_t instanceOffset) const noexcept {
+    PolygonOffset dummyPolyOffset;
+    PipelineState pipeline{ .polygonOffset = mPolygonOffset };
+    PolygonOffset* const pPipelinePolygonOffset =
+            mPolygonOffsetOverride ? &dummyPolyOffset : &pipeline.polygonOffset;
+
+    Handle<HwUniformBuffer> uboHandle = mUboHandle;
+    Handle<HwUniformBuffer> bonesUboHandle = mEngine.getRenderableManager().getBonesUbh();
+    FMaterialInstance const* UTILS_RESTRICT mi = nullptr;
+    FMaterial const* UTILS_RESTRICT ma = nullptr;
+    auto const& customCommands = mCustomCommands;
+
+    first--;
+    while (++first != last) {
+        /*
+         * Be careful when changing code below, this is the hot inner-loop
+         */
 
-            pipeline.program = ma->getProgram(info.materialVariant.key);
-            size_t offset = info.index * sizeof(PerRenderableUib);
+        if (UTILS_UNLIKELY((first->key & CUSTOM_MASK) != uint64_t(CustomCommand::PASS))) {
+            uint32_t index = (first->key & CUSTOM_INDEX_MASK) >> CUSTOM_INDEX_SHIFT;
+            customCommands[index]();
+            continue;
+        }
+
+        // per-renderable uniform
+        const PrimitiveInfo info = first->primitive;
+        pipeline.rasterState = info.rasterState;
+        if (UTILS_UNLIKELY(mi != info.mi)) {
+            // this is always taken the first time
+            mi = info.mi;
+            ma = mi->getMaterial();
+            pipeline.scissor = mi->getScissor();
+            *pPipelinePolygonOffset = mi->getPolygonOffset();
+            mi->use(driver);
+        }
+
+        // if Material::compile() didn't create this program yet, it's created now
+        pipeline.program = ma->getProgram(info.materialVariant.key);
+
+        if (UTILS_UNLIKELY(info.instanceCount > 1)) {
             driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE,
-                    uboHandle, offset, sizeof(PerRenderableUib));
-            if (UTILS_UNLIKELY(info.perRenderableBones)) {
-                driver.bindUniformBuffer(BindingPoints::PER_RENDERABLE_BONES,
-                        info.perRenderableBones);
-            }
-            driver.draw(pipeline, info.primitiveHandle);
+                    instanceUboHandle, instanceOffset, PER_RENDERABLE_RANGE_SIZE);
+            driver.drawInstanced(pipeline, info.primitiveHandle, info.instanceCount);
+            instanceOffset += info.instanceCount * sizeof(PerRenderableUib);
+            // skip the other commands of this run
+            first += info.instanceCount - 1;
+            continue;
         }
-        mCustomCommands.clear();
+
+        size_t offset = info.index * sizeof(PerRenderableUib);
+        driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE,
+                uboHandle, offset, PER_RENDERABLE_RANGE_SIZE);
+        if (UTILS_UNLIKELY(info.bonesOffset)) {
+            driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE_BONES,
+                    bonesUboHandle, info.bonesOffset, FRenderableManager::BONES_RANGE_SIZE);
+        }
+        driver.draw(pipeline, info.primitiveHandle);
     }
 }
 
@@ -355,7 +755,7 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
     auto const* const UTILS_RESTRICT soaReversedWinding = soa.data<FScene::REVERSED_WINDING_ORDER>();
     auto const* const UTILS_RESTRICT soaVisibility      = soa.data<FScene::VISIBILITY_STATE>();
     auto const* const UTILS_RESTRICT soaPrimitives      = soa.data<FScene::PRIMITIVES>();
-    auto const* const UTILS_RESTRICT soaBonesUbh        = soa.data<FScene::BONES_UBH>();
+    auto const* const UTILS_RESTRICT soaBonesOffset     = soa.data<FScene::BONES_OFFSET>();
     auto const* const UTILS_RESTRICT soaVisibilityMask  = soa.data<FScene::VISIBLE_MASK>();
 
     const bool hasShadowing = renderFlags & HAS_SHADOWING;
@@ -429,7 +829,7 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
 
         cmdColor.key = makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
         cmdColor.primitive.index = (uint16_t)i;
-        cmdColor.primitive.perRenderableBones = soaBonesUbh[i];
+        cmdColor.primitive.bonesOffset = soaBonesOffset[i];
         materialVariant.setShadowReceiver(soaVisibility[i].receiveShadows & hasShadowing);
         materialVariant.setSkinning(soaVisibility[i].skinning || soaVisibility[i].morphing);
 
@@ -440,7 +840,7 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
         cmdDepth.key |= makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
         cmdDepth.key |= makeField(distanceBits, DISTANCE_BITS_MASK, DISTANCE_BITS_SHIFT);
         cmdDepth.primitive.index = (uint16_t)i;
-        cmdDepth.primitive.perRenderableBones = soaBonesUbh[i];
+        cmdDepth.primitive.bonesOffset = soaBonesOffset[i];
         cmdDepth.primitive.materialVariant.setSkinning(soaVisibility[i].skinning || soaVisibility[i].morphing);
         cmdDepth.primitive.rasterState.inverseFrontFaces = inverseFrontFaces;
 
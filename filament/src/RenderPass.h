@@ -19,6 +19,7 @@
 
 #include <filament/Viewport.h>
 
+#include "details/Allocators.h"
 #include "details/Camera.h"
 #include "details/Material.h"
 #include "details/Scene.h"
@@ -32,6 +33,10 @@
 
 #include <limits>
 
+// for gtest
+class FilamentTest_RenderPassParallelRecording_Test;
+class FilamentTest_MaterialCompile_Test;
+
 namespace utils {
 class JobSystem;
 }
@@ -212,11 +217,11 @@ public:
     struct PrimitiveInfo { // 24 bytes
         FMaterialInstance const* mi = nullptr;                          // 8 bytes (4)
         backend::Handle<backend::HwRenderPrimitive> primitiveHandle;    // 4 bytes
-        backend::Handle<backend::HwUniformBuffer> perRenderableBones;   // 4 bytes
+        uint32_t bonesOffset = 0;                                       // 4 bytes
         backend::RasterState rasterState;                               // 4 bytes
         uint16_t index = 0;                                             // 2 bytes
         Variant materialVariant;                                        // 1 byte
-        uint8_t reserved = {};                                          // 1 byte
+        uint8_t instanceCount = {};                                     // 1 byte
     };
 
     struct alignas(8) Command {     // 32 bytes
@@ -280,6 +285,22 @@ public:
     // the new mCommands.end()
     Command* sortCommands() noexcept;
 
+    // Sorts 'count' commands by key using a parallel LSD radix sort, sentinels are dropped.
+    // Returns the number of sorted commands, which are at the beginning of the array.
+    // The scratch memory is allocated from 'arena', std::sort() is used if it's too small.
+    static uint32_t radixSortCommands(utils::JobSystem& js, ArenaScope& arena,
+            Command* commands, uint32_t count) noexcept;
+
+    // Same as above, with std::sort()
+    static uint32_t sortCommandsSerial(Command* commands, uint32_t count) noexcept;
+
+    // Merges runs of consecutive commands drawing the same primitive with the same material
+    // instance, variant and raster state into instanced draws. The first command of each run
+    // gets the run's instanceCount, the following ones are skipped when recording.
+    // Commands must be sorted, commands with the same key may be reordered.
+    // Returns the total number of commands in instanced runs.
+    static uint32_t instanceCommands(Command* first, Command* last) noexcept;
+
     void execute(const char* name,
             backend::Handle<backend::HwRenderTarget> renderTarget,
             backend::RenderPassParams params) const noexcept;
@@ -295,6 +316,8 @@ public:
 
 private:
     friend class FRenderer;
+    friend class ::FilamentTest_RenderPassParallelRecording_Test;
+    friend class ::FilamentTest_MaterialCompile_Test;
 
     // on 64-bits systems, we process batches of 4 (64 bytes) cache-lines, or 8 (32 bytes) commands
     // on 32-bits systems, we process batches of 8 (32 bytes) cache-lines, or 8 (32 bytes) commands
@@ -305,6 +328,15 @@ private:
     static_assert(JOBS_PARALLEL_FOR_COMMANDS_SIZE % utils::CACHELINE_SIZE == 0,
             "Size of Commands jobs must be multiple of a cache-line size");
 
+    // below this number of commands, std::sort() is faster than the radix sort
+    static constexpr uint32_t RADIX_SORT_MIN_COMMANDS = 4096;
+
+    // the radix sort processes commands in chunks of this size, one job per chunk
+    static constexpr uint32_t RADIX_SORT_CHUNK_SIZE = 16384;
+
+    // below this number of commands, recording them on a single thread is faster
+    static constexpr size_t PARALLEL_RECORD_MIN_COMMANDS = 1024;
+
     static inline void generateCommands(uint32_t commandTypeFlags, Command* commands,
             FScene::RenderableSoa const& soa, utils::Range<uint32_t> range, RenderFlags renderFlags,
             FScene::VisibleMaskType visibilityMask, math::float3 cameraPosition, math::float3 cameraForward) noexcept;
@@ -318,9 +350,24 @@ private:
     static void setupColorCommand(Command& cmdDraw,
             FMaterialInstance const* mi, bool inverseFrontFaces) noexcept;
 
+    // writes the data of the instanced runs to a new mInstanceUboHandle
+    void updateInstanceUbo(uint32_t instanceCount) noexcept;
+
+    // records all the commands, the data of their instanced runs must be in mInstanceUboHandle
     void recordDriverCommands(FEngine::DriverApi& driver, const Command* first,
             const Command* last) const noexcept;
 
+    // records the commands on the JobSystem, each job into its own SecondaryCommandStream
+    void recordDriverCommandsParallel(FEngine::DriverApi& driver,
+            const Command* first, const Command* last,
+            backend::Handle<backend::HwUniformBuffer> instanceUboHandle) const noexcept;
+
+    // records the commands of [first, last), which must not split an instanced run
+    void recordCommandRange(FEngine::DriverApi& driver,
+            const Command* first, const Command* last,
+            backend::Handle<backend::HwUniformBuffer> instanceUboHandle,
+            size_t instanceOffset) const noexcept;
+
     static void updateSummedPrimitiveCounts(
             FScene::RenderableSoa& renderableData, utils::Range<uint32_t> vr) noexcept;
 
@@ -339,6 +386,8 @@ private:
     utils::Range<uint32_t> mVisibleRenderables{};
     // the UBO containing the data for the renderables
     backend::Handle<backend::HwUniformBuffer> mUboHandle;
+    // the UBO containing the data of the instanced runs, in draw order, see sortCommands()
+    backend::Handle<backend::HwUniformBuffer> mInstanceUboHandle;
 
     // info about the camera
     CameraInfo mCamera;
@@ -64,6 +64,8 @@ FRenderer::FRenderer(FEngine& engine) :
 
     debugRegistry.registerProperty("d.renderer.doFrameCapture",
             &engine.debug.renderer.doFrameCapture);
+    debugRegistry.registerProperty("d.renderer.instancing",
+            &engine.debug.renderer.instancing);
 }
 
 void FRenderer::init() noexcept {
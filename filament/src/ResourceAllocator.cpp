@@ -22,43 +22,16 @@
 
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
 using namespace utils;
 
 namespace filament {
 
 using namespace backend;
 
-// ------------------------------------------------------------------------------------------------
-
-template<typename K, typename V, typename H>
-UTILS_NOINLINE
-typename ResourceAllocator::AssociativeContainer<K, V, H>::iterator
-ResourceAllocator::AssociativeContainer<K, V, H>::erase(iterator it) {
-    return mContainer.erase(it);
-}
-
-template<typename K, typename V, typename H>
-typename ResourceAllocator::AssociativeContainer<K, V, H>::const_iterator
-ResourceAllocator::AssociativeContainer<K, V, H>::find(key_type const& key) const {
-    return const_cast<AssociativeContainer*>(this)->find(key);
-}
-
-template<typename K, typename V, typename H>
-UTILS_NOINLINE
-typename ResourceAllocator::AssociativeContainer<K, V, H>::iterator
-ResourceAllocator::AssociativeContainer<K, V, H>::find(key_type const& key) {
-    return std::find_if(mContainer.begin(), mContainer.end(), [&key](auto const& v) {
-        return v.first == key;
-    });
-}
-
-template<typename K, typename V, typename H>
-template<typename... ARGS>
-UTILS_NOINLINE
-void ResourceAllocator::AssociativeContainer<K, V, H>::emplace(ARGS&& ... args) {
-    mContainer.emplace_back(std::forward<ARGS>(args)...);
-}
-
 // ------------------------------------------------------------------------------------------------
 ResourceAllocatorInterface::~ResourceAllocatorInterface() = default;
 
@@ -82,17 +55,28 @@ ResourceAllocator::ResourceAllocator(DriverApi& driverApi) noexcept
 }
 
 ResourceAllocator::~ResourceAllocator() noexcept {
-    assert(!mTextureCache.size());
-    assert(!mInUseTextures.size());
+    assert(mTextureCache.empty());
+    assert(mInUseTextures.empty());
 }
 
 void ResourceAllocator::terminate() noexcept {
-    assert(!mInUseTextures.size());
-    auto& textureCache = mTextureCache;
-    for (auto it = textureCache.begin(); it != textureCache.end();) {
-        mBackend.destroyTexture(it->second.handle);
-        it = textureCache.erase(it);
+    assert(mInUseTextures.empty());
+    for (auto const& entry : mTextureCache) {
+        mBackend.destroyTexture(entry.handle);
     }
+    mTextureCache.clear();
+    mTextureCacheIndex.clear();
+    mCacheSize = 0;
+    debug.cacheSizeInKiB = 0;
+    debug.cacheEntries = 0;
+}
+
+void ResourceAllocator::setCacheBudget(size_t bytes) noexcept {
+    debug.cacheBudgetInMiB = int(std::min(bytes >> 20u, size_t(std::numeric_limits<int>::max())));
+}
+
+size_t ResourceAllocator::getCacheBudget() const noexcept {
+    return size_t(std::max(0, debug.cacheBudgetInMiB)) << 20u;
 }
 
 RenderTargetHandle ResourceAllocator::createRenderTarget(const char* name,
@@ -131,20 +115,30 @@ backend::TextureHandle ResourceAllocator::createTexture(const char* name,
     // do we have a suitable texture in the cache?
     TextureHandle handle;
     if (mEnabled) {
-        auto& textureCache = mTextureCache;
         const TextureKey key{ name, target, levels, format, samples, width, height, depth, usage };
-        auto it = textureCache.find(key);
-        if (UTILS_LIKELY(it != textureCache.end())) {
-            // we do, move the entry to the in-use list, and remove from the cache
-            handle = it->second.handle;
-            mCacheSize -= it->second.size;
-            textureCache.erase(it);
+        auto range = mTextureCacheIndex.equal_range(key);
+        if (UTILS_LIKELY(range.first != range.second)) {
+            // we do, pick the most recently used one (it's the least likely to be purged
+            // soon anyway), move it to the in-use list, and remove it from the cache
+            auto best = range.first;
+            for (auto it = std::next(range.first); it != range.second; ++it) {
+                if (it->second->age > best->second->age) {
+                    best = it;
+                }
+            }
+            TextureCacheList::iterator entry = best->second;
+            handle = entry->handle;
+            mCacheSize -= entry->size;
+            mTextureCacheIndex.erase(best);
+            mTextureCache.erase(entry);
+            debug.cacheHits++;
         } else {
             // we don't, allocate a new texture and populate the in-use list
             handle = mBackend.createTexture(
                     target, levels, format, samples, width, height, depth, usage);
+            debug.cacheMisses++;
         }
-        mInUseTextures.emplace(handle, key);
+        mInUseTextures.insert({ handle, key });
     } else {
         handle = mBackend.createTexture(
                 target, levels, format, samples, width, height, depth, usage);
@@ -162,7 +156,10 @@ void ResourceAllocator::destroyTexture(TextureHandle h) noexcept {
         const TextureKey key = it->second;
         uint32_t size = key.getSize();
 
-        mTextureCache.emplace(key, TextureCachePayload{ h, mAge, size });
+        // the cache list is kept sorted from least to most recently used
+        auto entry = mTextureCache.insert(mTextureCache.end(),
+                TextureCachePayload{ key, h, mAge, size });
+        mTextureCacheIndex.emplace(key, entry);
         mCacheSize += size;
 
         // remove it from the in-use list
@@ -172,49 +169,64 @@ void ResourceAllocator::destroyTexture(TextureHandle h) noexcept {
     }
 }
 
+void ResourceAllocator::evict(TextureCacheList::iterator entry) noexcept {
+    mBackend.destroyTexture(entry->handle);
+    mCacheSize -= entry->size;
+    auto range = mTextureCacheIndex.equal_range(entry->key);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == entry) {
+            mTextureCacheIndex.erase(it);
+            break;
+        }
+    }
+    mTextureCache.erase(entry);
+    debug.cacheEvictions++;
+}
+
 void ResourceAllocator::gc() noexcept {
     // this is called regularly -- usually once per frame of each Renderer
 
     // increase our age
     const size_t age = mAge++;
+    const size_t maxAge = size_t(std::max(1, debug.cacheMaxAge));
+    const size_t budget = getCacheBudget();
 
     // Purging strategy:
     // + remove entries that are older than a certain age
-    // - remove only one entry per gc(), unless we're at capacity
+    // - remove only one entry per gc(), unless we're above budget
+    // + then remove the least recently used entries until we're within budget
 
+    // The cache is sorted by age, so old entries are all at the front.
     auto& textureCache = mTextureCache;
-    for (auto it = textureCache.begin(); it != textureCache.end();) {
-        const size_t ageDiff = age - it->second.age;
-        if (ageDiff >= CACHE_MAX_AGE) {
-            mBackend.destroyTexture(it->second.handle);
-            mCacheSize -= it->second.size;
-            //slog.d << "purging " << it->second.handle.getId() << io::endl;
-            it = textureCache.erase(it);
-            if (mCacheSize < CACHE_CAPACITY) {
-                // if we're not at capacity, only purge a single entry per gc, trying to
-                // avoid a burst of work.
-                break;
-            }
-        } else {
-            ++it;
+    while (!textureCache.empty() && age - textureCache.front().age >= maxAge) {
+        evict(textureCache.begin());
+        if (mCacheSize < budget) {
+            // if we're not above budget, only purge a single entry per gc, trying to
+            // avoid a burst of work.
+            break;
         }
     }
 
+    while (!textureCache.empty() && mCacheSize > budget) {
+        evict(textureCache.begin());
+    }
+
+    debug.cacheSizeInKiB = uint32_t(mCacheSize >> 10u);
+    debug.cacheEntries = uint32_t(textureCache.size());
+
     //if (mAge % 60 == 0) dump();
-    // TODO: maybe purge LRU entries if we have more than a certain number
-    // TODO: maybe purge LRU entries if the size of the cache is too large
 }
 
 UTILS_NOINLINE
 void ResourceAllocator::dump() const noexcept {
     slog.d << "# entries=" << mTextureCache.size() << ", sz=" << mCacheSize / float(1u << 20u)
            << " MiB" << io::endl;
-    for (auto const & it : mTextureCache) {
-        auto w = it.first.width;
-        auto h = it.first.height;
-        auto f = FTexture::getFormatSize(it.first.format);
-        slog.d << it.first.name << ": w=" << w << ", h=" << h << ", f=" << f << ", sz="
-               << it.second.size / float(1u << 20u) << io::endl;
+    for (auto const& entry : mTextureCache) {
+        auto w = entry.key.width;
+        auto h = entry.key.height;
+        auto f = FTexture::getFormatSize(entry.key.format);
+        slog.d << entry.key.name << ": w=" << w << ", h=" << h << ", f=" << f << ", sz="
+               << entry.size / float(1u << 20u) << ", age=" << entry.age << io::endl;
     }
 }
 
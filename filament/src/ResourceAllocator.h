@@ -25,7 +25,10 @@
 
 #include <utils/Hash.h>
 
-#include <vector>
+#include <tsl/robin_map.h>
+
+#include <list>
+#include <unordered_map>
 
 #include <stdint.h>
 
@@ -85,11 +88,26 @@ public:
 
     void gc() noexcept;
 
-private:
-    // TODO: these should be settings of the engine
-    static constexpr size_t CACHE_CAPACITY = 64u << 20u;   // 64 MiB
-    static constexpr size_t CACHE_MAX_AGE  = 30u;
+    // Textures that are no longer in use are kept in a cache for reuse. Least recently used
+    // textures are evicted when the cache goes over its budget, or when they've not been used
+    // for a while. The budget has a granularity of 1 MiB, smaller amounts are rounded down.
+    void setCacheBudget(size_t bytes) noexcept;
+    size_t getCacheBudget() const noexcept;
+
+    // Tunables and statistics of the cache, these are exposed through the DebugRegistry (which
+    // only supports int properties) as "d.resourceAllocator.*". The statistics are unsigned so
+    // that the counters can wrap around.
+    struct {
+        int cacheBudgetInMiB = 64;          // evict least recently used textures above this size
+        int cacheMaxAge = 30;               // evict textures not used for this many gc()
+        uint32_t cacheHits = 0;             // createTexture() calls served from the cache
+        uint32_t cacheMisses = 0;           // createTexture() calls that created a new texture
+        uint32_t cacheEvictions = 0;        // textures destroyed by gc()
+        uint32_t cacheSizeInKiB = 0;        // current size of the cache
+        uint32_t cacheEntries = 0;          // current number of textures in the cache
+    } debug;
 
+private:
     struct TextureKey {
         const char* name; // doesn't participate in the hash
         backend::SamplerType target;
@@ -129,6 +147,7 @@ private:
     };
 
     struct TextureCachePayload {
+        TextureKey key;
         backend::TextureHandle handle;
         size_t age = 0;
         uint32_t size = 0;
@@ -151,36 +170,21 @@ private:
 
     inline void dump() const noexcept;
 
-    template<typename Key, typename Value, typename Hasher = Hasher<Key>>
-    class AssociativeContainer {
-        // We use a std::vector instead of a std::multimap because we don't expect many items
-        // in the cache and std::multimap generates tons of code. Even with more items, we
-        // could improve this trivially by using a sorted std::vector.
-        using Container = std::vector<std::pair<Key, Value>>;
-        Container mContainer;
-    public:
-        using iterator = typename Container::iterator;
-        using const_iterator = typename Container::const_iterator;
-        using key_type = typename Container::value_type::first_type;
-        using value_type = typename Container::value_type::second_type;
-
-        size_t size() const { return mContainer.size(); }
-        iterator begin() { return mContainer.begin(); }
-        const_iterator begin() const { return mContainer.begin(); }
-        iterator end() { return mContainer.end(); }
-        const_iterator end() const  { return mContainer.end(); }
-        iterator erase(iterator it);
-        const_iterator find(key_type const& key) const;
-        iterator find(key_type const& key);
-        template<typename ... ARGS>
-        void emplace(ARGS&&... args);
-    };
+    // The cache is a list of textures ordered from least to most recently used, indexed by a
+    // hashed multimap so that looking up a texture by its key is O(1).
+    using TextureCacheList = std::list<TextureCachePayload>;
+    using TextureCacheIndex = std::unordered_multimap<TextureKey,
+            TextureCacheList::iterator, Hasher<TextureKey>>;
+
+    void evict(TextureCacheList::iterator it) noexcept;
 
     backend::DriverApi& mBackend;
-    AssociativeContainer<TextureKey, TextureCachePayload> mTextureCache;
-    AssociativeContainer<backend::TextureHandle, TextureKey> mInUseTextures;
+    TextureCacheList mTextureCache;
+    TextureCacheIndex mTextureCacheIndex;
+    tsl::robin_map<backend::TextureHandle, TextureKey,
+            Hasher<backend::TextureHandle>> mInUseTextures;
     size_t mAge = 0;
-    uint32_t mCacheSize = 0;
+    size_t mCacheSize = 0;
     const bool mEnabled = true;
 };
 
@@ -27,7 +27,9 @@
 
 #include <utils/compiler.h>
 #include <utils/EntityManager.h>
+#include <utils/JobSystem.h>
 #include <utils/Range.h>
+#include <utils/Systrace.h>
 #include <utils/Zip2Iterator.h>
 
 #include <algorithm>
@@ -45,26 +47,52 @@ FScene::FScene(FEngine& engine) :
 
 FScene::~FScene() noexcept = default;
 
+// copies the given arrays of a StructureOfArrays into another one of the same type
+template<size_t ... Es, typename SoA>
+static inline void copyColumns(SoA& UTILS_RESTRICT dst, SoA const& UTILS_RESTRICT src,
+        size_t count) noexcept {
+    ( std::copy_n(src.template data<Es>(), count, dst.template data<Es>()), ... );
+}
 
 void FScene::prepare(const mat4f& worldOriginTransform) {
-    // TODO: can we skip this in most cases? Since we rely on indices staying the same,
-    //       we could only skip, if nothing changed in the RCM.
-
     FEngine& engine = mEngine;
-    EntityManager& em = engine.getEntityManager();
     FRenderableManager& rcm = engine.getRenderableManager();
     FTransformManager& tcm = engine.getTransformManager();
     FLightManager& lcm = engine.getLightManager();
-    // go through the list of entities, and gather the data of those that are renderables
-    auto& sceneData = mRenderableData;
-    auto& lightData = mLightData;
-    auto const& entities = mEntities;
 
+    // find out what changed since our last prepare()
+    const uint32_t transformVersion = tcm.commitVersion();
+    const uint32_t renderableVersion = rcm.commitVersion();
+    const uint32_t lightVersion = lcm.commitVersion();
+    const uint32_t destroyedEntityVersion = tcm.getDestroyedEntityVersion();
+
+    const bool gathered = needsGather(worldOriginTransform, destroyedEntityVersion);
+    if (gathered) {
+        gather(worldOriginTransform);
+    } else {
+        // only update the entries whose components changed
+        update(worldOriginTransform,
+                transformVersion != mTransformVersion,
+                renderableVersion != mRenderableVersion,
+                lightVersion != mLightVersion);
+    }
+
+    if (mCullingHierarchyEnabled) {
+        updateCullingHierarchy(gathered);
+    }
 
-    // NOTE: we can't know in advance how many entities are renderable or lights because the corresponding
-    // component can be added after the entity is added to the scene.
+    mTransformVersion = transformVersion;
+    mRenderableVersion = renderableVersion;
+    mLightVersion = lightVersion;
+    mDestroyedEntityVersion = destroyedEntityVersion;
+
+    // go through the list of gathered entities, and copy their data into the per-view arrays
+    auto& sceneData = mRenderableData;
+    auto& lightData = mLightData;
+    auto const& renderableCache = mRenderableCache;
+    auto const& lightCache = mLightCache;
 
-    size_t renderableDataCapacity = entities.size();
+    size_t renderableDataCapacity = renderableCache.size();
     // we need the capacity to be multiple of 16 for SIMD loops
     renderableDataCapacity = (renderableDataCapacity + 0xFu) & ~0xFu;
     // we need 1 extra entry at the end for the summed primitive count
@@ -75,9 +103,17 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
         sceneData.setCapacity(renderableDataCapacity);
     }
 
+    // this default-constructs all entries, which takes care of the temporaries (i.e.
+    // VISIBLE_MASK, PRIMITIVES and SUMMED_PRIMITIVE_COUNT)
+    const size_t renderableCount = renderableCache.size();
+    sceneData.resize(renderableCount);
+    copyColumns<RENDERABLE_INSTANCE, WORLD_TRANSFORM, REVERSED_WINDING_ORDER, VISIBILITY_STATE,
+            BONES_OFFSET, WORLD_AABB_CENTER, MORPH_WEIGHTS, LAYERS, WORLD_AABB_EXTENT>(
+                    sceneData, renderableCache, renderableCount);
+
     // The light data list will always contain at least one entry for the
     // dominating directional light, even if there are no entities.
-    size_t lightDataCapacity = std::max<size_t>(1, entities.size());
+    size_t lightDataCapacity = lightCache.size() + DIRECTIONAL_LIGHTS_COUNT;
     // we need the capacity to be multiple of 16 for SIMD loops
     lightDataCapacity = (lightDataCapacity + 0xFu) & ~0xFu;
 
@@ -88,90 +124,364 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
     // the first entries are reserved for the directional lights (currently only one)
     lightData.resize(DIRECTIONAL_LIGHTS_COUNT);
 
-
     // find the max intensity directional light index in our local array
     float maxIntensity = 0.0f;
 
-    for (Entity e : entities) {
-        if (!em.isAlive(e)) {
-            continue;
+    for (size_t i = 0, c = lightCache.size(); i < c; i++) {
+        auto li = lightCache.elementAt<LIGHT_INSTANCE>(i);
+        // find the dominant directional light
+        if (UTILS_UNLIKELY(lcm.isDirectionalLight(li))) {
+            // we don't store the directional lights, because we only have a single one
+            if (lcm.getIntensity(li) >= maxIntensity) {
+                maxIntensity = lcm.getIntensity(li);
+                lightData.elementAt<FScene::POSITION_RADIUS>(0) =
+                        lightCache.elementAt<POSITION_RADIUS>(i);
+                lightData.elementAt<FScene::DIRECTION>(0)       =
+                        lightCache.elementAt<DIRECTION>(i);
+                lightData.elementAt<FScene::LIGHT_INSTANCE>(0)  = li;
+            }
+        } else {
+            lightData.push_back_unsafe(
+                    lightCache.elementAt<POSITION_RADIUS>(i),
+                    lightCache.elementAt<DIRECTION>(i), li, {}, {}, {});
         }
+    }
 
-        // getInstance() always returns null if the entity is the Null entity
-        // so we don't need to check for that, but we need to check it's alive
-        auto ri = rcm.getInstance(e);
-        auto li = lcm.getInstance(e);
-        if (!ri & !li) {
-            continue;
-        }
+    // some elements past the end of the array will be accessed by SIMD code, we need to make
+    // sure the data is valid enough as not to produce errors such as divide-by-zero
+    // (e.g. in computeLightRanges())
+    for (size_t i = lightData.size(), e = (lightData.size() + 3u) & ~3u; i < e; i++) {
+        new(lightData.data<POSITION_RADIUS>() + i) float4{ 0, 0, 0, 1 };
+    }
+}
 
-        // get the world transform
-        auto ti = tcm.getInstance(e);
-        const mat4f worldTransform = worldOriginTransform * tcm.getWorldTransform(ti);
-        const bool reversedWindingOrder = det(worldTransform.upperLeft()) < 0;
-
-        // don't even draw this object if it doesn't have a transform (which shouldn't happen
-        // because one is always created when creating a Renderable component).
-        if (ri && ti) {
-            // compute the world AABB so we can perform culling
-            const Box worldAABB = rigidTransform(rcm.getAABB(ri), worldTransform);
-
-            // we know there is enough space in the array
-            sceneData.push_back_unsafe(
-                    ri,                       // RENDERABLE_INSTANCE
-                    worldTransform,           // WORLD_TRANSFORM
-                    reversedWindingOrder,     // REVERSED_WINDING_ORDER
-                    rcm.getVisibility(ri),    // VISIBILITY_STATE
-                    rcm.getBonesUbh(ri),      // BONES_UBH
-                    worldAABB.center,         // WORLD_AABB_CENTER
-                    0,                        // VISIBLE_MASK
-                    rcm.getMorphWeights(ri),  // MORPH_WEIGHTS
-                    rcm.getLayerMask(ri),     // LAYERS
-                    worldAABB.halfExtent,     // WORLD_AABB_EXTENT
-                    {},                       // PRIMITIVES
-                    0                         // SUMMED_PRIMITIVE_COUNT
-            );
+bool FScene::needsGather(const mat4f& worldOriginTransform,
+        uint32_t destroyedEntityVersion) const noexcept {
+    FEngine& engine = mEngine;
+    if (mEntitiesChanged ||
+            engine.getTransformManager().getStructureVersion() != mTransformStructureVersion ||
+            engine.getRenderableManager().getStructureVersion() != mRenderableStructureVersion ||
+            engine.getLightManager().getStructureVersion() != mLightStructureVersion) {
+        return true;
+    }
+
+    mat4f const& origin = mGatherWorldOrigin;
+    if (origin[0] != worldOriginTransform[0] || origin[1] != worldOriginTransform[1] ||
+        origin[2] != worldOriginTransform[2] || origin[3] != worldOriginTransform[3]) {
+        return true;
+    }
+
+    // entities can be destroyed without their components being removed right away, but we only
+    // need to look for them if some entities were destroyed since the last prepare()
+    if (destroyedEntityVersion == mDestroyedEntityVersion) {
+        return false;
+    }
+    EntityManager& em = engine.getEntityManager();
+    auto isDead = [&em](GatherKey const& key) { return !em.isAlive(key.entity); };
+    return std::any_of(mRenderableKeys.begin(), mRenderableKeys.end(), isDead) ||
+           std::any_of(mLightKeys.begin(), mLightKeys.end(), isDead);
+}
+
+void FScene::gather(const mat4f& worldOriginTransform) noexcept {
+    SYSTRACE_CALL();
+
+    FEngine& engine = mEngine;
+    JobSystem& js = engine.getJobSystem();
+    EntityManager& em = engine.getEntityManager();
+    FRenderableManager& rcm = engine.getRenderableManager();
+    FTransformManager& tcm = engine.getTransformManager();
+    FLightManager& lcm = engine.getLightManager();
+
+    // flatten the set of entities, so we can process it in parallel
+    auto& entities = mGatherEntities;
+    entities.assign(mEntities.begin(), mEntities.end());
+
+    const uint32_t entityCount = uint32_t(entities.size());
+    const uint32_t chunkCount = (entityCount + GATHER_CHUNK_SIZE - 1) / GATHER_CHUNK_SIZE;
+
+    auto& instances = mGatherInstances;
+    auto& chunks = mGatherChunks;
+    instances.resize(entityCount);
+    chunks.resize(chunkCount);
+
+    // NOTE: we can't know in advance how many entities are renderable or lights because the corresponding
+    // component can be added after the entity is added to the scene.
+    // So, first we find the components of each entity, and count renderables and lights per chunk.
+    auto findComponents = [&](uint32_t firstChunk, uint32_t count) {
+        for (uint32_t c = firstChunk; c < firstChunk + count; c++) {
+            GatherChunk chunk{};
+            const uint32_t first = c * GATHER_CHUNK_SIZE;
+            const uint32_t last = std::min(first + GATHER_CHUNK_SIZE, entityCount);
+            for (uint32_t i = first; i < last; i++) {
+                Entity const e = entities[i];
+                GatherInstances& gi = instances[i];
+                gi = {};
+                if (em.isAlive(e)) {
+                    // getInstance() always returns null if the entity is the Null entity
+                    // so we don't need to check for that, but we need to check it's alive
+                    gi.ri = rcm.getInstance(e);
+                    gi.li = lcm.getInstance(e);
+                    if (gi.ri || gi.li) {
+                        gi.ti = tcm.getInstance(e);
+                    }
+                    // don't even draw this object if it doesn't have a transform (which
+                    // shouldn't happen because one is always created when creating a
+                    // Renderable component).
+                    if (!gi.ti) {
+                        gi.ri = {};
+                    }
+                }
+                chunk.renderables += gi.ri ? 1 : 0;
+                chunk.lights += gi.li ? 1 : 0;
+            }
+            chunks[c] = chunk;
         }
+    };
+
+    auto* job = jobs::parallel_for(js, nullptr, 0, chunkCount,
+            std::ref(findComponents), jobs::CountSplitter<1, 8>());
+    js.runAndWait(job);
+
+    // exclusive prefix-sum of the per-chunk counts gives the offset of each chunk in the cache
+    uint32_t renderableCount = 0;
+    uint32_t lightCount = 0;
+    for (GatherChunk& chunk : chunks) {
+        const GatherChunk counts = chunk;
+        chunk = { renderableCount, lightCount };
+        renderableCount += counts.renderables;
+        lightCount += counts.lights;
+    }
 
-        if (li) {
-            // find the dominant directional light
-            if (UTILS_UNLIKELY(lcm.isDirectionalLight(li))) {
-                // we don't store the directional lights, because we only have a single one
-                if (lcm.getIntensity(li) >= maxIntensity) {
-                    maxIntensity = lcm.getIntensity(li);
-                    float3 d = lcm.getLocalDirection(li);
-                    // using mat3f::getTransformForNormals handles non-uniform scaling
-                    d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
-                    lightData.elementAt<FScene::POSITION_RADIUS>(0) =
-                            float4{ 0, 0, 0, std::numeric_limits<float>::infinity() };
-                    lightData.elementAt<FScene::DIRECTION>(0)       = d;
-                    lightData.elementAt<FScene::LIGHT_INSTANCE>(0)  = li;
+    mRenderableCache.clear();
+    mRenderableCache.resize(renderableCount);
+    mRenderableKeys.resize(renderableCount);
+    mWorldAABBs.resize(Culler::getBlockCount(renderableCount));
+    mLightCache.clear();
+    mLightCache.resize(lightCount);
+    mLightKeys.resize(lightCount);
+
+    // then, each chunk writes its renderables and lights at its offset, in the same order as
+    // a serial traversal of the entities would.
+    auto gatherComponents = [&](uint32_t firstChunk, uint32_t count) {
+        for (uint32_t c = firstChunk; c < firstChunk + count; c++) {
+            uint32_t r = chunks[c].renderables;
+            uint32_t l = chunks[c].lights;
+            const uint32_t first = c * GATHER_CHUNK_SIZE;
+            const uint32_t last = std::min(first + GATHER_CHUNK_SIZE, entityCount);
+            for (uint32_t i = first; i < last; i++) {
+                GatherInstances const& gi = instances[i];
+                if (gi.ri) {
+                    mRenderableCache.elementAt<RENDERABLE_INSTANCE>(r) = gi.ri;
+                    mRenderableKeys[r] = { entities[i], gi.ti };
+                    gatherRenderable(r, worldOriginTransform);
+                    r++;
                 }
-            } else {
-                const float4 p = worldTransform * float4{ lcm.getLocalPosition(li), 1 };
-                float3 d = 0;
-                if (!lcm.isPointLight(li) || lcm.isIESLight(li)) {
-                    d = lcm.getLocalDirection(li);
-                    // using mat3f::getTransformForNormals handles non-uniform scaling
-                    d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
+                if (gi.li) {
+                    mLightCache.elementAt<LIGHT_INSTANCE>(l) = gi.li;
+                    mLightKeys[l] = { entities[i], gi.ti };
+                    gatherLight(l, worldOriginTransform);
+                    l++;
                 }
-                lightData.push_back_unsafe(
-                        float4{ p.xyz, lcm.getRadius(li) }, d, li, {}, {}, {});
             }
         }
+    };
+
+    job = jobs::parallel_for(js, nullptr, 0, chunkCount,
+            std::ref(gatherComponents), jobs::CountSplitter<1, 8>());
+    js.runAndWait(job);
+
+    mGatherWorldOrigin = worldOriginTransform;
+    mTransformStructureVersion = tcm.getStructureVersion();
+    mRenderableStructureVersion = rcm.getStructureVersion();
+    mLightStructureVersion = lcm.getStructureVersion();
+    mEntitiesChanged = false;
+}
+
+void FScene::update(const mat4f& worldOriginTransform,
+        bool transformsChanged, bool renderablesChanged, bool lightsChanged) noexcept {
+    SYSTRACE_CALL();
+
+    FEngine& engine = mEngine;
+    JobSystem& js = engine.getJobSystem();
+    FRenderableManager const& rcm = engine.getRenderableManager();
+    FTransformManager const& tcm = engine.getTransformManager();
+    FLightManager const& lcm = engine.getLightManager();
+
+    if (transformsChanged || renderablesChanged) {
+        auto const* const keys = mRenderableKeys.data();
+        auto const* const instances = mRenderableCache.data<RENDERABLE_INSTANCE>();
+        uint8_t* const moved = mCullingHierarchyValid ? mMovedRenderables.data() : nullptr;
+        auto work = [&, keys, instances, moved](uint32_t first, uint32_t count) {
+            for (uint32_t i = first; i < first + count; i++) {
+                if ((transformsChanged && tcm.getVersion(keys[i].ti) >= mTransformVersion) ||
+                    (renderablesChanged && rcm.getVersion(instances[i]) >= mRenderableVersion)) {
+                    gatherRenderable(i, worldOriginTransform);
+                    if (moved) {
+                        moved[i] = 1;
+                    }
+                }
+            }
+        };
+        auto* job = jobs::parallel_for(js, nullptr, 0, uint32_t(mRenderableCache.size()),
+                std::ref(work), jobs::CountSplitter<GATHER_CHUNK_SIZE, 8>());
+        js.runAndWait(job);
     }
 
-    // some elements past the end of the array will be accessed by SIMD code, we need to make
-    // sure the data is valid enough as not to produce errors such as divide-by-zero
-    // (e.g. in computeLightRanges())
-    for (size_t i = lightData.size(), e = (lightData.size() + 3u) & ~3u; i < e; i++) {
-        new(lightData.data<POSITION_RADIUS>() + i) float4{ 0, 0, 0, 1 };
+    if (transformsChanged || lightsChanged) {
+        // there are typically few lights, don't bother doing this in parallel
+        auto const* const keys = mLightKeys.data();
+        auto const* const instances = mLightCache.data<LIGHT_INSTANCE>();
+        for (size_t i = 0, c = mLightCache.size(); i < c; i++) {
+            if ((transformsChanged && tcm.getVersion(keys[i].ti) >= mTransformVersion) ||
+                (lightsChanged && lcm.getVersion(instances[i]) >= mLightVersion)) {
+                gatherLight(i, worldOriginTransform);
+            }
+        }
     }
 }
 
+void FScene::gatherRenderable(size_t index, const mat4f& worldOriginTransform) noexcept {
+    FEngine& engine = mEngine;
+    FRenderableManager& rcm = engine.getRenderableManager();
+    FTransformManager& tcm = engine.getTransformManager();
+    auto& cache = mRenderableCache;
+
+    auto ri = cache.elementAt<RENDERABLE_INSTANCE>(index);
+    auto ti = mRenderableKeys[index].ti;
+
+    // get the world transform
+    const mat4f worldTransform = worldOriginTransform * tcm.getWorldTransform(ti);
+    const bool reversedWindingOrder = det(worldTransform.upperLeft()) < 0;
+
+    // compute the world AABB so we can perform culling
+    const Box worldAABB = rigidTransform(rcm.getAABB(ri), worldTransform);
+
+    cache.elementAt<WORLD_TRANSFORM>(index)         = worldTransform;
+    cache.elementAt<REVERSED_WINDING_ORDER>(index)  = reversedWindingOrder;
+    cache.elementAt<VISIBILITY_STATE>(index)        = rcm.getVisibility(ri);
+    cache.elementAt<BONES_OFFSET>(index)            = rcm.getBonesOffset(ri);
+    cache.elementAt<WORLD_AABB_CENTER>(index)       = worldAABB.center;
+    cache.elementAt<MORPH_WEIGHTS>(index)           = rcm.getMorphWeights(ri);
+    cache.elementAt<LAYERS>(index)                  = rcm.getLayerMask(ri);
+    cache.elementAt<WORLD_AABB_EXTENT>(index)       = worldAABB.halfExtent;
+    Culler::setAabb(mWorldAABBs.data(), index, worldAABB.center, worldAABB.halfExtent);
+}
+
+void FScene::updateCullingHierarchy(bool rebuild) noexcept {
+    Bvh& bvh = mCullingHierarchy;
+    if (rebuild || !mCullingHierarchyValid || bvh.needsRebuild()) {
+        const size_t count = mRenderableCache.size();
+        bvh.build(mWorldAABBs.data(), count);
+        mMovedRenderables.assign(count, 0);
+        mCullingHierarchyValid = true;
+    } else {
+        bvh.refit(mWorldAABBs.data(), mMovedRenderables.data());
+    }
+}
+
+void FScene::setCullingHierarchyEnabled(bool enabled) noexcept {
+    mCullingHierarchyEnabled = enabled;
+    if (!enabled) {
+        // free the memory, the hierarchy is rebuilt from scratch if re-enabled
+        mCullingHierarchy.clear();
+        mMovedRenderables = {};
+        mCullingHierarchyValid = false;
+    }
+}
+
+void FScene::gatherLight(size_t index, const mat4f& worldOriginTransform) noexcept {
+    FEngine& engine = mEngine;
+    FLightManager& lcm = engine.getLightManager();
+    FTransformManager& tcm = engine.getTransformManager();
+    auto& cache = mLightCache;
+
+    auto li = cache.elementAt<LIGHT_INSTANCE>(index);
+    auto ti = mLightKeys[index].ti;
+
+    // get the world transform
+    const mat4f worldTransform = worldOriginTransform * tcm.getWorldTransform(ti);
+
+    if (UTILS_UNLIKELY(lcm.isDirectionalLight(li))) {
+        float3 d = lcm.getLocalDirection(li);
+        // using mat3f::getTransformForNormals handles non-uniform scaling
+        d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
+        cache.elementAt<POSITION_RADIUS>(index) =
+                float4{ 0, 0, 0, std::numeric_limits<float>::infinity() };
+        cache.elementAt<DIRECTION>(index) = d;
+    } else {
+        const float4 p = worldTransform * float4{ lcm.getLocalPosition(li), 1 };
+        float3 d = 0;
+        if (!lcm.isPointLight(li) || lcm.isIESLight(li)) {
+            d = lcm.getLocalDirection(li);
+            // using mat3f::getTransformForNormals handles non-uniform scaling
+            d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
+        }
+        cache.elementAt<POSITION_RADIUS>(index) = float4{ p.xyz, lcm.getRadius(li) };
+        cache.elementAt<DIRECTION>(index) = d;
+    }
+}
+
+size_t FScene::getRenderableUBOSize(size_t count) noexcept {
+    return (count + CONFIG_MAX_INSTANCES - 1) * sizeof(PerRenderableUib);
+}
+
+void FScene::writeRenderableUib(void* buffer, size_t offset,
+        RenderableSoa const& soa, uint32_t index) noexcept {
+    mat4f const& model = soa.elementAt<WORLD_TRANSFORM>(index);
+
+    UniformBuffer::setUniform(buffer,
+            offset + offsetof(PerRenderableUib, worldFromModelMatrix), model);
+
+    // Using mat3f::getTransformForNormals handles non-uniform scaling, but DOESN'T guarantee that
+    // the transformed normals will have unit-length, therefore they need to be normalized
+    // in the shader (that's already the case anyways, since normalization is needed after
+    // interpolation).
+    //
+    // We pre-scale normals by the inverse of the largest scale factor to avoid
+    // large post-transform magnitudes in the shader, especially in the fragment shader, where
+    // we use medium precision.
+    //
+    // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
+
+    mat3f m = mat3f::getTransformForNormals(model.upperLeft());
+    m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
+
+    // The shading normal must be flipped for mirror transformations.
+    // Basically we're shading the other side of the polygon and therefore need to negate the
+    // normal, similar to what we already do to support double-sided lighting.
+    if (soa.elementAt<REVERSED_WINDING_ORDER>(index)) {
+        m = -m;
+    }
+
+    UniformBuffer::setUniform(buffer,
+            offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix), m);
+
+    // Note that we cast bool to uint32_t. Booleans are byte-sized in C++, but we need to
+    // initialize all 32 bits in the UBO field.
+
+    FRenderableManager::Visibility visibility = soa.elementAt<VISIBILITY_STATE>(index);
+    UniformBuffer::setUniform(buffer,
+            offset + offsetof(PerRenderableUib, skinningEnabled),
+            uint32_t(visibility.skinning));
+
+    UniformBuffer::setUniform(buffer,
+            offset + offsetof(PerRenderableUib, morphingEnabled),
+            uint32_t(visibility.morphing));
+
+    UniformBuffer::setUniform(buffer,
+            offset + offsetof(PerRenderableUib, screenSpaceContactShadows),
+            uint32_t(visibility.screenSpaceContactShadows));
+
+    UniformBuffer::setUniform(buffer,
+            offset + offsetof(PerRenderableUib, morphWeights),
+            soa.elementAt<MORPH_WEIGHTS>(index));
+}
+
 void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Handle<backend::HwUniformBuffer> renderableUbh) noexcept {
     FEngine::DriverApi& driver = mEngine.getDriverApi();
-    const size_t size = visibleRenderables.size() * sizeof(PerRenderableUib);
+
+    // we upload the padding as well, see getRenderableUBOSize()
+    const size_t size = getRenderableUBOSize(visibleRenderables.size());
 
     // allocate space into the command stream directly
     void* const buffer = driver.allocate(size);
@@ -179,56 +489,9 @@ void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Hand
     bool hasContactShadows = false;
     auto& sceneData = mRenderableData;
     for (uint32_t i : visibleRenderables) {
-        mat4f const& model = sceneData.elementAt<WORLD_TRANSFORM>(i);
-        const size_t offset = i * sizeof(PerRenderableUib);
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelMatrix), model);
-
-        // Using mat3f::getTransformForNormals handles non-uniform scaling, but DOESN'T guarantee that
-        // the transformed normals will have unit-length, therefore they need to be normalized
-        // in the shader (that's already the case anyways, since normalization is needed after
-        // interpolation).
-        //
-        // We pre-scale normals by the inverse of the largest scale factor to avoid
-        // large post-transform magnitudes in the shader, especially in the fragment shader, where
-        // we use medium precision.
-        //
-        // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
-
-        mat3f m = mat3f::getTransformForNormals(model.upperLeft());
-        m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
-
-        // The shading normal must be flipped for mirror transformations.
-        // Basically we're shading the other side of the polygon and therefore need to negate the
-        // normal, similar to what we already do to support double-sided lighting.
-        if (sceneData.elementAt<REVERSED_WINDING_ORDER>(i)) {
-            m = -m;
-        }
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix), m);
-
-        // Note that we cast bool to uint32_t. Booleans are byte-sized in C++, but we need to
-        // initialize all 32 bits in the UBO field.
-
+        writeRenderableUib(buffer, i * sizeof(PerRenderableUib), sceneData, i);
         FRenderableManager::Visibility visibility = sceneData.elementAt<VISIBILITY_STATE>(i);
         hasContactShadows = hasContactShadows || visibility.screenSpaceContactShadows;
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, skinningEnabled),
-                uint32_t(visibility.skinning));
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, morphingEnabled),
-                uint32_t(visibility.morphing));
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, screenSpaceContactShadows),
-                uint32_t(visibility.screenSpaceContactShadows));
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, morphWeights),
-                sceneData.elementAt<MORPH_WEIGHTS>(i));
     }
 
     // TODO: handle static objects separately
@@ -359,14 +622,17 @@ inline void FScene::computeLightRanges(
 }
 
 void FScene::addEntity(Entity entity) {
+    mEntitiesChanged = true;
     mEntities.insert(entity);
 }
 
 void FScene::addEntities(const Entity* entities, size_t count) {
+    mEntitiesChanged = true;
     mEntities.insert(entities, entities + count);
 }
 
 void FScene::remove(Entity entity) {
+    mEntitiesChanged = true;
     mEntities.erase(entity);
 }
 
@@ -482,4 +748,12 @@ bool Scene::hasEntity(Entity entity) const noexcept {
     return upcast(this)->hasEntity(entity);
 }
 
+void Scene::setCullingHierarchyEnabled(bool enabled) noexcept {
+    upcast(this)->setCullingHierarchyEnabled(enabled);
+}
+
+bool Scene::isCullingHierarchyEnabled() const noexcept {
+    return upcast(this)->isCullingHierarchyEnabled();
+}
+
 } // namespace filament
@@ -308,8 +308,8 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(
         map.update(lightData, 0, scene, viewingCameraInfo, visibleLayers,
                 layout, cascadeParams);
         Frustum const& frustum = map.getCamera().getFrustum();
-        FView::cullRenderables(engine.getJobSystem(), renderableData, frustum,
-                VISIBLE_DIR_SHADOW_RENDERABLE_BIT);
+        FView::cullRenderables(engine.getJobSystem(), *scene, renderableData,
+                frustum, VISIBLE_DIR_SHADOW_RENDERABLE_BIT);
 
         // Set shadowBias, using the first directional cascade.
         const float texelSizeWorldSpace = map.getTexelSizeWorldSpace();
@@ -467,8 +467,8 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateSpotShadowMaps(
             // Cull shadow casters
             UniformBuffer& u = shadowUb;
             Frustum const& frustum = shadowMap.getCamera().getFrustum();
-            FView::cullRenderables(engine.getJobSystem(), renderableData, frustum,
-                    VISIBLE_SPOT_SHADOW_RENDERABLE_N_BIT(i));
+            FView::cullRenderables(engine.getJobSystem(), *scene, renderableData,
+                    frustum, VISIBLE_SPOT_SHADOW_RENDERABLE_N_BIT(i));
 
             mat4f const& lightFromWorldMatrix =
                 view.hasVsm() ? shadowMap.getLightSpaceMatrixVsm() : shadowMap.getLightSpaceMatrix();
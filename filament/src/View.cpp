@@ -485,12 +485,12 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
         merged = Range{ 0, iSpotLightCastersEnd };
 
         // update those UBOs
-        const size_t size = merged.size() * sizeof(PerRenderableUib);
-        if (size) {
+        if (!merged.empty()) {
+            const size_t size = FScene::getRenderableUBOSize(merged.size());
             if (mRenderableUBOSize < size) {
                 // allocate 1/3 extra, with a minimum of 16 objects
                 const size_t count = std::max(size_t(16u), (4u * merged.size() + 2u) / 3u);
-                mRenderableUBOSize = uint32_t(count * sizeof(PerRenderableUib));
+                mRenderableUBOSize = uint32_t(FScene::getRenderableUBOSize(count));
                 driver.destroyUniformBuffer(mRenderableUbh);
                 mRenderableUbh = driver.createUniformBuffer(mRenderableUBOSize,
                         backend::BufferUsage::STREAM);
@@ -543,9 +543,8 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
     u.setUniform(offsetof(PerViewUib, fogInscatteringSize),  fogOptions.inScatteringSize);
     u.setUniform(offsetof(PerViewUib, fogColorFromIbl),      fogOptions.fogColorFromIbl ? 1.0f : 0.0f);
 
-    // upload the renderables's dirty UBOs
-    engine.getRenderableManager().prepare(driver,
-            renderableData.data<FScene::RENDERABLE_INSTANCE>(), merged);
+    // upload the renderables's bones
+    engine.getRenderableManager().prepare(driver);
 
     // set uniforms and samplers
     bindPerViewUniformsAndSamplers(driver);
@@ -721,33 +720,43 @@ void FView::prepareVisibleRenderables(JobSystem& js,
         Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept {
     SYSTRACE_CALL();
     if (UTILS_LIKELY(isFrustumCullingEnabled())) {
-        FView::cullRenderables(js, renderableData, frustum, VISIBLE_RENDERABLE_BIT);
+        FView::cullRenderables(js, *getScene(), renderableData,
+                frustum, VISIBLE_RENDERABLE_BIT);
     } else {
         std::uninitialized_fill(renderableData.begin<FScene::VISIBLE_MASK>(),
                   renderableData.end<FScene::VISIBLE_MASK>(), VISIBLE_RENDERABLE);
     }
 }
 
-void FView::cullRenderables(JobSystem& js,
+void FView::cullRenderables(JobSystem& js, FScene const& scene,
         FScene::RenderableSoa& renderableData, Frustum const& frustum, size_t bit) noexcept {
 
-    float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
-    float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    Culler::AabbBlock const* worldAABBs = scene.getWorldAABBs();
     FScene::VisibleMaskType* visibleArray = renderableData.data<FScene::VISIBLE_MASK>();
 
-    // culling job (this runs on multiple threads)
-    auto functor = [&frustum, worldAABBCenter, worldAABBExtent, visibleArray, bit]
-            (uint32_t index, uint32_t c) {
+    Bvh const* const hierarchy = scene.getCullingHierarchy();
+    if (hierarchy) {
+        // the hierarchy lets us skip entire groups of invisible renderables, the remaining work
+        // is proportional to the number of visible renderables, so we don't split it.
+        assert(hierarchy->getPrimitiveCount() == renderableData.size());
+        hierarchy->cull(visibleArray, frustum, worldAABBs, bit);
+        return;
+    }
+
+    // culling job (this runs on multiple threads), we split the work by blocks of
+    // Culler::MODULO boxes, so that jobs never write the same results.
+    auto functor = [&frustum, worldAABBs, visibleArray, bit](uint32_t block, uint32_t c) {
         Culler::intersects(
-                visibleArray + index,
+                visibleArray + block * Culler::MODULO,
                 frustum,
-                worldAABBCenter + index,
-                worldAABBExtent + index, c, bit);
+                worldAABBs + block,
+                c * Culler::MODULO, bit);
     };
 
     // launch the computation on multiple threads
-    auto *job = jobs::parallel_for(js, nullptr, 0, (uint32_t)renderableData.size(),
-            std::ref(functor), jobs::CountSplitter<Culler::MODULO * Culler::MIN_LOOP_COUNT_HINT, 8>());
+    auto *job = jobs::parallel_for(js, nullptr, 0,
+            (uint32_t)Culler::getBlockCount(renderableData.size()),
+            std::ref(functor), jobs::CountSplitter<Culler::MIN_LOOP_COUNT_HINT, 8>());
     js.runAndWait(job);
 }
 
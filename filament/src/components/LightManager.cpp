@@ -162,6 +162,7 @@ void FLightManager::create(const FLightManager::Builder& builder, utils::Entity
     }
     Instance i = manager.addComponent(entity);
     assert(i);
+    ++mStructureVersion;
 
     if (i) {
         // This needs to happen before we call the set() methods below
@@ -210,6 +211,7 @@ void FLightManager::destroy(utils::Entity e) noexcept {
     if (i) {
         auto& manager = mManager;
         manager.removeComponent(e);
+        ++mStructureVersion;
     }
 }
 
@@ -231,12 +233,14 @@ void FLightManager::setLocalPosition(Instance i, const float3& position) noexcep
     assert(i);
     auto& manager = mManager;
     manager[i].position = position;
+    markDirty(i);
 }
 
 void FLightManager::setLocalDirection(Instance i, float3 direction) noexcept {
     assert(i);
     auto& manager = mManager;
     manager[i].direction = direction;
+    markDirty(i);
 }
 
 void FLightManager::setColor(Instance i, const LinearColor& color) noexcept {
@@ -308,6 +312,7 @@ void FLightManager::setFalloff(Instance i, float falloff) noexcept {
         SpotParams& spotParams = manager[i].spotParams;
         manager[i].squaredFallOffInv = sqFalloff > 0.0f ? (1 / sqFalloff) : 0;
         spotParams.radius = falloff;
+        markDirty(i);
     }
 }
 
@@ -67,7 +67,31 @@ public:
     void prepare(backend::DriverApi& driver) const noexcept;
 
     void gc(utils::EntityManager& em) noexcept {
-        mManager.gc(em);
+        mManager.gc(em, 4, [this](utils::Entity e) {
+            mManager.removeComponent(e);
+            ++mStructureVersion;
+        });
+    }
+
+    /*
+     * Change tracking, used by FScene::prepare() to only re-gather what changed.
+     * See FTransformManager for details.
+     */
+
+    uint32_t getVersion(Instance i) const noexcept {
+        return mManager[i].version;
+    }
+
+    uint32_t getStructureVersion() const noexcept {
+        return mStructureVersion;
+    }
+
+    uint32_t commitVersion() noexcept {
+        if (mHasChanges) {
+            mHasChanges = false;
+            ++mVersion;
+        }
+        return mVersion;
     }
 
     struct LightType {
@@ -222,6 +246,11 @@ public:
 private:
     friend class FScene;
 
+    void markDirty(Instance i) noexcept {
+        mManager[i].version = mVersion;
+        mHasChanges = true;
+    }
+
     enum {
         LIGHT_TYPE,         // light type
         POSITION,           // position in local-space (i.e. pre-transform)
@@ -234,9 +263,10 @@ private:
         SUN_HALO_FALLOFF,   // state for the directional light sun
         INTENSITY,
         FALLOFF,
+        VERSION,            // version at which the scene data last changed
     };
 
-    using Base = utils::SingleInstanceComponentManager<  // 120 bytes
+    using Base = utils::SingleInstanceComponentManager<  // 124 bytes
             LightType,      //  1
             math::float3,   // 12
             math::float3,   // 12
@@ -247,7 +277,8 @@ private:
             float,          //  4
             float,          //  4
             float,          //  4
-            float           //  4
+            float,          //  4
+            uint32_t        //  4
     >;
 
     struct Sim : public Base {
@@ -273,6 +304,7 @@ private:
                 Field<SUN_HALO_FALLOFF>     sunHaloFalloff;
                 Field<INTENSITY>            intensity;
                 Field<FALLOFF>              squaredFallOffInv;
+                Field<VERSION>              version;
             };
         };
 
@@ -286,6 +318,9 @@ private:
 
     Sim mManager;
     FEngine& mEngine;
+    uint32_t mVersion = 0;
+    uint32_t mStructureVersion = 0;
+    bool mHasChanges = false;
 };
 
 FILAMENT_UPCAST(LightManager)
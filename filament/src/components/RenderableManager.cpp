@@ -29,6 +29,11 @@
 #include <utils/Log.h>
 #include <utils/Panic.h>
 
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
+
 using namespace filament::math;
 using namespace utils;
 
@@ -264,6 +269,7 @@ void FRenderableManager::create(
     }
     Instance ci = manager.addComponent(entity);
     assert(ci);
+    ++mStructureVersion;
 
     if (ci) {
         // create and initialize all needed RenderPrimitives
@@ -289,7 +295,7 @@ void FRenderableManager::create(
         const size_t count = builder->mSkinningBoneCount;
         if (UTILS_UNLIKELY(count > 0 || builder->mMorphingEnabled)) {
             std::unique_ptr<Bones>& bones = manager[ci].bones;
-            // Note that we are sizing the bones UBO according to CONFIG_MAX_BONE_COUNT rather than
+            // Note that each renderable binds a range of CONFIG_MAX_BONE_COUNT bones rather than
             // mSkinningBoneCount. According to the OpenGL ES 3.2 specification in 7.6.3 Uniform
             // Buffer Object Bindings:
             //
@@ -297,16 +303,9 @@ void FRenderableManager::create(
             //     than the minimum required size of the uniform block (the value of
             //     UNIFORM_BLOCK_DATA_SIZE).
             //
-            // This unfortunately means that we are using a large memory footprint for skinned
-            // renderables. In the future we could try addressing this by implementing a paging
-            // system such that multiple skinned renderables will share regions within a single
-            // large block of bones.
-            bones = std::unique_ptr<Bones>(new Bones{
-                    driver.createUniformBuffer(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone),
-                            backend::BufferUsage::DYNAMIC),
-                    UniformBuffer{ count * sizeof(PerRenderableUibBone) },
-                    count
-            });
+            // However these ranges can overlap the bones of other renderables, so only count
+            // bones are allocated in the shared bones buffer.
+            bones = std::unique_ptr<Bones>(new Bones{ allocateBones(count), uint32_t(count) });
             assert(bones);
             if (bones) {
                 setSkinning(ci, count > 0);
@@ -316,7 +315,8 @@ void FRenderableManager::create(
                     setBones(ci, builder->mUserBoneMatrices, count);
                 } else {
                     // initialize the bones to identity
-                    PerRenderableUibBone* out = (PerRenderableUibBone*)bones->bones.invalidate();
+                    PerRenderableUibBone* out = (PerRenderableUibBone*)mBones.invalidateUniforms(
+                            bones->offset, count * sizeof(PerRenderableUibBone));
                     std::uninitialized_fill_n(out, count, PerRenderableUibBone{});
                 }
             }
@@ -330,6 +330,7 @@ void FRenderableManager::destroy(utils::Entity e) noexcept {
     if (ci) {
         destroyComponent(ci);
         mManager.removeComponent(e);
+        ++mStructureVersion;
     }
 }
 
@@ -347,6 +348,10 @@ void FRenderableManager::terminate() noexcept {
             manager.removeComponent(manager.getEntity(ci));
         }
     }
+    if (mBonesUbh) {
+        mEngine.getDriverApi().destroyUniformBuffer(mBonesUbh);
+        mBonesUbh.clear();
+    }
 }
 
 // This is basically a Renderable's destructor.
@@ -359,10 +364,10 @@ void FRenderableManager::destroyComponent(Instance ci) noexcept {
     // See create(RenderableManager::Builder&, Entity)
     destroyComponentPrimitives(engine, manager[ci].primitives);
 
-    // destroy the bones structures if any
+    // release the bones if any
     std::unique_ptr<Bones> const& bones = manager[ci].bones;
     if (bones) {
-        driver.destroyUniformBuffer(bones->handle);
+        freeBones(*bones);
     }
 }
 
@@ -375,22 +380,92 @@ void FRenderableManager::destroyComponentPrimitives(
 }
 
 
-void FRenderableManager::prepare(
-        backend::DriverApi& UTILS_RESTRICT driver,
-        Instance const* UTILS_RESTRICT instances,
-        utils::Range<uint32_t> list) const noexcept {
-    const auto& manager = mManager;
+void FRenderableManager::prepare(backend::DriverApi& driver) const noexcept {
+    // all the bones are uploaded at once, the buffer is usually not large enough for tracking
+    // individual ranges to be worth it.
+    if (mBones.isDirty()) {
+        const size_t size = mBones.getSize();
+        void* buffer = malloc(size);
+        memcpy(buffer, mBones.getBuffer(), size);
+        mBones.clean();
+        driver.loadUniformBuffer(mBonesUbh, { buffer, size,
+                [](void* buffer, size_t, void*) { free(buffer); }});
+    }
+}
 
-    std::unique_ptr<Bones>  const * const UTILS_RESTRICT bones = manager.raw_array<BONES>();
-    for (uint32_t index : list) {
-        size_t i = instances[index].asValue();
-        assert(i);  // we should never get the null instance here
-        if (UTILS_UNLIKELY(bones[i])) {
-            if (bones[i]->bones.isDirty()) {
-                driver.loadUniformBuffer(bones[i]->handle, bones[i]->bones.toBufferDescriptor(driver));
-            }
-        }
+uint32_t FRenderableManager::allocateBones(size_t count) noexcept {
+    // renderables with morphing but no skinning still need a (dummy) range
+    const uint32_t blockCount = uint32_t(std::max(size_t(1),
+            (count * sizeof(PerRenderableUibBone) + BONES_BLOCK_SIZE - 1) / BONES_BLOCK_SIZE));
+
+    auto pos = std::find_if(mFreeBones.begin(), mFreeBones.end(),
+            [blockCount](BonesRange const& range) { return range.count >= blockCount; });
+    if (UTILS_UNLIKELY(pos == mFreeBones.end())) {
+        growBones(blockCount);
+        pos = std::find_if(mFreeBones.begin(), mFreeBones.end(),
+                [blockCount](BonesRange const& range) { return range.count >= blockCount; });
+        assert(pos != mFreeBones.end());
+    }
+
+    // first fit
+    const uint32_t first = pos->first;
+    pos->first += blockCount;
+    pos->count -= blockCount;
+    if (!pos->count) {
+        mFreeBones.erase(pos);
+    }
+    return uint32_t(first * BONES_BLOCK_SIZE);
+}
+
+void FRenderableManager::freeBones(Bones const& bones) noexcept {
+    const uint32_t first = uint32_t(bones.offset / BONES_BLOCK_SIZE);
+    const uint32_t blockCount = uint32_t(std::max(size_t(1),
+            (bones.count * sizeof(PerRenderableUibBone) + BONES_BLOCK_SIZE - 1) / BONES_BLOCK_SIZE));
+
+    // insert the range in the sorted list, and merge it with its neighbors
+    auto pos = std::lower_bound(mFreeBones.begin(), mFreeBones.end(), first,
+            [](BonesRange const& range, uint32_t first) { return range.first < first; });
+    pos = mFreeBones.insert(pos, { first, blockCount });
+    if (pos + 1 != mFreeBones.end() && pos->first + pos->count == (pos + 1)->first) {
+        pos->count += (pos + 1)->count;
+        mFreeBones.erase(pos + 1);
+    }
+    if (pos != mFreeBones.begin() && (pos - 1)->first + (pos - 1)->count == pos->first) {
+        (pos - 1)->count += pos->count;
+        mFreeBones.erase(pos);
+    }
+}
+
+void FRenderableManager::growBones(size_t blockCount) noexcept {
+    FEngine::DriverApi& driver = mEngine.getDriverApi();
+
+    // block 0 is reserved so that an offset of 0 means "no bones"
+    const uint32_t oldBlockCount = std::max(mBonesBlockCount, 1u);
+    const uint32_t newBlockCount = uint32_t(std::max({
+            size_t(oldBlockCount) * 2, oldBlockCount + blockCount, size_t(64) }));
+
+    if (!mFreeBones.empty() &&
+            mFreeBones.back().first + mFreeBones.back().count == oldBlockCount) {
+        mFreeBones.back().count += newBlockCount - oldBlockCount;
+    } else {
+        mFreeBones.push_back({ oldBlockCount, newBlockCount - oldBlockCount });
+    }
+    mBonesBlockCount = newBlockCount;
+
+    // the last block must be followed by a whole range
+    const size_t size = newBlockCount * BONES_BLOCK_SIZE + BONES_RANGE_SIZE;
+    UniformBuffer bones(size);
+    void* const out = bones.invalidate();
+    memset(out, 0, size);
+    if (mBones.getSize()) {
+        memcpy(out, mBones.getBuffer(), mBones.getSize());
+    }
+    mBones = std::move(bones);
+
+    if (mBonesUbh) {
+        driver.destroyUniformBuffer(mBonesUbh);
     }
+    mBonesUbh = driver.createUniformBuffer(size, backend::BufferUsage::DYNAMIC);
 }
 
 void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
@@ -473,8 +548,8 @@ void FRenderableManager::setBones(Instance ci,
         assert(bones && offset + boneCount <= bones->count);
         if (bones) {
             boneCount = std::min(boneCount, bones->count - offset);
-            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)bones->bones.invalidateUniforms(
-                    offset * sizeof(PerRenderableUibBone),
+            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)mBones.invalidateUniforms(
+                    bones->offset + offset * sizeof(PerRenderableUibBone),
                     boneCount * sizeof(PerRenderableUibBone));
             for (size_t i = 0, c = boneCount; i < c; ++i) {
                 out[i].q = transforms[i].unitQuaternion;
@@ -492,8 +567,8 @@ void FRenderableManager::setBones(Instance ci,
         assert(bones && offset + boneCount <= bones->count);
         if (bones) {
             boneCount = std::min(boneCount, bones->count - offset);
-            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)bones->bones.invalidateUniforms(
-                    offset * sizeof(PerRenderableUibBone),
+            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)mBones.invalidateUniforms(
+                    bones->offset + offset * sizeof(PerRenderableUibBone),
                     boneCount * sizeof(PerRenderableUibBone));
             for (size_t i = 0, c = boneCount; i < c; ++i) {
                 makeBone(&out[i], transforms[i]);
@@ -505,6 +580,7 @@ void FRenderableManager::setBones(Instance ci,
 void FRenderableManager::setMorphWeights(Instance ci, const float4& weights) noexcept {
     if (ci) {
         mManager[ci].morphWeights = weights;
+        markDirty(ci);
     }
 }
 
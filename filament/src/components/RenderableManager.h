@@ -35,6 +35,8 @@
 #include <utils/Slice.h>
 #include <utils/Range.h>
 
+#include <vector>
+
 // for gtest
 class FilamentTest_Bones_Test;
 
@@ -84,14 +86,14 @@ public:
 
     void destroy(utils::Entity e) noexcept;
 
-    // - instances is a list of Instance (typically the list from a given scene)
-    // - list is a list of index in 'instances' (typically the visible ones)
-    void prepare(backend::DriverApi& driver,
-            RenderableManager::Instance const* instances,
-            utils::Range<uint32_t> list) const noexcept;
+    // uploads the bones of all renderables, if any changed
+    void prepare(backend::DriverApi& driver) const noexcept;
 
     void gc(utils::EntityManager& em) noexcept {
-        mManager.gc(em);
+        mManager.gc(em, 4, [this](utils::Entity e) {
+            mManager.removeComponent(e);
+            ++mStructureVersion;
+        });
     }
 
     inline void setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept;
@@ -127,9 +129,36 @@ public:
     inline uint8_t getPriority(Instance instance) const noexcept;
     inline filament::math::float4 getMorphWeights(Instance instance) const noexcept;
 
-    inline backend::Handle<backend::HwUniformBuffer> getBonesUbh(Instance instance) const noexcept;
+    // All bones live in a single uniform buffer, each renderable binds the range that starts
+    // at its offset (in bytes). An offset of 0 means the renderable has no bones.
+    backend::Handle<backend::HwUniformBuffer> getBonesUbh() const noexcept { return mBonesUbh; }
+    inline uint32_t getBonesOffset(Instance instance) const noexcept;
     inline uint32_t getBoneCount(Instance instance) const noexcept;
 
+    // size of the range of the bones uniform buffer bound for each renderable
+    static constexpr size_t BONES_RANGE_SIZE = CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone);
+
+
+    /*
+     * Change tracking, used by FScene::prepare() to only re-gather what changed.
+     * See FTransformManager for details.
+     */
+
+    uint32_t getVersion(Instance instance) const noexcept {
+        return mManager[instance].version;
+    }
+
+    uint32_t getStructureVersion() const noexcept {
+        return mStructureVersion;
+    }
+
+    uint32_t commitVersion() noexcept {
+        if (mHasChanges) {
+            mHasChanges = false;
+            ++mVersion;
+        }
+        return mVersion;
+    }
 
     inline size_t getLevelCount(Instance instance) const noexcept { return 1; }
     inline size_t getPrimitiveCount(Instance instance, uint8_t level) const noexcept;
@@ -152,15 +181,31 @@ private:
             utils::Slice<FRenderPrimitive>& primitives) noexcept;
 
     struct Bones {
-        filament::backend::Handle<backend::HwUniformBuffer> handle;
-        UniformBuffer bones;
-        size_t count;
+        uint32_t offset;    // in bytes, in the bones uniform buffer
+        uint32_t count;
+    };
+
+    // Bones are allocated in blocks that satisfy the strictest uniform buffer offset alignment.
+    static constexpr size_t BONES_BLOCK_SIZE = 256;
+
+    struct BonesRange {
+        uint32_t first;     // in blocks
+        uint32_t count;     // in blocks
     };
 
+    uint32_t allocateBones(size_t count) noexcept;
+    void freeBones(Bones const& bones) noexcept;
+    void growBones(size_t blockCount) noexcept;
+
     friend class ::FilamentTest_Bones_Test;
 
     static void makeBone(PerRenderableUibBone* out, math::mat4f const& transforms) noexcept;
 
+    void markDirty(Instance instance) noexcept {
+        mManager[instance].version = mVersion;
+        mHasChanges = true;
+    }
+
     enum {
         AABB,               // user data
         LAYERS,             // user data
@@ -168,6 +213,7 @@ private:
         VISIBILITY,         // user data
         PRIMITIVES,         // user data
         BONES,              // filament data, UBO storing a pointer to the bones information
+        VERSION,            // filament data, version at which the scene data last changed
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -176,7 +222,8 @@ private:
             filament::math::float4,          // MORPH_WEIGHTS
             Visibility,                      // VISIBILITY
             utils::Slice<FRenderPrimitive>,  // PRIMITIVES
-            std::unique_ptr<Bones>           // BONES
+            std::unique_ptr<Bones>,          // BONES
+            uint32_t                         // VERSION
     >;
 
     struct Sim : public Base {
@@ -197,6 +244,7 @@ private:
                 Field<VISIBILITY>   visibility;
                 Field<PRIMITIVES>   primitives;
                 Field<BONES>        bones;
+                Field<VERSION>      version;
             };
         };
 
@@ -210,6 +258,17 @@ private:
 
     Sim mManager;
     FEngine& mEngine;
+
+    // The bones of all renderables are suballocated from a single uniform buffer, which is
+    // uploaded at most once per frame. Each renderable binds a BONES_RANGE_SIZE range of it,
+    // so the buffer extends that far past its last block. Block 0 is never allocated.
+    backend::Handle<backend::HwUniformBuffer> mBonesUbh;
+    UniformBuffer mBones;
+    std::vector<BonesRange> mFreeBones;     // sorted by first block
+    uint32_t mBonesBlockCount = 0;
+    uint32_t mVersion = 0;
+    uint32_t mStructureVersion = 0;
+    bool mHasChanges = false;
 };
 
 FILAMENT_UPCAST(RenderableManager)
@@ -217,6 +276,7 @@ FILAMENT_UPCAST(RenderableManager)
 void FRenderableManager::setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept {
     if (instance) {
         mManager[instance].aabb = aabb;
+        markDirty(instance);
     }
 }
 
@@ -225,12 +285,14 @@ void FRenderableManager::setLayerMask(Instance instance,
     if (instance) {
         uint8_t& layers = mManager[instance].layers;
         layers = (layers & ~select) | (values & select);
+        markDirty(instance);
     }
 }
 
 void FRenderableManager::setLayerMask(Instance instance, uint8_t layerMask) noexcept {
     if (instance) {
         mManager[instance].layers = layerMask;
+        markDirty(instance);
     }
 }
 
@@ -238,6 +300,7 @@ void FRenderableManager::setPriority(Instance instance, uint8_t priority) noexce
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.priority = priority;
+        markDirty(instance);
     }
 }
 
@@ -245,6 +308,7 @@ void FRenderableManager::setCastShadows(Instance instance, bool enable) noexcept
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.castShadows = enable;
+        markDirty(instance);
     }
 }
 
@@ -252,6 +316,7 @@ void FRenderableManager::setReceiveShadows(Instance instance, bool enable) noexc
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.receiveShadows = enable;
+        markDirty(instance);
     }
 }
 
@@ -259,6 +324,7 @@ void FRenderableManager::setScreenSpaceContactShadows(Instance instance, bool en
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.screenSpaceContactShadows = enable;
+        markDirty(instance);
     }
 }
 
@@ -266,6 +332,7 @@ void FRenderableManager::setCulling(Instance instance, bool enable) noexcept {
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.culling = enable;
+        markDirty(instance);
     }
 }
 
@@ -273,6 +340,7 @@ void FRenderableManager::setSkinning(Instance instance, bool enable) noexcept {
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.skinning = enable;
+        markDirty(instance);
     }
 }
 
@@ -280,6 +348,7 @@ void FRenderableManager::setMorphing(Instance instance, bool enable) noexcept {
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.morphing = enable;
+        markDirty(instance);
     }
 }
 
@@ -323,9 +392,9 @@ Box const& FRenderableManager::getAABB(Instance instance) const noexcept {
     return mManager[instance].aabb;
 }
 
-backend::Handle<backend::HwUniformBuffer> FRenderableManager::getBonesUbh(Instance instance) const noexcept {
+uint32_t FRenderableManager::getBonesOffset(Instance instance) const noexcept {
     std::unique_ptr<Bones> const& bones = mManager[instance].bones;
-    return bones ? bones->handle : backend::Handle<backend::HwUniformBuffer>{};
+    return bones ? bones->offset : 0;
 }
 
 inline uint32_t FRenderableManager::getBoneCount(Instance instance) const noexcept {
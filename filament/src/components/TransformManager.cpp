@@ -16,16 +16,33 @@
 
 #include "components/TransformManager.h"
 
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
+
 #include <math/mat4.h>
 
+#include <algorithm>
+
 using namespace utils;
 using namespace filament::math;
 
 namespace filament {
 
-FTransformManager::FTransformManager() noexcept = default;
+FTransformManager::FTransformManager(JobSystem* js) noexcept
+        : mJobSystem(js) {
+    EntityManager::get().registerListener(&mEntityListener);
+}
+
+FTransformManager::~FTransformManager() noexcept {
+    EntityManager::get().unregisterListener(&mEntityListener);
+}
 
-FTransformManager::~FTransformManager() noexcept = default;
+void FTransformManager::EntityListener::onEntitiesDestroyed(size_t n,
+        Entity const* entities) noexcept {
+    if (std::any_of(entities, entities + n, [](Entity e) { return !e.isNull(); })) {
+        version.fetch_add(1, std::memory_order_release);
+    }
+}
 
 void FTransformManager::terminate() noexcept {
 }
@@ -45,12 +62,14 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4f& loca
     Instance i = manager.addComponent(entity);
     assert(i);
     assert(i != parent);
+    ++mStructureVersion;
 
     if (i && i != parent) {
         manager[i].parent = 0;
         manager[i].next = 0;
         manager[i].prev = 0;
         manager[i].firstChild = 0;
+        manager[i].dirty = 0;
         insertNode(i, parent);
         setTransform(i, localTransform);
     }
@@ -68,8 +87,8 @@ void FTransformManager::setParent(Instance i, Instance parent) noexcept {
             updateNodeTransform(i);
             // Note: setParent() doesn't reorder the child after the parent in the array,
             // but that's not a problem because TransformManager doesn't rely on that.
-            // Also note that commitLocalTransformTransaction() does reorder all children after
-            // their parent, as an optimization to calculate the world transform.
+            // Also note that commitLocalTransformTransaction() does reorder all nodes by
+            // depth, as an optimization to calculate the world transform.
         }
     }
 }
@@ -118,11 +137,15 @@ void FTransformManager::destroy(Entity e) noexcept {
         Instance child = manager[i].firstChild;
         while (child) {
             manager[child].parent = 0;
+            // during a transaction, their world transform is updated when committing
+            manager[child].dirty |= uint8_t(mLocalTransformTransactionOpen);
             child = manager[child].next;
         }
 
         // 2) remove the component
         Instance moved = manager.removeComponent(e);
+        ++mStructureVersion;
+        mSortedByLevel = false;
 
         // 3) update the references to the entry now with Instance i
         if (moved != i) {
@@ -141,8 +164,23 @@ void FTransformManager::setTransform(Instance ci, const mat4f& model) noexcept {
     }
 }
 
+void FTransformManager::setTransforms(Instance const* instances, mat4f const* models,
+        size_t count) noexcept {
+    // this is a transaction, which is committed right away unless one was already open
+    const bool commit = !mLocalTransformTransactionOpen;
+    mLocalTransformTransactionOpen = true;
+    for (size_t k = 0; k < count; k++) {
+        setTransform(instances[k], models[k]);
+    }
+    if (commit) {
+        commitLocalTransformTransaction();
+    }
+}
+
 void FTransformManager::updateNodeTransform(Instance i) noexcept {
     if (UTILS_UNLIKELY(mLocalTransformTransactionOpen)) {
+        // the world transform will be updated by commitLocalTransformTransaction()
+        mManager[i].dirty = 1;
         return;
     }
 
@@ -157,11 +195,12 @@ void FTransformManager::updateNodeTransform(Instance i) noexcept {
 
     // compute our world transform
     manager[i].world = pt * static_cast<mat4f const&>(manager[i].local);
+    markDirty(i);
 
     // update our children's world transforms
     Instance child = manager[i].firstChild;
     if (UTILS_UNLIKELY(child)) { // assume we don't have a hierarchy in the common case
-        transformChildren(manager, child);
+        transformChildren(manager, child, mVersion);
     }
 }
 
@@ -172,23 +211,129 @@ void FTransformManager::openLocalTransformTransaction() noexcept {
 void FTransformManager::commitLocalTransformTransaction() noexcept {
     if (mLocalTransformTransactionOpen) {
         mLocalTransformTransactionOpen = false;
-        auto& manager = mManager;
+        if (!mSortedByLevel) {
+            sortByLevel();
+        }
+        updateLevels();
+    }
+}
+
+// Reorders the nodes by depth in the hierarchy (which guarantees that children are always
+// sorted after their parent), and records where each level starts.
+void FTransformManager::sortByLevel() noexcept {
+    SYSTRACE_CALL();
+
+    auto& manager = mManager;
+    const Instance begin = manager.begin();
+    const Instance end = manager.end();
+    const size_t count = end - begin;
+
+    // breadth-first traversal of the hierarchy, starting with all the roots
+    std::vector<Instance> order;
+    order.reserve(count);
+    for (Instance i = begin; i != end; ++i) {
+        if (manager[i].parent == Instance{}) {
+            order.push_back(i);
+        }
+    }
+    mLevels.clear();
+    for (size_t first = 0, last = order.size(); first != last; last = order.size()) {
+        mLevels.push_back(Instance(begin + first));
+        for (; first != last; ++first) {
+            for (Instance child = manager[order[first]].firstChild; child;
+                    child = manager[child].next) {
+                order.push_back(child);
+            }
+        }
+    }
+    mLevels.push_back(end);
+    assert(order.size() == count);
+
+    // swapNode() below needs some temporary storage which we provide here
+    auto& soa = manager.getSoA();
+    soa.ensureCapacity(soa.size() + 1);
+
+    // move each node to its place, the node initially at order[k] ends-up at begin + k
+    std::vector<Instance> nodeAt(count);   // node (initial instance) currently at an instance
+    std::vector<Instance> nodeIn(count);   // current instance of a node (initial instance)
+    for (size_t k = 0; k < count; k++) {
+        nodeAt[k] = nodeIn[k] = Instance(begin + k);
+    }
+    bool reordered = false;
+    for (size_t k = 0; k < count; k++) {
+        const Instance target = Instance(begin + k);
+        const Instance node = order[k];
+        const Instance current = nodeIn[node - begin];
+        if (current != target) {
+            swapNode(target, current);
+            const Instance displaced = nodeAt[k];
+            nodeAt[current - begin] = displaced;
+            nodeIn[displaced - begin] = current;
+            nodeAt[k] = node;
+            nodeIn[node - begin] = target;
+            reordered = true;
+        }
+    }
+    if (reordered) {
+        ++mStructureVersion;
+    }
+    mSortedByLevel = true;
+}
 
-        // swapNode() below needs some temporary storage which we provide here
-        auto& soa = manager.getSoA();
-        soa.ensureCapacity(soa.size() + 1);
+// Updates the world transform of dirty nodes and their descendants, one level at a time.
+void FTransformManager::updateLevels() noexcept {
+    SYSTRACE_CALL();
 
-        mat4f const* const UTILS_RESTRICT world = manager.raw_array<WORLD>();
-        for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
-            // Ensure that children are always sorted after their parent.
-            while (UTILS_UNLIKELY(Instance(manager[i].parent) > i)) {
-                swapNode(i, manager[i].parent);
+    auto& manager = mManager;
+    auto& soa = manager.getSoA();
+    uint8_t* const UTILS_RESTRICT dirty = soa.data<DIRTY>();
+    uint8_t const* const firstDirty = std::find_if(dirty + manager.begin(), dirty + manager.end(),
+            [](uint8_t d) { return d != 0; });
+    if (firstDirty == dirty + manager.end()) {
+        return;
+    }
+
+    mHasChanges = true;
+    const uint32_t version = mVersion;
+    mat4f* const UTILS_RESTRICT world = soa.data<WORLD>();
+    mat4f const* const UTILS_RESTRICT local = soa.data<LOCAL>();
+    Instance const* const UTILS_RESTRICT parent = soa.data<PARENT>();
+    uint32_t* const UTILS_RESTRICT versions = soa.data<VERSION>();
+
+    // The parents of a level are all in the previous levels, which are up-to-date, and
+    // a node is dirty if it or its parent is.
+    // Note: dirty[0] is always 0, so roots don't need special casing.
+    auto update = [=](uint32_t first, uint32_t count) {
+        for (uint32_t i = first, e = first + count; i != e; i++) {
+            const Instance p = parent[i];
+            if (dirty[i] | dirty[p]) {
+                world[i] = world[p] * local[i];
+                versions[i] = version;
+                dirty[i] = 1;
             }
-            Instance parent = manager[i].parent;
-            assert(parent < i);
-            manager[i].world = world[parent] * static_cast<mat4f const&>(manager[i].local);
+        }
+    };
+
+    // Nodes are sorted by level, so the nodes before the first dirty one and their parents are
+    // all clean: start with the level of the first dirty node, at that node.
+    const uint32_t firstDirtyNode = uint32_t(firstDirty - dirty);
+    const auto nextLevel = std::upper_bound(mLevels.begin(), mLevels.end(), firstDirtyNode,
+            [](uint32_t node, Instance levelBegin) { return node < levelBegin; });
+    size_t level = size_t(nextLevel - mLevels.begin()) - 1;
+    for (size_t c = mLevels.size() - 1; level < c; level++) {
+        const uint32_t first = std::max(uint32_t(mLevels[level]), firstDirtyNode);
+        const uint32_t count = mLevels[level + 1] - first;
+        if (mJobSystem && count >= PARALLEL_LEVEL_THRESHOLD) {
+            JobSystem& js = *mJobSystem;
+            auto* job = jobs::parallel_for(js, nullptr, first, count, std::cref(update),
+                    jobs::CountSplitter<256, 8>());
+            js.runAndWait(job);
+        } else {
+            update(first, count);
         }
     }
+
+    std::fill(dirty + firstDirtyNode, dirty + manager.end(), 0);
 }
 
 // Inserts a parentless node in the hierarchy
@@ -196,6 +341,7 @@ void FTransformManager::insertNode(Instance i, Instance parent) noexcept {
     auto& manager = mManager;
 
     assert(manager[i].parent == Instance{});
+    mSortedByLevel = false;
 
     manager[i].parent = parent;
     manager[i].prev = 0;
@@ -225,6 +371,8 @@ void FTransformManager::swapNode(Instance i, Instance j) noexcept {
     // swap the content of the nodes directly
     std::swap(manager.elementAt<LOCAL>(i), manager.elementAt<LOCAL>(j));
     std::swap(manager.elementAt<WORLD>(i), manager.elementAt<WORLD>(j));
+    std::swap(manager.elementAt<VERSION>(i), manager.elementAt<VERSION>(j));
+    std::swap(manager.elementAt<DIRTY>(i), manager.elementAt<DIRTY>(j));
     manager.swap(i, j); // this swaps the data relative to SingleInstanceComponentManager
 
     // now swap the linked-list references, to do that correctly we must use a temporary
@@ -258,6 +406,7 @@ void FTransformManager::swapNode(Instance i, Instance j) noexcept {
 // (making everybody orphaned).
 void FTransformManager::removeNode(Instance i) noexcept {
     auto& manager = mManager;
+    mSortedByLevel = false;
     Instance parent = manager[i].parent;
     Instance prev = manager[i].prev;
     Instance next = manager[i].next;
@@ -311,18 +460,19 @@ void FTransformManager::updateNode(Instance i) noexcept {
     validateNode(next);
 }
 
-void FTransformManager::transformChildren(Sim& manager, Instance ci) noexcept {
+void FTransformManager::transformChildren(Sim& manager, Instance ci, uint32_t version) noexcept {
     while (ci) {
         // update child's world transform
         Instance parent = manager[ci].parent;
         mat4f const& pt = manager[parent].world;
         mat4f const& local = manager[ci].local;
         manager[ci].world = pt * local;
+        manager[ci].version = version;
 
         // assume we don't have a deep hierarchy
         Instance child = manager[ci].firstChild;
         if (UTILS_UNLIKELY(child)) {
-            transformChildren(manager, child);
+            transformChildren(manager, child, version);
         }
 
         // process our next child
@@ -413,6 +563,11 @@ void TransformManager::setTransform(Instance ci, const mat4f& model) noexcept {
     upcast(this)->setTransform(ci, model);
 }
 
+void TransformManager::setTransforms(Instance const* instances, const mat4f* localTransforms,
+        size_t count) noexcept {
+    upcast(this)->setTransforms(instances, localTransforms, count);
+}
+
 const mat4f& TransformManager::getTransform(Instance ci) const noexcept {
     return upcast(this)->getTransform(ci);
 }
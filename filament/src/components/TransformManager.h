@@ -24,17 +24,27 @@
 #include <utils/compiler.h>
 #include <utils/SingleInstanceComponentManager.h>
 #include <utils/Entity.h>
+#include <utils/EntityManager.h>
 #include <utils/Slice.h>
 
 #include <math/mat4.h>
 
+#include <atomic>
+#include <vector>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 
 class UTILS_PRIVATE FTransformManager : public TransformManager {
 public:
     using Instance = TransformManager::Instance;
 
-    FTransformManager() noexcept;
+    // When a JobSystem is provided, commitLocalTransformTransaction() and setTransforms() update
+    // large hierarchy levels in parallel.
+    explicit FTransformManager(utils::JobSystem* js = nullptr) noexcept;
     ~FTransformManager() noexcept;
 
     // free-up all resources
@@ -83,6 +93,9 @@ public:
 
     void setTransform(Instance ci, const math::mat4f& model) noexcept;
 
+    void setTransforms(Instance const* instances, math::mat4f const* models,
+            size_t count) noexcept;
+
     const math::mat4f& getTransform(Instance ci) const noexcept {
         return mManager[ci].local;
     }
@@ -91,16 +104,64 @@ public:
         return mManager[ci].world;
     }
 
+    /*
+     * Change tracking, used by FScene::prepare() to only re-gather what changed.
+     *
+     * Each component is stamped with the current version when its world transform changes.
+     * commitVersion() returns a version V such that all changes made before the call have a
+     * stamp < V and all changes made after the call have a stamp >= V.
+     * The structure version changes whenever instances are created, destroyed or reordered,
+     * in which case all previously obtained Instances must be considered invalid.
+     */
+
+    uint32_t getVersion(Instance ci) const noexcept {
+        return mManager[ci].version;
+    }
+
+    uint32_t getStructureVersion() const noexcept {
+        return mStructureVersion;
+    }
+
+    uint32_t commitVersion() noexcept {
+        if (mHasChanges) {
+            mHasChanges = false;
+            ++mVersion;
+        }
+        return mVersion;
+    }
+
+    /*
+     * Entities can be destroyed before their components are garbage collected, this version
+     * changes whenever entities are destroyed so that users of the components only need to
+     * check which entities are still alive when it does.
+     */
+    uint32_t getDestroyedEntityVersion() const noexcept {
+        return mEntityListener.version.load(std::memory_order_acquire);
+    }
+
 private:
     struct Sim;
 
+    // EntityManager::destroy() is thread safe, so the listener can be called from any thread.
+    struct EntityListener : public utils::EntityManager::Listener {
+        void onEntitiesDestroyed(size_t n, utils::Entity const* entities) noexcept override;
+        std::atomic<uint32_t> version = { 0 };
+    };
+
     void validateNode(Instance i) noexcept;
     void removeNode(Instance i) noexcept;
     void updateNode(Instance i) noexcept;
     void updateNodeTransform(Instance i) noexcept;
     void insertNode(Instance i, Instance p) noexcept;
     void swapNode(Instance i, Instance j) noexcept;
-    static void transformChildren(Sim& manager, Instance firstChild) noexcept;
+    void sortByLevel() noexcept;
+    void updateLevels() noexcept;
+    static void transformChildren(Sim& manager, Instance firstChild, uint32_t version) noexcept;
+
+    void markDirty(Instance i) noexcept {
+        mManager[i].version = mVersion;
+        mHasChanges = true;
+    }
 
     friend class TransformManager::children_iterator;
 
@@ -111,6 +172,8 @@ private:
         FIRST_CHILD,    // instance to our first child
         NEXT,           // instance to our next sibling
         PREV,           // instance to our previous sibling
+        VERSION,        // version at which the world transform last changed
+        DIRTY,          // local transform changed during the current transaction
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -119,7 +182,9 @@ private:
             Instance,
             Instance,
             Instance,
-            Instance
+            Instance,
+            uint32_t,
+            uint8_t
     >;
 
     struct Sim : public Base {
@@ -142,6 +207,8 @@ private:
                 Field<FIRST_CHILD>  firstChild;
                 Field<NEXT>         next;
                 Field<PREV>         prev;
+                Field<VERSION>      version;
+                Field<DIRTY>        dirty;
             };
         };
 
@@ -153,7 +220,23 @@ private:
         }
     };
 
+    // Hierarchy levels are updated one after the other, but nodes of large levels are updated in
+    // parallel.
+    static constexpr size_t PARALLEL_LEVEL_THRESHOLD = 1024;
+
     Sim mManager;
+    utils::JobSystem* const mJobSystem;
+
+    // When sorted, instances are ordered by depth in the hierarchy: mLevels[n] is the first
+    // instance of level n, and the last entry is the end instance.
+    std::vector<Instance> mLevels;
+    bool mSortedByLevel = false;
+
+    EntityListener mEntityListener;
+
+    uint32_t mVersion = 0;
+    uint32_t mStructureVersion = 0;
+    bool mHasChanges = false;
     bool mLocalTransformTransactionOpen = false;
 };
 
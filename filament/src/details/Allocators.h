@@ -34,7 +34,9 @@
 namespace filament {
 
 // per render pass allocations
-// Froxelization needs about 1 MiB. Command buffer needs about 1 MiB.
+// Froxelization needs about 1 MiB. Command buffer needs about 1 MiB. Radix sorting the commands
+// needs about 36 bytes per command on top of that, RenderPass falls back to std::sort() when the
+// arena can't fit it, e.g. for a full command buffer with the default sizes.
 static constexpr size_t CONFIG_PER_RENDER_PASS_ARENA_SIZE  = FILAMENT_PER_RENDER_PASS_ARENA_SIZE_IN_MB * 1024 * 1024;
 
 // size of the high-level draw commands buffer (comes from the per-render pass allocator)
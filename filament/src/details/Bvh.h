@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_BVH_H
+#define TNT_FILAMENT_DETAILS_BVH_H
+
+#include "details/Culler.h"
+
+#include <utils/compiler.h>
+
+#include <math/vec3.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+class Frustum;
+
+/*
+ * A bounding volume hierarchy over an array of AABBs, used to cull large scenes without
+ * testing every single box.
+ *
+ * The tree is built with median splits along the largest axis, and is refit in place when
+ * boxes move. Refitting doesn't change the topology, so the quality of the tree degrades as
+ * boxes move around, needsRebuild() returns true once enough boxes moved since the last
+ * build() that it is worth rebuilding.
+ *
+ * Primitives are identified by their index in the array of boxes given to build(), which is
+ * also the index written by cull().
+ */
+class Bvh {
+public:
+    // maximum number of primitives per leaf
+    static constexpr uint32_t LEAF_SIZE = 4;
+
+    Bvh() noexcept = default;
+    Bvh(Bvh const&) = delete;
+    Bvh& operator=(Bvh const&) = delete;
+
+    // (re)builds the hierarchy over the first 'count' boxes
+    void build(Culler::AabbBlock const* boxes, size_t count) noexcept;
+
+    // Updates the bounds of the nodes containing the primitives flagged in 'dirty', which must
+    // have the same size as the boxes given to build(). All flags are cleared.
+    void refit(Culler::AabbBlock const* boxes, uint8_t* dirty) noexcept;
+
+    // whether the tree degraded enough since the last build() that it should be rebuilt
+    bool needsRebuild() const noexcept {
+        return mMovedSinceBuild > mPrimitiveCount / 4;
+    }
+
+    // Sets 'bit' in results[i] for each box intersecting the frustum. Other entries are
+    // left untouched, so results must be cleared by the caller.
+    // The cost is proportional to the number of visible boxes rather than to the total.
+    void cull(Culler::result_type* results, Frustum const& frustum,
+            Culler::AabbBlock const* boxes, size_t bit) const noexcept;
+
+    size_t getPrimitiveCount() const noexcept { return mPrimitiveCount; }
+
+    void clear() noexcept;
+
+private:
+    struct Node {
+        math::float3 min;
+        uint32_t first;     // index of the first primitive of the subtree in mIndices
+        math::float3 max;
+        uint32_t count;     // number of primitives in the subtree
+        uint32_t right;     // index of the right child, 0 for leaves. The left child follows.
+        uint32_t parent;
+    };
+
+    uint32_t buildNode(Culler::AabbBlock const* boxes,
+            uint32_t parent, uint32_t first, uint32_t count) noexcept;
+
+    void updateLeaf(Culler::AabbBlock const* boxes, Node& node) noexcept;
+
+    std::vector<Node> mNodes;           // depth-first order, i.e. parents precede children
+    std::vector<uint32_t> mIndices;     // primitive indices, grouped by leaf
+    std::vector<uint32_t> mLeafOf;      // leaf node of each primitive
+    std::vector<math::float3> mCenters; // scratch storage for build()
+    size_t mPrimitiveCount = 0;
+    size_t mMovedSinceBuild = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_BVH_H
@@ -47,6 +47,50 @@ public:
 
     using result_type = uint8_t;
 
+    /*
+     * World-space AABBs stored in blocks of MODULO boxes, with the x, y and z components of the
+     * centers and half-extents in separate arrays. This is the layout used by the explicit SIMD
+     * culling kernels, each block is processed with a single pass of 8-wide operations.
+     */
+    struct alignas(32) AabbBlock {
+        float cx[MODULO];
+        float cy[MODULO];
+        float cz[MODULO];
+        float ex[MODULO];
+        float ey[MODULO];
+        float ez[MODULO];
+    };
+
+    // number of AabbBlock needed to store 'count' AABBs
+    static inline size_t getBlockCount(size_t count) noexcept {
+        return round(count) / MODULO;
+    }
+
+    static inline void setAabb(AabbBlock* blocks, size_t index,
+            math::float3 const& center, math::float3 const& extent) noexcept {
+        AabbBlock& block = blocks[index / MODULO];
+        const size_t lane = index % MODULO;
+        block.cx[lane] = center.x;
+        block.cy[lane] = center.y;
+        block.cz[lane] = center.z;
+        block.ex[lane] = extent.x;
+        block.ey[lane] = extent.y;
+        block.ez[lane] = extent.z;
+    }
+
+    // Implementations of the AabbBlock culling kernel
+    enum class Implementation : uint8_t {
+        SCALAR,     // portable C++, relies on auto-vectorization
+        AVX2,       // x86-64 with AVX2 (checked at runtime)
+        NEON        // ARMv8
+    };
+
+    // returns whether an implementation can run on the current CPU
+    static bool isSupported(Implementation implementation) noexcept;
+
+    // returns the implementation used by intersects() below, i.e. the best supported one
+    static Implementation getImplementation() noexcept;
+
     /*
      * returns whether each AABB in an array intersects with the frustum
      */
@@ -56,6 +100,15 @@ public:
             math::float3 const* extent,
             size_t count, size_t bit) noexcept;
 
+    /*
+     * returns whether each AABB in an array of blocks intersects with the frustum
+     * (count is the number of AABBs, not the number of blocks)
+     */
+    static void intersects(result_type* results,
+            Frustum const& frustum,
+            AabbBlock const* boxes,
+            size_t count, size_t bit) noexcept;
+
     /*
      * returns whether each sphere in an array intersects with the frustum
      */
@@ -91,6 +144,12 @@ public:
                 Frustum const& frustum,
                 math::float4 const* b,
                 size_t count) noexcept;
+
+        // the implementation must be supported
+        static void intersects(result_type* results,
+                Frustum const& frustum,
+                AabbBlock const* boxes,
+                size_t count, Implementation implementation) noexcept;
     };
 };
 
@@ -51,6 +51,7 @@ public:
         Type type = BOOL;
         if (std::is_same<T, bool>::value)           type = BOOL;
         if (std::is_same<T, int>::value)            type = INT;
+        if (std::is_same<T, uint32_t>::value)       type = INT;     // read as an int
         if (std::is_same<T, float>::value)          type = FLOAT;
         if (std::is_same<T, math::float2>::value)   type = FLOAT2;
         if (std::is_same<T, math::float3>::value)   type = FLOAT3;
@@ -121,6 +121,9 @@ public:
     static constexpr size_t CONFIG_FROXEL_SLICE_COUNT      = 16;
     static constexpr bool   CONFIG_IBL_USE_IRRADIANCE_MAP  = false;
 
+    // number of programs prepared by Material::compile() created at each frame
+    static constexpr size_t CONFIG_MAX_COMPILED_PROGRAMS_PER_FRAME = 4;
+
     static constexpr size_t CONFIG_PER_RENDER_PASS_ARENA_SIZE   = filament::CONFIG_PER_RENDER_PASS_ARENA_SIZE;
     static constexpr size_t CONFIG_PER_FRAME_COMMANDS_SIZE      = filament::CONFIG_PER_FRAME_COMMANDS_SIZE;
     static constexpr size_t CONFIG_MIN_COMMAND_BUFFERS_SIZE     = filament::CONFIG_MIN_COMMAND_BUFFERS_SIZE;
@@ -144,6 +147,7 @@ public:
 
     backend::Driver& getDriver() const noexcept { return *mDriver; }
     DriverApi& getDriverApi() noexcept { return mCommandStream; }
+    backend::CommandBufferQueue& getCommandBufferQueue() noexcept { return mCommandBufferQueue; }
     DFG* getDFG() const noexcept { return mDFG.get(); }
 
     // the per-frame Area is used by all Renderer, so they must run in sequence and
@@ -151,6 +155,10 @@ public:
     // we'll simply have to use separate Areas (for instance).
     LinearAllocatorArena& getPerRenderPassAllocator() noexcept { return mPerRenderPassAllocator; }
 
+    // Returns a UBO that can hold the data of 'count' instances, see RenderPass::sortCommands().
+    // These UBOs are reused every frame, so each one is handed out once per frame only.
+    backend::Handle<backend::HwUniformBuffer> acquireInstanceUbo(size_t count) noexcept;
+
     // Material IDs...
     uint32_t getMaterialId() const noexcept { return mMaterialId++; }
 
@@ -369,6 +377,15 @@ private:
     LinearAllocatorArena mPerRenderPassAllocator;
     HeapAllocatorArena mHeapAllocator;
 
+    // UBOs holding the per-instance data of render passes, the first mInstanceUboUsed are
+    // in use this frame
+    struct InstanceUbo {
+        backend::Handle<backend::HwUniformBuffer> handle;
+        size_t count = 0;
+    };
+    std::vector<InstanceUbo> mInstanceUbos;
+    size_t mInstanceUboUsed = 0;
+
     utils::JobSystem mJobSystem;
 
     std::default_random_engine mRandomEngine;
@@ -414,6 +431,8 @@ public:
             // When set to true, the backend will attempt to capture the next frame and write the
             // capture to file. At the moment, only supported by the Metal backend.
             bool doFrameCapture = false;
+            // merge identical draws into instanced draws, see RenderPass::instanceCommands()
+            bool instancing = true;
         } renderer;
         matdbg::DebugServer* server = nullptr;
     } debug;
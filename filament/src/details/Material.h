@@ -32,6 +32,10 @@
 #include <utils/compiler.h>
 
 #include <atomic>
+#include <memory>
+
+// for gtest
+class FilamentTest_MaterialCompile_Test;
 
 namespace filament {
 
@@ -85,8 +89,25 @@ public:
         backend::Handle<backend::HwProgram> const entry = mCachedPrograms[variantKey];
         return UTILS_LIKELY(entry) ? entry : getProgramSlow(variantKey);
     }
+
+    // Returns true if the program of this variant is still being prepared by compile().
+    // getProgram() can still be called, it then creates the program right away.
+    bool isProgramPending(uint8_t variantKey) const noexcept {
+        return UTILS_UNLIKELY(mCompilation != nullptr) &&
+                !mCachedPrograms[variantKey] && isProgramPendingSlow(variantKey);
+    }
+
+    void compile(VariantFeature variants, CompileCallback callback, void* user) noexcept;
+
+    bool isCompiling() const noexcept { return mCompilation != nullptr; }
+
+    // Creates at most budget of the programs prepared by compile(), and invokes its callbacks
+    // once they're all created. Returns the remaining budget.
+    size_t createCompiledPrograms(size_t budget) noexcept;
+
     backend::Program getProgramBuilderWithVariants(uint8_t variantKey, uint8_t vertexVariantKey,
-            uint8_t fragmentVariantKey) const noexcept;
+            uint8_t fragmentVariantKey, filaflat::ShaderBuilder& vsBuilder,
+            filaflat::ShaderBuilder& fsBuilder) const noexcept;
     backend::Handle<backend::HwProgram> createAndCacheProgram(backend::Program&& p,
             uint8_t variantKey) const noexcept;
 
@@ -156,9 +177,21 @@ public:
     static MaterialParser* createParser(backend::Backend backend, const void* data, size_t size);
 
 private:
+    friend class ::FilamentTest_MaterialCompile_Test;
+
+    struct Compilation;
+
     backend::Handle<backend::HwProgram> getProgramSlow(uint8_t variantKey) const noexcept;
-    backend::Handle<backend::HwProgram> getSurfaceProgramSlow(uint8_t variantKey) const noexcept;
-    backend::Handle<backend::HwProgram> getPostProcessProgramSlow(uint8_t variantKey) const noexcept;
+    bool isProgramPendingSlow(uint8_t variantKey) const noexcept;
+    void finishCompilation(bool invokeCallbacks) noexcept;
+
+    // These only read the material and can be called from any thread.
+    backend::Program getProgramBuilder(uint8_t variantKey,
+            filaflat::ShaderBuilder& vsBuilder, filaflat::ShaderBuilder& fsBuilder) const noexcept;
+    backend::Program getSurfaceProgramBuilder(uint8_t variantKey,
+            filaflat::ShaderBuilder& vsBuilder, filaflat::ShaderBuilder& fsBuilder) const noexcept;
+    backend::Program getPostProcessProgramBuilder(uint8_t variantKey,
+            filaflat::ShaderBuilder& vsBuilder, filaflat::ShaderBuilder& fsBuilder) const noexcept;
 
     // try to order by frequency of use
     mutable std::array<backend::Handle<backend::HwProgram>, VARIANT_COUNT> mCachedPrograms;
@@ -201,6 +234,9 @@ private:
     mutable uint32_t mMaterialInstanceId = 0;
     MaterialParser* mMaterialParser = nullptr;
     std::atomic<MaterialParser*> mPendingEdits = {};
+
+    // pending compile() request, if any
+    std::unique_ptr<Compilation> mCompilation;
 };
 
 
@@ -22,6 +22,7 @@
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
 
+#include "details/Bvh.h"
 #include "details/Culler.h"
 
 #include "Allocators.h"
@@ -36,6 +37,8 @@
 #include <utils/Range.h>
 
 #include <cstddef>
+#include <vector>
+
 #include <tsl/robin_set.h>
 
 namespace filament {
@@ -70,6 +73,9 @@ public:
     size_t getLightCount() const noexcept;
     bool hasEntity(utils::Entity entity) const noexcept;
 
+    void setCullingHierarchyEnabled(bool enabled) noexcept;
+    bool isCullingHierarchyEnabled() const noexcept { return mCullingHierarchyEnabled; }
+
 public:
     /*
      * Filaments-scope Public API
@@ -102,7 +108,7 @@ public:
         WORLD_TRANSFORM,        // 16 | instance of the Transform component
         REVERSED_WINDING_ORDER, //  1 | det(WORLD_TRANSFORM)<0
         VISIBILITY_STATE,       //  1 | visibility data of the component
-        BONES_UBH,              //  4 | bones uniform buffer handle
+        BONES_OFFSET,           //  4 | offset of the bones in the bones uniform buffer
         WORLD_AABB_CENTER,      // 12 | world-space bounding box center of the renderable
         VISIBLE_MASK,           //  1 | each bit represents a visibility in a pass
         MORPH_WEIGHTS,          //  4 | floats for morphing
@@ -121,7 +127,7 @@ public:
             math::mat4f,                                // WORLD_TRANSFORM
             bool,                                       // REVERSED_WINDING_ORDER
             FRenderableManager::Visibility,             // VISIBILITY_STATE
-            backend::Handle<backend::HwUniformBuffer>,  // BONES_UBH
+            uint32_t,                                   // BONES_OFFSET
             math::float3,                               // WORLD_AABB_CENTER
             VisibleMaskType,                            // VISIBLE_MASK
             math::float4,                               // MORPH_WEIGHTS
@@ -132,6 +138,16 @@ public:
     >;
 
     RenderableSoa const& getRenderableData() const noexcept { return mRenderableData; }
+
+    // World-space AABBs of the renderables in the SIMD friendly layout used for culling.
+    // These are in the same order as getRenderableData() right after prepare(), i.e. they
+    // don't follow the partitioning done by the View.
+    Culler::AabbBlock const* getWorldAABBs() const noexcept { return mWorldAABBs.data(); }
+
+    // Hierarchy over getWorldAABBs(), or nullptr if the culling hierarchy is disabled.
+    Bvh const* getCullingHierarchy() const noexcept {
+        return mCullingHierarchyEnabled ? &mCullingHierarchy : nullptr;
+    }
     RenderableSoa& getRenderableData() noexcept { return mRenderableData; }
 
     static inline uint32_t getPrimitiveCount(RenderableSoa const& soa,
@@ -198,6 +214,15 @@ public:
 
     void updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Handle<backend::HwUniformBuffer> renderableUbh) noexcept;
 
+    // Size of the per-renderable UBO needed for 'count' renderables. Shaders declare an array of
+    // CONFIG_MAX_INSTANCES PerRenderableUib, so the UBO is padded to allow binding that range
+    // at the last renderable.
+    static size_t getRenderableUBOSize(size_t count) noexcept;
+
+    // writes the PerRenderableUib of the renderable at 'index' in 'soa' at 'offset' in 'buffer'
+    static void writeRenderableUib(void* buffer, size_t offset,
+            RenderableSoa const& soa, uint32_t index) noexcept;
+
     bool hasContactShadows() const noexcept;
 
 private:
@@ -207,6 +232,15 @@ private:
     static inline void computeLightCameraPlaneDistances(float* distances,
             const CameraInfo& camera, const math::float4* spheres, size_t count) noexcept;
 
+    void gather(const math::mat4f& worldOriginTransform) noexcept;
+    void update(const math::mat4f& worldOriginTransform,
+            bool transformsChanged, bool renderablesChanged, bool lightsChanged) noexcept;
+    void gatherRenderable(size_t index, const math::mat4f& worldOriginTransform) noexcept;
+    void gatherLight(size_t index, const math::mat4f& worldOriginTransform) noexcept;
+    void updateCullingHierarchy(bool rebuild) noexcept;
+    bool needsGather(const math::mat4f& worldOriginTransform,
+            uint32_t destroyedEntityVersion) const noexcept;
+
     FEngine& mEngine;
     FSkybox* mSkybox = nullptr;
     FIndirectLight const* mIndirectLight = nullptr;
@@ -218,6 +252,59 @@ private:
      */
     tsl::robin_set<utils::Entity> mEntities;
 
+    /*
+     * Persistent per-entity data gathered by prepare(). It is kept across frames so that only
+     * the entries whose components changed since the last prepare() need to be recomputed,
+     * the per-view data below is then simply copied from it.
+     * Entries store the component Instances, so the whole cache is rebuilt when the set of
+     * entities, the structure of a component manager, or the world origin changes.
+     */
+    struct GatherKey {
+        utils::Entity entity;
+        FTransformManager::Instance ti;
+    };
+
+    // gather() processes entities in fixed-size chunks, so that its output doesn't depend on
+    // how the work is split across threads.
+    static constexpr uint32_t GATHER_CHUNK_SIZE = 1024;
+
+    struct GatherInstances {
+        FTransformManager::Instance ti;
+        FRenderableManager::Instance ri;
+        FLightManager::Instance li;
+    };
+
+    struct GatherChunk {
+        uint32_t renderables;   // renderable count, then offset of the chunk in mRenderableCache
+        uint32_t lights;        // light count, then offset of the chunk in mLightCache
+    };
+
+    RenderableSoa mRenderableCache;
+    std::vector<GatherKey> mRenderableKeys;
+    std::vector<Culler::AabbBlock> mWorldAABBs;
+    LightSoa mLightCache;
+    std::vector<GatherKey> mLightKeys;
+    math::mat4f mGatherWorldOrigin;
+    uint32_t mTransformVersion = 0;
+    uint32_t mRenderableVersion = 0;
+    uint32_t mLightVersion = 0;
+    uint32_t mTransformStructureVersion = 0;
+    uint32_t mRenderableStructureVersion = 0;
+    uint32_t mLightStructureVersion = 0;
+    uint32_t mDestroyedEntityVersion = 0;
+    bool mEntitiesChanged = true;
+
+    // optional hierarchy over mWorldAABBs, mMovedRenderables flags the entries that update()
+    // changed so that the hierarchy can be refit incrementally.
+    Bvh mCullingHierarchy;
+    std::vector<uint8_t> mMovedRenderables;
+    bool mCullingHierarchyEnabled = false;
+    bool mCullingHierarchyValid = false;
+
+    // scratch storage for gather(), kept around to avoid reallocations
+    std::vector<utils::Entity> mGatherEntities;
+    std::vector<GatherInstances> mGatherInstances;
+    std::vector<GatherChunk> mGatherChunks;
 
     /*
      * The data below is valid only during a view pass. i.e. if a scene is used in multiple
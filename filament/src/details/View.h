@@ -407,8 +407,10 @@ public:
         return mRenderTarget == nullptr ? kEmptyHandle : mRenderTarget->getHwHandle();
     }
 
-    static void cullRenderables(utils::JobSystem& js, FScene::RenderableSoa& renderableData,
-            Frustum const& frustum, size_t bit) noexcept;
+    // renderableData must not have been reordered since scene.prepare(), so that it matches
+    // scene.getWorldAABBs() and scene.getCullingHierarchy()
+    static void cullRenderables(utils::JobSystem& js, FScene const& scene,
+            FScene::RenderableSoa& renderableData, Frustum const& frustum, size_t bit) noexcept;
 
     UniformBuffer& getViewUniforms() const { return mPerViewUb; }
     backend::SamplerGroup& getViewSamplers() const { return mPerViewSb; }
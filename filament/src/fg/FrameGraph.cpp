@@ -24,6 +24,7 @@
 #include "fg/fg/VirtualResource.h"
 
 #include "details/Engine.h"
+#include "details/Texture.h"
 
 #include <backend/DriverEnums.h>
 #include <backend/Handle.h>
@@ -31,6 +32,8 @@
 #include <utils/Panic.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+
 using namespace utils;
 
 namespace filament {
@@ -365,6 +368,9 @@ FrameGraph& FrameGraph::compile() noexcept {
         }
     }
 
+    // now that usages are final, figure out which transient textures can share memory
+    aliasResources();
+
     // add resource to de-virtualize or destroy to the corresponding list for each active pass
     // but add them in priority order (this is so that rendertargets are added after textures)
     for (size_t priority = 0; priority < 2; priority++) {
@@ -384,6 +390,111 @@ FrameGraph& FrameGraph::compile() noexcept {
     return *this;
 }
 
+// Two transient textures can share the same concrete texture if they would be created with the
+// same parameters, except for the usage flags, which are merged.
+static bool canAlias(FrameGraphTexture::Descriptor const& lhs,
+        FrameGraphTexture::Descriptor const& rhs, TextureUsage usage) noexcept {
+    // non-sampleable textures are always created with a single level (see FrameGraphTexture)
+    auto getLevels = [](FrameGraphTexture::Descriptor const& desc) {
+        return any(desc.usage & TextureUsage::SAMPLEABLE) ? desc.levels : uint8_t(1);
+    };
+    auto getSamples = [](FrameGraphTexture::Descriptor const& desc) {
+        return std::max(desc.samples, uint8_t(1));
+    };
+    if (lhs.type != rhs.type || lhs.format != rhs.format ||
+        lhs.width != rhs.width || lhs.height != rhs.height || lhs.depth != rhs.depth ||
+        getLevels(lhs) != getLevels(rhs) || getSamples(lhs) != getSamples(rhs)) {
+        return false;
+    }
+    // multi-sampled textures can't be sampled
+    usage |= lhs.usage | rhs.usage;
+    return getSamples(lhs) == 1 || none(usage & TextureUsage::SAMPLEABLE);
+}
+
+void FrameGraph::aliasResources() noexcept {
+    struct Interval {
+        ResourceEntry<FrameGraphTexture>* texture;
+        uint32_t first;     // id of the first pass using the texture
+        uint32_t last;      // id of the last pass using the texture
+    };
+
+    Vector<Interval> intervals(mArena);
+    intervals.reserve(mResourceEntries.size());
+    for (UniquePtr<fg::ResourceEntryBase> const& resource : mResourceEntries) {
+        auto* texture = resource->asTextureResourceEntry();
+        if (texture && texture->refs && !texture->imported && texture->first &&
+                any(texture->descriptor.usage)) {
+            intervals.push_back({ texture, texture->first->id, texture->last->id });
+        }
+    }
+
+    // a render target could be used after the last pass using its attachments directly,
+    // so the attachments must stay alive for as long as the render target
+    for (UniquePtr<fg::ResourceEntryBase> const& resource : mResourceEntries) {
+        auto* rt = resource->asRenderTargetResourceEntry();
+        if (!rt || !rt->refs || !rt->first) {
+            continue;
+        }
+        for (auto const& attachment : rt->descriptor.attachments.textures) {
+            if (attachment.isValid()) {
+                VirtualResource const* const texture =
+                        mResourceNodes[attachment.getHandle().index]->resource;
+                auto pos = std::find_if(intervals.begin(), intervals.end(),
+                        [texture](Interval const& interval) {
+                            return interval.texture == texture;
+                        });
+                if (pos != intervals.end()) {
+                    pos->first = std::min(pos->first, rt->first->id);
+                    pos->last = std::max(pos->last, rt->last->id);
+                }
+            }
+        }
+    }
+
+    // Interval partitioning: textures are processed in order of their first use and each one
+    // goes into the first compatible slot that is free by then, or into a new slot. This uses
+    // the minimum number of slots for each set of compatible textures.
+    std::sort(intervals.begin(), intervals.end(), [](Interval const& lhs, Interval const& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    struct Slot {
+        ResourceEntry<FrameGraphTexture>* head;     // creates the concrete texture
+        ResourceEntry<FrameGraphTexture>* tail;     // currently owns the concrete texture
+        uint32_t last;
+        TextureUsage usage;
+    };
+
+    Vector<Slot> slots(mArena);
+    for (Interval const& interval : intervals) {
+        ResourceEntry<FrameGraphTexture>* const texture = interval.texture;
+        auto pos = std::find_if(slots.begin(), slots.end(), [&](Slot const& slot) {
+            return slot.last < interval.first &&
+                   canAlias(slot.head->descriptor, texture->descriptor, slot.usage);
+        });
+        if (pos != slots.end()) {
+            pos->tail->aliasNext = texture;
+            texture->aliasInherited = true;
+            pos->tail = texture;
+            pos->last = interval.last;
+            pos->usage |= texture->descriptor.usage;
+        } else {
+            pos = slots.insert(slots.end(),
+                    { texture, texture, interval.last, texture->descriptor.usage });
+        }
+        texture->aliasSlot = int16_t(pos - slots.begin());
+    }
+
+    // the concrete texture must be created with the usages of all the textures sharing it
+    for (Slot const& slot : slots) {
+        auto& desc = slot.head->descriptor;
+        if (none(desc.usage & TextureUsage::SAMPLEABLE)) {
+            desc.levels = 1;
+        }
+        desc.usage = slot.usage;
+    }
+}
+
 void FrameGraph::executeInternal(PassNode const& node, DriverApi& driver) noexcept {
     assert(node.base);
     // create concrete resources and rendertargets
@@ -496,6 +607,9 @@ void FrameGraph::export_graphviz(utils::io::ostream& out, const char* viewName)
             }
         }
 #endif
+        if (subresource->aliasSlot >= 0) {
+            out << "\\nslot:" << subresource->aliasSlot;
+        }
         auto *rendertarget = subresource->asRenderTargetResourceEntry();
         if (rendertarget) {
             out << ", " << "RenderTarget";
@@ -538,6 +652,27 @@ void FrameGraph::export_graphviz(utils::io::ostream& out, const char* viewName)
         out << "} [color=lightgreen]\n";
     }
 
+    // memory used by transient textures, with and without aliasing
+    size_t transientSize = 0;
+    size_t aliasedSize = 0;
+    for (UniquePtr<fg::ResourceEntryBase> const& resource : mResourceEntries) {
+        auto const* texture = resource->asTextureResourceEntry();
+        if (texture && texture->aliasSlot >= 0) {
+            auto const& desc = texture->descriptor;
+            size_t size = size_t(desc.width) * desc.height * desc.depth *
+                    FTexture::getFormatSize(desc.format) * std::max(desc.samples, uint8_t(1));
+            if (desc.levels > 1 && any(desc.usage & TextureUsage::SAMPLEABLE)) {
+                // if we have mip-maps we assume the full pyramid
+                size += size / 3;
+            }
+            transientSize += size;
+            aliasedSize += texture->aliasInherited ? 0 : size;
+        }
+    }
+    out << "\nlabel=\"transient textures: " << transientSize / float(1u << 20u)
+        << " MiB, after aliasing: " << aliasedSize / float(1u << 20u) << " MiB\"\n";
+    out << "fontcolor=white\n";
+
     out << "}" << utils::io::endl;
 #endif
 }
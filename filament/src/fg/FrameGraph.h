@@ -280,6 +280,9 @@ private:
 
     void executeInternal(fg::PassNode const& node, backend::DriverApi& driver) noexcept;
 
+    // plans which transient textures share the same concrete texture
+    void aliasResources() noexcept;
+
     ResourceAllocatorInterface& getResourceAllocator() noexcept { return mResourceAllocator; }
 
     void reset() noexcept;
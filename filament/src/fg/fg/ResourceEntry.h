@@ -19,6 +19,8 @@
 
 #include "fg/fg/VirtualResource.h"
 
+#include <fg/FrameGraphHandle.h>
+
 #include <stdint.h>
 
 namespace filament {
@@ -31,6 +33,9 @@ namespace fg {
 struct PassNode;
 class RenderTargetResourceEntry;
 
+template<typename T>
+class ResourceEntry;
+
 class ResourceEntryBase : public VirtualResource {
 public:
     explicit ResourceEntryBase(const char* name, uint16_t id, bool imported, uint8_t priority) noexcept;
@@ -41,6 +46,10 @@ public:
         return nullptr;
     }
 
+    virtual ResourceEntry<FrameGraphTexture>* asTextureResourceEntry() noexcept {
+        return nullptr;
+    }
+
     void preExecuteDestroy(FrameGraph& fg) noexcept override {
         discardEnd = true;
     }
@@ -62,6 +71,7 @@ public:
 
     // computed during compile()
     uint32_t refs = 0;                      // final reference count
+    int16_t aliasSlot = -1;                 // concrete resource shared with other resources
 
     // updated during execute()
     bool discardStart = true;
@@ -86,21 +96,33 @@ public:
             : ResourceEntryBase(name, id, true, priority), resource(r), descriptor(desc) {
     }
 
+    // Computed during compile(), when transient resources whose lifetimes don't overlap share
+    // the same concrete resource. The first resource of the chain creates it, then each hands
+    // it over to the next one once it's done with it, and the last one destroys it.
+    ResourceEntry* aliasNext = nullptr;     // resource inheriting our concrete resource
+    bool aliasInherited = false;            // our concrete resource comes from another resource
+
     T const& getResource() const noexcept { return resource; }
 
     T& getResource() noexcept { return resource; }
 
+    ResourceEntry<FrameGraphTexture>* asTextureResourceEntry() noexcept override;
+
     void resolve(FrameGraph& fg) noexcept override { }
 
     void preExecuteDevirtualize(FrameGraph& fg) noexcept override {
-        if (!imported) {
+        if (!imported && !aliasInherited) {
             resource.create(getResourceAllocator(fg), name, descriptor);
         }
     }
 
     void postExecuteDestroy(FrameGraph& fg) noexcept override {
         if (!imported) {
-            resource.destroy(getResourceAllocator(fg));
+            if (aliasNext) {
+                aliasNext->resource = resource;
+            } else {
+                resource.destroy(getResourceAllocator(fg));
+            }
             // make sure to clear the resource as some code might rely on e.g. handles to know
             // if they need to be set or not
             resource = {};
@@ -108,6 +130,17 @@ public:
     }
 };
 
+template<typename T>
+ResourceEntry<FrameGraphTexture>* ResourceEntry<T>::asTextureResourceEntry() noexcept {
+    return nullptr;
+}
+
+template<>
+inline ResourceEntry<FrameGraphTexture>*
+ResourceEntry<FrameGraphTexture>::asTextureResourceEntry() noexcept {
+    return this;
+}
+
 } // namespace fg
 } // namespace filament
 
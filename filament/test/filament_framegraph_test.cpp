@@ -35,6 +35,8 @@ static CommandStream driverApi(*platform->createDriver(nullptr), buffer);
 class MockResourceAllocator : public ResourceAllocatorInterface {
     uint32_t handle = 0;
 public:
+    uint32_t textureCount = 0;
+
     backend::RenderTargetHandle createRenderTarget(const char* name,
             backend::TargetBufferFlags targetBufferFlags,
             uint32_t width,
@@ -53,6 +55,7 @@ public:
             uint8_t levels,
             backend::TextureFormat format, uint8_t samples, uint32_t width, uint32_t height,
             uint32_t depth, backend::TextureUsage usage) noexcept override {
+        textureCount++;
         return backend::TextureHandle(++handle);
     }
 
@@ -444,3 +447,94 @@ TEST(FrameGraphTest, MoveGenericResource) {
     EXPECT_EQ(h[1], h[3]);
     EXPECT_EQ(h[3], h[0]);
 }
+
+TEST(FrameGraphTest, TransientAliasing) {
+    // This checks that:
+    // - textures with compatible descriptors and non-overlapping lifetimes share the same
+    //   concrete texture, even if their usages differ.
+    // - textures with overlapping lifetimes or incompatible descriptors don't.
+
+    MockResourceAllocator resourceAllocator;
+    FrameGraph fg(resourceAllocator);
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> input;
+        FrameGraphId<FrameGraphTexture> output;
+        FrameGraphRenderTargetHandle rt;
+    };
+
+    backend::TextureHandle h[4];
+
+    auto addPass = [&](const char* name, FrameGraphId<FrameGraphTexture> input,
+            TextureFormat format, backend::TextureHandle& out) -> auto& {
+        return fg.addPass<PassData>(name,
+                [&, name, input, format](FrameGraph::Builder& builder, auto& data) {
+                    if (input.isValid()) {
+                        data.input = builder.sample(input);
+                    }
+                    data.output = builder.createTexture(name,
+                            { .width = 64, .height = 64, .format = format });
+                    data.output = builder.write(data.output);
+                    data.rt = builder.createRenderTarget(name, { .attachments = { data.output }});
+                },
+                [&out](FrameGraphPassResources const& resources,
+                        auto const& data, backend::DriverApi& driver) {
+                    out = resources.get(data.output).texture;
+                    EXPECT_TRUE(out);
+                });
+    };
+
+    // t0 and t2 can be aliased (t0 is sampled, t2 is not), t1 and t3 overlap with t2
+    auto& p0 = addPass("t0", {}, TextureFormat::RGBA16F, h[0]);
+    auto& p1 = addPass("t1", p0.getData().output, TextureFormat::RGBA16F, h[1]);
+    auto& p2 = addPass("t2", p1.getData().output, TextureFormat::RGBA16F, h[2]);
+    auto& p3 = addPass("t3", p2.getData().output, TextureFormat::RGBA8, h[3]);
+
+    fg.present(p3.getData().output);
+    fg.compile();
+    fg.execute(driverApi);
+
+    EXPECT_EQ(h[0], h[2]);
+    EXPECT_NE(h[0], h[1]);
+    EXPECT_NE(h[2], h[3]);
+    EXPECT_NE(h[1], h[3]);
+    EXPECT_EQ(3u, resourceAllocator.textureCount);
+}
+
+TEST(FrameGraphTest, ResourceAllocatorCache) {
+
+    ResourceAllocator resourceAllocator(driverApi);
+
+    auto create = [&](uint32_t width) {
+        return resourceAllocator.createTexture("t", SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, width, 64, 1, TextureUsage::COLOR_ATTACHMENT);
+    };
+
+    // a texture with the same key is served from the cache
+    TextureHandle t0 = create(64);
+    resourceAllocator.destroyTexture(t0);
+    TextureHandle t1 = create(64);
+    EXPECT_EQ(t0, t1);
+    EXPECT_EQ(1u, resourceAllocator.debug.cacheHits);
+    EXPECT_EQ(1u, resourceAllocator.debug.cacheMisses);
+
+    // a texture with a different key is not
+    TextureHandle t2 = create(128);
+    EXPECT_NE(t1, t2);
+    EXPECT_EQ(2u, resourceAllocator.debug.cacheMisses);
+
+    resourceAllocator.destroyTexture(t1);
+    resourceAllocator.destroyTexture(t2);
+    resourceAllocator.gc();
+    EXPECT_EQ(2u, resourceAllocator.debug.cacheEntries);
+    EXPECT_EQ(0u, resourceAllocator.debug.cacheEvictions);
+
+    // going over budget evicts the least recently used textures
+    resourceAllocator.setCacheBudget(0);
+    resourceAllocator.gc();
+    EXPECT_EQ(0u, resourceAllocator.debug.cacheEntries);
+    EXPECT_EQ(0u, resourceAllocator.debug.cacheSizeInKiB);
+    EXPECT_EQ(2u, resourceAllocator.debug.cacheEvictions);
+
+    resourceAllocator.terminate();
+}
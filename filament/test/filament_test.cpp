@@ -14,8 +14,15 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <random>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -25,6 +32,8 @@
 #include <math/mat4.h>
 #include <math/scalar.h>
 
+#include <utils/JobSystem.h>
+
 #include <filament/Box.h>
 #include <filament/Camera.h>
 #include <filament/Color.h>
@@ -35,12 +44,19 @@
 #include <private/filament/UniformInterfaceBlock.h>
 #include <private/filament/UibGenerator.h>
 #include <private/backend/BackendUtils.h>
+#include <private/backend/CircularBuffer.h>
+#include <private/backend/CommandStream.h>
 
 #include "details/Allocators.h"
+#include "details/Bvh.h"
+#include "details/Culler.h"
 #include "details/Material.h"
 #include "details/Camera.h"
 #include "details/Froxelizer.h"
 #include "details/Engine.h"
+#include "details/Scene.h"
+#include "RenderPass.h"
+#include "components/LightManager.h"
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
 #include "UniformBuffer.h"
@@ -277,6 +293,90 @@ TEST(FilamentTest, TransformManager) {
     EXPECT_EQ(c, tcm.getChildCount(newParent));
 }
 
+TEST(FilamentTest, TransformManagerLevels) {
+    JobSystem js;
+    js.adopt();
+    filament::FTransformManager tcm(&js);
+    EntityManager& em = EntityManager::get();
+
+    // a root with enough children to update them in parallel, and a grandchild for each one,
+    // created before their parent.
+    constexpr size_t COUNT = 2048;
+    Entity root = em.create();
+    std::vector<Entity> children(COUNT);
+    std::vector<Entity> grandchildren(COUNT);
+    em.create(COUNT, grandchildren.data());
+    em.create(COUNT, children.data());
+    for (size_t i = 0; i < COUNT; i++) {
+        tcm.create(grandchildren[i], {}, mat4f::translation(float3{ 0, 0, 1 }));
+    }
+    tcm.create(root);
+    for (size_t i = 0; i < COUNT; i++) {
+        tcm.create(children[i], tcm.getInstance(root), mat4f::translation(float3{ 0, float(i), 0 }));
+        tcm.setParent(tcm.getInstance(grandchildren[i]), tcm.getInstance(children[i]));
+    }
+
+    // move everything at once
+    std::vector<TransformManager::Instance> instances(COUNT + 1);
+    std::vector<mat4f> transforms(COUNT + 1);
+    instances[0] = tcm.getInstance(root);
+    transforms[0] = mat4f::translation(float3{ 1, 0, 0 });
+    for (size_t i = 0; i < COUNT; i++) {
+        instances[i + 1] = tcm.getInstance(children[i]);
+        transforms[i + 1] = mat4f::translation(float3{ 0, float(2 * i), 0 });
+    }
+    tcm.setTransforms(instances.data(), transforms.data(), instances.size());
+
+    for (size_t i = 0; i < COUNT; i++) {
+        TransformManager::Instance child = tcm.getInstance(children[i]);
+        TransformManager::Instance grandchild = tcm.getInstance(grandchildren[i]);
+        EXPECT_GT(child, tcm.getInstance(root));
+        EXPECT_GT(grandchild, child);
+        EXPECT_EQ(tcm.getWorldTransform(grandchild)[3].xyz, (float3{ 1, float(2 * i), 1 }));
+    }
+
+    // only the subtree of a dirty node is updated, the nodes stamped with the new version
+    auto expectUpdated = [&](uint32_t version, std::initializer_list<Entity> updated) {
+        auto isUpdated = [&](Entity e) {
+            return std::find(updated.begin(), updated.end(), e) != updated.end();
+        };
+        EXPECT_LT(tcm.getVersion(tcm.getInstance(root)), version);
+        for (size_t i = 0; i < COUNT; i++) {
+            EXPECT_EQ(isUpdated(children[i]),
+                    tcm.getVersion(tcm.getInstance(children[i])) >= version);
+            EXPECT_EQ(isUpdated(grandchildren[i]),
+                    tcm.getVersion(tcm.getInstance(grandchildren[i])) >= version);
+        }
+    };
+
+    uint32_t version = tcm.commitVersion();
+    TransformManager::Instance child = tcm.getInstance(children[1]);
+    tcm.setTransforms(&child, transforms.data(), 1);
+    EXPECT_EQ(tcm.getWorldTransform(tcm.getInstance(grandchildren[1]))[3].xyz,
+            (float3{ 2, 0, 1 }));
+    EXPECT_EQ(tcm.getWorldTransform(tcm.getInstance(grandchildren[2]))[3].xyz,
+            (float3{ 1, 4, 1 }));
+    expectUpdated(version, { children[1], grandchildren[1] });
+    EXPECT_NE(version, tcm.commitVersion());
+
+    // a dirty node in the last level, after clean levels
+    version = tcm.commitVersion();
+    TransformManager::Instance grandchild = tcm.getInstance(grandchildren[3]);
+    tcm.setTransforms(&grandchild, transforms.data(), 1);
+    EXPECT_EQ(tcm.getWorldTransform(grandchild)[3].xyz, (float3{ 2, 6, 0 }));
+    expectUpdated(version, { grandchildren[3] });
+
+    tcm.destroy(root);
+    for (size_t i = 0; i < COUNT; i++) {
+        tcm.destroy(children[i]);
+        tcm.destroy(grandchildren[i]);
+    }
+    em.destroy(COUNT, grandchildren.data());
+    em.destroy(COUNT, children.data());
+    em.destroy(root);
+    js.emancipate();
+}
+
 TEST(FilamentTest, UniformInterfaceBlock) {
 
     UniformInterfaceBlock::Builder b;
@@ -581,6 +681,385 @@ TEST(FilamentTest, SphereCulling) {
     EXPECT_TRUE(frustum.intersects({ 0, 200 }));
 }
 
+TEST(FilamentTest, BvhCulling) {
+    Frustum frustum(mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f));
+
+    std::default_random_engine gen; // NOLINT
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 5.0f);
+
+    const size_t count = 1000;
+    std::vector<Culler::AabbBlock> boxes(Culler::getBlockCount(count));
+    auto randomize = [&](size_t i) {
+        Culler::setAabb(boxes.data(), i,
+                { position(gen), position(gen), position(gen) },
+                { size(gen), size(gen), size(gen) });
+    };
+    for (size_t i = 0; i < Culler::round(count); i++) {
+        randomize(i);
+    }
+
+    std::vector<Culler::result_type> expected(Culler::round(count));
+    std::vector<Culler::result_type> results(Culler::round(count));
+    auto check = [&](Bvh const& bvh) {
+        std::fill(expected.begin(), expected.end(), 0);
+        std::fill(results.begin(), results.end(), 0);
+        Culler::Test::intersects(expected.data(), frustum, boxes.data(), count,
+                Culler::Implementation::SCALAR);
+        bvh.cull(results.data(), frustum, boxes.data(), 0);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(expected[i], results[i]) << "box " << i;
+        }
+    };
+
+    Bvh bvh;
+    bvh.build(boxes.data(), count);
+    EXPECT_EQ(count, bvh.getPrimitiveCount());
+    check(bvh);
+
+    // move a few boxes and refit the hierarchy
+    std::vector<uint8_t> dirty(count);
+    for (size_t i = 0; i < count; i += 17) {
+        randomize(i);
+        dirty[i] = 1;
+    }
+    bvh.refit(boxes.data(), dirty.data());
+    EXPECT_TRUE(std::all_of(dirty.begin(), dirty.end(), [](uint8_t d) { return d == 0; }));
+    EXPECT_FALSE(bvh.needsRebuild());
+    check(bvh);
+
+    // an empty hierarchy culls nothing
+    bvh.build(boxes.data(), 0);
+    std::fill(results.begin(), results.end(), 0);
+    bvh.cull(results.data(), frustum, boxes.data(), 0);
+    EXPECT_TRUE(std::all_of(results.begin(), results.end(), [](auto r) { return r == 0; }));
+}
+
+TEST(FilamentTest, RenderPassInstancing) {
+    using Command = RenderPass::Command;
+    using Pass = RenderPass::Pass;
+
+    // material instances are only compared, never dereferenced
+    FMaterialInstance const* const mi0 = reinterpret_cast<FMaterialInstance const*>(0x100);
+    FMaterialInstance const* const mi1 = reinterpret_cast<FMaterialInstance const*>(0x200);
+
+    auto make = [](FMaterialInstance const* mi, uint32_t primitive, uint16_t index) {
+        Command c;
+        c.key = uint64_t(Pass::COLOR) | uint64_t(RenderPass::CustomCommand::PASS);
+        c.primitive.mi = mi;
+        c.primitive.primitiveHandle = backend::Handle<backend::HwRenderPrimitive>(primitive);
+        c.primitive.index = index;
+        return c;
+    };
+
+    // all commands have the same key, interleaved primitives get grouped together
+    std::vector<Command> commands;
+    for (uint16_t i = 0; i < 10; i++) {
+        commands.push_back(make(mi0, 1 + i % 2, i));
+    }
+    // a different material instance, which comes with a different key
+    commands.push_back(make(mi1, 1, 10));
+    commands.back().key |= RenderPass::makeMaterialSortingKey(1, 1);
+
+    EXPECT_EQ(10, RenderPass::instanceCommands(commands.data(), commands.data() + commands.size()));
+    EXPECT_EQ(5, commands[0].primitive.instanceCount);
+    EXPECT_EQ(5, commands[5].primitive.instanceCount);
+    EXPECT_EQ(0, commands[10].primitive.instanceCount);
+    for (size_t i = 0; i < 10; i++) {
+        EXPECT_EQ(commands[i - i % 5].primitive.primitiveHandle,
+                commands[i].primitive.primitiveHandle);
+        EXPECT_EQ(mi0, commands[i].primitive.mi);
+    }
+
+    // runs are limited to CONFIG_MAX_INSTANCES
+    commands.clear();
+    for (uint16_t i = 0; i < CONFIG_MAX_INSTANCES + 1; i++) {
+        commands.push_back(make(mi0, 1, i));
+    }
+    EXPECT_EQ(CONFIG_MAX_INSTANCES,
+            RenderPass::instanceCommands(commands.data(), commands.data() + commands.size()));
+    EXPECT_EQ(CONFIG_MAX_INSTANCES, commands[0].primitive.instanceCount);
+    EXPECT_EQ(0, commands[CONFIG_MAX_INSTANCES].primitive.instanceCount);
+
+    // skinned renderables are never instanced
+    for (Command& c : commands) {
+        c.primitive.bonesOffset = FRenderableManager::BONES_RANGE_SIZE;
+    }
+    EXPECT_EQ(0, RenderPass::instanceCommands(commands.data(), commands.data() + commands.size()));
+}
+
+TEST(FilamentTest, RenderPassRadixSort) {
+    using Command = RenderPass::Command;
+    using Pass = RenderPass::Pass;
+
+    JobSystem js;
+    js.adopt();
+
+    // sorts with the radix sort, then checks the keys against std::sort() and, if the sort is
+    // stable, that commands with the same key kept their order (stored in bonesOffset).
+    auto check = [&js](std::vector<Command> commands, size_t arenaSize, bool stable) {
+        std::vector<uint64_t> expected;
+        for (uint32_t i = 0; i < commands.size(); i++) {
+            commands[i].primitive.bonesOffset = i;
+            if (commands[i].key != uint64_t(Pass::SENTINEL)) {
+                expected.push_back(commands[i].key);
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+
+        LinearAllocatorArena arena("test", arenaSize);
+        filament::ArenaScope scope(arena);
+        const uint32_t count = RenderPass::radixSortCommands(js, scope,
+                commands.data(), uint32_t(commands.size()));
+        ASSERT_EQ(expected.size(), count);
+        for (uint32_t i = 0; i < count; i++) {
+            EXPECT_EQ(expected[i], commands[i].key);
+            if (stable && i && commands[i].key == commands[i - 1].key) {
+                EXPECT_LT(commands[i - 1].primitive.bonesOffset,
+                        commands[i].primitive.bonesOffset);
+            }
+        }
+    };
+
+    std::default_random_engine gen; // NOLINT
+    std::uniform_int_distribution<uint64_t> anyKey;
+    std::uniform_int_distribution<uint64_t> fewKeys(0, 15);
+
+    // random keys, over several chunks and with sentinels
+    std::vector<Command> commands(100000);
+    for (size_t i = 0; i < commands.size(); i++) {
+        commands[i].key = i % 1000 ? anyKey(gen) >> 1u : uint64_t(Pass::SENTINEL);
+    }
+    check(commands, 16 * 1024 * 1024, true);
+
+    // many duplicate keys, which differ in a few bytes only
+    for (Command& command : commands) {
+        const uint64_t k = fewKeys(gen);
+        command.key = uint64_t(Pass::COLOR) | (k << 8u) | (k << 40u);
+    }
+    check(commands, 16 * 1024 * 1024, true);
+
+    // all keys equal
+    for (Command& command : commands) {
+        command.key = uint64_t(Pass::DEPTH);
+    }
+    check(commands, 16 * 1024 * 1024, true);
+
+    // without enough scratch memory, std::sort() is used instead, which isn't stable
+    for (Command& command : commands) {
+        command.key = anyKey(gen) >> 1u;
+    }
+    check(commands, 1024, false);
+
+    js.emancipate();
+}
+
+// Returns the execute function of each command between 'first' and 'last', jumping into the
+// inserted secondary streams. The jumps themselves are skipped. The commands are executed
+// with 'driver', which must not care about their parameters.
+static std::vector<uintptr_t> getCommandSequence(backend::Driver& driver,
+        void* first, void* last) {
+    // the execute function is the first and only field of CommandBase
+    auto getExecute = [](void const* command) {
+        uintptr_t execute;
+        memcpy(&execute, command, sizeof(execute));
+        return execute;
+    };
+    backend::NoopCommand jump(nullptr);
+    const uintptr_t jumpExecute = getExecute(&jump);
+
+    std::vector<uintptr_t> sequence;
+    for (auto* c = static_cast<backend::CommandBase*>(first); c != last; c = c->execute(driver)) {
+        if (getExecute(c) != jumpExecute) {
+            sequence.push_back(getExecute(c));
+        }
+    }
+    return sequence;
+}
+
+TEST(FilamentTest, RenderPassParallelRecording) {
+    using Command = RenderPass::Command;
+    using Pass = RenderPass::Pass;
+
+    // the NOOP backend lets us execute the recorded commands
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    backend::Driver& driver = engine->getDriver();
+    FMaterial const* material = engine->getDefaultMaterial();
+    std::array<FMaterialInstance const*, 3> instances = {
+            material->getDefaultInstance(),
+            material->createInstance(nullptr),
+            material->createInstance(nullptr) };
+
+    // enough commands for several jobs, with material changes and instanced runs
+    std::vector<Command> commands(8000);
+    for (size_t i = 0; i < commands.size(); i++) {
+        Command& c = commands[i];
+        c.key = uint64_t(Pass::COLOR) | uint64_t(RenderPass::CustomCommand::PASS);
+        c.primitive.mi = instances[(i / 7) % instances.size()];
+        c.primitive.primitiveHandle = backend::Handle<backend::HwRenderPrimitive>(1 + i % 3);
+        c.primitive.index = uint16_t(i);
+    }
+    for (size_t i = 0; i < commands.size(); i += 50) {
+        commands[i].primitive.instanceCount = uint8_t(2 + i % 9);
+    }
+    for (size_t i = 25; i < commands.size(); i += 100) {
+        commands[i].primitive.bonesOffset = FRenderableManager::BONES_RANGE_SIZE;
+    }
+    Command const* const first = commands.data();
+    Command const* const last = commands.data() + commands.size();
+
+    RenderPass pass(*engine, { commands.data(), commands.size() });
+    pass.mUboHandle = backend::Handle<backend::HwUniformBuffer>(1);
+    const backend::Handle<backend::HwUniformBuffer> instanceUbo(2);
+
+    backend::CircularBuffer serialBuffer(4 * 1024 * 1024);
+    backend::CommandStream serial(driver, serialBuffer);
+    void* const serialFirst = serialBuffer.getHead();
+    pass.recordCommandRange(serial, first, last, instanceUbo, 0);
+    void* const serialLast = serialBuffer.getHead();
+
+    backend::CircularBuffer parallelBuffer(4 * 1024 * 1024);
+    backend::CommandStream parallel(driver, parallelBuffer);
+    void* const parallelFirst = parallelBuffer.getHead();
+    pass.recordDriverCommandsParallel(parallel, first, last, instanceUbo);
+    void* const parallelLast = parallelBuffer.getHead();
+
+    std::vector<uintptr_t> serialSequence = getCommandSequence(driver, serialFirst, serialLast);
+    std::vector<uintptr_t> parallelSequence =
+            getCommandSequence(driver, parallelFirst, parallelLast);
+    EXPECT_GT(serialSequence.size(), commands.size());
+    EXPECT_EQ(serialSequence, parallelSequence);
+
+    engine->destroy(instances[1]);
+    engine->destroy(instances[2]);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, MaterialCompile) {
+    using Command = RenderPass::Command;
+    using Pass = RenderPass::Pass;
+
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    backend::Driver& driver = engine->getDriver();
+    FMaterial* material = const_cast<FMaterial*>(engine->getDefaultMaterial());
+    FMaterialInstance const* mi = material->getDefaultInstance();
+
+    // a variant created before compile() isn't pending
+    const uint8_t created = 0;
+    const uint8_t pending = Variant::DIRECTIONAL_LIGHTING;
+    material->getProgram(created);
+
+    struct Callbacks {
+        FMaterial const* material;
+        std::vector<uint8_t> variants;
+        size_t count = 0;
+        bool allCreated = false;
+    } callbacks{ material };
+    auto callback = [](Material* m, void* user) {
+        Callbacks& c = *static_cast<Callbacks*>(user);
+        EXPECT_EQ(c.material, m);
+        // the programs are all created by the time the callback is invoked
+        c.allCreated = std::all_of(c.variants.begin(), c.variants.end(),
+                [&c](uint8_t v) { return bool(c.material->mCachedPrograms[v]); });
+        c.count++;
+    };
+    using VariantFeature = Material::VariantFeature;
+    const uint8_t dynamic = Variant::DYNAMIC_LIGHTING;
+    material->compile(VariantFeature::DIRECTIONAL_LIGHTING | VariantFeature::SHADOW_RECEIVER,
+            callback, &callbacks);
+    EXPECT_TRUE(material->isCompiling());
+    EXPECT_FALSE(material->isProgramPending(created));
+    EXPECT_TRUE(material->isProgramPending(pending));
+    EXPECT_TRUE(material->isProgramPending(pending | Variant::SHADOW_RECEIVER));
+    EXPECT_FALSE(material->isProgramPending(dynamic));
+
+    // compiling again adds the other variants and the callback
+    material->compile(VariantFeature::ALL, callback, &callbacks);
+    EXPECT_TRUE(material->isProgramPending(dynamic));
+    ASSERT_TRUE(material->isProgramPending(pending));
+    for (size_t i = 0; i < VARIANT_COUNT; i++) {
+        if (material->isProgramPending(uint8_t(i))) {
+            EXPECT_FALSE(material->mCachedPrograms[i]);
+            callbacks.variants.push_back(uint8_t(i));
+        }
+    }
+
+    // pending variants that are drawn are created right away
+    std::vector<Command> commands(40);
+    for (size_t i = 0; i < commands.size(); i++) {
+        Command& c = commands[i];
+        c.key = uint64_t(Pass::COLOR) | uint64_t(RenderPass::CustomCommand::PASS);
+        c.primitive.mi = mi;
+        c.primitive.primitiveHandle = backend::Handle<backend::HwRenderPrimitive>(1);
+        c.primitive.materialVariant.key = (i / 10) % 2 ? pending : created;
+        c.primitive.index = uint16_t(i);
+    }
+    commands[12].primitive.instanceCount = 4;   // pending
+    commands[22].primitive.instanceCount = 3;   // created
+
+    RenderPass pass(*engine, { commands.data(), commands.size() });
+    pass.mUboHandle = backend::Handle<backend::HwUniformBuffer>(1);
+    const backend::Handle<backend::HwUniformBuffer> instanceUbo(2);
+
+    auto record = [&](bool parallel) {
+        backend::CircularBuffer buffer(1024 * 1024);
+        backend::CommandStream stream(driver, buffer);
+        void* const begin = buffer.getHead();
+        if (parallel) {
+            pass.recordDriverCommandsParallel(stream,
+                    commands.data(), commands.data() + commands.size(), instanceUbo);
+        } else {
+            pass.recordCommandRange(stream,
+                    commands.data(), commands.data() + commands.size(), instanceUbo, 0);
+        }
+        return getCommandSequence(driver, begin, buffer.getHead());
+    };
+    auto getExecute = [&](auto recordOne) {
+        backend::CircularBuffer buffer(1024 * 1024);
+        backend::CommandStream stream(driver, buffer);
+        void* const begin = buffer.getHead();
+        recordOne(stream);
+        return getCommandSequence(driver, begin, buffer.getHead()).front();
+    };
+    const uintptr_t draw = getExecute([](backend::CommandStream& stream) {
+        stream.draw({}, backend::Handle<backend::HwRenderPrimitive>(1));
+    });
+    const uintptr_t drawInstanced = getExecute([](backend::CommandStream& stream) {
+        stream.drawInstanced({}, backend::Handle<backend::HwRenderPrimitive>(1), 2);
+    });
+
+    for (bool parallel : { false, true }) {
+        std::vector<uintptr_t> sequence = record(parallel);
+        EXPECT_EQ(33, std::count(sequence.begin(), sequence.end(), draw));
+        EXPECT_EQ(2, std::count(sequence.begin(), sequence.end(), drawInstanced));
+        EXPECT_FALSE(material->isProgramPending(pending));
+        EXPECT_TRUE(material->mCachedPrograms[pending]);
+    }
+    EXPECT_TRUE(material->isCompiling());
+
+    // the programs are created a few per frame, then the callbacks are invoked
+    size_t remaining = callbacks.variants.size();
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (material->isCompiling() && std::chrono::steady_clock::now() < timeout) {
+        EXPECT_EQ(0u, callbacks.count);
+        engine->prepare();
+        engine->flush();
+        const size_t left = std::count_if(callbacks.variants.begin(), callbacks.variants.end(),
+                [&](uint8_t v) { return !material->mCachedPrograms[v]; });
+        EXPECT_LE(remaining - left, FEngine::CONFIG_MAX_COMPILED_PROGRAMS_PER_FRAME);
+        if (left == remaining) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        remaining = left;
+    }
+    EXPECT_FALSE(material->isCompiling());
+    EXPECT_EQ(2u, callbacks.count);
+    EXPECT_TRUE(callbacks.allCreated);
+    EXPECT_FALSE(material->isProgramPending(dynamic));
+
+    Engine::destroy((Engine **)&engine);
+}
+
 TEST(FilamentTest, ColorConversion) {
     // Linear to Gamma
     // 0.0 stays 0.0
@@ -860,6 +1339,156 @@ TEST(FilamentTest, Bones) {
     }
 }
 
+TEST(FilamentTest, SharedBones) {
+    FEngine* engine = FEngine::create();
+    FRenderableManager& rcm = engine->getRenderableManager();
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 4> entities;
+    em.create(entities.size(), entities.data());
+
+    RenderableManager::Builder(0).culling(false).castShadows(false).receiveShadows(false)
+            .skinning(10).build(*engine, entities[0]);
+    RenderableManager::Builder(0).culling(false).castShadows(false).receiveShadows(false)
+            .skinning(100).build(*engine, entities[1]);
+    RenderableManager::Builder(0).culling(false).castShadows(false).receiveShadows(false)
+            .morphing(true).build(*engine, entities[2]);
+
+    // all renderables share the same buffer, at non-overlapping, aligned offsets
+    const uint32_t offset0 = rcm.getBonesOffset(rcm.getInstance(entities[0]));
+    const uint32_t offset1 = rcm.getBonesOffset(rcm.getInstance(entities[1]));
+    const uint32_t offset2 = rcm.getBonesOffset(rcm.getInstance(entities[2]));
+    EXPECT_TRUE(bool(rcm.getBonesUbh()));
+    EXPECT_NE(0u, offset0);
+    EXPECT_NE(0u, offset2);
+    EXPECT_EQ(0u, offset0 % 256);
+    EXPECT_EQ(0u, offset1 % 256);
+    EXPECT_EQ(0u, offset2 % 256);
+    EXPECT_LE(offset0 + 10 * sizeof(PerRenderableUibBone), offset1);
+    EXPECT_LE(offset1 + 100 * sizeof(PerRenderableUibBone), offset2);
+
+    // freed bones are reused
+    rcm.destroy(entities[1]);
+    RenderableManager::Builder(0).culling(false).castShadows(false).receiveShadows(false)
+            .skinning(50).build(*engine, entities[3]);
+    EXPECT_EQ(offset1, rcm.getBonesOffset(rcm.getInstance(entities[3])));
+
+    rcm.destroy(entities[0]);
+    rcm.destroy(entities[2]);
+    rcm.destroy(entities[3]);
+    em.destroy(entities.size(), entities.data());
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, SceneIncrementalGather) {
+    FEngine* engine = FEngine::create();
+    FTransformManager& tcm = engine->getTransformManager();
+    FRenderableManager& rcm = engine->getRenderableManager();
+    FLightManager& lcm = engine->getLightManager();
+    EntityManager& em = EntityManager::get();
+
+    std::vector<Entity> entities(100);
+    em.create(entities.size(), entities.data());
+    for (size_t i = 0; i < entities.size(); i++) {
+        RenderableManager::Builder(0).boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+                .build(*engine, entities[i]);
+        if (i % 10 == 0) {
+            LightManager::Builder(LightManager::Type::POINT).position({ 0, float(i), 0 })
+                    .build(*engine, entities[i]);
+        }
+    }
+
+    // the data gathered by prepare(), sorted by instance so that scenes can be compared
+    struct Gathered {
+        std::vector<std::tuple<uint32_t, std::array<float4, 4>, float3, float3, uint8_t>> renderables;
+        std::vector<std::tuple<uint32_t, float4, float3>> lights;
+    };
+    auto getGathered = [](FScene const* scene) {
+        Gathered result;
+        auto const& rd = scene->getRenderableData();
+        for (size_t i = 0; i < rd.size(); i++) {
+            mat4f const& m = rd.elementAt<FScene::WORLD_TRANSFORM>(i);
+            result.renderables.emplace_back(
+                    rd.elementAt<FScene::RENDERABLE_INSTANCE>(i).asValue(),
+                    std::array<float4, 4>{ m[0], m[1], m[2], m[3] },
+                    rd.elementAt<FScene::WORLD_AABB_CENTER>(i),
+                    rd.elementAt<FScene::WORLD_AABB_EXTENT>(i),
+                    rd.elementAt<FScene::LAYERS>(i));
+        }
+        auto const& ld = scene->getLightData();
+        for (size_t i = FScene::DIRECTIONAL_LIGHTS_COUNT; i < ld.size(); i++) {
+            result.lights.emplace_back(ld.elementAt<FScene::LIGHT_INSTANCE>(i).asValue(),
+                    ld.elementAt<FScene::POSITION_RADIUS>(i),
+                    ld.elementAt<FScene::DIRECTION>(i));
+        }
+        std::sort(result.renderables.begin(), result.renderables.end(),
+                [](auto const& a, auto const& b) { return std::get<0>(a) < std::get<0>(b); });
+        std::sort(result.lights.begin(), result.lights.end(),
+                [](auto const& a, auto const& b) { return std::get<0>(a) < std::get<0>(b); });
+        return result;
+    };
+
+    // compares the incrementally updated scene against a new scene, which gathers everything
+    FScene* scene = engine->createScene();
+    auto expectFullGather = [&](size_t renderableCount, size_t lightCount) {
+        scene->prepare({});
+        FScene* reference = engine->createScene();
+        for (Entity e : entities) {
+            if (scene->hasEntity(e)) {
+                reference->addEntity(e);
+            }
+        }
+        reference->prepare({});
+        Gathered const actual = getGathered(scene);
+        Gathered const expected = getGathered(reference);
+        EXPECT_EQ(renderableCount, actual.renderables.size());
+        EXPECT_EQ(lightCount, actual.lights.size());
+        EXPECT_TRUE(actual.renderables == expected.renderables);
+        EXPECT_TRUE(actual.lights == expected.lights);
+        engine->destroy(reference);
+    };
+
+    scene->addEntities(entities.data(), entities.size());
+    expectFullGather(100, 10);
+
+    // transforms, including the transforms of lights
+    for (size_t i = 0; i < entities.size(); i += 3) {
+        tcm.setTransform(tcm.getInstance(entities[i]), mat4f::translation(float3{ float(i), 1, 2 }));
+    }
+    expectFullGather(100, 10);
+
+    // renderable and light properties
+    rcm.setLayerMask(rcm.getInstance(entities[5]), 0xFF, 0x2);
+    rcm.setAxisAlignedBoundingBox(rcm.getInstance(entities[7]), {{ 1, 1, 1 }, { 2, 2, 2 }});
+    lcm.setLocalPosition(lcm.getInstance(entities[20]), { 1, 2, 3 });
+    expectFullGather(100, 10);
+
+    // nothing changed
+    expectFullGather(100, 10);
+
+    // removing entities from the scene
+    scene->remove(entities[1]);
+    scene->remove(entities[10]);
+    expectFullGather(98, 9);
+
+    // destroying entities without removing them from the scene or destroying their components
+    em.destroy(entities[2]);
+    em.destroy(entities[30]);
+    expectFullGather(96, 8);
+
+    // then changing the transforms of the remaining entities
+    tcm.setTransform(tcm.getInstance(entities[3]), mat4f::translation(float3{ 3, 2, 1 }));
+    expectFullGather(96, 8);
+
+    engine->destroy(scene);
+    for (Entity e : entities) {
+        rcm.destroy(e);
+        lcm.destroy(e);
+        tcm.destroy(e);
+    }
+    em.destroy(entities.size(), entities.data());
+    Engine::destroy((Engine **)&engine);
+}
+
 TEST(FilamentTest, GoogleLineDirective) {
     {
         char s[512] = "#line 10 \"foobar\"";
@@ -62,6 +62,11 @@ constexpr size_t CONFIG_MAX_SHADOW_CASCADES = 4;
 // We store 64 bytes per bone.
 constexpr size_t CONFIG_MAX_BONE_COUNT = 256;
 
+// The maximum number of instances of an instanced draw call.
+// This value is also limited by UBO size, ES3.0 only guarantees 16 KiB.
+// We store 256 bytes per instance.
+constexpr size_t CONFIG_MAX_INSTANCES = 64;
+
 } // namespace filament
 
 #endif // TNT_FILAMENT_driver/EngineEnums.h
@@ -146,6 +146,8 @@ struct alignas(256) PerRenderableUib {
     int32_t morphingEnabled; // 0=disabled, 1=enabled, ignored unless variant & SKINNING_OR_MORPHING
     uint32_t screenSpaceContactShadows; // 0=disabled, 1=enabled, ignored unless variant & SKINNING_OR_MORPHING
     float padding0;
+    // bring PerRenderableUib to 256 bytes, so its std140 layout matches when used in an array
+    filament::math::float4 padding1[7];
 };
 
 struct LightsUib {
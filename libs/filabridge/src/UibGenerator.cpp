@@ -28,9 +28,15 @@ using namespace backend;
 static_assert(sizeof(PerRenderableUib) % 256 == 0,
         "sizeof(Transform) should be a multiple of 256");
 
+static_assert(sizeof(PerRenderableUib) == 256,
+        "PerRenderableUib should be exactly 256 bytes");
+
 static_assert(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone) <= 16384,
         "Bones exceed max UBO size");
 
+static_assert(CONFIG_MAX_INSTANCES * sizeof(PerRenderableUib) <= 16384,
+        "Instances exceed max UBO size");
+
 static_assert(CONFIG_MAX_SHADOW_CASCADES == 4,
         "Changing CONFIG_MAX_SHADOW_CASCADES affects PerView size and breaks materials.");
 
@@ -125,6 +131,8 @@ UniformInterfaceBlock const& UibGenerator::getPerRenderableUib() noexcept {
             .add("morphingEnabled", 1, UniformInterfaceBlock::Type::INT)
             .add("screenSpaceContactShadows", 1, UniformInterfaceBlock::Type::UINT)
             .add("padding0", 1, UniformInterfaceBlock::Type::FLOAT)
+            // bring PerRenderableUib to 256 bytes
+            .add("padding1", 7, UniformInterfaceBlock::Type::FLOAT4)
             .build();
     return uib;
 }
@@ -37,10 +37,13 @@ public:
     // call this once after container.parse() has been called
     bool readIndex(filamat::ChunkType materialTag);
 
-    // call this as many times as needed
+    // call this as many times as needed, possibly concurrently with different ShaderBuilders
     bool getShader(ShaderBuilder& shaderBuilder,
             BlobDictionary const& dictionary,
-            uint8_t shaderModel, uint8_t variant, uint8_t stage);
+            uint8_t shaderModel, uint8_t variant, uint8_t stage) const;
+
+    // returns whether the package has the given shader, without extracting it
+    bool hasShader(uint8_t shaderModel, uint8_t variant, uint8_t stage) const noexcept;
 
 private:
     ChunkContainer const& mContainer;
@@ -51,11 +54,11 @@ private:
 
     bool getTextShader(Unflattener unflattener,
             BlobDictionary const& dictionary, ShaderBuilder& shaderBuilder,
-            uint8_t shaderModel, uint8_t variant, uint8_t stage);
+            uint8_t shaderModel, uint8_t variant, uint8_t stage) const;
 
     bool getSpirvShader(
             BlobDictionary const& dictionary, ShaderBuilder& shaderBuilder,
-            uint8_t shaderModel, uint8_t variant, uint8_t stage);
+            uint8_t shaderModel, uint8_t variant, uint8_t stage) const;
 };
 
 } // namespace filamat
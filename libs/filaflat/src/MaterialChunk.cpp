@@ -82,7 +82,7 @@ bool MaterialChunk::readIndex(filamat::ChunkType materialTag) {
 }
 
 bool MaterialChunk::getTextShader(Unflattener unflattener, BlobDictionary const& dictionary,
-        ShaderBuilder& shaderBuilder, uint8_t shaderModel, uint8_t variant, uint8_t ps) {
+        ShaderBuilder& shaderBuilder, uint8_t shaderModel, uint8_t variant, uint8_t ps) const {
     if (mBase == nullptr) {
         return false;
     }
@@ -137,7 +137,7 @@ bool MaterialChunk::getTextShader(Unflattener unflattener, BlobDictionary const&
 
 
 bool MaterialChunk::getSpirvShader(BlobDictionary const& dictionary,
-        ShaderBuilder& shaderBuilder, uint8_t shaderModel, uint8_t variant, uint8_t stage) {
+        ShaderBuilder& shaderBuilder, uint8_t shaderModel, uint8_t variant, uint8_t stage) const {
 
     if (mBase == nullptr) {
         return false;
@@ -160,7 +160,8 @@ bool MaterialChunk::getSpirvShader(BlobDictionary const& dictionary,
 }
 
 bool MaterialChunk::getShader(ShaderBuilder& shaderBuilder,
-        BlobDictionary const& dictionary, uint8_t shaderModel, uint8_t variant, uint8_t stage) {
+        BlobDictionary const& dictionary, uint8_t shaderModel, uint8_t variant,
+        uint8_t stage) const {
     switch (mMaterialTag) {
         case filamat::ChunkType::MaterialGlsl:
         case filamat::ChunkType::MaterialMetal:
@@ -172,5 +173,16 @@ bool MaterialChunk::getShader(ShaderBuilder& shaderBuilder,
     }
 }
 
-} // namespace filaflat
+bool MaterialChunk::hasShader(uint8_t shaderModel, uint8_t variant, uint8_t stage) const noexcept {
+    if (mBase == nullptr) {
+        return false;
+    }
+    auto pos = mOffsets.find(makeKey(shaderModel, variant, stage));
+    if (pos == mOffsets.end()) {
+        return false;
+    }
+    // text shaders use an offset of 0 for missing shaders, SPIR-V shaders are blob indices
+    return mMaterialTag == filamat::ChunkType::MaterialSpirv || pos->second != 0;
+}
 
+} // namespace filaflat
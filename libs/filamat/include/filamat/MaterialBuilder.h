@@ -32,12 +32,17 @@
 
 #include <filamat/IncludeCallback.h>
 #include <filamat/Package.h>
+#include <filamat/ShaderCache.h>
 
 #include <utils/BitmaskEnum.h>
 #include <utils/bitset.h>
 #include <utils/compiler.h>
 #include <utils/CString.h>
 
+namespace utils {
+class JobSystem;
+}
+
 namespace filamat {
 
 struct MaterialInfo;
@@ -462,6 +467,13 @@ public:
     //! If true, will include debugging information in generated SPIRV.
     MaterialBuilder& generateDebugInfo(bool generateDebugInfo) noexcept;
 
+    /**
+     * Set the cache consulted before compiling each shader, compiled shaders that were not
+     * found are added to it. The cache must outlive the calls to build(). The default is no
+     * cache. The cache is not used when printing shaders or when linking against filamat_lite.
+     */
+    MaterialBuilder& shaderCache(ShaderCache* cache) noexcept;
+
     //! Specifies a list of variants that should be filtered out during code generation.
     MaterialBuilder& variantFilter(uint8_t variantFilter) noexcept;
 
@@ -478,6 +490,13 @@ public:
     //! Build the material.
     Package build() noexcept;
 
+    /**
+     * Build the material, compiling its shaders in parallel on the given JobSystem.
+     * The calling thread must have been adopted by the JobSystem. The package is identical to
+     * the one returned by build().
+     */
+    Package build(utils::JobSystem& jobSystem) noexcept;
+
 public:
     // The methods and types below are for internal use
     /// @cond never
@@ -595,8 +614,10 @@ private:
     void writeCommonChunks(ChunkContainer& container, MaterialInfo& info) const noexcept;
     void writeSurfaceChunks(ChunkContainer& container) const noexcept;
 
-    bool generateShaders(const std::vector<Variant>& variants, ChunkContainer& container,
-            const MaterialInfo& info) const noexcept;
+    Package build(utils::JobSystem* jobSystem) noexcept;
+
+    bool generateShaders(utils::JobSystem* jobSystem, const std::vector<Variant>& variants,
+            ChunkContainer& container, const MaterialInfo& info) const noexcept;
 
     bool isLit() const noexcept { return mShading != filament::Shading::UNLIT; }
 
@@ -632,6 +653,8 @@ private:
 
     IncludeCallback mIncludeCallback = nullptr;
 
+    ShaderCache* mShaderCache = nullptr;
+
     PropertyList mProperties;
     ParameterList mParameters;
     VariableList mVariables;
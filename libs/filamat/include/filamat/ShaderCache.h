@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMAT_SHADERCACHE_H
+#define TNT_FILAMAT_SHADERCACHE_H
+
+#include <utils/compiler.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filamat {
+
+/**
+ * A content-addressed store of compiled shaders, consulted by MaterialBuilder before running
+ * glslang and spirv-opt.
+ *
+ * Keys are hexadecimal digests of everything that affects a compiled shader: the generated
+ * source (with its includes resolved and variant defines applied), the shader stage and model,
+ * the target API and language, the optimization level and the debug flags. Values are opaque
+ * blobs produced by MaterialBuilder, which validates them when they're read back.
+ *
+ * When a material is built with a JobSystem, get() and put() are called concurrently and must
+ * be thread-safe.
+ *
+ * For an example of implementing this interface, see tools/matc/src/matc/DirShaderCache.h.
+ */
+class UTILS_PUBLIC ShaderCache {
+public:
+    virtual ~ShaderCache() = default;
+
+    /**
+     * Looks up a compiled shader.
+     *
+     * @param key a null-terminated hexadecimal digest
+     * @param blob receives the value stored for this key
+     * @return true if the key was found, false otherwise.
+     */
+    virtual bool get(const char* key, std::vector<uint8_t>& blob) noexcept = 0;
+
+    //! Stores a compiled shader, failures are not reported since the cache is only an optimization.
+    virtual void put(const char* key, const uint8_t* data, size_t size) noexcept = 0;
+};
+
+} // namespace filamat
+
+#endif // TNT_FILAMAT_SHADERCACHE_H
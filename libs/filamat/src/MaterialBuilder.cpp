@@ -18,6 +18,9 @@
 
 #include <vector>
 
+#include <string.h>
+
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 #include <utils/Log.h>
 
@@ -378,6 +381,11 @@ MaterialBuilder& MaterialBuilder::generateDebugInfo(bool generateDebugInfo) noex
     return *this;
 }
 
+MaterialBuilder& MaterialBuilder::shaderCache(ShaderCache* cache) noexcept {
+    mShaderCache = cache;
+    return *this;
+}
+
 MaterialBuilder& MaterialBuilder::variantFilter(uint8_t variantFilter) noexcept {
     mVariantFilter = variantFilter;
     return *this;
@@ -596,14 +604,124 @@ static void showErrorMessage(const char* materialName, uint8_t variant,
             << shaderCode;
 }
 
-bool MaterialBuilder::generateShaders(const std::vector<Variant>& variants, ChunkContainer& container,
-        const MaterialInfo& info) const noexcept {
-    // Create a postprocessor to optimize / compile to Spir-V if necessary.
+#ifndef FILAMAT_LITE
+
+// Bump this when the compiled shaders change while their generated source doesn't, e.g. when
+// glslang, spirv-opt or the optimization passes are updated.
+static constexpr uint32_t SHADER_CACHE_VERSION = 1;
+
+static constexpr uint32_t SHADER_CACHE_MAGIC = 0x43485346; // 'FSHC'
+
+// A 128-bit digest made of two 64-bit FNV-1a hashes with different bases and primes, each
+// finalized with murmur3's mixer. It isn't cryptographic, but the inputs aren't adversarial.
+class ShaderDigest {
+public:
+    void add(const void* data, size_t size) noexcept {
+        const uint8_t* p = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++) {
+            mHash[0] = (mHash[0] ^ p[i]) * 0x100000001b3ull;
+            mHash[1] = (mHash[1] ^ p[i]) * 0x9e3779b97f4a7c15ull;
+        }
+    }
+
+    void add(uint32_t value) noexcept {
+        add(&value, sizeof(value));
+    }
+
+    // Writes the digest as 32 hexadecimal digits, followed by a null character.
+    void getKey(char key[33]) const noexcept {
+        static const char digits[] = "0123456789abcdef";
+        for (size_t i = 0; i < 2; i++) {
+            const uint64_t h = mix(mHash[i]);
+            for (size_t j = 0; j < 16; j++) {
+                key[i * 16 + j] = digits[(h >> (60u - j * 4u)) & 0xfu];
+            }
+        }
+        key[32] = 0;
+    }
+
+private:
+    static uint64_t mix(uint64_t h) noexcept {
+        h ^= h >> 33u;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33u;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33u;
+        return h;
+    }
+
+    uint64_t mHash[2] = { 0xcbf29ce484222325ull, 0x84222325cbf29ce4ull };
+};
+
+// A cached shader is a header followed by the compiled shader text, the MSL and the SPIR-V.
+struct CachedShaderHeader {
+    uint32_t magic;
+    uint32_t shaderSize;
+    uint32_t mslSize;
+    uint32_t spirvSize;     // in words
+};
+
+static void writeCachedShader(std::vector<uint8_t>& blob, const std::string& shader,
+        const std::vector<uint32_t>* spirv, const std::string* msl) noexcept {
+    const CachedShaderHeader header{
+            SHADER_CACHE_MAGIC,
+            uint32_t(shader.size()),
+            msl ? uint32_t(msl->size()) : 0u,
+            spirv ? uint32_t(spirv->size()) : 0u };
+    const size_t spirvBytes = header.spirvSize * sizeof(uint32_t);
+    blob.resize(sizeof(header) + header.shaderSize + header.mslSize + spirvBytes);
+    uint8_t* p = blob.data();
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, shader.data(), header.shaderSize);
+    p += header.shaderSize;
+    if (msl) {
+        memcpy(p, msl->data(), header.mslSize);
+        p += header.mslSize;
+    }
+    if (spirv) {
+        memcpy(p, spirv->data(), spirvBytes);
+    }
+}
+
+// Returns false, leaving the outputs untouched, if the blob is malformed or doesn't have the
+// outputs this compilation expects.
+static bool readCachedShader(const std::vector<uint8_t>& blob, std::string& shader,
+        std::vector<uint32_t>* spirv, std::string* msl) noexcept {
+    CachedShaderHeader header;
+    if (blob.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, blob.data(), sizeof(header));
+    const size_t spirvBytes = size_t(header.spirvSize) * sizeof(uint32_t);
+    if (header.magic != SHADER_CACHE_MAGIC ||
+            blob.size() != sizeof(header) + header.shaderSize + header.mslSize + spirvBytes ||
+            (spirv != nullptr) != (header.spirvSize != 0) ||
+            (msl != nullptr) != (header.mslSize != 0)) {
+        return false;
+    }
+    const char* p = (const char*)blob.data() + sizeof(header);
+    shader.assign(p, header.shaderSize);
+    p += header.shaderSize;
+    if (msl) {
+        msl->assign(p, header.mslSize);
+        p += header.mslSize;
+    }
+    if (spirv) {
+        spirv->resize(header.spirvSize);
+        memcpy(spirv->data(), p, spirvBytes);
+    }
+    return true;
+}
+
+#endif
+
+bool MaterialBuilder::generateShaders(JobSystem* jobSystem, const std::vector<Variant>& variants,
+        ChunkContainer& container, const MaterialInfo& info) const noexcept {
 #ifndef FILAMAT_LITE
     uint32_t flags = 0;
     flags |= mPrintShaders ? GLSLPostProcessor::PRINT_SHADERS : 0;
     flags |= mGenerateDebugInfo ? GLSLPostProcessor::GENERATE_DEBUG_INFO : 0;
-    GLSLPostProcessor postProcessor(mOptimization, flags);
 #endif
 
     // Generate all shaders.
@@ -617,8 +735,6 @@ bool MaterialBuilder::generateShaders(const std::vector<Variant>& variants, Chun
 #ifndef FILAMAT_LITE
     BlobDictionary spirvDictionary;
 #endif
-    std::vector<uint32_t> spirv;
-    std::string msl;
 
     ShaderGenerator sg(mProperties, mVariables, mOutputs, mDefines, mMaterialCode.getResolved(),
             mMaterialCode.getLineOffset(), mMaterialVertexCode.getResolved(),
@@ -629,38 +745,59 @@ bool MaterialBuilder::generateShaders(const std::vector<Variant>& variants, Chun
             mBlendingMode == BlendingMode::MASKED || !emptyVertexCode;
     container.addSimpleChild<bool>(ChunkType::MaterialHasCustomDepthShader, customDepth);
 
+    // Each shader is compiled on its own, possibly in parallel, and the results are then added to
+    // the dictionaries and chunks in order, so that the package doesn't depend on scheduling.
+    struct Compilation {
+        CodeGenParams const* params;
+        Variant const* variant;
+        std::string shader;             // GLSL, or MSL for Metal
+        std::vector<uint32_t> spirv;
+        std::string log;                // diagnostics, when compiled in parallel
+        bool ok;
+    };
+
+    std::vector<Compilation> compilations;
+    compilations.reserve(mCodeGenPermutations.size() * variants.size());
     for (const auto& params : mCodeGenPermutations) {
-        const ShaderModel shaderModel = ShaderModel(params.shaderModel);
-        const TargetApi targetApi = params.targetApi;
-        const TargetLanguage targetLanguage = params.targetLanguage;
-
-        assertSingleTargetApi(targetApi);
-
-        // Metal Shading Language is cross-compiled from Vulkan.
-        const bool targetApiNeedsSpirv =
-                (targetApi == TargetApi::VULKAN || targetApi == TargetApi::METAL);
-        const bool targetApiNeedsMsl = targetApi == TargetApi::METAL;
-        std::vector<uint32_t>* pSpirv = targetApiNeedsSpirv ? &spirv : nullptr;
-        std::string* pMsl = targetApiNeedsMsl ? &msl : nullptr;
-
-        TextEntry glslEntry{0};
-        SpirvEntry spirvEntry{0};
-        TextEntry metalEntry{0};
+        assertSingleTargetApi(params.targetApi);
+        for (const auto& v : variants) {
+            compilations.push_back({ &params, &v, {}, {}, {}, false });
+        }
+    }
 
-        glslEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
-        spirvEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
-        metalEntry.shaderModel = static_cast<uint8_t>(params.shaderModel);
+    // Printed shaders would be interleaved, so they are compiled serially.
+    const bool parallel = jobSystem && !mPrintShaders && compilations.size() > 1;
 
-        for (const auto& v : variants) {
-            glslEntry.variant = v.variant;
-            spirvEntry.variant = v.variant;
-            metalEntry.variant = v.variant;
+    auto compile = [&](uint32_t first, uint32_t count) {
+#ifndef FILAMAT_LITE
+        // GLSLPostProcessor isn't thread-safe, each batch uses its own.
+        GLSLPostProcessor postProcessor(mOptimization, flags);
+#endif
+        for (uint32_t i = first, e = first + count; i != e; i++) {
+            Compilation& c = compilations[i];
+            // The diagnostics are logged in order once all the shaders are compiled. This thread
+            // may have been logging for something it's waiting for, that's restored afterwards.
+            std::string* const previousLog =
+                    parallel ? io::LogStream::redirect(&c.log) : nullptr;
+
+            const Variant& v = *c.variant;
+            const ShaderModel shaderModel = ShaderModel(c.params->shaderModel);
+            const TargetApi targetApi = c.params->targetApi;
+            const TargetLanguage targetLanguage = c.params->targetLanguage;
+
+            // Metal Shading Language is cross-compiled from Vulkan.
+            const bool targetApiNeedsSpirv =
+                    (targetApi == TargetApi::VULKAN || targetApi == TargetApi::METAL);
+            const bool targetApiNeedsMsl = targetApi == TargetApi::METAL;
+            std::vector<uint32_t>* pSpirv = targetApiNeedsSpirv ? &c.spirv : nullptr;
+            std::string msl;
+            std::string* pMsl = targetApiNeedsMsl ? &msl : nullptr;
 
             // Generate raw shader code.
             // The quotes in Google-style line directives cause problems with certain drivers. These
             // directives are optimized away when using the full filamat, so down below we
             // explicitly remove them when using filamat lite.
-            std::string shader;
+            std::string& shader = c.shader;
             if (v.stage == filament::backend::ShaderType::VERTEX) {
                 shader = sg.createVertexProgram(
                         shaderModel, targetApi, targetLanguage, info, v.variant,
@@ -690,46 +827,111 @@ bool MaterialBuilder::generateShaders(const std::vector<Variant>& variants, Chun
                 config.glsl.subpassInputToColorLocation.emplace_back(0, 0);
             }
 
-            bool ok = postProcessor.process(shader, config, &shader, pSpirv, pMsl);
-#else
-            bool ok = true;
-#endif
-            if (!ok) {
-                showErrorMessage(mMaterialName.c_str_safe(), v.variant, targetApi, v.stage, shader);
-                return false;
+            // Printed shaders come from the post-processor, so the cache can't be used then.
+            char key[33];
+            std::vector<uint8_t> blob;
+            ShaderCache* const cache = mPrintShaders ? nullptr : mShaderCache;
+            if (cache) {
+                ShaderDigest digest;
+                digest.add(SHADER_CACHE_VERSION);
+                digest.add(filament::MATERIAL_VERSION);
+                digest.add(uint32_t(v.stage));
+                digest.add(uint32_t(v.variant));
+                digest.add(uint32_t(shaderModel));
+                digest.add(uint32_t(targetApi));
+                digest.add(uint32_t(targetLanguage));
+                digest.add(uint32_t(mOptimization));
+                digest.add(flags);
+                digest.add(uint32_t(mEnableFramebufferFetch));
+                digest.add(shader.data(), shader.size());
+                digest.getKey(key);
             }
 
-            if (targetApi == TargetApi::OPENGL) {
-                if (targetLanguage == TargetLanguage::SPIRV) {
-                    sg.fixupExternalSamplers(shaderModel, shader, info);
+            if (cache && cache->get(key, blob) && readCachedShader(blob, shader, pSpirv, pMsl)) {
+                c.ok = true;
+            } else {
+                c.ok = postProcessor.process(shader, config, &shader, pSpirv, pMsl);
+                if (cache && c.ok) {
+                    writeCachedShader(blob, shader, pSpirv, pMsl);
+                    cache->put(key, blob.data(), blob.size());
                 }
-
-                glslEntry.stage = v.stage;
-                glslEntry.shader = shader;
-                textDictionary.addText(glslEntry.shader);
-                glslEntries.push_back(glslEntry);
+            }
+#else
+            c.ok = true;
+#endif
+            if (parallel) {
+                io::LogStream::redirect(previousLog);
+            }
+            if (!c.ok) {
+                // the remaining shaders of this batch would be discarded anyway
+                return;
             }
 
-#ifndef FILAMAT_LITE
-            if (targetApi == TargetApi::VULKAN) {
-                assert(!spirv.empty());
-                spirvEntry.stage = v.stage;
-                spirvEntry.dictionaryIndex = spirvDictionary.addBlob(spirv);
-                spirv.clear();
-                spirvEntries.push_back(spirvEntry);
+            if (targetApi == TargetApi::OPENGL && targetLanguage == TargetLanguage::SPIRV) {
+                sg.fixupExternalSamplers(shaderModel, shader, info);
             }
             if (targetApi == TargetApi::METAL) {
-                assert(!spirv.empty());
-                assert(msl.length() > 0);
-                metalEntry.stage = v.stage;
-                metalEntry.shader = msl;
-                spirv.clear();
-                msl.clear();
-                textDictionary.addText(metalEntry.shader);
-                metalEntries.push_back(metalEntry);
+                shader = std::move(msl);
             }
-#endif
         }
+    };
+
+    if (parallel) {
+        auto* job = jobs::parallel_for(*jobSystem, nullptr, 0, uint32_t(compilations.size()),
+                std::cref(compile), jobs::CountSplitter<1>());
+        jobSystem->runAndWait(job);
+    } else {
+        compile(0, uint32_t(compilations.size()));
+    }
+
+    for (Compilation& c : compilations) {
+        const Variant& v = *c.variant;
+        const TargetApi targetApi = c.params->targetApi;
+
+        if (!c.log.empty()) {
+            utils::slog.e << c.log << utils::io::flush;
+        }
+        if (!c.ok) {
+            showErrorMessage(mMaterialName.c_str_safe(), v.variant, targetApi, v.stage, c.shader);
+            return false;
+        }
+
+        if (targetApi == TargetApi::OPENGL) {
+            TextEntry glslEntry{0};
+            glslEntry.shaderModel = static_cast<uint8_t>(c.params->shaderModel);
+            glslEntry.variant = v.variant;
+            glslEntry.stage = v.stage;
+            glslEntry.shader = std::move(c.shader);
+            textDictionary.addText(glslEntry.shader);
+            glslEntries.push_back(std::move(glslEntry));
+        }
+
+#ifndef FILAMAT_LITE
+        if (targetApi == TargetApi::VULKAN) {
+            assert(!c.spirv.empty());
+            SpirvEntry spirvEntry{0};
+            spirvEntry.shaderModel = static_cast<uint8_t>(c.params->shaderModel);
+            spirvEntry.variant = v.variant;
+            spirvEntry.stage = v.stage;
+            spirvEntry.dictionaryIndex = spirvDictionary.addBlob(c.spirv);
+            spirvEntries.push_back(spirvEntry);
+        }
+        if (targetApi == TargetApi::METAL) {
+            assert(!c.spirv.empty());
+            assert(c.shader.length() > 0);
+            TextEntry metalEntry{0};
+            metalEntry.shaderModel = static_cast<uint8_t>(c.params->shaderModel);
+            metalEntry.variant = v.variant;
+            metalEntry.stage = v.stage;
+            metalEntry.shader = std::move(c.shader);
+            textDictionary.addText(metalEntry.shader);
+            metalEntries.push_back(std::move(metalEntry));
+        }
+#endif
+        // release the memory as we go
+        c.shader = {};
+        c.spirv = {};
+        c.log = {};
     }
 
     // Emit dictionary chunk (TextDictionaryReader and DictionaryTextChunk)
@@ -809,6 +1011,14 @@ MaterialBuilder& MaterialBuilder::enableFramebufferFetch() noexcept {
 }
 
 Package MaterialBuilder::build() noexcept {
+    return build(nullptr);
+}
+
+Package MaterialBuilder::build(JobSystem& jobSystem) noexcept {
+    return build(&jobSystem);
+}
+
+Package MaterialBuilder::build(JobSystem* jobSystem) noexcept {
     if (materialBuilderClients == 0) {
         utils::slog.e << "Error: MaterialBuilder::init() must be called before build()."
             << utils::io::endl;
@@ -855,7 +1065,7 @@ Package MaterialBuilder::build() noexcept {
     const auto variants = mMaterialDomain == MaterialDomain::SURFACE ?
         determineSurfaceVariants(mVariantFilter, isLit(), mShadowMultiplier) :
         determinePostProcessVariants();
-    bool success = generateShaders(variants, container, info);
+    bool success = generateShaders(jobSystem, variants, container, info);
 
     if (!success) {
         // Return an empty package to signal a failure to build the material.
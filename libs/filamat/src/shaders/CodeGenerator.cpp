@@ -270,16 +270,68 @@ io::sstream& CodeGenerator::generateUniforms(io::sstream& out, ShaderType shader
     std::string instanceName(uib.getName().c_str());
     instanceName.front() = char(std::tolower((unsigned char)instanceName.front()));
 
-    Precision uniformPrecision = getDefaultUniformPrecision();
-    Precision defaultPrecision = getDefaultPrecision(shaderType);
-
     out << "\nlayout(";
     if (mTargetLanguage == TargetLanguage::SPIRV) {
         uint32_t bindingIndex = (uint32_t) binding; // avoid char output
         out << "binding = " << bindingIndex << ", ";
     }
     out << "std140) uniform " << blockName.c_str() << " {\n";
-    for (auto const& info : infos) {
+    generateUniformFields(out, shaderType, uib);
+    out << "} " << instanceName << ";\n";
+
+    return out;
+}
+
+io::sstream& CodeGenerator::generateInstancedUniforms(io::sstream& out, ShaderType shaderType,
+        uint8_t binding, const UniformInterfaceBlock& uib, uint32_t instanceCount) const {
+    auto const& infos = uib.getUniformInfoList();
+    if (infos.empty()) {
+        return out;
+    }
+
+    // The block holds an array of structures, one per instance of an instanced draw call.
+    // The usual "instance" name of the block is then defined as the current instance's entry,
+    // which is indexed by the instance ID in the vertex shader, and by a flat varying in the
+    // fragment shader.
+    const CString& blockName = uib.getName();
+    std::string instanceName(uib.getName().c_str());
+    instanceName.front() = char(std::tolower((unsigned char)instanceName.front()));
+
+    out << "\nstruct " << blockName.c_str() << "Data {\n";
+    generateUniformFields(out, shaderType, uib);
+    out << "};\n";
+
+    out << "layout(";
+    if (mTargetLanguage == TargetLanguage::SPIRV) {
+        uint32_t bindingIndex = (uint32_t) binding; // avoid char output
+        out << "binding = " << bindingIndex << ", ";
+    }
+    out << "std140) uniform " << blockName.c_str() << " {\n";
+    out << "    " << blockName.c_str() << "Data " << instanceName << "Array["
+        << instanceCount << "];\n";
+    out << "};\n";
+
+    if (shaderType == ShaderType::VERTEX) {
+        // glslang defines VULKAN when it parses with Vulkan semantics, which doesn't depend only
+        // on the target language: OpenGL shaders that go through SPIR-V are analyzed without.
+        out << "#if defined(VULKAN)\n";
+        out << "#define INSTANCE_INDEX gl_InstanceIndex\n";
+        out << "#else\n";
+        out << "#define INSTANCE_INDEX gl_InstanceID\n";
+        out << "#endif\n";
+    } else {
+        out << "#define INSTANCE_INDEX vertex_instanceIndex\n";
+    }
+    out << "#define " << instanceName << " " << instanceName << "Array[INSTANCE_INDEX]\n";
+
+    return out;
+}
+
+void CodeGenerator::generateUniformFields(io::sstream& out, ShaderType shaderType,
+        const UniformInterfaceBlock& uib) const {
+    Precision uniformPrecision = getDefaultUniformPrecision();
+    Precision defaultPrecision = getDefaultPrecision(shaderType);
+    for (auto const& info : uib.getUniformInfoList()) {
         char const* const type = getUniformTypeName(info.type);
         char const* const precision = getUniformPrecisionQualifier(info.type, info.precision,
                 uniformPrecision, defaultPrecision);
@@ -291,9 +343,6 @@ io::sstream& CodeGenerator::generateUniforms(io::sstream& out, ShaderType shader
         }
         out << ";\n";
     }
-    out << "} " << instanceName << ";\n";
-
-    return out;
 }
 
 io::sstream& CodeGenerator::generateSamplers(
@@ -102,6 +102,12 @@ public:
     utils::io::sstream& generateUniforms(utils::io::sstream& out, ShaderType type, uint8_t binding,
             const filament::UniformInterfaceBlock& uib) const;
 
+    // generate uniforms declared as an array with one entry per instance, the block's instance
+    // name refers to the entry of the current instance
+    utils::io::sstream& generateInstancedUniforms(utils::io::sstream& out, ShaderType type,
+            uint8_t binding, const filament::UniformInterfaceBlock& uib,
+            uint32_t instanceCount) const;
+
     // generate samplers
     utils::io::sstream& generateSamplers(
         utils::io::sstream& out, uint8_t firstBinding, const filament::SamplerInterfaceBlock& sib) const;
@@ -131,6 +137,9 @@ private:
     filament::backend::Precision getDefaultPrecision(ShaderType type) const;
     filament::backend::Precision getDefaultUniformPrecision() const;
 
+    void generateUniformFields(utils::io::sstream& out, ShaderType type,
+            const filament::UniformInterfaceBlock& uib) const;
+
     const char* getUniformPrecisionQualifier(filament::backend::UniformType type,
             filament::backend::Precision precision,
             filament::backend::Precision uniformPrecision,
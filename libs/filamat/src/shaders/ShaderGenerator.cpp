@@ -224,8 +224,9 @@ std::string ShaderGenerator::createVertexProgram(filament::backend::ShaderModel
     // uniforms
     cg.generateUniforms(vs, ShaderType::VERTEX,
             BindingPoints::PER_VIEW, UibGenerator::getPerViewUib());
-    cg.generateUniforms(vs, ShaderType::VERTEX,
-            BindingPoints::PER_RENDERABLE, UibGenerator::getPerRenderableUib());
+    cg.generateInstancedUniforms(vs, ShaderType::VERTEX,
+            BindingPoints::PER_RENDERABLE, UibGenerator::getPerRenderableUib(),
+            uint32_t(CONFIG_MAX_INSTANCES));
     if (litVariants && variant.hasShadowReceiver()) {
         cg.generateUniforms(vs, ShaderType::VERTEX,
                 BindingPoints::SHADOW, UibGenerator::getShadowUib());
@@ -412,8 +413,9 @@ std::string ShaderGenerator::createFragmentProgram(filament::backend::ShaderMode
     // uniforms and samplers
     cg.generateUniforms(fs, ShaderType::FRAGMENT,
             BindingPoints::PER_VIEW, UibGenerator::getPerViewUib());
-    cg.generateUniforms(fs, ShaderType::FRAGMENT,
-            BindingPoints::PER_RENDERABLE, UibGenerator::getPerRenderableUib());
+    cg.generateInstancedUniforms(fs, ShaderType::FRAGMENT,
+            BindingPoints::PER_RENDERABLE, UibGenerator::getPerRenderableUib(),
+            uint32_t(CONFIG_MAX_INSTANCES));
     cg.generateUniforms(fs, ShaderType::FRAGMENT,
             BindingPoints::LIGHTS, UibGenerator::getLightsUib());
     cg.generateUniforms(fs, ShaderType::FRAGMENT,
@@ -23,6 +23,14 @@
 
 #include <filamat/Enums.h>
 
+#include <utils/JobSystem.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <string.h>
+
 using namespace ASTUtils;
 using namespace filament::backend;
 
@@ -695,6 +703,97 @@ TEST_F(MaterialCompiler, Arrays) {
     EXPECT_TRUE(result.isValid());
 }
 
+TEST_F(MaterialCompiler, ParallelBuildIsDeterministic) {
+    auto build = [](utils::JobSystem* jobSystem) {
+        filamat::MaterialBuilder builder;
+        builder.material(R"(
+            void material(inout MaterialInputs material) {
+                prepareMaterial(material);
+                material.baseColor = materialParams.color;
+            }
+        )");
+        builder.parameter(UniformType::FLOAT4, "color");
+        builder.targetApi(filamat::MaterialBuilder::TargetApi::ALL);
+        return jobSystem ? builder.build(*jobSystem) : builder.build();
+    };
+
+    // several threads, regardless of the machine
+    utils::JobSystem jobSystem(4);
+    jobSystem.adopt();
+    filamat::Package parallel = build(&jobSystem);
+    jobSystem.emancipate();
+    filamat::Package serial = build(nullptr);
+
+    ASSERT_TRUE(serial.isValid());
+    ASSERT_TRUE(parallel.isValid());
+    ASSERT_EQ(serial.getSize(), parallel.getSize());
+    EXPECT_EQ(0, memcmp(serial.getData(), parallel.getData(), serial.getSize()));
+}
+
+class MemoryShaderCache : public filamat::ShaderCache {
+public:
+    bool get(const char* key, std::vector<uint8_t>& blob) noexcept override {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto pos = mEntries.find(key);
+        if (pos == mEntries.end()) {
+            misses++;
+            return false;
+        }
+        hits++;
+        blob = pos->second;
+        return true;
+    }
+
+    void put(const char* key, const uint8_t* data, size_t size) noexcept override {
+        std::lock_guard<std::mutex> lock(mLock);
+        mEntries[key].assign(data, data + size);
+    }
+
+    size_t getEntryCount() const noexcept { return mEntries.size(); }
+
+    size_t hits = 0;
+    size_t misses = 0;
+
+private:
+    std::mutex mLock;
+    std::map<std::string, std::vector<uint8_t>> mEntries;
+};
+
+TEST_F(MaterialCompiler, ShaderCacheHits) {
+    MemoryShaderCache cache;
+    auto build = [&cache](const char* color) {
+        filamat::MaterialBuilder builder;
+        std::string code = std::string(R"(
+            void material(inout MaterialInputs material) {
+                prepareMaterial(material);
+                material.baseColor = )") + color + ";\n}\n";
+        builder.material(code.c_str());
+        builder.targetApi(filamat::MaterialBuilder::TargetApi::ALL);
+        builder.shaderCache(&cache);
+        return builder.build();
+    };
+
+    filamat::Package first = build("vec4(1.0)");
+    ASSERT_TRUE(first.isValid());
+    EXPECT_EQ(0u, cache.hits);
+    EXPECT_EQ(cache.misses, cache.getEntryCount());
+
+    // an identical material is entirely served by the cache, and yields the same package
+    const size_t misses = cache.misses;
+    filamat::Package second = build("vec4(1.0)");
+    ASSERT_TRUE(second.isValid());
+    EXPECT_EQ(misses, cache.hits);
+    EXPECT_EQ(misses, cache.misses);
+    ASSERT_EQ(first.getSize(), second.getSize());
+    EXPECT_EQ(0, memcmp(first.getData(), second.getData(), first.getSize()));
+
+    // only the fragment shaders depend on the material's code
+    filamat::Package third = build("vec4(0.5)");
+    ASSERT_TRUE(third.isValid());
+    EXPECT_GT(cache.hits, misses);
+    EXPECT_GT(cache.misses, misses);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
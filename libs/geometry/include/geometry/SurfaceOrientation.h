@@ -23,6 +23,13 @@
 
 #include <utils/compiler.h>
 
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 
 /**
@@ -39,6 +46,19 @@ struct OrientationImpl;
 class UTILS_PUBLIC SurfaceOrientation {
 public:
 
+    /**
+     * Type of the components of the vertex attributes given to the Builder. Integer components
+     * are converted to float either by normalization (e.g. a SHORT of 32767 becomes 1.0) or as-is,
+     * which matches the quantized attributes allowed by glTF's KHR_mesh_quantization.
+     */
+    enum class ComponentType : uint8_t {
+        FLOAT,
+        BYTE,
+        UBYTE,
+        SHORT,
+        USHORT,
+    };
+
     /**
      * The Builder is used to construct an immutable surface orientation helper.
      *
@@ -53,11 +73,17 @@ public:
      *
      * Additionally, the client-side data has the following type constraints:
      *
-     *  - Normals must be float3
-     *  - Tangents must be float4
-     *  - UVs must be float2
-     *  - Positions must be float3
-     *  - Triangles must be uint3 or ushort3
+     *  - Normals must have 3 components
+     *  - Tangents must have 4 components
+     *  - UVs must have 2 components
+     *  - Positions must have 3 components
+     *  - Triangles must be uint3, ushort3 or ubyte3
+     *
+     * Attributes are float by default, the setters that take a ComponentType also accept
+     * quantized data. All attributes can be interleaved, the strides are given in bytes.
+     *
+     * If a triangle count is given without triangles, every three consecutive vertices form a
+     * triangle.
      *
      * Currently, mikktspace is not supported because it requires re-indexing the mesh. Instead
      * we use the method described by Eric Lengyel in "Foundations of Game Engine Development"
@@ -80,9 +106,33 @@ public:
         Builder& uvs(const filament::math::float2*, size_t stride = 0) noexcept;
         Builder& positions(const filament::math::float3*, size_t stride = 0) noexcept;
 
+        /**
+         * Supplies attributes in any of the types of ComponentType, e.g. normalized shorts. The
+         * data is read directly during build(), without any intermediate copy.
+         * @{
+         */
+        Builder& normals(const void*, ComponentType, bool normalized, size_t stride = 0) noexcept;
+        Builder& tangents(const void*, ComponentType, bool normalized, size_t stride = 0) noexcept;
+        Builder& uvs(const void*, ComponentType, bool normalized, size_t stride = 0) noexcept;
+        Builder& positions(const void*, ComponentType, bool normalized, size_t stride = 0) noexcept;
+        /**
+         * @}
+         */
+
         Builder& triangleCount(size_t triangleCount) noexcept;
         Builder& triangles(const filament::math::uint3*) noexcept;
         Builder& triangles(const filament::math::ushort3*) noexcept;
+        Builder& triangles(const filament::math::ubyte3*) noexcept;
+
+        /**
+         * Optional JobSystem used to split large meshes across its threads. build() waits for the
+         * jobs to complete, it can itself be called from a job.
+         *
+         * The jobs are run with the given JobSystem::runFlags. When build() is called from a
+         * BACKGROUND job, pass JobSystem::BACKGROUND so that the work doesn't delay frame-critical
+         * jobs.
+         */
+        Builder& jobSystem(utils::JobSystem* js, uint32_t runFlags = 0) noexcept;
 
         /**
          * Generates quats or returns null if the submitted data is an incomplete combination.
@@ -16,37 +16,142 @@
 
 #include <geometry/SurfaceOrientation.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 
 #include <math/mat3.h>
 #include <math/norm.h>
 
+#include <algorithm>
+#include <limits>
 #include <vector>
 
+#include <string.h>
+
 namespace filament {
 namespace geometry {
 
 using namespace filament::math;
+using namespace utils;
 using std::vector;
 using Builder = SurfaceOrientation::Builder;
+using ComponentType = SurfaceOrientation::ComponentType;
+
+// Number of vertices or triangles below which a mesh is not split across several jobs.
+static constexpr size_t VERTICES_PER_JOB = 64 * 1024;
+static constexpr size_t TRIANGLES_PER_JOB = 32 * 1024;
+
+// Reads a vertex attribute of any component type and stride, converting it to float.
+struct Attribute {
+    const uint8_t* data = nullptr;
+    size_t stride = 0;
+    ComponentType type = ComponentType::FLOAT;
+    bool normalized = false;
+
+    explicit operator bool() const noexcept { return data != nullptr; }
+
+    float component(const uint8_t* p, size_t i) const noexcept {
+        switch (type) {
+            case ComponentType::FLOAT: {
+                float f;
+                memcpy(&f, p + i * sizeof(float), sizeof(float));
+                return f;
+            }
+            case ComponentType::BYTE: {
+                const float f = ((const int8_t*) p)[i];
+                return normalized ? std::max(f / 127.0f, -1.0f) : f;
+            }
+            case ComponentType::UBYTE: {
+                const float f = ((const uint8_t*) p)[i];
+                return normalized ? f / 255.0f : f;
+            }
+            case ComponentType::SHORT: {
+                int16_t c;
+                memcpy(&c, p + i * sizeof(c), sizeof(c));
+                return normalized ? std::max(c / 32767.0f, -1.0f) : c;
+            }
+            case ComponentType::USHORT: {
+                uint16_t c;
+                memcpy(&c, p + i * sizeof(c), sizeof(c));
+                return normalized ? c / 65535.0f : c;
+            }
+        }
+        return 0.0f;
+    }
+
+    template<typename VEC>
+    VEC get(size_t index) const noexcept {
+        const uint8_t* p = data + index * stride;
+        VEC result;
+        for (size_t i = 0; i < VEC::SIZE; ++i) {
+            result[i] = component(p, i);
+        }
+        return result;
+    }
+};
+
+static size_t getComponentSize(ComponentType type) {
+    switch (type) {
+        case ComponentType::FLOAT: return sizeof(float);
+        case ComponentType::BYTE:
+        case ComponentType::UBYTE: return 1;
+        case ComponentType::SHORT:
+        case ComponentType::USHORT: return 2;
+    }
+    return 0;
+}
+
+static Attribute makeAttribute(const void* data, ComponentType type, bool normalized,
+        size_t stride, size_t componentCount) {
+    return {(const uint8_t*) data, stride ? stride : getComponentSize(type) * componentCount,
+            type, normalized };
+}
 
 struct OrientationBuilderImpl {
     size_t vertexCount = 0;
-    const float3* normals = nullptr;
-    const float4* tangents = nullptr;
-    const float2* uvs = nullptr;
-    const float3* positions = nullptr;
+    Attribute normals;
+    Attribute tangents;
+    Attribute uvs;
+    Attribute positions;
     const uint3* triangles32 = nullptr;
     const ushort3* triangles16 = nullptr;
-    size_t normalStride = 0;
-    size_t tangentStride = 0;
-    size_t uvStride = 0;
-    size_t positionStride = 0;
+    const ubyte3* triangles8 = nullptr;
     size_t triangleCount = 0;
+    JobSystem* jobSystem = nullptr;
+    uint32_t runFlags = 0;
     SurfaceOrientation* buildWithNormalsOnly();
     SurfaceOrientation* buildWithSuppliedTangents();
     SurfaceOrientation* buildWithUvs();
     SurfaceOrientation* buildWithFlatNormals();
+
+    uint3 getTriangle(size_t index) const noexcept {
+        if (triangles32) return triangles32[index];
+        if (triangles16) return uint3(triangles16[index]);
+        if (triangles8) return uint3(triangles8[index]);
+        const uint32_t first = uint32_t(index * 3);
+        return { first, first + 1, first + 2 };
+    }
+
+    void accumulateTangents(size_t first, size_t last, float3* tan1, float3* tan2,
+            uint32_t base) const noexcept;
+
+    // Calls func(first, last) over consecutive ranges covering [0, count) and waits for all of
+    // them. With a JobSystem, the ranges are split across jobs of at least GRAIN items, which run
+    // with the client's flags so that they stay in the client's lane.
+    template<size_t GRAIN, typename F>
+    void parallelFor(size_t count, const F& func) const {
+        if (!jobSystem || count < 2 * GRAIN) {
+            func(size_t(0), count);
+            return;
+        }
+        auto range = [&func](uint32_t start, uint32_t size) {
+            func(size_t(start), size_t(start + size));
+        };
+        JobSystem::Job* job = jobs::parallel_for(*jobSystem, nullptr, 0, uint32_t(count),
+                std::cref(range), jobs::CountSplitter<GRAIN>());
+        job = jobSystem->runAndRetain(job, runFlags);
+        jobSystem->waitAndRelease(job);
+    }
 };
 
 struct OrientationImpl {
@@ -72,26 +177,42 @@ Builder& Builder::vertexCount(size_t vertexCount) noexcept {
 }
 
 Builder& Builder::normals(const float3* normals, size_t stride) noexcept {
-    mImpl->normals = normals;
-    mImpl->normalStride = stride;
-    return *this;
+    return this->normals(normals, ComponentType::FLOAT, false, stride);
 }
 
 Builder& Builder::tangents(const float4* tangents, size_t stride) noexcept {
-    mImpl->tangents = tangents;
-    mImpl->tangentStride = stride;
-    return *this;
+    return this->tangents(tangents, ComponentType::FLOAT, false, stride);
 }
 
 Builder& Builder::uvs(const float2* uvs, size_t stride) noexcept {
-    mImpl->uvs = uvs;
-    mImpl->uvStride = stride;
-    return *this;
+    return this->uvs(uvs, ComponentType::FLOAT, false, stride);
 }
 
 Builder& Builder::positions(const float3* positions, size_t stride) noexcept {
-    mImpl->positions = positions;
-    mImpl->positionStride = stride;
+    return this->positions(positions, ComponentType::FLOAT, false, stride);
+}
+
+Builder& Builder::normals(const void* normals, ComponentType type, bool normalized,
+        size_t stride) noexcept {
+    mImpl->normals = makeAttribute(normals, type, normalized, stride, 3);
+    return *this;
+}
+
+Builder& Builder::tangents(const void* tangents, ComponentType type, bool normalized,
+        size_t stride) noexcept {
+    mImpl->tangents = makeAttribute(tangents, type, normalized, stride, 4);
+    return *this;
+}
+
+Builder& Builder::uvs(const void* uvs, ComponentType type, bool normalized,
+        size_t stride) noexcept {
+    mImpl->uvs = makeAttribute(uvs, type, normalized, stride, 2);
+    return *this;
+}
+
+Builder& Builder::positions(const void* positions, ComponentType type, bool normalized,
+        size_t stride) noexcept {
+    mImpl->positions = makeAttribute(positions, type, normalized, stride, 3);
     return *this;
 }
 
@@ -110,34 +231,57 @@ Builder& Builder::triangles(const ushort3* triangles) noexcept {
     return *this;
 }
 
+Builder& Builder::triangles(const ubyte3* triangles) noexcept {
+    mImpl->triangles8 = triangles;
+    return *this;
+}
+
+Builder& Builder::jobSystem(JobSystem* js, uint32_t runFlags) noexcept {
+    mImpl->jobSystem = js;
+    mImpl->runFlags = runFlags;
+    return *this;
+}
+
 SurfaceOrientation* Builder::build() {
     if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->vertexCount > 0, "Vertex count must be non-zero.")) {
         return nullptr;
     }
-    if (mImpl->triangles16 || mImpl->triangles32) {
+    const int indexTypeCount = (mImpl->triangles8 ? 1 : 0) + (mImpl->triangles16 ? 1 : 0) +
+            (mImpl->triangles32 ? 1 : 0);
+    if (indexTypeCount > 0) {
         if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->positions, "Positions are required.")) {
             return nullptr;
         }
-        if (!ASSERT_PRECONDITION_NON_FATAL(!mImpl->triangles16 || !mImpl->triangles32,
-                "Choose 16 or 32-bit indices, not both.")) {
+        if (!ASSERT_PRECONDITION_NON_FATAL(indexTypeCount == 1,
+                "Choose 8, 16 or 32-bit indices, not several.")) {
             return nullptr;
         }
-        if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->triangleCount > 0, "Triangle count is required.")) {
+        if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->triangleCount > 0,
+                "Triangle count is required.")) {
             return nullptr;
         }
-        if (mImpl->normals == nullptr) {
-            return mImpl->buildWithFlatNormals();
+    } else if (mImpl->triangleCount > 0) {
+        // every three consecutive vertices form a triangle
+        if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->triangleCount <= mImpl->vertexCount / 3,
+                "Without triangles, at least 3 vertices are required per triangle.")) {
+            return nullptr;
         }
     }
-    if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->normals != nullptr, "Normals are required.")) {
+    if (!mImpl->normals && mImpl->positions && mImpl->triangleCount > 0) {
+        return mImpl->buildWithFlatNormals();
+    }
+    if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->normals, "Normals are required.")) {
         return nullptr;
     }
-    if (mImpl->tangents != nullptr) {
+    if (mImpl->tangents) {
         return mImpl->buildWithSuppliedTangents();
     }
-    if (mImpl->uvs == nullptr) {
+    if (!mImpl->uvs) {
         return mImpl->buildWithNormalsOnly();
     }
+    if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->positions, "Positions are required.")) {
+        return nullptr;
+    }
     return mImpl->buildWithUvs();
 }
 
@@ -154,16 +298,14 @@ static float3 randomPerp(const float3& n) {
 SurfaceOrientation* OrientationBuilderImpl::buildWithNormalsOnly() {
     vector<quatf> quats(vertexCount);
 
-    const float3* normal = this->normals;
-    size_t nstride = this->normalStride ? this->normalStride : sizeof(float3);
-
-    for (size_t qindex = 0; qindex < vertexCount; ++qindex) {
-        float3 n = *normal;
-        float3 b = randomPerp(n);
-        float3 t = cross(n, b);
-        quats[qindex] = mat3f::packTangentFrame({t, b, n});
-        normal = (const float3*) (((const uint8_t*) normal) + nstride);
-    }
+    parallelFor<VERTICES_PER_JOB>(vertexCount, [this, &quats](size_t first, size_t last) {
+        for (size_t qindex = first; qindex < last; ++qindex) {
+            float3 n = normals.get<float3>(qindex);
+            float3 b = randomPerp(n);
+            float3 t = cross(n, b);
+            quats[qindex] = mat3f::packTangentFrame({t, b, n});
+        }
+    });
 
     return new SurfaceOrientation(new OrientationImpl( { std::move(quats) } ));
 }
@@ -171,67 +313,38 @@ SurfaceOrientation* OrientationBuilderImpl::buildWithNormalsOnly() {
 SurfaceOrientation* OrientationBuilderImpl::buildWithSuppliedTangents() {
     vector<quatf> quats(vertexCount);
 
-    const float3* normal = this->normals;
-    size_t nstride = this->normalStride ? this->normalStride : sizeof(float3);
-
-    const float3* tanvec = (const float3*) this->tangents;
-    const float* tandir = &this->tangents->w;
-    size_t tstride = this->tangentStride ? this->tangentStride : sizeof(float4);
+    parallelFor<VERTICES_PER_JOB>(vertexCount, [this, &quats](size_t first, size_t last) {
+        for (size_t qindex = first; qindex < last; ++qindex) {
+            float3 n = normals.get<float3>(qindex);
+            float4 tangent = tangents.get<float4>(qindex);
+            float3 t = tangent.xyz;
+            float3 b = tangent.w > 0 ? cross(t, n) : cross(n, t);
 
-    for (size_t qindex = 0; qindex < vertexCount; ++qindex) {
-        float3 n = *normal;
-        float3 t = *tanvec;
-        float3 b = *tandir > 0 ? cross(t, n) : cross(n, t);
+            // Some assets do not provide perfectly orthogonal tangents and normals, so we adjust
+            // the tangent to enforce orthonormality. We would rather honor the exact normal vector
+            // than the exact tangent vector since the latter is only used for bump mapping and
+            // anisotropic lighting.
+            t = tangent.w > 0 ? cross(n, b) : cross(b, n);
 
-        // Some assets do not provide perfectly orthogonal tangents and normals, so we adjust the
-        // tangent to enforce orthonormality. We would rather honor the exact normal vector than
-        // the exact tangent vector since the latter is only used for bump mapping and anisotropic
-        // lighting.
-        t = *tandir > 0 ? cross(n, b) : cross(b, n);
-
-        quats[qindex] = mat3f::packTangentFrame({t, b, n});
-        normal = (const float3*) (((const uint8_t*) normal) + nstride);
-        tanvec = (const float3*) (((const uint8_t*) tanvec) + tstride);
-        tandir = (const float*) (((const uint8_t*) tandir) + tstride);
-    }
+            quats[qindex] = mat3f::packTangentFrame({t, b, n});
+        }
+    });
 
     return new SurfaceOrientation(new OrientationImpl( { std::move(quats) } ));
 }
 
-// This method is based on:
-//
-// Computing Tangent Space Basis Vectors for an Arbitrary Mesh (Lengyel’s Method)
-// http://www.terathon.com/code/tangent.html
-//
-// We considered mikktspace (which thankfully has a zlib-style license) but it would require
-// re-indexing (i.e. welding) and is therefore a bit heavyweight. Note that the welding could be
-// done via meshoptimizer.
-//
-SurfaceOrientation* OrientationBuilderImpl::buildWithUvs() {
-    if (!ASSERT_PRECONDITION_NON_FATAL(this->normalStride == 0, "Non-zero normal stride not yet supported.")) {
-        return nullptr;
-    }
-    if (!ASSERT_PRECONDITION_NON_FATAL(this->tangentStride == 0, "Non-zero tangent stride not yet supported.")) {
-        return nullptr;
-    }
-    if (!ASSERT_PRECONDITION_NON_FATAL(this->uvStride == 0, "Non-zero uv stride not yet supported.")) {
-        return nullptr;
-    }
-    if (!ASSERT_PRECONDITION_NON_FATAL(this->positionStride == 0, "Non-zero positions stride not yet supported.")) {
-        return nullptr;
-    }
-    vector<float3> tan1(vertexCount);
-    vector<float3> tan2(vertexCount);
-    memset(tan1.data(), 0, sizeof(float3) * vertexCount);
-    memset(tan2.data(), 0, sizeof(float3) * vertexCount);
-    for (size_t a = 0; a < triangleCount; ++a) {
-        uint3 tri = triangles16 ? uint3(triangles16[a]) : triangles32[a];
-        const float3& v1 = positions[tri.x];
-        const float3& v2 = positions[tri.y];
-        const float3& v3 = positions[tri.z];
-        const float2& w1 = uvs[tri.x];
-        const float2& w2 = uvs[tri.y];
-        const float2& w3 = uvs[tri.z];
+// Adds the tangent and bitangent directions of the triangles in [first, last) to the vertices they
+// use. The destination arrays start at the vertex index "base".
+void OrientationBuilderImpl::accumulateTangents(size_t first, size_t last, float3* tan1,
+        float3* tan2, uint32_t base) const noexcept {
+    for (size_t a = first; a < last; ++a) {
+        const uint3 tri = getTriangle(a);
+        const float3 v1 = positions.get<float3>(tri.x);
+        const float3 v2 = positions.get<float3>(tri.y);
+        const float3 v3 = positions.get<float3>(tri.z);
+        const float2 w1 = uvs.get<float2>(tri.x);
+        const float2 w2 = uvs.get<float2>(tri.y);
+        const float2 w3 = uvs.get<float2>(tri.z);
         float x1 = v2.x - v1.x;
         float x2 = v3.x - v1.x;
         float y1 = v2.y - v1.y;
@@ -247,7 +360,7 @@ SurfaceOrientation* OrientationBuilderImpl::buildWithUvs() {
         // In general we can't guarantee smooth tangents when the UV's are non-smooth, but let's at
         // least avoid divide-by-zero and fall back to normals-only method.
         if (d == 0.0) {
-            const float3& n1 = normals[tri.x];
+            const float3 n1 = normals.get<float3>(tri.x);
             sdir = randomPerp(n1);
             tdir = cross(n1, sdir);
         } else {
@@ -257,29 +370,108 @@ SurfaceOrientation* OrientationBuilderImpl::buildWithUvs() {
             sdir *= r;
             tdir *= r;
         }
-        tan1[tri.x] += sdir;
-        tan1[tri.y] += sdir;
-        tan1[tri.z] += sdir;
-        tan2[tri.x] += tdir;
-        tan2[tri.y] += tdir;
-        tan2[tri.z] += tdir;
+        tan1[tri.x - base] += sdir;
+        tan1[tri.y - base] += sdir;
+        tan1[tri.z - base] += sdir;
+        tan2[tri.x - base] += tdir;
+        tan2[tri.y - base] += tdir;
+        tan2[tri.z - base] += tdir;
+    }
+}
+
+// This method is based on:
+//
+// Computing Tangent Space Basis Vectors for an Arbitrary Mesh (Lengyel’s Method)
+// http://www.terathon.com/code/tangent.html
+//
+// We considered mikktspace (which thankfully has a zlib-style license) but it would require
+// re-indexing (i.e. welding) and is therefore a bit heavyweight. Note that the welding could be
+// done via meshoptimizer.
+//
+SurfaceOrientation* OrientationBuilderImpl::buildWithUvs() {
+    vector<float3> tan1(vertexCount);
+    vector<float3> tan2(vertexCount);
+
+    // Several triangles contribute to each vertex, so each job accumulates a range of triangles
+    // into its own arrays, which only cover the range of vertices that these triangles use. The
+    // arrays are then added together. This is only worthwhile if the triangles that are close in
+    // the index buffer are also close in the vertex buffer, otherwise we use a single thread.
+    bool accumulated = false;
+    const size_t chunkCount = (triangleCount + TRIANGLES_PER_JOB - 1) / TRIANGLES_PER_JOB;
+    if (jobSystem && chunkCount > 1) {
+        struct Chunk {
+            uint32_t minIndex;
+            uint32_t maxIndex;
+            vector<float3> tan1;
+            vector<float3> tan2;
+        };
+        vector<Chunk> chunks(chunkCount);
+        auto getRange = [this](size_t chunk) {
+            const size_t first = chunk * TRIANGLES_PER_JOB;
+            return std::make_pair(first, std::min(triangleCount, first + TRIANGLES_PER_JOB));
+        };
+        parallelFor<1>(chunkCount, [this, &chunks, &getRange](size_t first, size_t last) {
+            for (size_t index = first; index < last; ++index) {
+                auto range = getRange(index);
+                uint3 lo(std::numeric_limits<uint32_t>::max());
+                uint3 hi(0);
+                for (size_t a = range.first; a < range.second; ++a) {
+                    const uint3 tri = getTriangle(a);
+                    lo = min(lo, tri);
+                    hi = max(hi, tri);
+                }
+                chunks[index].minIndex = std::min({ lo.x, lo.y, lo.z });
+                chunks[index].maxIndex = std::max({ hi.x, hi.y, hi.z });
+            }
+        });
+
+        size_t totalSize = 0;
+        for (const Chunk& chunk : chunks) {
+            totalSize += chunk.maxIndex - chunk.minIndex + 1;
+        }
+        if (totalSize <= 2 * vertexCount) {
+            parallelFor<1>(chunkCount, [this, &chunks, &getRange](size_t first, size_t last) {
+                for (size_t index = first; index < last; ++index) {
+                    auto range = getRange(index);
+                    Chunk& chunk = chunks[index];
+                    chunk.tan1.resize(chunk.maxIndex - chunk.minIndex + 1);
+                    chunk.tan2.resize(chunk.maxIndex - chunk.minIndex + 1);
+                    accumulateTangents(range.first, range.second, chunk.tan1.data(),
+                            chunk.tan2.data(), chunk.minIndex);
+                }
+            });
+            for (Chunk& chunk : chunks) {
+                for (size_t i = 0, n = chunk.tan1.size(); i < n; ++i) {
+                    tan1[chunk.minIndex + i] += chunk.tan1[i];
+                    tan2[chunk.minIndex + i] += chunk.tan2[i];
+                }
+                chunk.tan1 = {};
+                chunk.tan2 = {};
+            }
+            accumulated = true;
+        }
+    }
+    if (!accumulated) {
+        accumulateTangents(0, triangleCount, tan1.data(), tan2.data(), 0);
     }
 
     vector<quatf> quats(vertexCount);
-    for (size_t a = 0; a < vertexCount; a++) {
-        const float3& n = normals[a];
-        const float3& t1 = tan1[a];
-        const float3& t2 = tan2[a];
+    parallelFor<VERTICES_PER_JOB>(vertexCount, [&](size_t first, size_t last) {
+        for (size_t a = first; a < last; a++) {
+            const float3 n = normals.get<float3>(a);
+            const float3& t1 = tan1[a];
+            const float3& t2 = tan2[a];
 
-        // Gram-Schmidt orthogonalize
-        float3 t = normalize(t1 - n * dot(n, t1));
+            // Gram-Schmidt orthogonalize
+            float3 t = normalize(t1 - n * dot(n, t1));
 
-        // Calculate handedness
-        float w = (dot(cross(n, t1), t2) < 0.0f) ? -1.0f : 1.0f;
+            // Calculate handedness
+            float w = (dot(cross(n, t1), t2) < 0.0f) ? -1.0f : 1.0f;
 
-        float3 b = w < 0 ? cross(t, n) : cross(n, t);
-        quats[a] = mat3f::packTangentFrame({t, b, n});
-    }
+            float3 b = w < 0 ? cross(t, n) : cross(n, t);
+            quats[a] = mat3f::packTangentFrame({t, b, n});
+        }
+    });
     return new SurfaceOrientation(new OrientationImpl( { std::move(quats) } ));
 }
 
@@ -314,6 +506,23 @@ void SurfaceOrientation::getQuats(short4* out, size_t quatCount, size_t stride)
     const vector<quatf>& in = mImpl->quaternions;
     quatCount = std::min(quatCount, in.size());
     stride = stride ? stride : sizeof(decltype(*out));
+
+    // When the output is tightly packed, both arrays can be processed as flat arrays of components.
+    // This is equivalent to packSnorm16() but it is written without branches or calls to
+    // std::round(), which allows the loop to be vectorized.
+    if (stride == sizeof(short4)) {
+        const float* UTILS_RESTRICT src = &in.data()->x;
+        int16_t* UTILS_RESTRICT dst = &out->x;
+        for (size_t i = 0, n = quatCount * 4; i < n; ++i) {
+            float v = src[i];
+            v = v < -1.0f ? -1.0f : v;
+            v = v > 1.0f ? 1.0f : v;
+            v *= 32767.0f;
+            dst[i] = int16_t(v + (v < 0.0f ? -0.5f : 0.5f));
+        }
+        return;
+    }
+
     for (size_t i = 0; i < quatCount; ++i) {
         *out = packSnorm16(in[i].xyzw);
         out = (decltype(out)) (((uint8_t*) out) + stride);
@@ -331,21 +540,21 @@ void SurfaceOrientation::getQuats(quath* out, size_t quatCount, size_t stride) c
 }
 
 SurfaceOrientation* OrientationBuilderImpl::buildWithFlatNormals() {
-    float3* normals = new float3[vertexCount];
+    float3* flatNormals = new float3[vertexCount];
     for (size_t a = 0; a < triangleCount; ++a) {
-        const uint3 tri = triangles16 ? uint3(triangles16[a]) : triangles32[a];
-        const float3 v1 = positions[tri.x];
-        const float3 v2 = positions[tri.y];
-        const float3 v3 = positions[tri.z];
+        const uint3 tri = getTriangle(a);
+        const float3 v1 = positions.get<float3>(tri.x);
+        const float3 v2 = positions.get<float3>(tri.y);
+        const float3 v3 = positions.get<float3>(tri.z);
         const float3 normal = normalize(cross(v2 - v1, v3 - v1));
-        normals[tri.x] = normal;
-        normals[tri.y] = normal;
-        normals[tri.z] = normal;
+        flatNormals[tri.x] = normal;
+        flatNormals[tri.y] = normal;
+        flatNormals[tri.z] = normal;
     }
-    this->normals = normals;
+    this->normals = makeAttribute(flatNormals, ComponentType::FLOAT, false, 0, 3);
     SurfaceOrientation* result = buildWithNormalsOnly();
-    this->normals = nullptr;
-    delete[] normals;
+    this->normals = {};
+    delete[] flatNormals;
     return result;
 }
 
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <geometry/SurfaceOrientation.h>
+
+#include <gtest/gtest.h>
+
+#include <utils/JobSystem.h>
+
+#include <math/norm.h>
+#include <math/vec2.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace filament::geometry;
+using namespace filament::math;
+using namespace utils;
+
+using ComponentType = SurfaceOrientation::ComponentType;
+
+// A bumpy grid of gridSize x gridSize vertices, with two triangles per cell.
+struct Mesh {
+    explicit Mesh(uint32_t gridSize) {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+        for (uint32_t y = 0; y < gridSize; y++) {
+            for (uint32_t x = 0; x < gridSize; x++) {
+                positions.push_back({ float(x) + jitter(rng), float(y) + jitter(rng), jitter(rng) });
+                normals.push_back(normalize(float3{ jitter(rng), jitter(rng), 1.0f }));
+                uvs.push_back({ float(x) / gridSize, float(y) / gridSize + jitter(rng) * 0.01f });
+                tangents.push_back({ normalize(float3{ 1.0f, jitter(rng), jitter(rng) }),
+                        jitter(rng) < 0.0f ? -1.0f : 1.0f });
+            }
+        }
+        for (uint32_t y = 0; y + 1 < gridSize; y++) {
+            for (uint32_t x = 0; x + 1 < gridSize; x++) {
+                const uint32_t i = y * gridSize + x;
+                triangles.push_back({ i, i + 1, i + gridSize });
+                triangles.push_back({ i + 1, i + gridSize + 1, i + gridSize });
+            }
+        }
+    }
+
+    SurfaceOrientation::Builder& configure(SurfaceOrientation::Builder& builder) const {
+        return builder.vertexCount(positions.size())
+                .normals(normals.data())
+                .uvs(uvs.data())
+                .positions(positions.data())
+                .triangleCount(triangles.size())
+                .triangles(triangles.data());
+    }
+
+    std::vector<float3> positions;
+    std::vector<float3> normals;
+    std::vector<float2> uvs;
+    std::vector<float4> tangents;
+    std::vector<uint3> triangles;
+};
+
+static std::vector<short4> getQuats(SurfaceOrientation::Builder& builder) {
+    std::unique_ptr<SurfaceOrientation> orientation(builder.build());
+    EXPECT_NE(nullptr, orientation);
+    if (!orientation) {
+        return {};
+    }
+    std::vector<short4> quats(orientation->getVertexCount());
+    orientation->getQuats(quats.data(), quats.size());
+    return quats;
+}
+
+static void expectEqual(const std::vector<short4>& expected, const std::vector<short4>& actual,
+        int tolerance = 0) {
+    ASSERT_EQ(expected.size(), actual.size());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        for (size_t c = 0; c < 4; c++) {
+            mismatches += std::abs(expected[i][c] - actual[i][c]) > tolerance;
+        }
+    }
+    EXPECT_EQ(0u, mismatches);
+}
+
+// Large enough for the triangles and the vertices to be split across several jobs.
+TEST(SurfaceOrientationTest, SerialMatchesParallel) {
+    const Mesh mesh(400);
+    SurfaceOrientation::Builder serialBuilder;
+    mesh.configure(serialBuilder);
+    const std::vector<short4> serial = getQuats(serialBuilder);
+
+    JobSystem js;
+    js.adopt();
+    for (uint32_t runFlags : { 0u, uint32_t(JobSystem::BACKGROUND) }) {
+        // the partial sums of the tangents are added in a different order, hence the tolerance
+        SurfaceOrientation::Builder builder;
+        mesh.configure(builder).jobSystem(&js, runFlags);
+        expectEqual(serial, getQuats(builder), 1);
+
+        SurfaceOrientation::Builder normalsOnly;
+        normalsOnly.vertexCount(mesh.normals.size()).normals(mesh.normals.data());
+        const std::vector<short4> expected = getQuats(normalsOnly);
+        normalsOnly.jobSystem(&js, runFlags);
+        expectEqual(expected, getQuats(normalsOnly));
+    }
+    js.emancipate();
+}
+
+// Quantized and interleaved attributes give the same result as floats with the same values.
+TEST(SurfaceOrientationTest, QuantizedInput) {
+    const Mesh mesh(20);
+    const size_t vertexCount = mesh.positions.size();
+
+    struct Vertex {
+        int8_t position[4];
+        int16_t normal[4];
+        uint16_t uv[2];
+        int8_t tangent[4];
+    };
+    std::vector<Vertex> vertices(vertexCount);
+    std::vector<float3> positions(vertexCount);
+    std::vector<float3> normals(vertexCount);
+    std::vector<float2> uvs(vertexCount);
+    std::vector<float4> tangents(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        Vertex& v = vertices[i];
+        for (size_t c = 0; c < 3; c++) {
+            v.position[c] = int8_t(std::round(mesh.positions[i][c] * 5.0f));
+            positions[i][c] = v.position[c];
+            v.normal[c] = packSnorm16(mesh.normals[i][c]);
+            normals[i][c] = std::max(v.normal[c] / 32767.0f, -1.0f);
+        }
+        for (size_t c = 0; c < 2; c++) {
+            v.uv[c] = uint16_t(std::round(std::min(mesh.uvs[i][c], 1.0f) * 65535.0f));
+            uvs[i][c] = v.uv[c] / 65535.0f;
+        }
+        for (size_t c = 0; c < 4; c++) {
+            v.tangent[c] = int8_t(std::round(mesh.tangents[i][c] * 127.0f));
+            tangents[i][c] = std::max(v.tangent[c] / 127.0f, -1.0f);
+        }
+    }
+
+    SurfaceOrientation::Builder floats;
+    mesh.configure(floats).positions(positions.data()).normals(normals.data()).uvs(uvs.data());
+    SurfaceOrientation::Builder quantized;
+    mesh.configure(quantized).positions(&vertices[0].position, ComponentType::BYTE, false, sizeof(Vertex))
+            .normals(&vertices[0].normal, ComponentType::SHORT, true, sizeof(Vertex))
+            .uvs(&vertices[0].uv, ComponentType::USHORT, true, sizeof(Vertex));
+    expectEqual(getQuats(floats), getQuats(quantized));
+
+    SurfaceOrientation::Builder floatTangents;
+    floatTangents.vertexCount(vertexCount).normals(normals.data()).tangents(tangents.data());
+    SurfaceOrientation::Builder quantizedTangents;
+    quantizedTangents.vertexCount(vertexCount)
+            .normals(&vertices[0].normal, ComponentType::SHORT, true, sizeof(Vertex))
+            .tangents(&vertices[0].tangent, ComponentType::BYTE, true, sizeof(Vertex));
+    expectEqual(getQuats(floatTangents), getQuats(quantizedTangents));
+}
+
+TEST(SurfaceOrientationTest, Triangles) {
+    // fewer than 256 vertices, so that 8-bit indices can be used
+    const Mesh mesh(15);
+    SurfaceOrientation::Builder builder;
+    const std::vector<short4> expected = getQuats(mesh.configure(builder));
+
+    std::vector<ubyte3> triangles8(mesh.triangles.begin(), mesh.triangles.end());
+    SurfaceOrientation::Builder builder8;
+    mesh.configure(builder8).triangles((const uint3*) nullptr).triangles(triangles8.data());
+    expectEqual(expected, getQuats(builder8));
+
+    std::vector<ushort3> triangles16(mesh.triangles.begin(), mesh.triangles.end());
+    SurfaceOrientation::Builder builder16;
+    mesh.configure(builder16).triangles((const uint3*) nullptr).triangles(triangles16.data());
+    expectEqual(expected, getQuats(builder16));
+
+    // without indices, every three consecutive vertices form a triangle
+    const size_t vertexCount = mesh.triangles.size() * 3;
+    std::vector<float3> positions, normals;
+    std::vector<float2> uvs;
+    std::vector<uint3> triangles;
+    for (const uint3& triangle : mesh.triangles) {
+        const uint32_t first = uint32_t(positions.size());
+        for (size_t c = 0; c < 3; c++) {
+            positions.push_back(mesh.positions[triangle[c]]);
+            normals.push_back(mesh.normals[triangle[c]]);
+            uvs.push_back(mesh.uvs[triangle[c]]);
+        }
+        triangles.push_back({ first, first + 1, first + 2 });
+    }
+
+    SurfaceOrientation::Builder indexed;
+    indexed.vertexCount(vertexCount).normals(normals.data()).uvs(uvs.data())
+            .positions(positions.data()).triangleCount(triangles.size())
+            .triangles(triangles.data());
+    SurfaceOrientation::Builder nonIndexed;
+    nonIndexed.vertexCount(vertexCount).normals(normals.data()).uvs(uvs.data())
+            .positions(positions.data()).triangleCount(triangles.size());
+    expectEqual(getQuats(indexed), getQuats(nonIndexed));
+
+    // flat normals
+    SurfaceOrientation::Builder flatIndexed;
+    flatIndexed.vertexCount(vertexCount).positions(positions.data())
+            .triangleCount(triangles.size()).triangles(triangles.data());
+    SurfaceOrientation::Builder flatNonIndexed;
+    flatNonIndexed.vertexCount(vertexCount).positions(positions.data())
+            .triangleCount(triangles.size());
+    expectEqual(getQuats(flatIndexed), getQuats(flatNonIndexed));
+}
+
+// Tightly packed shorts are converted by a separate, vectorizable loop.
+TEST(SurfaceOrientationTest, PackedQuats) {
+    const Mesh mesh(300);
+    SurfaceOrientation::Builder builder;
+    std::unique_ptr<SurfaceOrientation> orientation(mesh.configure(builder).build());
+    ASSERT_NE(nullptr, orientation);
+    const size_t count = orientation->getVertexCount();
+
+    std::vector<quatf> floats(count);
+    orientation->getQuats(floats.data(), count);
+    std::vector<short4> expected(count);
+    for (size_t i = 0; i < count; i++) {
+        expected[i] = packSnorm16(floats[i].xyzw);
+    }
+
+    std::vector<short4> packed(count);
+    orientation->getQuats(packed.data(), count);
+    expectEqual(expected, packed);
+
+    std::vector<short4> strided(count * 2);
+    orientation->getQuats(strided.data(), count, sizeof(short4) * 2);
+    for (size_t i = 0; i < count; i++) {
+        strided[i] = strided[i * 2];
+    }
+    strided.resize(count);
+    expectEqual(expected, strided);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
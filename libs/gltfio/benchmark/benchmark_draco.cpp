@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "DracoCache.h"
+
+#include <utils/JobSystem.h>
+
+#include <cgltf.h>
+
+#include <vector>
+
+using namespace gltfio;
+using namespace utils;
+
+// Decodes the Draco meshes of a sample model, the same way ResourceLoader's decodeDracoMeshes()
+// does when skinning weights are normalized or bounding boxes recomputed. Otherwise ResourceLoader
+// decodes each mesh in its geometry job, which this doesn't measure.
+class DracoFixture : public benchmark::Fixture {
+protected:
+    cgltf_data* gltf = nullptr;
+    std::vector<const cgltf_buffer_view*> views;
+
+public:
+    void SetUp(benchmark::State& state) override {
+        const char* path = GLTFIO_BENCHMARK_DRACO_MODEL;
+        cgltf_options options {};
+        if (cgltf_parse_file(&options, path, &gltf) != cgltf_result_success ||
+                cgltf_load_buffers(&options, gltf, path) != cgltf_result_success) {
+            state.SkipWithError("Unable to load the Draco model.");
+            return;
+        }
+        for (cgltf_size i = 0; i < gltf->meshes_count; ++i) {
+            const cgltf_mesh& mesh = gltf->meshes[i];
+            for (cgltf_size j = 0; j < mesh.primitives_count; ++j) {
+                const cgltf_primitive& prim = mesh.primitives[j];
+                if (prim.has_draco_mesh_compression) {
+                    views.push_back(prim.draco_mesh_compression.buffer_view);
+                }
+            }
+        }
+    }
+
+    void TearDown(benchmark::State&) override {
+        cgltf_free(gltf);
+        gltf = nullptr;
+        views.clear();
+    }
+};
+
+BENCHMARK_DEFINE_F(DracoFixture, sequential)(benchmark::State& state) {
+    for (auto _ : state) {
+        DracoCache cache;
+        for (const cgltf_buffer_view* view : views) {
+            benchmark::DoNotOptimize(cache.findOrCreateMesh(view));
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * views.size()));
+}
+
+BENCHMARK_DEFINE_F(DracoFixture, parallel)(benchmark::State& state) {
+    JobSystem js;
+    js.adopt();
+    for (auto _ : state) {
+        DracoCache cache;
+        DracoCache* pCache = &cache;
+        JobSystem::Job* parent = js.createJob();
+        for (const cgltf_buffer_view* view : views) {
+            js.run(jobs::createJob(js, parent, [pCache, view] {
+                benchmark::DoNotOptimize(pCache->findOrCreateMesh(view));
+            }));
+        }
+        js.runAndWait(parent);
+    }
+    js.emancipate();
+    state.SetItemsProcessed(int64_t(state.iterations() * views.size()));
+}
+
+// The decoding happens on the JobSystem threads, so the CPU time of the main thread is meaningless.
+BENCHMARK_REGISTER_F(DracoFixture, sequential)->UseRealTime();
+BENCHMARK_REGISTER_F(DracoFixture, parallel)->UseRealTime();
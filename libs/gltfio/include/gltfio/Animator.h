@@ -42,6 +42,13 @@ public:
      * Applies rotation, translation, and scale to entities that have been targeted by the given
      * animation definition. Uses filament::TransformManager.
      *
+     * The components of a node's local transform that aren't driven by the animation are
+     * preserved, including changes made by the client since the last call.
+     *
+     * When the Animator drives many instances, they are evaluated in parallel on the Engine's
+     * JobSystem, if this is called from a thread adopted by it, e.g. the thread that created the
+     * Engine. Other threads evaluate them serially.
+     *
      * @param animationIndex Zero-based index for the \c animation of interest.
      * @param time Elapsed time of interest in seconds.
      */
@@ -52,6 +59,10 @@ public:
      * the results into filament::RenderableManager::setBones.
      * Uses filament::TransformManager and filament::RenderableManager.
      *
+     * Skin targets with the same world transform share a bone palette on the CPU, but each
+     * renderable still gets its own copy through setBones, since renderables cannot share a
+     * range of bones on the GPU.
+     *
      * NOTE: this operation is independent of \c animation.
      */
     void updateBoneMatrices();
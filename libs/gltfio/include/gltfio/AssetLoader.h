@@ -58,6 +58,13 @@ struct AssetConfiguration {
 
     //! Optional default node name for anonymous nodes
     char* defaultNodeName = nullptr;
+
+    //! Shares the vertex and index buffers of primitives that have identical geometry, within and
+    //! across all the assets created by the loader. Identical primitives are detected when their
+    //! data is loaded by ResourceLoader. Shared buffers are reference counted, so assets can be
+    //! destroyed in any order, but they must all be destroyed before the loader.
+    //! See AssetLoader::getSavedGeometrySize().
+    bool shareGeometry = false;
 };
 
 /**
@@ -152,6 +159,19 @@ public:
      */
     FilamentAsset* createAssetFromBinary(const uint8_t* bytes, uint32_t nbytes);
 
+    /**
+     * Maps a glTF 2.0 file (JSON or GLB) into memory and returns a bundle of Filament objects.
+     * Returns null on failure.
+     *
+     * Unlike createAssetFromBinary, this does not copy the file: the asset refers directly to the
+     * mapping, which is released along with the source data of the asset. For GLB files, vertex
+     * and index data are uploaded straight from the mapping. The file must not be modified until
+     * then.
+     *
+     * See also ResourceConfiguration::memoryMapBuffers for external buffers.
+     */
+    FilamentAsset* createAssetFromFile(const char* path);
+
     /**
      * Consumes the contents of a glTF 2.0 file and produces a primary asset with one or more
      * instances.
@@ -210,6 +230,13 @@ public:
      */
     size_t getMaterialsCount() const noexcept;
 
+    /**
+     * Returns the number of bytes of vertex and index data that were not uploaded because an
+     * identical primitive had already been loaded. This is always zero unless
+     * AssetConfiguration::shareGeometry is enabled.
+     */
+    size_t getSavedGeometrySize() const noexcept;
+
     utils::NameComponentManager* getNames() const noexcept;
 
     /*! \cond PRIVATE */
@@ -118,8 +118,8 @@ public:
      * please use popRenderables().
      *
      * This method allows clients to progressively add the asset's renderables to the scene as
-     * textures gradually become ready through asynchronous loading. For example, on every frame
-     * progressive applications can do something like this:
+     * their geometry and textures gradually become ready through asynchronous loading. For
+     * example, on every frame progressive applications can do something like this:
      *
      *    while (utils::Entity e = popRenderable()) { scene.addEntity(e); }
      *
@@ -50,6 +50,18 @@ struct ResourceConfiguration {
     //! If true, computes the bounding boxes of all \c POSITION attibutes. Well formed glTF files
     //! do not need this, but it is useful for robustness.
     bool recomputeBoundingBoxes;
+
+    //! If true, external buffer files are mapped into memory rather than read into a copy, and the
+    //! vertex and index data are uploaded straight from the mapping. The mapping is released along
+    //! with the source data of the asset, and the files must not be modified until then. This
+    //! only applies to buffers loaded from the file system, not to data provided with
+    //! #ResourceLoader::addResourceData. See also AssetLoader::createAssetFromFile.
+    bool memoryMapBuffers = false;
+
+    //! Maximum number of bytes that the geometry jobs allocate before their data is uploaded, e.g.
+    //! decompressed Draco meshes or generated tangents. Meshes are prepared concurrently until
+    //! this budget is reached. Zero means no limit.
+    size_t maxPendingGeometrySize = 0;
 };
 
 /**
@@ -112,7 +124,10 @@ public:
      * Returns false if the loading process was unable to start.
      *
      * This is an alternative to #loadResources and requires periodic calls to #asyncUpdateLoad.
-     * On multi-threaded systems this creates threads for texture decoding.
+     * On multi-threaded systems this creates jobs for texture decoding, and for preparing the
+     * vertex data of each mesh (e.g. Draco decoding and tangent generation). Each mesh is uploaded
+     * as soon as it is ready, and the renderables become available through
+     * FilamentAsset#popRenderables once their meshes and textures are all uploaded.
      */
     bool asyncBeginLoad(FilamentAsset* asset);
 
@@ -140,7 +155,6 @@ public:
 
 private:
     bool loadResources(FFilamentAsset* asset, bool async);
-    void applySparseData(FFilamentAsset* asset) const;
     void normalizeSkinningWeights(FFilamentAsset* asset) const;
     void updateBoundingBoxes(FFilamentAsset* asset) const;
     AssetPool* mPool;
@@ -25,7 +25,9 @@
 #include <filament/RenderableManager.h>
 #include <filament/TransformManager.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
+#include <utils/Systrace.h>
 
 #include <math/mat4.h>
 #include <math/quat.h>
@@ -33,7 +35,9 @@
 #include <math/vec3.h>
 #include <math/vec4.h>
 
-#include <map>
+#include <tsl/robin_map.h>
+
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -44,66 +48,103 @@ using namespace utils;
 
 namespace gltfio {
 
-using TimeValues = std::map<float, size_t>;
-using SourceValues = std::vector<float>;
 using BoneVector = std::vector<filament::math::mat4f>;
 
+// Instances are animated in parallel when there are at least this many channels in total.
+static constexpr size_t PARALLEL_CHANNEL_THRESHOLD = 256;
+
+// Skins are updated in parallel when there are at least this many joints in total.
+static constexpr size_t PARALLEL_JOINT_THRESHOLD = 256;
+
+// The keyframes of a sampler, stored in the flat arrays of its animation.
 struct Sampler {
-    TimeValues times;
-    SourceValues values;
+    uint32_t timesOffset;   // first keyframe time in Animation::times
+    uint32_t timesCount;
+    uint32_t valuesOffset;  // first value in Animation::values
+    uint32_t valuesCount;
     enum { LINEAR, STEP, CUBIC } interpolation;
 };
 
 struct Channel {
-    const Sampler* sourceData;
-    utils::Entity targetEntity;
+    uint32_t sampler;       // index in Animation::samplers
+    uint32_t node;          // index in AnimatorImpl::nodes
     enum { TRANSLATION, ROTATION, SCALE, WEIGHTS } transformType;
 };
 
 struct Animation {
     float duration;
     std::string name;
+    vector<float> times;
+    vector<float> values;
     vector<Sampler> samplers;
     vector<Channel> channels;
+    vector<uint32_t> cursors;       // for each channel, the keyframe found by the last evaluation
+    vector<uint32_t> instances;     // channels of instance i are [instances[i], instances[i + 1])
+};
+
+// Animated nodes keep their local transform as TRS, so that it only needs to be decomposed
+// when it's changed by other means than the Animator.
+struct Nodes {
+    enum : uint8_t { DIRTY_TRANSFORM = 0x1, DIRTY_WEIGHTS = 0x2 };
+    vector<utils::Entity> entities;
+    vector<mat4f> transforms;       // the local transform the TRS below correspond to
+    vector<float3> translations;
+    vector<quatf> rotations;
+    vector<float3> scales;
+    vector<float4> weights;
+    vector<uint8_t> dirty;
 };
 
 struct AnimatorImpl {
     vector<Animation> animations;
-    BoneVector boneMatrices;
+    Nodes nodes;
+    BoneVector boneMatrices;                // bone palettes of all the skins, back to back
+    vector<const Skin*> skins;
+    vector<uint32_t> skinBones;             // for each skin, its first palette in boneMatrices
+    vector<uint32_t> skinTargets;           // for each skin, its first target in targetPalettes
+    vector<uint32_t> targetPalettes;        // for each skin target, its palette in boneMatrices
+    vector<TransformManager::Instance> transformInstances;
+    vector<mat4f> transforms;
     FFilamentAsset* asset = nullptr;
     FFilamentInstance* instance = nullptr;
     RenderableManager* renderableManager;
     TransformManager* transformManager;
+    JobSystem* jobSystem;
 };
 
-static void createSampler(const cgltf_animation_sampler& src, Sampler& dst) {
-    // Copy the time values into a red-black tree.
+static void createSampler(const cgltf_animation_sampler& src, Animation& anim, Sampler& dst) {
+    // Append the time values to the flat array of the animation, glTF requires them to be
+    // strictly increasing.
     const cgltf_accessor* timelineAccessor = src.input;
     const uint8_t* timelineBlob = (const uint8_t*) timelineAccessor->buffer_view->buffer->data;
     const float* timelineFloats = (const float*) (timelineBlob + timelineAccessor->offset +
             timelineAccessor->buffer_view->offset);
-    for (size_t i = 0, len = timelineAccessor->count; i < len; ++i) {
-        dst.times[timelineFloats[i]] = i;
-    }
+    dst.timesOffset = anim.times.size();
+    dst.timesCount = timelineAccessor->count;
+    anim.times.insert(anim.times.end(), timelineFloats, timelineFloats + timelineAccessor->count);
 
     // Convert source data to float.
     const cgltf_accessor* valuesAccessor = src.output;
+    size_t count = 0;
     switch (valuesAccessor->type) {
         case cgltf_type_scalar:
-            dst.values.resize(valuesAccessor->count);
-            cgltf_accessor_unpack_floats(src.output, &dst.values[0], valuesAccessor->count);
+            count = valuesAccessor->count;
             break;
         case cgltf_type_vec3:
-            dst.values.resize(valuesAccessor->count * 3);
-            cgltf_accessor_unpack_floats(src.output, &dst.values[0], valuesAccessor->count * 3);
+            count = valuesAccessor->count * 3;
             break;
         case cgltf_type_vec4:
-            dst.values.resize(valuesAccessor->count * 4);
-            cgltf_accessor_unpack_floats(src.output, &dst.values[0], valuesAccessor->count * 4);
+            count = valuesAccessor->count * 4;
             break;
         default:
             slog.e << "Unknown animation type." << io::endl;
-            return;
+            break;
+    }
+    dst.valuesOffset = anim.values.size();
+    dst.valuesCount = count;
+    if (count) {
+        anim.values.resize(anim.values.size() + count);
+        cgltf_accessor_unpack_floats(src.output, &anim.values[dst.valuesOffset], count);
     }
 
     switch (src.interpolation) {
@@ -139,26 +180,196 @@ static void setTransformType(const cgltf_animation_channel& src, Channel& dst) {
     }
 }
 
+// Finds the pair of keyframes around the given time, and the interpolant between them.
+// The cursor is the index of the first keyframe at or after the time of the previous evaluation,
+// which is almost always the right one, or the one just after it, when playing forward.
+static void findKeyframes(const float* times, uint32_t count, float time, uint32_t& cursor,
+        uint32_t* prevIndex, uint32_t* nextIndex, float* t) {
+    auto isFirstAfter = [times, count, time](uint32_t i) {
+        return (i == count || time <= times[i]) && (i == 0 || times[i - 1] < time);
+    };
+
+    uint32_t next = std::min(cursor, count);
+    if (UTILS_UNLIKELY(!isFirstAfter(next))) {
+        if (next < count && isFirstAfter(next + 1)) {
+            next++;
+        } else {
+            next = std::lower_bound(times, times + count, time) - times;
+        }
+    }
+    cursor = next;
+
+    *t = 0.0f;
+    if (next == count) {
+        *nextIndex = *prevIndex = count - 1;
+    } else if (next == 0) {
+        *nextIndex = *prevIndex = 0;
+    } else {
+        *nextIndex = next;
+        *prevIndex = next - 1;
+        const float deltaTime = times[next] - times[next - 1];
+        assert(deltaTime >= 0);
+        if (deltaTime > 0) {
+            *t = (time - times[next - 1]) / deltaTime;
+        }
+    }
+}
+
+static void applyChannel(Animation& anim, size_t channelIndex, float time, Nodes& nodes) {
+    const Channel& channel = anim.channels[channelIndex];
+    const Sampler& sampler = anim.samplers[channel.sampler];
+    if (sampler.timesCount < 2) {
+        return;
+    }
+
+    uint32_t prevIndex;
+    uint32_t nextIndex;
+    float t;
+    findKeyframes(anim.times.data() + sampler.timesOffset, sampler.timesCount, time,
+            anim.cursors[channelIndex], &prevIndex, &nextIndex, &t);
+
+    if (sampler.interpolation == Sampler::STEP) {
+        t = 0.0f;
+    }
+
+    const float* const samplerValues = anim.values.data() + sampler.valuesOffset;
+    const uint32_t node = channel.node;
+
+    switch (channel.transformType) {
+
+        case Channel::SCALE: {
+            const float3* srcVec3 = (const float3*) samplerValues;
+            if (sampler.interpolation == Sampler::CUBIC) {
+                float3 vert0 = srcVec3[prevIndex * 3 + 1];
+                float3 tang0 = srcVec3[prevIndex * 3 + 2];
+                float3 tang1 = srcVec3[nextIndex * 3];
+                float3 vert1 = srcVec3[nextIndex * 3 + 1];
+                nodes.scales[node] = cubicSpline(vert0, tang0, vert1, tang1, t);
+            } else {
+                nodes.scales[node] = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
+            }
+            nodes.dirty[node] |= Nodes::DIRTY_TRANSFORM;
+            break;
+        }
+
+        case Channel::TRANSLATION: {
+            const float3* srcVec3 = (const float3*) samplerValues;
+            if (sampler.interpolation == Sampler::CUBIC) {
+                float3 vert0 = srcVec3[prevIndex * 3 + 1];
+                float3 tang0 = srcVec3[prevIndex * 3 + 2];
+                float3 tang1 = srcVec3[nextIndex * 3];
+                float3 vert1 = srcVec3[nextIndex * 3 + 1];
+                nodes.translations[node] = cubicSpline(vert0, tang0, vert1, tang1, t);
+            } else {
+                nodes.translations[node] =
+                        ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
+            }
+            nodes.dirty[node] |= Nodes::DIRTY_TRANSFORM;
+            break;
+        }
+
+        case Channel::ROTATION: {
+            const quatf* srcQuat = (const quatf*) samplerValues;
+            if (sampler.interpolation == Sampler::CUBIC) {
+                quatf vert0 = srcQuat[prevIndex * 3 + 1];
+                quatf tang0 = srcQuat[prevIndex * 3 + 2];
+                quatf tang1 = srcQuat[nextIndex * 3];
+                quatf vert1 = srcQuat[nextIndex * 3 + 1];
+                nodes.rotations[node] = normalize(cubicSpline(vert0, tang0, vert1, tang1, t));
+            } else {
+                nodes.rotations[node] = slerp(srcQuat[prevIndex], srcQuat[nextIndex], t);
+            }
+            nodes.dirty[node] |= Nodes::DIRTY_TRANSFORM;
+            break;
+        }
+
+        case Channel::WEIGHTS: {
+            float4 weights(0, 0, 0, 0);
+            assert(sampler.valuesCount % sampler.timesCount == 0);
+            const int valuesPerKeyframe = sampler.valuesCount / sampler.timesCount;
+
+            if (sampler.interpolation == Sampler::CUBIC) {
+                assert(valuesPerKeyframe % 3 == 0);
+                const int numMorphTargets = valuesPerKeyframe / 3;
+                const float* const inTangents = samplerValues;
+                const float* const splineVerts = samplerValues + numMorphTargets;
+                const float* const outTangents = samplerValues + numMorphTargets * 2;
+
+                const int numComponents = std::min((int) MAX_MORPH_TARGETS, numMorphTargets);
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    float vert0 = splineVerts[comp + prevIndex * valuesPerKeyframe];
+                    float tang0 = outTangents[comp + prevIndex * valuesPerKeyframe];
+                    float tang1 = inTangents[comp + nextIndex * valuesPerKeyframe];
+                    float vert1 = splineVerts[comp + nextIndex * valuesPerKeyframe];
+                    weights[comp] = cubicSpline(vert0, tang0, vert1, tang1, t);
+                }
+            } else {
+                const int numComponents = std::min((int) MAX_MORPH_TARGETS, valuesPerKeyframe);
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    float previous = samplerValues[comp + prevIndex * valuesPerKeyframe];
+                    float current = samplerValues[comp + nextIndex * valuesPerKeyframe];
+                    weights[comp] = (1 - t) * previous + t * current;
+                }
+            }
+            nodes.weights[node] = weights;
+            nodes.dirty[node] |= Nodes::DIRTY_WEIGHTS;
+            break;
+        }
+    }
+}
+
 Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
     mImpl = new AnimatorImpl();
     mImpl->asset = asset;
     mImpl->instance = instance;
     mImpl->renderableManager = &asset->mEngine->getRenderableManager();
     mImpl->transformManager = &asset->mEngine->getTransformManager();
+    mImpl->jobSystem = &asset->mEngine->getJobSystem();
+
+    // Each animated node gets a slot holding its TRS, initialized from its current transform.
+    Nodes& nodes = mImpl->nodes;
+    TransformManager* transformManager = mImpl->transformManager;
+    tsl::robin_map<Entity, uint32_t> nodeIndices;
+    auto getNode = [&nodes, &nodeIndices, transformManager](Entity entity) {
+        auto iter = nodeIndices.find(entity);
+        if (iter != nodeIndices.end()) {
+            return iter->second;
+        }
+        mat4f transform;
+        float3 translation;
+        quatf rotation = quatf{ 1 };
+        float3 scale = float3{ 1 };
+        TransformManager::Instance node = transformManager->getInstance(entity);
+        if (node) {
+            transform = transformManager->getTransform(node);
+            decomposeMatrix(transform, &translation, &rotation, &scale);
+        }
+        const uint32_t index = nodes.entities.size();
+        nodes.entities.push_back(entity);
+        nodes.transforms.push_back(transform);
+        nodes.translations.push_back(translation);
+        nodes.rotations.push_back(rotation);
+        nodes.scales.push_back(scale);
+        nodes.weights.push_back({});
+        nodes.dirty.push_back(0);
+        nodeIndices[entity] = index;
+        return index;
+    };
 
-    auto addChannels = [](const NodeMap& nodeMap, const cgltf_animation& srcAnim, Animation& dst) {
+    auto addChannels = [&getNode](const NodeMap& nodeMap, const cgltf_animation& srcAnim,
+            Animation& dst) {
         cgltf_animation_channel* srcChannels = srcAnim.channels;
         cgltf_animation_sampler* srcSamplers = srcAnim.samplers;
-        const Sampler* samplers = dst.samplers.data();
         for (cgltf_size j = 0, nchans = srcAnim.channels_count; j < nchans; ++j) {
             const cgltf_animation_channel& srcChannel = srcChannels[j];
             utils::Entity targetEntity = nodeMap.at(srcChannel.target_node);
             Channel dstChannel;
-            dstChannel.sourceData = samplers + (srcChannel.sampler - srcSamplers);
-            dstChannel.targetEntity = targetEntity;
+            dstChannel.sampler = srcChannel.sampler - srcSamplers;
+            dstChannel.node = getNode(targetEntity);
             setTransformType(srcChannel, dstChannel);
             dst.channels.push_back(dstChannel);
         }
+        dst.instances.push_back(dst.channels.size());
     };
 
     // Loop over the glTF animation definitions.
@@ -173,20 +384,21 @@ Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
             dstAnim.name = srcAnim.name;
         }
 
-        // Import each glTF sampler into a custom data structure.
+        // Import each glTF sampler into the flat keyframe arrays of the animation.
         cgltf_animation_sampler* srcSamplers = srcAnim.samplers;
         dstAnim.samplers.resize(srcAnim.samplers_count);
         for (cgltf_size j = 0, nsamps = srcAnim.samplers_count; j < nsamps; ++j) {
             const cgltf_animation_sampler& srcSampler = srcSamplers[j];
             Sampler& dstSampler = dstAnim.samplers[j];
-            createSampler(srcSampler, dstSampler);
-            if (dstSampler.times.size() > 1) {
-                float maxtime = (--dstSampler.times.end())->first;
+            createSampler(srcSampler, dstAnim, dstSampler);
+            if (dstSampler.timesCount > 1) {
+                float maxtime = dstAnim.times[dstSampler.timesOffset + dstSampler.timesCount - 1];
                 dstAnim.duration = std::max(dstAnim.duration, maxtime);
             }
         }
 
-        // Import each glTF channel into a custom data structure.
+        // Import each glTF channel into a custom data structure, grouped by instance.
+        dstAnim.instances.push_back(0);
         if (instance) {
             addChannels(instance->nodeMap, srcAnim, dstAnim);
         } else if (asset->mInstances.empty()) {
@@ -196,6 +408,7 @@ Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
                 addChannels(instance->nodeMap, srcAnim, dstAnim);
             }
         }
+        dstAnim.cursors.resize(dstAnim.channels.size(), 0);
     }
 }
 
@@ -208,182 +421,181 @@ size_t Animator::getAnimationCount() const {
 }
 
 void Animator::applyAnimation(size_t animationIndex, float time) const {
-    const Animation& anim = mImpl->animations[animationIndex];
+    SYSTRACE_CALL();
+
+    Animation& anim = mImpl->animations[animationIndex];
+    Nodes& nodes = mImpl->nodes;
     TransformManager* transformManager = mImpl->transformManager;
-    RenderableManager* renderableManager = mImpl->renderableManager;
     time = fmod(time, anim.duration);
-    for (const auto& channel : anim.channels) {
-        const Sampler* sampler = channel.sourceData;
-        if (sampler->times.size() < 2) {
-            continue;
-        }
 
-        TransformManager::Instance node = transformManager->getInstance(channel.targetEntity);
-        const TimeValues& times = sampler->times;
-
-        // Find the first keyframe after the given time, or the keyframe that matches it exactly.
-        TimeValues::const_iterator iter = times.lower_bound(time);
-
-        // Compute the interpolant (between 0 and 1) and determine the keyframe pair.
-        float t = 0.0f;
-        size_t nextIndex;
-        size_t prevIndex;
-        if (iter == times.end()) {
-            nextIndex = times.size() - 1;
-            prevIndex = nextIndex;
-        } else if (iter == times.begin()) {
-            nextIndex = 0;
-            prevIndex = 0;
-        } else {
-            TimeValues::const_iterator prev = iter; --prev;
-            nextIndex = iter->second;
-            prevIndex = prev->second;
-            const float nextTime = iter->first;
-            const float prevTime = prev->first;
-            float deltaTime = nextTime - prevTime;
-            assert(deltaTime >= 0);
-            if (deltaTime > 0) {
-                t = (time - prevTime) / deltaTime;
+    // Pick up the local transforms that were changed since the last call, so that the
+    // components this animation doesn't drive are preserved.
+    for (size_t i = 0, n = nodes.entities.size(); i < n; i++) {
+        TransformManager::Instance node = transformManager->getInstance(nodes.entities[i]);
+        if (node) {
+            const mat4f& transform = transformManager->getTransform(node);
+            if (UTILS_UNLIKELY(transform != nodes.transforms[i])) {
+                nodes.transforms[i] = transform;
+                decomposeMatrix(transform, &nodes.translations[i], &nodes.rotations[i],
+                        &nodes.scales[i]);
             }
         }
+    }
 
-        // Perform the interpolation. This is a simple but inefficient implementation; Filament
-        // stores transforms as mat4's but glTF animation is based on TRS (translation rotation
-        // scale).
-        mat4f xform = transformManager->getTransform(node);
-        float3 scale;
-        quatf rotation;
-        float3 translation;
-        decomposeMatrix(xform, &translation, &rotation, &scale);
-
-        if (sampler->interpolation == Sampler::STEP) {
-            t = 0.0f;
+    // Instances don't share nodes, so they can be evaluated in parallel.
+    auto evaluate = [&anim, &nodes, time](uint32_t first, uint32_t count) {
+        for (uint32_t i = first, e = first + count; i != e; i++) {
+            for (size_t c = anim.instances[i], ce = anim.instances[i + 1]; c != ce; c++) {
+                applyChannel(anim, c, time, nodes);
+            }
         }
+    };
 
-        switch (channel.transformType) {
-
-            case Channel::SCALE: {
-                const float3* srcVec3 = (const float3*) sampler->values.data();
-                if (sampler->interpolation == Sampler::CUBIC) {
-                    float3 vert0 = srcVec3[prevIndex * 3 + 1];
-                    float3 tang0 = srcVec3[prevIndex * 3 + 2];
-                    float3 tang1 = srcVec3[nextIndex * 3];
-                    float3 vert1 = srcVec3[nextIndex * 3 + 1];
-                    scale = cubicSpline(vert0, tang0, vert1, tang1, t);
-                } else {
-                    scale = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
-                }
-                break;
-            }
+    // Only threads of the JobSystem can run jobs, other threads evaluate all the instances.
+    const uint32_t instanceCount = anim.instances.size() - 1;
+    JobSystem& js = *mImpl->jobSystem;
+    if (instanceCount > 1 && anim.channels.size() >= PARALLEL_CHANNEL_THRESHOLD &&
+            js.isThreadAdopted()) {
+        auto* job = jobs::parallel_for(js, nullptr, 0, instanceCount, std::cref(evaluate),
+                jobs::CountSplitter<8>());
+        js.runAndWait(job);
+    } else {
+        evaluate(0, instanceCount);
+    }
 
-            case Channel::TRANSLATION: {
-                const float3* srcVec3 = (const float3*) sampler->values.data();
-                if (sampler->interpolation == Sampler::CUBIC) {
-                    float3 vert0 = srcVec3[prevIndex * 3 + 1];
-                    float3 tang0 = srcVec3[prevIndex * 3 + 2];
-                    float3 tang1 = srcVec3[nextIndex * 3];
-                    float3 vert1 = srcVec3[nextIndex * 3 + 1];
-                    translation = cubicSpline(vert0, tang0, vert1, tang1, t);
-                } else {
-                    translation = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
-                }
-                break;
+    // Push the new local transforms all at once, and the morph weights.
+    RenderableManager* renderableManager = mImpl->renderableManager;
+    auto& transformInstances = mImpl->transformInstances;
+    auto& transforms = mImpl->transforms;
+    transformInstances.clear();
+    transforms.clear();
+    for (size_t i = 0, n = nodes.entities.size(); i < n; i++) {
+        const uint8_t dirty = nodes.dirty[i];
+        if (!dirty) {
+            continue;
+        }
+        nodes.dirty[i] = 0;
+        if (dirty & Nodes::DIRTY_TRANSFORM) {
+            TransformManager::Instance node = transformManager->getInstance(nodes.entities[i]);
+            if (node) {
+                nodes.transforms[i] = composeMatrix(nodes.translations[i], nodes.rotations[i],
+                        nodes.scales[i]);
+                transformInstances.push_back(node);
+                transforms.push_back(nodes.transforms[i]);
             }
+        }
+        if (dirty & Nodes::DIRTY_WEIGHTS) {
+            auto renderable = renderableManager->getInstance(nodes.entities[i]);
+            renderableManager->setMorphWeights(renderable, nodes.weights[i]);
+        }
+    }
+    transformManager->setTransforms(transformInstances.data(), transforms.data(),
+            transformInstances.size());
+}
 
-            case Channel::ROTATION: {
-                const quatf* srcQuat = (const quatf*) sampler->values.data();
-                if (sampler->interpolation == Sampler::CUBIC) {
-                    quatf vert0 = srcQuat[prevIndex * 3 + 1];
-                    quatf tang0 = srcQuat[prevIndex * 3 + 2];
-                    quatf tang1 = srcQuat[nextIndex * 3];
-                    quatf vert1 = srcQuat[nextIndex * 3 + 1];
-                    rotation = normalize(cubicSpline(vert0, tang0, vert1, tang1, t));
-                } else {
-                    rotation = slerp(srcQuat[prevIndex], srcQuat[nextIndex], t);
-                }
-                break;
-            }
+void Animator::updateBoneMatrices() {
+    SYSTRACE_CALL();
 
-            case Channel::WEIGHTS: {
-                float4 weights(0, 0, 0, 0);
-                const float* const samplerValues = sampler->values.data();
-                assert(sampler->values.size() % times.size() == 0);
-                const int valuesPerKeyframe = sampler->values.size() / times.size();
-
-                if (sampler->interpolation == Sampler::CUBIC) {
-                    assert(valuesPerKeyframe % 3 == 0);
-                    const int numMorphTargets = valuesPerKeyframe / 3;
-                    const float* const inTangents = samplerValues;
-                    const float* const splineVerts = samplerValues + numMorphTargets;
-                    const float* const outTangents = samplerValues + numMorphTargets * 2;
-
-                    const int numComponents = std::min((int) MAX_MORPH_TARGETS, numMorphTargets);
-                    for (int comp = 0; comp < numComponents; ++comp) {
-                        float vert0 = splineVerts[comp + prevIndex * valuesPerKeyframe];
-                        float tang0 = outTangents[comp + prevIndex * valuesPerKeyframe];
-                        float tang1 = inTangents[comp + nextIndex * valuesPerKeyframe];
-                        float vert1 = splineVerts[comp + nextIndex * valuesPerKeyframe];
-                        weights[comp] = cubicSpline(vert0, tang0, vert1, tang1, t);
-                    }
-                } else {
-                    const int numComponents = std::min((int) MAX_MORPH_TARGETS, valuesPerKeyframe);
-                    for (int comp = 0; comp < numComponents; ++comp) {
-                        float previous = samplerValues[comp + prevIndex * valuesPerKeyframe];
-                        float current = samplerValues[comp + nextIndex * valuesPerKeyframe];
-                        weights[comp] = (1 - t) * previous + t * current;
-                    }
-                }
+    RenderableManager* renderableManager = mImpl->renderableManager;
+    TransformManager* transformManager = mImpl->transformManager;
 
-                auto renderable = renderableManager->getInstance(channel.targetEntity);
-                renderableManager->setMorphWeights(renderable, weights);
-                continue;
-            }
+    // Lay out the bone palettes of all the skins. Each skin gets one palette for the joint
+    // transforms in world space, followed by one palette for each of its targets.
+    auto& skins = mImpl->skins;
+    auto& skinBones = mImpl->skinBones;
+    auto& skinTargets = mImpl->skinTargets;
+    skins.clear();
+    skinBones.clear();
+    skinTargets.clear();
+    size_t boneCount = 0;
+    size_t targetCount = 0;
+    size_t jointCount = 0;
+    auto addSkins = [&](const SkinVector& skinVector) {
+        for (const auto& skin : skinVector) {
+            skins.push_back(&skin);
+            skinBones.push_back(boneCount);
+            skinTargets.push_back(targetCount);
+            boneCount += skin.joints.size() * (skin.targets.size() + 1);
+            targetCount += skin.targets.size();
+            jointCount += skin.joints.size();
         }
+    };
 
-        xform = composeMatrix(translation, rotation, scale);
-        transformManager->setTransform(node, xform);
+    if (mImpl->instance) {
+        addSkins(mImpl->instance->skins);
+    } else if (mImpl->asset->mInstances.empty()) {
+        addSkins(mImpl->asset->mSkins);
+    } else {
+        for (FFilamentInstance* instance : mImpl->asset->mInstances) {
+            addSkins(instance->skins);
+        }
     }
-}
 
-void Animator::updateBoneMatrices() {
-    auto renderableManager = mImpl->renderableManager;
-    auto transformManager = mImpl->transformManager;
-
-    auto update = [=](const SkinVector& skins, BoneVector& boneVector) {
-        for (const auto& skin : skins) {
-            size_t njoints = skin.joints.size();
-            boneVector.resize(njoints);
-            for (const auto& entity : skin.targets) {
-                auto renderable = renderableManager->getInstance(entity);
-                if (!renderable) {
-                    continue;
-                }
-                mat4f inverseGlobalTransform;
-                auto xformable = transformManager->getInstance(entity);
+    mImpl->boneMatrices.resize(boneCount);
+    mImpl->targetPalettes.resize(targetCount);
+    mat4f* const bones = mImpl->boneMatrices.data();
+    uint32_t* const targetPalettes = mImpl->targetPalettes.data();
+
+    // This only reads from the TransformManager, so skins can be computed in parallel.
+    auto update = [=, &skins, &skinBones, &skinTargets](uint32_t first, uint32_t count) {
+        for (uint32_t s = first, e = first + count; s != e; s++) {
+            const Skin& skin = *skins[s];
+            const size_t njoints = skin.joints.size();
+            const uint32_t jointPalette = skinBones[s];
+
+            // Joint instances are resolved once per skin, rather than once per target.
+            mat4f* const UTILS_RESTRICT palette = bones + jointPalette;
+            for (size_t boneIndex = 0; boneIndex < njoints; ++boneIndex) {
+                TransformManager::Instance jointInstance =
+                        transformManager->getInstance(skin.joints[boneIndex]);
+                palette[boneIndex] = transformManager->getWorldTransform(jointInstance) *
+                        skin.inverseBindMatrices[boneIndex];
+            }
+
+            // Targets share the palette of the skin (or of another target) when they have the
+            // same world transform, which is often the identity.
+            mat4f previousTransform;
+            uint32_t previousPalette = jointPalette;
+            for (size_t t = 0, n = skin.targets.size(); t < n; ++t) {
+                mat4f globalTransform;
+                auto xformable = transformManager->getInstance(skin.targets[t]);
                 if (xformable) {
-                    inverseGlobalTransform = inverse(transformManager->getWorldTransform(xformable));
+                    globalTransform = transformManager->getWorldTransform(xformable);
                 }
-                for (size_t boneIndex = 0; boneIndex < njoints; ++boneIndex) {
-                    const auto& joint = skin.joints[boneIndex];
-                    TransformManager::Instance jointInstance = transformManager->getInstance(joint);
-                    mat4f globalJointTransform = transformManager->getWorldTransform(jointInstance);
-                    boneVector[boneIndex] =
-                            inverseGlobalTransform *
-                            globalJointTransform *
-                            skin.inverseBindMatrices[boneIndex];
+                if (globalTransform != previousTransform) {
+                    const mat4f inverseGlobalTransform = inverse(globalTransform);
+                    previousTransform = globalTransform;
+                    previousPalette = jointPalette + uint32_t((t + 1) * njoints);
+                    mat4f* const UTILS_RESTRICT targetBones = bones + previousPalette;
+                    for (size_t boneIndex = 0; boneIndex < njoints; ++boneIndex) {
+                        targetBones[boneIndex] = inverseGlobalTransform * palette[boneIndex];
+                    }
                 }
-                renderableManager->setBones(renderable, boneVector.data(), boneVector.size());
+                targetPalettes[skinTargets[s] + t] = previousPalette;
             }
         }
     };
 
-    if (mImpl->instance) {
-        update(mImpl->instance->skins, mImpl->boneMatrices);
-    } else if (mImpl->asset->mInstances.empty()) {
-        update(mImpl->asset->mSkins, mImpl->boneMatrices);
+    const uint32_t skinCount = skins.size();
+    JobSystem& js = *mImpl->jobSystem;
+    if (skinCount > 1 && jointCount >= PARALLEL_JOINT_THRESHOLD && js.isThreadAdopted()) {
+        auto* job = jobs::parallel_for(js, nullptr, 0, skinCount, std::cref(update),
+                jobs::CountSplitter<4>());
+        js.runAndWait(job);
     } else {
-        for (FFilamentInstance* instance : mImpl->asset->mInstances) {
-            update(instance->skins, mImpl->boneMatrices);
+        update(0, skinCount);
+    }
+
+    // Each renderable owns a range of the bones buffer, so shared palettes are uploaded once per
+    // target. Binding one range for all of them would need a RenderableManager API.
+    for (size_t s = 0; s < skinCount; s++) {
+        const Skin& skin = *skins[s];
+        for (size_t t = 0, n = skin.targets.size(); t < n; ++t) {
+            auto renderable = renderableManager->getInstance(skin.targets[t]);
+            if (renderable) {
+                renderableManager->setBones(renderable,
+                        bones + targetPalettes[skinTargets[s] + t], skin.joints.size());
+            }
         }
     }
 }
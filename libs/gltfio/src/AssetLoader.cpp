@@ -118,10 +118,12 @@ struct FAssetLoader : public AssetLoader {
             mTransformManager(config.engine->getTransformManager()),
             mMaterials(config.materials),
             mEngine(config.engine),
+            mGeometryCache(config.shareGeometry ? new GeometryCache : nullptr),
             mDefaultNodeName(config.defaultNodeName) {}
 
     FFilamentAsset* createAssetFromJson(const uint8_t* bytes, uint32_t nbytes);
     FFilamentAsset* createAssetFromBinary(const uint8_t* bytes, uint32_t nbytes);
+    FFilamentAsset* createAssetFromFile(const char* path);
     FFilamentAsset* createInstancedAsset(const uint8_t* bytes, uint32_t numBytes,
         FilamentInstance** instances, size_t numInstances);
 
@@ -130,6 +132,7 @@ struct FAssetLoader : public AssetLoader {
 
     ~FAssetLoader() {
         delete mMaterials;
+        delete mGeometryCache;
     }
 
     void destroyAsset(const FFilamentAsset* asset) {
@@ -148,6 +151,10 @@ struct FAssetLoader : public AssetLoader {
         return mMaterials->getMaterials();
     }
 
+    size_t getSavedGeometrySize() const noexcept {
+        return mGeometryCache ? mGeometryCache->getSavedSize() : 0;
+    }
+
     void createAsset(const cgltf_data* srcAsset, size_t numInstances);
     void createEntity(const cgltf_node* node, Entity parent, bool enableLight,
             FFilamentInstance* instance);
@@ -170,6 +177,7 @@ struct FAssetLoader : public AssetLoader {
     TransformManager& mTransformManager;
     MaterialProvider* mMaterials;
     Engine* mEngine;
+    GeometryCache* mGeometryCache;
 
     // The loader owns a few transient mappings used only for the current asset being loaded.
     FFilamentAsset* mResult;
@@ -219,6 +227,29 @@ FFilamentAsset* FAssetLoader::createAssetFromBinary(const uint8_t* bytes, uint32
     return mResult;
 }
 
+FFilamentAsset* FAssetLoader::createAssetFromFile(const char* path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        slog.e << "Unable to map " << path << io::endl;
+        return nullptr;
+    }
+
+    // Unlike createAssetFromBinary, cgltf can point straight into the mapping because its lifetime
+    // is tied to the asset's. Let cgltf examine the magic identifier to determine the file type.
+    cgltf_options options {};
+    cgltf_data* sourceAsset;
+    cgltf_result result = cgltf_parse(&options, file.getData(), file.getSize(), &sourceAsset);
+    if (result != cgltf_result_success) {
+        slog.e << "Unable to parse glTF file." << io::endl;
+        return nullptr;
+    }
+    createAsset(sourceAsset, 0);
+    if (mResult) {
+        mResult->mMappedFiles.push_back(std::move(file));
+    }
+    return mResult;
+}
+
 FFilamentAsset* FAssetLoader::createInstancedAsset(const uint8_t* bytes, uint32_t numBytes,
         FilamentInstance** instances, size_t numInstances) {
     ASSERT_PRECONDITION(numInstances > 0, "Instance count must be 1 or more.");
@@ -260,6 +291,7 @@ void FAssetLoader::createAsset(const cgltf_data* srcAsset, size_t numInstances)
 
     mResult = new FFilamentAsset(mEngine, mNameManager, &mEntityManager);
     mResult->mSourceAsset = srcAsset;
+    mResult->mGeometryCache = mGeometryCache;
     mResult->acquireSourceAsset();
 
     // If there is no default scene specified, then the default is the first one.
@@ -449,6 +481,7 @@ void FAssetLoader::createRenderable(const cgltf_node* node, Entity entity, const
             mError = true;
             continue;
         }
+        mResult->mDependencyGraph.addEdge(entity, outputPrim->vertices);
 
         // Expand the object-space bounding box.
         aabb.min = min(outputPrim->aabb.min, aabb.min);
@@ -514,6 +547,7 @@ bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* out
     auto addBufferSlot = [slots](BufferSlot entry) {
         slots->push_back(entry);
     };
+    const size_t firstSlot = mResult->mBufferSlots.size();
 
     // In glTF, each primitive may or may not have an index buffer.
     IndexBuffer* indices;
@@ -557,7 +591,6 @@ bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* out
     bool hasUv0 = false, hasUv1 = false, hasVertexColor = false, hasNormals = false;
     uint32_t vertexCount = 0;
 
-    const size_t firstSlot = mResult->mBufferSlots.size();
     int slot = 0;
 
     for (cgltf_size aindex = 0; aindex < inPrim->attributes_count; aindex++) {
@@ -757,6 +790,12 @@ bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* out
     mResult->mPrimitives.push_back({inPrim, vertices});
     mResult->mVertexBuffers.push_back(vertices);
 
+    if (mGeometryCache) {
+        mResult->mCacheablePrimitives[vertices] = { indices, uvmap };
+    }
+
+    // All the slots of this primitive, including its index buffer, refer to its vertex buffer.
+    // This lets ResourceLoader upload the data of a primitive all at once.
     for (size_t i = firstSlot; i < mResult->mBufferSlots.size(); ++i) {
         mResult->mBufferSlots[i].vertexBuffer = vertices;
     }
@@ -1152,6 +1191,10 @@ FilamentAsset* AssetLoader::createAssetFromBinary(uint8_t const* bytes, uint32_t
     return upcast(this)->createAssetFromBinary(bytes, nbytes);
 }
 
+FilamentAsset* AssetLoader::createAssetFromFile(const char* path) {
+    return upcast(this)->createAssetFromFile(path);
+}
+
 FilamentAsset* AssetLoader::createInstancedAsset(const uint8_t* bytes, uint32_t numBytes,
         FilamentInstance** instances, size_t numInstances) {
     return upcast(this)->createInstancedAsset(bytes, numBytes, instances, numInstances);
@@ -1184,4 +1227,8 @@ const Material* const* AssetLoader::getMaterials() const noexcept {
     return upcast(this)->getMaterials();
 }
 
+size_t AssetLoader::getSavedGeometrySize() const noexcept {
+    return upcast(this)->getSavedGeometrySize();
+}
+
 } // namespace gltfio
@@ -44,6 +44,13 @@ void DependencyGraph::addEdge(MaterialInstance* mi, const char* parameter) {
     mMaterialToTexture[mi].params[parameter] = nullptr;
 }
 
+void DependencyGraph::addEdge(Entity entity, VertexBuffer* vertices) {
+    assert(!mFinalized);
+    if (mVertexBufferToEntity[vertices].insert(entity).second) {
+        mEntityToMaterial[entity].numPendingVertexBuffers++;
+    }
+}
+
 // During finalization, the structure of the glTF is known but we have not yet created texture
 // objects. Find all non-textured entities and immediately add mark them as ready.
 void DependencyGraph::finalize() {
@@ -89,12 +96,46 @@ void DependencyGraph::markAsReady(Texture* texture) {
     }
 }
 
+void DependencyGraph::markAsReady(VertexBuffer* vertices) {
+    auto iter = mVertexBufferToEntity.find(vertices);
+    if (iter == mVertexBufferToEntity.end()) {
+        return;
+    }
+    for (auto entity : iter->second) {
+        auto& status = mEntityToMaterial.at(entity);
+        assert(status.numPendingVertexBuffers > 0);
+        status.numPendingVertexBuffers--;
+        if (status.isReady()) {
+            mReadyRenderables.push(entity);
+        }
+    }
+    mVertexBufferToEntity.erase(iter);
+}
+
+void DependencyGraph::replace(VertexBuffer* from, VertexBuffer* to) {
+    assert(!mFinalized);
+    auto iter = mVertexBufferToEntity.find(from);
+    if (iter == mVertexBufferToEntity.end()) {
+        return;
+    }
+    tsl::robin_set<Entity> entities = std::move(iter.value());
+    mVertexBufferToEntity.erase(iter);
+    auto& target = mVertexBufferToEntity[to];
+    for (auto entity : entities) {
+        // If the entity already depends on the new vertex buffer, it now has one less to wait for.
+        if (!target.insert(entity).second) {
+            mEntityToMaterial.at(entity).numPendingVertexBuffers--;
+        }
+    }
+}
+
 void DependencyGraph::markAsReady(MaterialInstance* material) {
     auto& entities = mMaterialToEntity.at(material);
     for (auto entity : entities) {
         auto& status = mEntityToMaterial.at(entity);
         assert(status.numReadyMaterials < status.materials.size());
-        if (++status.numReadyMaterials == status.materials.size()) {
+        status.numReadyMaterials++;
+        if (status.isReady()) {
             mReadyRenderables.push(entity);
         }
     }
@@ -28,13 +28,14 @@
 namespace filament {
     class MaterialInstance;
     class Texture;
+    class VertexBuffer;
 }
 
 namespace gltfio {
 
 /**
  * Internal graph that enables FilamentAsset to discover "ready-to-render" entities by tracking
- * the Texture objects that each entity depends on.
+ * the Texture objects and the vertex data that each entity depends on.
  *
  * Renderables connect to a set of material instances, which in turn connect to a set of parameter
  * names, which in turn connect to a set of texture objects. These relationships are not easily
@@ -55,7 +56,10 @@ namespace gltfio {
  *          Texture     Texture  Texture
  *
  * Note that the left-most entity in the above graph has no textures, so it becomes ready as soon as
- * finalize is called.
+ * finalize is called and its vertex buffers are uploaded.
+ *
+ * Entities also connect to the vertex buffers of their primitives, which ResourceLoader marks as
+ * ready when their data has been uploaded.
  */
 class DependencyGraph {
 public:
@@ -70,6 +74,7 @@ public:
     // These are called during the initial asset loader phase.
     void addEdge(Entity entity, Material* material);
     void addEdge(Material* material, const char* parameter);
+    void addEdge(Entity entity, filament::VertexBuffer* vertices);
 
     // This is called at the end of the initial asset loading phase.
     void finalize();
@@ -78,6 +83,14 @@ public:
     void addEdge(filament::Texture* texture, Material* material, const char* parameter);
     void markAsReady(filament::Texture* texture);
 
+    // This is called after the data of a vertex buffer has been uploaded, it can be called before
+    // or after finalize.
+    void markAsReady(filament::VertexBuffer* vertices);
+
+    // This is called before finalize, when the entities that use a vertex buffer are given an
+    // identical one instead, which has not been uploaded yet either.
+    void replace(filament::VertexBuffer* from, filament::VertexBuffer* to);
+
 private:
     struct TextureNode {
         filament::Texture* texture;
@@ -91,6 +104,11 @@ private:
     struct EntityNode {
         tsl::robin_set<Material*> materials;
         size_t numReadyMaterials = 0;
+        size_t numPendingVertexBuffers = 0;
+
+        bool isReady() const noexcept {
+            return numReadyMaterials == materials.size() && numPendingVertexBuffers == 0;
+        }
     };
 
     void markAsReady(Material* material);
@@ -101,6 +119,7 @@ private:
     tsl::robin_map<Material*, tsl::robin_set<Entity>> mMaterialToEntity;
     tsl::robin_map<Material*, MaterialNode> mMaterialToTexture;
     tsl::robin_map<filament::Texture*, tsl::robin_set<Material*>> mTextureToMaterial;
+    tsl::robin_map<filament::VertexBuffer*, tsl::robin_set<Entity>> mVertexBufferToEntity;
 
     // Each texture (and its readiness flag) can be referenced from multiple nodes, so we own
     // a collection of wrapper objects in the following map. This uses std::unique_ptr to allow
@@ -33,15 +33,27 @@ using namespace utils;
 namespace gltfio {
 
 DracoMesh* DracoCache::findOrCreateMesh(const cgltf_buffer_view* key) {
-    auto iter = mCache.find(key);
-    if (iter != mCache.end()) {
-        return iter->second.get();
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        auto iter = mCache.find(key);
+        if (iter != mCache.end()) {
+            return iter->second.get();
+        }
     }
     assert(key->buffer && key->buffer->data);
     const uint8_t* compressedData = key->offset + (uint8_t*) key->buffer->data;
-    DracoMesh* mesh = DracoMesh::decode(compressedData, key->size);
-    mCache.emplace(key, mesh);
-    return mesh;
+    unique_ptr<DracoMesh> mesh(DracoMesh::decode(compressedData, key->size));
+
+    // If another job decoded the same mesh in the meantime, keep the first one since its
+    // accessors may already be in use.
+    std::lock_guard<std::mutex> guard(mLock);
+    auto result = mCache.emplace(key, std::move(mesh));
+    return result.first->second.get();
+}
+
+void DracoCache::clear() {
+    std::lock_guard<std::mutex> guard(mLock);
+    mCache.clear();
 }
 
 DracoMesh::DracoMesh(struct DracoMeshDetails* details) : mDetails(details) {}
@@ -52,6 +64,7 @@ struct DracoMeshDetails {
     unique_ptr<draco::Mesh> mesh;
     vector<unique_ptr<cgltf_buffer_view>> views;
     vector<unique_ptr<cgltf_buffer>> buffers;
+    std::mutex lock;
 };
 
 DracoMesh::~DracoMesh() {
@@ -118,6 +131,8 @@ DracoMesh* DracoMesh::decode(const uint8_t* data, size_t dataSize) {
 }
 
 void DracoMesh::getFaceIndices(cgltf_accessor* target) const {
+    std::lock_guard<std::mutex> guard(mDetails->lock);
+
     // Return early if we've already decompressed this data.
     if (target->buffer_view) {
         return;
@@ -154,6 +169,8 @@ void DracoMesh::getFaceIndices(cgltf_accessor* target) const {
 }
 
 bool DracoMesh::getVertexAttributes(uint32_t attributeId, cgltf_accessor* target) const {
+    std::lock_guard<std::mutex> guard(mDetails->lock);
+
     // Return early if we've already decompressed this data.
     if (target->buffer_view) {
         return true;
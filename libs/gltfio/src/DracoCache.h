@@ -22,6 +22,7 @@
 #include <tsl/robin_map.h>
 
 #include <memory>
+#include <mutex>
 
 #ifndef GLTFIO_DRACO_SUPPORTED
 #define GLTFIO_DRACO_SUPPORTED 0
@@ -35,10 +36,15 @@ class DracoMesh;
 //
 // The cache key is the buffer view that holds the compressed data. This allows the loader to
 // avoid duplicated work when a single Draco mesh is referenced from multiple primitives.
+//
+// The cache can be used from several jobs at once. Meshes are decoded outside of its lock, so that
+// different meshes are decoded concurrently.
 class DracoCache {
 public:
     DracoMesh* findOrCreateMesh(const cgltf_buffer_view* key);
+    void clear();
 private:
+    std::mutex mLock;
     tsl::robin_map<const cgltf_buffer_view*, std::unique_ptr<DracoMesh>> mCache;
 };
 
@@ -51,6 +57,8 @@ private:
 // our Draco decoder relies on the accessor fields being 100% correct. If we had to be robust
 // against faulty accessor information, we would need to replace the VertexBuffer object that was
 // created in the AssetLoader, which would be a messy process.
+//
+// The accessor getters can be called from several jobs at once, they hold a per-mesh lock.
 class DracoMesh {
 public:
     static DracoMesh* decode(const uint8_t* compressedData, size_t compressedSize);
@@ -18,6 +18,7 @@
 #define GLTFIO_FFILAMENTASSET_H
 
 #include <gltfio/FilamentAsset.h>
+#include <gltfio/MaterialProvider.h>
 
 #include <filament/Engine.h>
 #include <filament/IndexBuffer.h>
@@ -38,6 +39,8 @@
 #include "DependencyGraph.h"
 #include "DracoCache.h"
 #include "FFilamentInstance.h"
+#include "GeometryCache.h"
+#include "MappedFile.h"
 
 #include <tsl/robin_map.h>
 #include <tsl/htrie_map.h>
@@ -73,6 +76,13 @@ struct TextureSlot {
     bool srgb;
 };
 
+// What ResourceLoader needs to know about a primitive, besides its glTF data, to look it up in
+// the GeometryCache.
+struct CacheablePrimitive {
+    filament::IndexBuffer* indices;
+    UvMap uvmap; // the layout of the vertex buffer depends on it
+};
+
 struct FFilamentAsset : public FilamentAsset {
     FFilamentAsset(filament::Engine* engine, utils::NameComponentManager* names,
             utils::EntityManager* entityManager) :
@@ -187,6 +197,7 @@ struct FFilamentAsset : public FilamentAsset {
     utils::NameComponentManager* mNameManager;
     utils::EntityManager* mEntityManager;
     std::vector<uint8_t> mGlbData;
+    std::vector<MappedFile> mMappedFiles;
     std::vector<utils::Entity> mEntities;
     std::vector<utils::Entity> mLightEntities;
     std::vector<utils::Entity> mCameraEntities;
@@ -205,6 +216,7 @@ struct FFilamentAsset : public FilamentAsset {
     bool mSharedSourceAsset = false;
     DependencyGraph mDependencyGraph;
     DracoCache mDracoCache;
+    GeometryCache* mGeometryCache = nullptr; // owned by the AssetLoader, null if not sharing
     tsl::htrie_map<char, std::vector<utils::Entity>> mNameToEntity;
 
     // Sentinels for situations where ResourceLoader needs to generate data.
@@ -218,6 +230,7 @@ struct FFilamentAsset : public FilamentAsset {
     const cgltf_data* mSourceAsset = nullptr;
     NodeMap mNodeMap; // unused for instanced assets
     std::vector<std::pair<const cgltf_primitive*, filament::VertexBuffer*> > mPrimitives;
+    tsl::robin_map<const filament::VertexBuffer*, CacheablePrimitive> mCacheablePrimitives;
 };
 
 FILAMENT_UPCAST(FilamentAsset)
@@ -57,11 +57,16 @@ FFilamentAsset::~FFilamentAsset() {
     for (auto mi : mMaterialInstances) {
         mEngine->destroy(mi);
     }
+    // Buffers that are shared with other assets are only destroyed along with their last user.
     for (auto vb : mVertexBuffers) {
-        mEngine->destroy(vb);
+        if (!mGeometryCache || mGeometryCache->release(vb)) {
+            mEngine->destroy(vb);
+        }
     }
     for (auto ib : mIndexBuffers) {
-        mEngine->destroy(ib);
+        if (!mGeometryCache || mGeometryCache->release(ib)) {
+            mEngine->destroy(ib);
+        }
     }
     for (auto tx : mTextures) {
         mEngine->destroy(tx);
@@ -89,6 +94,7 @@ void FFilamentAsset::releaseSourceData() noexcept {
     mResourceUris = {};
     mNodeMap = {};
     mPrimitives = {};
+    mCacheablePrimitives = {};
     mBufferSlots = {};
     mTextureSlots = {};
     releaseSourceAsset();
@@ -103,11 +109,22 @@ void FFilamentAsset::releaseSourceAsset() {
         // release all remaining CPU-side source data, such as aggregated GLB buffers and Draco
         // meshes. Note that sidecar bin data is already released, because external resources
         // are released eagerly via BufferDescriptor callbacks.
-        mDracoCache = {};
+        mDracoCache.clear();
         mGlbData = {};
         if (!mSharedSourceAsset) {
-            cgltf_free((cgltf_data*) mSourceAsset);
+            // Buffers that point into a file mapping are not owned by cgltf.
+            cgltf_data* gltf = (cgltf_data*) mSourceAsset;
+            for (cgltf_size i = 0; i < gltf->buffers_count; ++i) {
+                for (const MappedFile& file : mMappedFiles) {
+                    if (file.contains(gltf->buffers[i].data)) {
+                        gltf->buffers[i].data = nullptr;
+                        break;
+                    }
+                }
+            }
+            cgltf_free(gltf);
         }
+        mMappedFiles.clear();
         mSourceAsset = nullptr;
     }
 }
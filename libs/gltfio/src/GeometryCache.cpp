@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GeometryCache.h"
+
+using namespace filament;
+
+namespace gltfio {
+
+bool GeometryCache::acquire(const Key& key, const FFilamentAsset* asset, VertexBuffer** vertices,
+        IndexBuffer** indices) {
+    auto iter = mEntries.find(key);
+    if (iter == mEntries.end()) {
+        return false;
+    }
+    const Entry& entry = iter->second;
+    if (!entry.uploaded && entry.asset != asset) {
+        return false;
+    }
+    mVertexReferences[entry.vertices].count++;
+    mIndexReferences[entry.indices].count++;
+    mSavedSize += entry.size;
+    *vertices = entry.vertices;
+    *indices = entry.indices;
+    return true;
+}
+
+bool GeometryCache::add(const Key& key, const FFilamentAsset* asset, VertexBuffer* vertices,
+        IndexBuffer* indices, size_t size) {
+    if (!mEntries.emplace(key, Entry { vertices, indices, size, asset, false }).second) {
+        return false;
+    }
+    mVertexReferences[vertices] = { key, 1 };
+    mIndexReferences[indices] = { key, 1 };
+    return true;
+}
+
+GeometryCache::Entry* GeometryCache::findEntry(const VertexBuffer* vertices) {
+    auto references = mVertexReferences.find(vertices);
+    if (references == mVertexReferences.end()) {
+        return nullptr;
+    }
+    // The key might have been evicted, then taken by other buffers.
+    auto iter = mEntries.find(references->second.key);
+    if (iter == mEntries.end() || iter->second.vertices != vertices) {
+        return nullptr;
+    }
+    return &iter.value();
+}
+
+void GeometryCache::markAsUploaded(const VertexBuffer* vertices) {
+    if (Entry* entry = findEntry(vertices)) {
+        entry->uploaded = true;
+    }
+}
+
+void GeometryCache::evict(const VertexBuffer* vertices) {
+    if (findEntry(vertices)) {
+        mEntries.erase(mVertexReferences[vertices].key);
+    }
+}
+
+// The entry goes away with the first of its buffers to be destroyed, its other buffer only
+// needs its references counted.
+template<typename Buffer>
+bool GeometryCache::release(tsl::robin_map<const Buffer*, References>& references,
+        const Buffer* buffer) {
+    auto iter = references.find(buffer);
+    if (iter == references.end()) {
+        return true;
+    }
+    if (--iter.value().count > 0) {
+        return false;
+    }
+    auto entry = mEntries.find(iter->second.key);
+    if (entry != mEntries.end() && entry->second.holds(buffer)) {
+        mEntries.erase(entry);
+    }
+    references.erase(iter);
+    return true;
+}
+
+bool GeometryCache::release(const VertexBuffer* vertices) {
+    return release(mVertexReferences, vertices);
+}
+
+bool GeometryCache::release(const IndexBuffer* indices) {
+    return release(mIndexReferences, indices);
+}
+
+} // namespace gltfio
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLTFIO_GEOMETRY_CACHE_H
+#define GLTFIO_GEOMETRY_CACHE_H
+
+#include <utils/Hash.h>
+
+#include <tsl/robin_map.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+    class IndexBuffer;
+    class VertexBuffer;
+}
+
+namespace gltfio {
+
+struct FFilamentAsset;
+
+// Content-addressed cache of the VertexBuffer and IndexBuffer objects of primitives, shared by all
+// the assets of an AssetLoader.
+//
+// AssetLoader creates buffers for every primitive because the data is not available yet. Once the
+// data is loaded, ResourceLoader looks up each primitive by the digest of its layout and data. On
+// a hit, the renderables are pointed to the cached buffers, which gain a reference, and the new
+// buffers are destroyed before anything is uploaded to them. On a miss, the primitive's buffers
+// are added to the cache.
+//
+// The data of a new entry is uploaded later, or never if the load is cancelled, so until it is
+// uploaded an entry is only shared within the asset that added it, whose dependency graph waits
+// for it.
+//
+// Assets hold a reference for each buffer in their vertex and index buffer lists, and they only
+// destroy a buffer once release() says it is no longer used.
+class GeometryCache {
+public:
+    using Key = utils::hash::Digest128::Value;
+
+    // Looks up a primitive for the given asset, on a hit adds a reference to its buffers and
+    // returns true. Entries that aren't uploaded yet are only found by the asset that added them.
+    bool acquire(const Key& key, const FFilamentAsset* asset, filament::VertexBuffer** vertices,
+            filament::IndexBuffer** indices);
+
+    // Adds the buffers of a new primitive of the given asset, with a single reference. The size is
+    // the amount of vertex and index data that subsequent hits save. Returns false if the key is
+    // taken by an entry that the asset can't acquire, in which case the buffers aren't shared.
+    bool add(const Key& key, const FFilamentAsset* asset, filament::VertexBuffer* vertices,
+            filament::IndexBuffer* indices, size_t size);
+
+    // Lets all the assets acquire the entry of these buffers, once their data is uploaded.
+    void markAsUploaded(const filament::VertexBuffer* vertices);
+
+    // Removes the entry of these buffers from the cache, e.g. because their data will never be
+    // uploaded. Their references are still counted.
+    void evict(const filament::VertexBuffer* vertices);
+
+    // Drops a reference, returns true if the caller should destroy the buffer. Buffers that are
+    // not in the cache are not shared and can always be destroyed.
+    bool release(const filament::VertexBuffer* vertices);
+    bool release(const filament::IndexBuffer* indices);
+
+    // Total size of the vertex and index data that was not uploaded thanks to the cache.
+    size_t getSavedSize() const noexcept { return mSavedSize; }
+
+private:
+    struct Entry {
+        filament::VertexBuffer* vertices;
+        filament::IndexBuffer* indices;
+        size_t size;
+        const FFilamentAsset* asset;
+        bool uploaded;
+
+        bool holds(const filament::VertexBuffer* buffer) const { return vertices == buffer; }
+        bool holds(const filament::IndexBuffer* buffer) const { return indices == buffer; }
+    };
+
+    struct References {
+        Key key;
+        int count;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const noexcept {
+            return size_t(key.hash[0]);
+        }
+    };
+
+    template<typename Buffer>
+    bool release(tsl::robin_map<const Buffer*, References>& references, const Buffer* buffer);
+
+    Entry* findEntry(const filament::VertexBuffer* vertices);
+
+    tsl::robin_map<Key, Entry, KeyHash> mEntries;
+    tsl::robin_map<const filament::VertexBuffer*, References> mVertexReferences;
+    tsl::robin_map<const filament::IndexBuffer*, References> mIndexReferences;
+    size_t mSavedSize = 0;
+};
+
+} // namespace gltfio
+
+#endif // GLTFIO_GEOMETRY_CACHE_H
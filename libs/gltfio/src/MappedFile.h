@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLTFIO_MAPPEDFILE_H
+#define GLTFIO_MAPPEDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gltfio {
+
+// Maps the contents of a file into memory, the mapping is released upon destruction.
+//
+// The mapping is private and copy-on-write: the loader is allowed to modify the data in place
+// (e.g. when normalizing skinning weights), which copies the touched pages but never writes back
+// to the file. Untouched pages stay backed by the file, so they don't count against the process'
+// anonymous memory and the kernel is free to evict them.
+class MappedFile {
+public:
+    MappedFile() noexcept = default;
+    MappedFile(MappedFile&& rhs) noexcept;
+    MappedFile& operator=(MappedFile&& rhs) noexcept;
+    MappedFile(MappedFile const& rhs) = delete;
+    MappedFile& operator=(MappedFile const& rhs) = delete;
+    ~MappedFile() noexcept;
+
+    // Returns false if the file cannot be opened or mapped, or if it is empty.
+    bool open(const char* path) noexcept;
+
+    uint8_t* getData() const noexcept { return mData; }
+    size_t getSize() const noexcept { return mSize; }
+
+    bool contains(const void* p) const noexcept {
+        return p >= mData && p < mData + mSize;
+    }
+
+private:
+    void close() noexcept;
+    uint8_t* mData = nullptr;
+    size_t mSize = 0;
+};
+
+} // namespace gltfio
+
+#endif // GLTFIO_MAPPEDFILE_H
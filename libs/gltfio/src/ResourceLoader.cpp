@@ -18,16 +18,19 @@
 #include <gltfio/Image.h>
 
 #include "FFilamentAsset.h"
+#include "GltfEnums.h"
 #include "upcast.h"
 
 #include <filament/Engine.h>
 #include <filament/IndexBuffer.h>
 #include <filament/MaterialInstance.h>
+#include <filament/RenderableManager.h>
 #include <filament/Texture.h>
 #include <filament/VertexBuffer.h>
 
 #include <geometry/SurfaceOrientation.h>
 
+#include <utils/Hash.h>
 #include <utils/JobSystem.h>
 #include <utils/Log.h>
 #include <utils/Systrace.h>
@@ -39,8 +42,12 @@
 #include <math/vec4.h>
 
 #include <tsl/robin_map.h>
+#include <tsl/robin_set.h>
 
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <vector>
 
 #if defined(__EMSCRIPTEN__) || defined(ANDROID)
 #define USE_FILESYSTEM 0
@@ -70,6 +77,29 @@ namespace {
     using BufferTextureCache = tsl::robin_map<const void*, std::unique_ptr<TextureCacheEntry>>;
     using UriTextureCache = tsl::robin_map<std::string, std::unique_ptr<TextureCacheEntry>>;
     using UriDataCache = tsl::robin_map<std::string, gltfio::ResourceLoader::BufferDescriptor>;
+
+    // The data of a vertex or index buffer slot, ready to be uploaded.
+    struct GeometryUpload {
+        gltfio::BufferSlot slot;
+        const void* data;
+        uint32_t size;
+        bool generated; // the data was allocated by the loader, free it once uploaded
+    };
+
+    // The geometry of each glTF mesh is prepared on its own job (Draco decoding, sparse data,
+    // tangent generation...) and then uploaded from the main thread.
+    struct GeometryTask {
+        gltfio::FFilamentAsset* asset;
+        std::vector<std::pair<const cgltf_primitive*, VertexBuffer*>> primitives;
+        std::vector<gltfio::BufferSlot> slots;
+        size_t size; // estimate of the memory allocated by the job
+        JobSystem::Job* job;
+        std::atomic<bool> ready;
+        bool uploaded;
+        std::vector<GeometryUpload> uploads;
+    };
+
+    using GeometryTasks = std::vector<std::unique_ptr<GeometryTask>>;
 }
 
 namespace gltfio {
@@ -80,11 +110,14 @@ struct ResourceLoader::Impl {
         mEngine = config.engine;
         mNormalizeSkinningWeights = config.normalizeSkinningWeights;
         mRecomputeBoundingBoxes = config.recomputeBoundingBoxes;
+        mMemoryMapBuffers = config.memoryMapBuffers;
+        mMaxPendingGeometrySize = config.maxPendingGeometrySize;
     }
 
     Engine* mEngine;
     bool mNormalizeSkinningWeights;
     bool mRecomputeBoundingBoxes;
+    bool mMemoryMapBuffers;
     std::string mGltfPath;
 
     // User-provided resource data with URI string keys, populated with addResourceData().
@@ -101,8 +134,25 @@ struct ResourceLoader::Impl {
     int mNumDecoderTasksFinished;
     JobSystem::Job* mDecoderRootJob = nullptr;
     FFilamentAsset* mCurrentAsset;
-
-    void computeTangents(FFilamentAsset* asset);
+    AssetPool* mPool;
+
+    // Geometry tasks are run in order, as long as the memory they allocate stays within budget.
+    // They can finish in any order, the tasks before mFirstPendingGeometryTask are all uploaded.
+    GeometryTasks mGeometryTasks;
+    size_t mNextGeometryTask = 0;
+    size_t mFirstPendingGeometryTask = 0;
+    size_t mPendingGeometrySize = 0;
+    size_t mMaxPendingGeometrySize;
+    int mNumGeometryTasks = 0;
+    int mNumGeometryTasksFinished = 0;
+
+    void shareGeometry(FFilamentAsset* asset);
+    void createGeometryTasks(FFilamentAsset* asset);
+    void runGeometryTasks(bool async);
+    void uploadGeometry(bool wait);
+    void uploadGeometry(GeometryTask* task);
+    void finishGeometry();
+    void cancelGeometry();
     bool createTextures(bool async);
     void cancelTextureDecoding();
     void addTextureCacheEntry(const TextureSlot& tb);
@@ -198,13 +248,41 @@ static void importSkins(const cgltf_data* gltf, const NodeMap& nodeMap, SkinVect
     }
 }
 
+#if USE_FILESYSTEM
+static void mapBuffers(FFilamentAsset* asset, const std::string& gltfPath) {
+    const cgltf_data* gltf = asset->mSourceAsset;
+    const size_t slash = gltfPath.find_last_of("/\\");
+    const std::string prefix = slash == std::string::npos ? "" : gltfPath.substr(0, slash + 1);
+    for (cgltf_size i = 0; i < gltf->buffers_count; ++i) {
+        cgltf_buffer& buffer = gltf->buffers[i];
+        const char* uri = buffer.uri;
+        if (buffer.data || !uri || strncmp(uri, "data:", 5) == 0 || strstr(uri, "://")) {
+            continue;
+        }
+        // This is the same path resolution as cgltf_load_buffers.
+        std::string path = uri;
+        cgltf_decode_uri(&path[0]);
+        path = prefix + path.c_str();
+        MappedFile file;
+        if (!file.open(path.c_str()) || file.getSize() < buffer.size) {
+            slog.w << "Unable to map " << path << ", reading it instead." << io::endl;
+            continue;
+        }
+        buffer.data = file.getData();
+        asset->mMappedFiles.push_back(std::move(file));
+    }
+}
+#endif
+
 static void convertBytesToShorts(uint16_t* dst, const uint8_t* src, size_t count) {
     for (size_t i = 0; i < count; ++i) {
         dst[i] = src[i];
     }
 }
 
-static void decodeDracoMeshes(FFilamentAsset* asset) {
+// Decodes the Draco mesh of a primitive and points its accessors to the decoded data. This can be
+// called concurrently from several jobs.
+static void decodeDracoPrimitive(FFilamentAsset* asset, const cgltf_primitive* prim) {
     DracoCache* dracoCache = &asset->mDracoCache;
 
     // For a given primitive and attribute, find the corresponding accessor.
@@ -218,55 +296,88 @@ static void decodeDracoMeshes(FFilamentAsset* asset) {
         return (cgltf_accessor*) nullptr;
     };
 
-    // Go through every primitive and check if it has a Draco mesh.
-    for (auto pair : asset->mPrimitives) {
-        const cgltf_primitive* prim = pair.first;
-        VertexBuffer* vb = pair.second;
-        if (!prim->has_draco_mesh_compression) {
-            continue;
-        }
+    const cgltf_draco_mesh_compression& draco = prim->draco_mesh_compression;
+
+    // Check if we have already decoded this mesh.
+    DracoMesh* mesh = dracoCache->findOrCreateMesh(draco.buffer_view);
+    if (!mesh) {
+        slog.w << "Cannot decompress mesh, Draco decoding error." << io::endl;
+        return;
+    }
+
+    // Copy over the decompressed data, converting the data type if necessary.
+    if (prim->indices) {
+        mesh->getFaceIndices(prim->indices);
+    }
+
+    // Go through each attribute in the decompressed mesh.
+    for (cgltf_size i = 0; i < draco.attributes_count; i++) {
 
-        const cgltf_draco_mesh_compression& draco = prim->draco_mesh_compression;
+        // In cgltf, each Draco attribute's data pointer is an attribute id, not an accessor.
+        const uint32_t id = draco.attributes[i].data - asset->mSourceAsset->accessors;
 
-        // Check if we have already decoded this mesh.
-        DracoMesh* mesh = dracoCache->findOrCreateMesh(draco.buffer_view);
-        if (!mesh) {
-            slog.w << "Cannot decompress mesh, Draco decoding error." << io::endl;
+        // Find the destination accessor; this contains the desired component type, etc.
+        const cgltf_attribute_type type = draco.attributes[i].type;
+        const cgltf_int index = draco.attributes[i].index;
+        cgltf_accessor* accessor = findAccessor(prim, type, index);
+        if (!accessor) {
+            slog.w << "Cannot find matching accessor for Draco id " << id << io::endl;
             continue;
         }
 
         // Copy over the decompressed data, converting the data type if necessary.
-        if (prim->indices) {
-            mesh->getFaceIndices(prim->indices);
-        }
-
-        // Go through each attribute in the decompressed mesh.
-        for (cgltf_size i = 0; i < draco.attributes_count; i++) {
+        mesh->getVertexAttributes(id, accessor);
+    }
+}
 
-            // In cgltf, each Draco attribute's data pointer is an attribute id, not an accessor.
-            const uint32_t id = draco.attributes[i].data - asset->mSourceAsset->accessors;
-
-            // Find the destination accessor; this contains the desired component type, etc.
-            const cgltf_attribute_type type = draco.attributes[i].type;
-            const cgltf_int index = draco.attributes[i].index;
-            cgltf_accessor* accessor = findAccessor(prim, type, index);
-            if (!accessor) {
-                slog.w << "Cannot find matching accessor for Draco id " << id << io::endl;
-                continue;
+// Decodes all the Draco meshes of the asset upfront, concurrently. This is only needed when
+// skinning weights are normalized or bounding boxes recomputed, otherwise each mesh is decoded by
+// its own geometry job, see createGeometryTasks().
+static void decodeDracoMeshes(FFilamentAsset* asset, JobSystem& js) {
+    // Gather the compressed meshes, several primitives can refer to the same buffer view.
+    std::vector<const cgltf_buffer_view*> views;
+    tsl::robin_set<const cgltf_buffer_view*> uniqueViews;
+    for (auto pair : asset->mPrimitives) {
+        const cgltf_primitive* prim = pair.first;
+        if (prim->has_draco_mesh_compression) {
+            const cgltf_buffer_view* view = prim->draco_mesh_compression.buffer_view;
+            if (uniqueViews.insert(view).second) {
+                views.push_back(view);
             }
+        }
+    }
+    if (views.empty()) {
+        return;
+    }
+
+    // Decode each mesh in its own job, the cache can be populated concurrently.
+    DracoCache* dracoCache = &asset->mDracoCache;
+    JobSystem::Job* parent = js.createJob();
+    for (const cgltf_buffer_view* view : views) {
+        js.run(jobs::createJob(js, parent, [dracoCache, view] {
+            dracoCache->findOrCreateMesh(view);
+        }));
+    }
+    js.runAndWait(parent);
 
-            // Copy over the decompressed data, converting the data type if necessary.
-            mesh->getVertexAttributes(id, accessor);
+    // Now that all the meshes are in the cache, point the accessors to the decoded data.
+    for (auto pair : asset->mPrimitives) {
+        const cgltf_primitive* prim = pair.first;
+        if (prim->has_draco_mesh_compression) {
+            decodeDracoPrimitive(asset, prim);
         }
     }
 }
 
 ResourceLoader::ResourceLoader(const ResourceConfiguration& config) :
-        mPool(new AssetPool), pImpl(new Impl(config)) { }
+        mPool(new AssetPool), pImpl(new Impl(config)) {
+    pImpl->mPool = mPool;
+}
 
 ResourceLoader::~ResourceLoader() {
-    mPool->onLoaderDestroyed();
+    // Pending geometry jobs are using the source asset, wait for them before releasing it.
     delete pImpl;
+    mPool->onLoaderDestroyed();
 }
 
 void ResourceLoader::addResourceData(const char* uri, BufferDescriptor&& buffer) {
@@ -362,6 +473,12 @@ bool ResourceLoader::loadResources(FFilamentAsset* asset, bool async) {
 
     #else
 
+    // Map the external buffer files if requested. The buffers that remain empty (e.g. if a file
+    // cannot be mapped) are read by cgltf_load_buffers below, which skips the others.
+    if (pImpl->mMemoryMapBuffers) {
+        mapBuffers(asset, pImpl->mGltfPath);
+    }
+
     // Read data from the file system and base64 URIs.
     cgltf_result result = cgltf_load_buffers(&options, (cgltf_data*) gltf, pImpl->mGltfPath.c_str());
     if (result != cgltf_result_success) {
@@ -379,14 +496,18 @@ bool ResourceLoader::loadResources(FFilamentAsset* asset, bool async) {
     }
     #endif
 
-    // Decompress Draco meshes early on, which allows us to exploit subsequent processing such as
-    // tangent generation.
-    decodeDracoMeshes(asset);
+    // Draco meshes are normally decoded by the geometry jobs below, along with the rest of the
+    // data of their mesh. Skinning weight normalization and bounding box computation need all the
+    // vertex data upfront though.
+    const bool normalizeWeights = gltf->skins_count > 0 && pImpl->mNormalizeSkinningWeights;
+    if (normalizeWeights || pImpl->mRecomputeBoundingBoxes) {
+        decodeDracoMeshes(asset, pImpl->mEngine->getJobSystem());
+    }
 
     // Normalize skinning weights, then "import" each skin into the asset by building a mapping of
     // skins to their affected entities.
     if (gltf->skins_count > 0) {
-        if (pImpl->mNormalizeSkinningWeights) {
+        if (normalizeWeights) {
             normalizeSkinningWeights(asset);
         }
         if (asset->mInstances.empty()) {
@@ -402,45 +523,19 @@ bool ResourceLoader::loadResources(FFilamentAsset* asset, bool async) {
         updateBoundingBoxes(asset);
     }
 
-    Engine& engine = *pImpl->mEngine;
-
-    // Upload VertexBuffer and IndexBuffer data to the GPU.
-    for (auto slot : asset->mBufferSlots) {
-        const cgltf_accessor* accessor = slot.accessor;
-        if (!accessor->buffer_view) {
-            continue;
-        }
-        auto bufferData = (const uint8_t*) accessor->buffer_view->buffer->data;
-        const uint8_t* data = computeBindingOffset(accessor) + bufferData;
-        const uint32_t size = computeBindingSize(accessor);
-        if (slot.vertexBuffer) {
-            mPool->addPendingUpload();
-            VertexBuffer::BufferDescriptor bd(data, size, AssetPool::onLoadedResource, mPool);
-            slot.vertexBuffer->setBufferAt(engine, slot.bufferIndex, std::move(bd));
-            continue;
-        }
-        assert(slot.indexBuffer);
-        if (accessor->component_type == cgltf_component_type_r_8u) {
-            const size_t size16 = size * 2;
-            uint16_t* data16 = (uint16_t*) malloc(size16);
-            convertBytesToShorts(data16, data, size);
-            IndexBuffer::BufferDescriptor bd(data16, size16, FREE_CALLBACK);
-            slot.indexBuffer->setBuffer(engine, std::move(bd));
-            continue;
-        }
-        mPool->addPendingUpload();
-        IndexBuffer::BufferDescriptor bd(data, size, AssetPool::onLoadedResource, mPool);
-        slot.indexBuffer->setBuffer(engine, std::move(bd));
+    // Prepare the VertexBuffer and IndexBuffer data of each mesh on a job: Draco decoding, sparse
+    // data, 8-bit indices and surface orientation quaternions. Each mesh is uploaded as soon as its
+    // job is done. In asynchronous mode this happens in asyncUpdateLoad(), and its renderables can
+    // be shown before the rest of the asset is ready.
+    pImpl->createGeometryTasks(asset);
+    if (async) {
+        pImpl->runGeometryTasks(true);
+    } else {
+        pImpl->finishGeometry();
     }
 
-    // Apply sparse data modifications to base arrays, then upload the result.
-    applySparseData(asset);
-
-    // Compute surface orientation quaternions if necessary. This is similar to sparse data in that
-    // we need to generate the contents of a GPU buffer by processing one or more CPU buffer(s).
-    pImpl->computeTangents(asset);
-
-    // Non-textured renderables are now considered ready, so notify the dependency graph.
+    // Non-textured renderables are now considered ready once their geometry is uploaded, so notify
+    // the dependency graph.
     asset->mDependencyGraph.finalize();
     pImpl->mCurrentAsset = asset;
 
@@ -453,16 +548,19 @@ bool ResourceLoader::asyncBeginLoad(FilamentAsset* asset) {
 }
 
 void ResourceLoader::asyncCancelLoad() {
+    pImpl->cancelGeometry();
     pImpl->cancelTextureDecoding();
 }
 
 float ResourceLoader::asyncGetLoadProgress() const {
-    const float finished = pImpl->mNumDecoderTasksFinished;
-    const float total = pImpl->mNumDecoderTasks;
+    const float finished = pImpl->mNumDecoderTasksFinished + pImpl->mNumGeometryTasksFinished;
+    const float total = pImpl->mNumDecoderTasks + pImpl->mNumGeometryTasks;
     return total == 0 ? 0 : finished / total;
 }
 
 void ResourceLoader::asyncUpdateLoad() {
+    pImpl->uploadGeometry(false);
+    pImpl->runGeometryTasks(true);
     if (!UTILS_HAS_THREADING) {
         pImpl->decodeSingleTexture();
     }
@@ -692,6 +790,9 @@ bool ResourceLoader::Impl::createTextures(bool async) {
 
     JobSystem::Job* parent = js->createJob();
 
+    // Asynchronous decoding happens in the background, so it doesn't hold up rendering.
+    const uint32_t runFlags = async ? JobSystem::BACKGROUND : 0;
+
     // Kick off jobs that decode texels from buffer pointers.
     for (auto& pair : mBufferTextureCache) {
         const uint8_t* sourceData = (const uint8_t*) pair.first;
@@ -701,7 +802,7 @@ bool ResourceLoader::Impl::createTextures(bool async) {
             entry->texels = stbi_load_from_memory(sourceData, entry->bufferSize,
                     &width, &height, &comp, 4);
         });
-        js->run(decode);
+        js->run(decode, runFlags);
     }
 
     // Kick off jobs that decode texels from URI strings.
@@ -718,7 +819,7 @@ bool ResourceLoader::Impl::createTextures(bool async) {
                 entry->texels = stbi_load_from_memory(sourceData, iter->second.size, &width,
                         &height, &comp, 4);
             });
-            js->run(decode);
+            js->run(decode, runFlags);
             continue;
         }
 
@@ -732,12 +833,12 @@ bool ResourceLoader::Impl::createTextures(bool async) {
                 int width, height, comp;
                 entry->texels = stbi_load(fullpath.c_str(), &width, &height, &comp, 4);
             });
-            js->run(decode);
+            js->run(decode, runFlags);
         #endif
     }
 
     if (async) {
-        mDecoderRootJob = js->runAndRetain(parent);
+        mDecoderRootJob = js->runAndRetain(parent, runFlags);
         return true;
     }
 
@@ -751,212 +852,679 @@ bool ResourceLoader::Impl::createTextures(bool async) {
     return true;
 }
 
-void ResourceLoader::Impl::computeTangents(FFilamentAsset* asset) {
-    SYSTRACE_CALL();
+static constexpr int kMorphTargetUnused = -1;
 
-    const cgltf_accessor* kGenerateTangents = &asset->mGenerateTangents;
-    const cgltf_accessor* kGenerateNormals = &asset->mGenerateNormals;
-
-    struct JobParams {
-        // Consumed by the job:
-        const cgltf_primitive* prim;
-        VertexBuffer* const vb;
-        const uint8_t slot;
-        const int morphTargetIndex;
-        // Produced by the job:
-        cgltf_size vertexCount;
-        short4* results;
-    };
+using ComponentType = geometry::SurfaceOrientation::ComponentType;
 
-    constexpr int kMorphTargetUnused = -1;
-
-    auto computeQuats = [&](JobParams* params) {
-        const cgltf_primitive& prim = *params->prim;
-        const uint8_t slot = params->slot;
-        const int morphTargetIndex = params->morphTargetIndex;
-
-        // Declare vectors of normals and tangents, which we'll extract & convert from the source.
-        std::vector<float3> fp32Normals;
-        std::vector<float4> fp32Tangents;
-        std::vector<float3> fp32Positions;
-        std::vector<float2> fp32TexCoords;
-        std::vector<uint3> ui32Triangles;
-
-        cgltf_size vertexCount = 0;
-
-        // Build a mapping from cgltf_attribute_type to cgltf_accessor*.
-        const int NUM_ATTRIBUTES = 8;
-        const cgltf_accessor* accessors[NUM_ATTRIBUTES] = {};
-
-        // Collect accessors for normals, tangents, etc.
-        if (morphTargetIndex == kMorphTargetUnused) {
-            for (cgltf_size aindex = 0; aindex < prim.attributes_count; aindex++) {
-                const cgltf_attribute& attr = prim.attributes[aindex];
-                if (attr.index == 0) {
-                    accessors[attr.type] = attr.data;
-                    vertexCount = attr.data->count;
-                }
+// Returns true if the data of an accessor can be read in place, i.e. without unpacking it first.
+static bool isReadableInPlace(const cgltf_accessor* accessor) {
+    const cgltf_buffer_view* view = accessor->buffer_view;
+    return !accessor->is_sparse && view && view->buffer->data &&
+            accessor->offset + computeBindingSize(accessor) <= view->size;
+}
+
+static const uint8_t* getAccessorData(const cgltf_accessor* accessor) {
+    auto bufferData = (const uint8_t*) accessor->buffer_view->buffer->data;
+    return computeBindingOffset(accessor) + bufferData;
+}
+
+struct AttributeData {
+    const void* data;
+    ComponentType type;
+    bool normalized;
+    size_t stride;
+};
+
+// Gets the data of a vertex attribute in a form that SurfaceOrientation can read. The data is used
+// in place when possible, otherwise it is unpacked into the given vector.
+static AttributeData getAttributeData(const cgltf_accessor* accessor,
+        std::vector<float>& unpacked) {
+    if (isReadableInPlace(accessor)) {
+        const uint8_t* data = getAccessorData(accessor);
+        const size_t stride = accessor->stride;
+        const bool normalized = accessor->normalized;
+        switch (accessor->component_type) {
+            case cgltf_component_type_r_8:
+                return { data, ComponentType::BYTE, normalized, stride };
+            case cgltf_component_type_r_8u:
+                return { data, ComponentType::UBYTE, normalized, stride };
+            case cgltf_component_type_r_16:
+                return { data, ComponentType::SHORT, normalized, stride };
+            case cgltf_component_type_r_16u:
+                return { data, ComponentType::USHORT, normalized, stride };
+            case cgltf_component_type_r_32f:
+                return { data, ComponentType::FLOAT, false, stride };
+            default:
+                break;
+        }
+    }
+    const cgltf_size count = accessor->count * cgltf_num_components(accessor->type);
+    unpacked.resize(count);
+    cgltf_accessor_unpack_floats(accessor, unpacked.data(), count);
+    return { unpacked.data(), ComponentType::FLOAT, false, 0 };
+}
+
+// Computes the surface orientation quaternions of a primitive or of one of its morph targets.
+// Returns null if they cannot be computed, otherwise the result must be freed with free().
+//
+// The source data is read in place whenever possible, and large primitives are split across the
+// threads of the given JobSystem, in jobs that run with the given flags.
+static short4* computeQuats(const cgltf_primitive& prim, int morphTargetIndex, JobSystem* js,
+        uint32_t runFlags, cgltf_size* outVertexCount) {
+    // These only hold data that cannot be read in place, e.g. sparse accessors.
+    std::vector<float> unpackedNormals;
+    std::vector<float> unpackedTangents;
+    std::vector<float> unpackedPositions;
+    std::vector<float> unpackedTexCoords;
+    std::vector<uint3> ui32Triangles;
+
+    cgltf_size vertexCount = 0;
+
+    // Build a mapping from cgltf_attribute_type to cgltf_accessor*.
+    const int NUM_ATTRIBUTES = 8;
+    const cgltf_accessor* accessors[NUM_ATTRIBUTES] = {};
+
+    // Collect accessors for normals, tangents, etc.
+    if (morphTargetIndex == kMorphTargetUnused) {
+        for (cgltf_size aindex = 0; aindex < prim.attributes_count; aindex++) {
+            const cgltf_attribute& attr = prim.attributes[aindex];
+            if (attr.index == 0) {
+                accessors[attr.type] = attr.data;
+                vertexCount = attr.data->count;
+            }
+        }
+    } else {
+        const cgltf_morph_target& morphTarget = prim.targets[morphTargetIndex];
+        for (cgltf_size aindex = 0; aindex < morphTarget.attributes_count; aindex++) {
+            const cgltf_attribute& attr = prim.attributes[aindex];
+            if (attr.index == 0) {
+                accessors[attr.type] = attr.data;
+                vertexCount = attr.data->count;
             }
+        }
+    }
+    *outVertexCount = vertexCount;
+
+    // At a minimum we need normals to generate tangents.
+    auto normalsInfo = accessors[cgltf_attribute_type_normal];
+    if (vertexCount == 0) {
+        return nullptr;
+    }
+
+    geometry::SurfaceOrientation::Builder sob;
+    sob.vertexCount(vertexCount);
+    sob.jobSystem(js, runFlags);
+
+    if (normalsInfo) {
+        assert(normalsInfo->count == vertexCount);
+        assert(normalsInfo->type == cgltf_type_vec3);
+        AttributeData normals = getAttributeData(normalsInfo, unpackedNormals);
+        sob.normals(normals.data, normals.type, normals.normalized, normals.stride);
+    }
+
+    auto tangentsInfo = accessors[cgltf_attribute_type_tangent];
+    if (tangentsInfo) {
+        if (tangentsInfo->count != vertexCount || tangentsInfo->type != cgltf_type_vec4) {
+            slog.e << "Bad tangent count or type." << io::endl;
+            return nullptr;
+        }
+        AttributeData tangents = getAttributeData(tangentsInfo, unpackedTangents);
+        sob.tangents(tangents.data, tangents.type, tangents.normalized, tangents.stride);
+    }
+
+    auto positionsInfo = accessors[cgltf_attribute_type_position];
+    if (positionsInfo) {
+        if (positionsInfo->count != vertexCount || positionsInfo->type != cgltf_type_vec3) {
+            slog.e << "Bad position count or type." << io::endl;
+            return nullptr;
+        }
+        AttributeData positions = getAttributeData(positionsInfo, unpackedPositions);
+        sob.positions(positions.data, positions.type, positions.normalized, positions.stride);
+    }
+
+    // Tightly packed indices are read in place. Without indices, every three consecutive vertices
+    // form a triangle, which SurfaceOrientation handles when it is given no triangles.
+    const cgltf_accessor* indices = prim.indices;
+    if (indices) {
+        const size_t triangleCount = indices->count / 3;
+        const uint8_t* data = isReadableInPlace(indices) ? getAccessorData(indices) : nullptr;
+        const cgltf_component_type type = indices->component_type;
+        const cgltf_size stride = indices->stride;
+        if (data && type == cgltf_component_type_r_8u && stride == sizeof(uint8_t)) {
+            sob.triangles((const ubyte3*) data);
+        } else if (data && type == cgltf_component_type_r_16u && stride == sizeof(uint16_t)) {
+            sob.triangles((const ushort3*) data);
+        } else if (data && type == cgltf_component_type_r_32u && stride == sizeof(uint32_t)) {
+            sob.triangles((const uint3*) data);
         } else {
-            const cgltf_morph_target& morphTarget = prim.targets[morphTargetIndex];
-            for (cgltf_size aindex = 0; aindex < morphTarget.attributes_count; aindex++) {
-                const cgltf_attribute& attr = prim.attributes[aindex];
-                if (attr.index == 0) {
-                    accessors[attr.type] = attr.data;
-                    vertexCount = attr.data->count;
-                }
+            ui32Triangles.resize(triangleCount);
+            for (cgltf_size i = 0, j = 0; i < triangleCount; ++i) {
+                ui32Triangles[i].x = cgltf_accessor_read_index(indices, j++);
+                ui32Triangles[i].y = cgltf_accessor_read_index(indices, j++);
+                ui32Triangles[i].z = cgltf_accessor_read_index(indices, j++);
             }
+            sob.triangles(ui32Triangles.data());
         }
-        params->vertexCount = vertexCount;
+        sob.triangleCount(triangleCount);
+    } else {
+        sob.triangleCount(vertexCount / 3);
+    }
 
-        // At a minimum we need normals to generate tangents.
-        auto normalsInfo = accessors[cgltf_attribute_type_normal];
-        if (vertexCount == 0) {
-            return;
+    auto texcoordsInfo = accessors[cgltf_attribute_type_texcoord];
+    if (texcoordsInfo) {
+        if (texcoordsInfo->count != vertexCount || texcoordsInfo->type != cgltf_type_vec2) {
+            slog.e << "Bad texture coordinate count or type." << io::endl;
+            return nullptr;
         }
+        AttributeData texcoords = getAttributeData(texcoordsInfo, unpackedTexCoords);
+        sob.uvs(texcoords.data, texcoords.type, texcoords.normalized, texcoords.stride);
+    }
 
-        geometry::SurfaceOrientation::Builder sob;
-        sob.vertexCount(vertexCount);
+    // Compute surface orientation quaternions.
+    geometry::SurfaceOrientation* helper = sob.build();
+    if (!helper) {
+        return nullptr;
+    }
+    short4* results = (short4*) malloc(sizeof(short4) * vertexCount);
+    helper->getQuats(results, vertexCount);
+    delete helper;
+    return results;
+}
 
-        // Convert normals into packed floats.
-        if (normalsInfo) {
-            assert(normalsInfo->count == vertexCount);
-            assert(normalsInfo->type == cgltf_type_vec3);
-            fp32Normals.resize(vertexCount);
-            cgltf_accessor_unpack_floats(normalsInfo, &fp32Normals[0].x, vertexCount * 3);
-            sob.normals(fp32Normals.data());
+// Returns the primitive of a geometry task that uses the given vertex buffer.
+static const cgltf_primitive* findPrimitive(const GeometryTask& task, VertexBuffer* vb) {
+    for (auto pair : task.primitives) {
+        if (pair.second == vb) {
+            return pair.first;
         }
+    }
+    return nullptr;
+}
 
-        // Convert tangents into packed floats.
-        auto tangentsInfo = accessors[cgltf_attribute_type_tangent];
-        if (tangentsInfo) {
-            if (tangentsInfo->count != vertexCount || tangentsInfo->type != cgltf_type_vec4) {
-                slog.e << "Bad tangent count or type." << io::endl;
-                return;
+// Estimates the memory that a geometry task allocates until its data is uploaded.
+static size_t computeGeometrySize(const GeometryTask& task) {
+    const FFilamentAsset* asset = task.asset;
+    size_t size = 0;
+    for (const BufferSlot& slot : task.slots) {
+        const cgltf_accessor* accessor = slot.accessor;
+        if (accessor == &asset->mGenerateTangents || accessor == &asset->mGenerateNormals) {
+            const cgltf_primitive* prim = findPrimitive(task, slot.vertexBuffer);
+            if (prim && prim->attributes_count) {
+                size += prim->attributes[0].data->count * sizeof(short4);
             }
-            fp32Tangents.resize(vertexCount);
-            cgltf_accessor_unpack_floats(tangentsInfo, &fp32Tangents[0].x, vertexCount * 4);
-            sob.tangents(fp32Tangents.data());
+        } else if (accessor->is_sparse && !slot.indexBuffer) {
+            size += accessor->count * cgltf_num_components(accessor->type) * sizeof(float);
+        } else if (!accessor->buffer_view) {
+            // Draco data is decoded into a new buffer.
+            size += accessor->count * accessor->stride;
+        } else if (slot.indexBuffer && accessor->component_type == cgltf_component_type_r_8u) {
+            size += accessor->count * sizeof(uint16_t);
         }
+    }
+    return size;
+}
 
-        auto positionsInfo = accessors[cgltf_attribute_type_position];
-        if (positionsInfo) {
-            if (positionsInfo->count != vertexCount || positionsInfo->type != cgltf_type_vec3) {
-                slog.e << "Bad position count or type." << io::endl;
-                return;
-            }
-            fp32Positions.resize(vertexCount);
-            cgltf_accessor_unpack_floats(positionsInfo, &fp32Positions[0].x, vertexCount * 3);
-            sob.positions(fp32Positions.data());
+// Prepares the data of all the buffer slots of a geometry task, this runs on a job that was run
+// with the given flags.
+static void prepareGeometry(GeometryTask* task, uint32_t runFlags) {
+    SYSTRACE_CALL();
+    FFilamentAsset* asset = task->asset;
+
+    // Decompress Draco meshes first, this points their accessors to the decompressed data.
+    for (auto pair : task->primitives) {
+        if (pair.first->has_draco_mesh_compression) {
+            decodeDracoPrimitive(asset, pair.first);
         }
+    }
 
-        if (prim.indices) {
-            size_t triangleCount = prim.indices->count / 3;
-            ui32Triangles.resize(triangleCount);
-            cgltf_size j = 0;
-            for (auto& triangle : ui32Triangles) {
-                triangle.x = cgltf_accessor_read_index(prim.indices, j++);
-                triangle.y = cgltf_accessor_read_index(prim.indices, j++);
-                triangle.z = cgltf_accessor_read_index(prim.indices, j++);
-            }
-        } else {
-            size_t triangleCount = vertexCount / 3;
-            ui32Triangles.resize(triangleCount);
-            cgltf_size j = 0;
-            for (auto& triangle : ui32Triangles) {
-                triangle.x = j++;
-                triangle.y = j++;
-                triangle.z = j++;
+    for (const BufferSlot& slot : task->slots) {
+        const cgltf_accessor* accessor = slot.accessor;
+
+        // Compute surface orientation quaternions if necessary. This is similar to sparse data in
+        // that we need to generate the contents of a GPU buffer by processing one or more CPU
+        // buffer(s).
+        if (accessor == &asset->mGenerateTangents || accessor == &asset->mGenerateNormals) {
+            const cgltf_primitive* prim = findPrimitive(*task, slot.vertexBuffer);
+            const int morphTargetIndex = slot.morphTarget ? slot.morphTarget - 1 :
+                    kMorphTargetUnused;
+            cgltf_size vertexCount = 0;
+            JobSystem* js = &asset->mEngine->getJobSystem();
+            short4* quats = prim ?
+                    computeQuats(*prim, morphTargetIndex, js, runFlags, &vertexCount) : nullptr;
+            if (quats) {
+                const uint32_t size = uint32_t(vertexCount * sizeof(short4));
+                task->uploads.push_back({ slot, quats, size, true });
             }
+            continue;
         }
 
-        sob.triangleCount(ui32Triangles.size());
-        sob.triangles(ui32Triangles.data());
+        // Apply sparse data modifications to base arrays.
+        if (accessor->is_sparse && !slot.indexBuffer) {
+            cgltf_size numFloats = accessor->count * cgltf_num_components(accessor->type);
+            cgltf_size numBytes = sizeof(float) * numFloats;
+            float* generated = (float*) malloc(numBytes);
+            cgltf_accessor_unpack_floats(accessor, generated, numFloats);
+            task->uploads.push_back({ slot, generated, uint32_t(numBytes), true });
+            continue;
+        }
 
-        auto texcoordsInfo = accessors[cgltf_attribute_type_texcoord];
-        if (texcoordsInfo) {
-            if (texcoordsInfo->count != vertexCount || texcoordsInfo->type != cgltf_type_vec2) {
-                slog.e << "Bad texture coordinate count or type." << io::endl;
-                return;
-            }
-            fp32TexCoords.resize(vertexCount);
-            cgltf_accessor_unpack_floats(texcoordsInfo, &fp32TexCoords[0].x, vertexCount * 2);
-            sob.uvs(fp32TexCoords.data());
+        if (!accessor->buffer_view) {
+            continue;
+        }
+        auto bufferData = (const uint8_t*) accessor->buffer_view->buffer->data;
+        const uint8_t* data = computeBindingOffset(accessor) + bufferData;
+        const uint32_t size = computeBindingSize(accessor);
+        if (slot.indexBuffer && accessor->component_type == cgltf_component_type_r_8u) {
+            const size_t size16 = size * 2;
+            uint16_t* data16 = (uint16_t*) malloc(size16);
+            convertBytesToShorts(data16, data, size);
+            task->uploads.push_back({ slot, data16, uint32_t(size16), true });
+            continue;
         }
+        task->uploads.push_back({ slot, data, size, false });
+    }
+}
+
+// Digests everything that determines the contents of the buffers of a primitive: the layout of its
+// vertex buffer and the data of all its accessors, which are also used to generate tangents.
+// Returns false if the primitive cannot be shared.
+static bool computeGeometryKey(const FFilamentAsset* asset, const cgltf_primitive* prim,
+        const CacheablePrimitive& info, const std::vector<BufferSlot>& slots,
+        GeometryCache::Key* key) {
+    utils::hash::Digest128 digest;
+    digest.update(info.uvmap);
+    for (const BufferSlot& slot : slots) {
+        const cgltf_accessor* accessor = slot.accessor;
+        const int kind = accessor == &asset->mGenerateTangents ? 1 :
+                accessor == &asset->mGenerateNormals ? 2 : 0;
+        digest.update(kind);
+        digest.update(slot.attribute);
+        digest.update(slot.bufferIndex);
+        digest.update(slot.morphTarget);
+        digest.update(slot.indexBuffer != nullptr);
+    }
 
-        // Compute surface orientation quaternions.
-        params->results = (short4*) malloc(sizeof(short4) * vertexCount);
-        geometry::SurfaceOrientation* helper = sob.build();
-        helper->getQuats(params->results, vertexCount);
-        delete helper;
+    // Draco accessors might not be decoded yet, the compressed data is digested instead.
+    const bool draco = prim->has_draco_mesh_compression;
+    auto addAccessor = [&digest, draco](const cgltf_accessor* accessor) {
+        if (!accessor) {
+            digest.update(-1);
+            return true;
+        }
+        digest.update(accessor->component_type);
+        digest.update(accessor->type);
+        digest.update(accessor->normalized);
+        digest.update(accessor->count);
+        digest.update(accessor->stride);
+        if (draco) {
+            return true;
+        }
+        const cgltf_buffer_view* view = accessor->buffer_view;
+        if (accessor->is_sparse || !view || !view->buffer->data) {
+            return false;
+        }
+        auto bufferData = (const uint8_t*) view->buffer->data;
+        digest.update(computeBindingOffset(accessor) + bufferData, computeBindingSize(accessor));
+        return true;
     };
 
-    // Collect all TANGENT vertex attribute slots that need to be populated.
-    tsl::robin_map<VertexBuffer*, uint8_t> baseTangents;
-    tsl::robin_map<VertexBuffer*, uint8_t> morphTangents[4];
-    for (auto slot : asset->mBufferSlots) {
-        if (slot.accessor != kGenerateTangents && slot.accessor != kGenerateNormals) {
+    if (!addAccessor(prim->indices)) {
+        return false;
+    }
+    for (cgltf_size i = 0; i < prim->attributes_count; i++) {
+        const cgltf_attribute& attribute = prim->attributes[i];
+        digest.update(attribute.type);
+        digest.update(attribute.index);
+        if (!addAccessor(attribute.data)) {
+            return false;
+        }
+    }
+    digest.update(prim->targets_count);
+    for (cgltf_size i = 0; i < prim->targets_count; i++) {
+        const cgltf_morph_target& target = prim->targets[i];
+        for (cgltf_size j = 0; j < target.attributes_count; j++) {
+            const cgltf_attribute& attribute = target.attributes[j];
+            digest.update(attribute.type);
+            digest.update(attribute.index);
+            if (!addAccessor(attribute.data)) {
+                return false;
+            }
+        }
+    }
+
+    if (draco) {
+        const cgltf_draco_mesh_compression& compression = prim->draco_mesh_compression;
+        const cgltf_buffer_view* view = compression.buffer_view;
+        if (!view || !view->buffer->data) {
+            return false;
+        }
+        digest.update(view->offset + (const uint8_t*) view->buffer->data, view->size);
+        for (cgltf_size i = 0; i < compression.attributes_count; i++) {
+            const cgltf_attribute& attribute = compression.attributes[i];
+            // In cgltf, each Draco attribute's data pointer is an attribute id, not an accessor.
+            const cgltf_size id = attribute.data - asset->mSourceAsset->accessors;
+            digest.update(attribute.type);
+            digest.update(attribute.index);
+            digest.update(id);
+        }
+    }
+
+    *key = digest.finish();
+    return true;
+}
+
+// Computes the size of the data that is uploaded to the buffers of a primitive by the geometry
+// tasks, this does not include the data uploaded by AssetLoader.
+static size_t computeSharedGeometrySize(const FFilamentAsset* asset, const cgltf_primitive* prim,
+        const std::vector<BufferSlot>& slots) {
+    size_t size = 0;
+    for (const BufferSlot& slot : slots) {
+        const cgltf_accessor* accessor = slot.accessor;
+        if (accessor == &asset->mGenerateTangents || accessor == &asset->mGenerateNormals) {
+            size += prim->attributes_count ? prim->attributes[0].data->count * sizeof(short4) : 0;
+        } else if (slot.indexBuffer && accessor->component_type == cgltf_component_type_r_8u) {
+            size += accessor->count * sizeof(uint16_t);
+        } else {
+            size += accessor->count * accessor->stride;
+        }
+    }
+    return size;
+}
+
+void ResourceLoader::Impl::shareGeometry(FFilamentAsset* asset) {
+    GeometryCache* cache = asset->mGeometryCache;
+    if (!cache) {
+        return;
+    }
+
+    // Gather the buffer slots of each primitive.
+    tsl::robin_map<VertexBuffer*, std::vector<BufferSlot>> primitiveSlots;
+    for (const BufferSlot& slot : asset->mBufferSlots) {
+        primitiveSlots[slot.vertexBuffer].push_back(slot);
+    }
+
+    // Look up each primitive in the cache, the ones that are found get their buffers replaced.
+    struct Replacement {
+        VertexBuffer* vertices;
+        IndexBuffer* indices;
+    };
+    tsl::robin_map<const cgltf_primitive*, Replacement> replacements;
+    tsl::robin_set<VertexBuffer*> replacedVertexBuffers;
+    tsl::robin_set<IndexBuffer*> replacedIndexBuffers;
+    tsl::robin_set<VertexBuffer*> addedVertexBuffers;
+    for (auto pair : asset->mPrimitives) {
+        const cgltf_primitive* prim = pair.first;
+        VertexBuffer* vertices = pair.second;
+        auto iter = asset->mCacheablePrimitives.find(vertices);
+        if (iter == asset->mCacheablePrimitives.end()) {
             continue;
         }
-        if (slot.morphTarget) {
-            morphTangents[slot.morphTarget - 1][slot.vertexBuffer] = slot.bufferIndex;
+        const CacheablePrimitive& info = iter->second;
+        const std::vector<BufferSlot>& slots = primitiveSlots[vertices];
+        GeometryCache::Key key;
+        if (!computeGeometryKey(asset, prim, info, slots, &key)) {
             continue;
         }
-        baseTangents[slot.vertexBuffer] = slot.bufferIndex;
+        Replacement replacement;
+        if (!cache->acquire(key, asset, &replacement.vertices, &replacement.indices)) {
+            const size_t size = computeSharedGeometrySize(asset, prim, slots);
+            if (cache->add(key, asset, vertices, info.indices, size)) {
+                addedVertexBuffers.insert(vertices);
+            }
+            continue;
+        }
+        replacements[prim] = replacement;
+        replacedVertexBuffers.insert(vertices);
+        replacedIndexBuffers.insert(info.indices);
+
+        // The entities now wait for the shared buffer if it belongs to this asset, otherwise it
+        // has already been uploaded, see GeometryCache::acquire().
+        if (addedVertexBuffers.find(replacement.vertices) != addedVertexBuffers.end()) {
+            asset->mDependencyGraph.replace(vertices, replacement.vertices);
+        } else {
+            asset->mDependencyGraph.markAsReady(vertices);
+        }
+    }
+    if (replacements.empty()) {
+        return;
     }
 
-    // Create a job description for each primitive.
-    std::vector<JobParams> jobParams;
-    for (auto pair : asset->mPrimitives) {
-        VertexBuffer* vb = pair.second;
-        auto iter = baseTangents.find(vb);
-        if (iter != baseTangents.end()) {
-            jobParams.emplace_back(JobParams { pair.first, vb, iter->second, kMorphTargetUnused });
-        }
-        for (int morphTarget = 0; morphTarget < 4; morphTarget++) {
-            const auto& tangents = morphTangents[morphTarget];
-            auto iter = tangents.find(vb);
-            if (iter != tangents.end()) {
-                jobParams.emplace_back(JobParams { pair.first, vb, iter->second, morphTarget });
+    // Point the renderables to the shared buffers. Primitives are shared between the renderables
+    // of a glTF mesh, see the MeshCache in AssetLoader.
+    RenderableManager& rm = mEngine->getRenderableManager();
+    auto updateRenderables = [&rm, &replacements](const NodeMap& nodeMap) {
+        for (auto pair : nodeMap) {
+            const cgltf_mesh* mesh = pair.first->mesh;
+            if (!mesh) {
+                continue;
+            }
+            auto renderable = rm.getInstance(pair.second);
+            for (cgltf_size index = 0; index < mesh->primitives_count; ++index) {
+                const cgltf_primitive* prim = &mesh->primitives[index];
+                auto iter = replacements.find(prim);
+                RenderableManager::PrimitiveType type;
+                if (iter == replacements.end() || !getPrimitiveType(prim->type, &type)) {
+                    continue;
+                }
+                IndexBuffer* indices = iter->second.indices;
+                rm.setGeometryAt(renderable, index, type, iter->second.vertices, indices, 0,
+                        indices->getIndexCount());
             }
         }
+    };
+    if (asset->mInstances.empty()) {
+        updateRenderables(asset->mNodeMap);
+    }
+    for (FFilamentInstance* instance : asset->mInstances) {
+        updateRenderables(instance->nodeMap);
+    }
+
+    // Nothing is uploaded to the replaced primitives, destroy their buffers and hold a reference
+    // to the shared ones instead.
+    auto isReplaced = [&](const BufferSlot& slot) {
+        return replacedVertexBuffers.find(slot.vertexBuffer) != replacedVertexBuffers.end();
+    };
+    auto& slots = asset->mBufferSlots;
+    slots.erase(std::remove_if(slots.begin(), slots.end(), isReplaced), slots.end());
+
+    auto& primitives = asset->mPrimitives;
+    primitives.erase(std::remove_if(primitives.begin(), primitives.end(),
+            [&replacements](const std::pair<const cgltf_primitive*, VertexBuffer*>& pair) {
+                return replacements.find(pair.first) != replacements.end();
+            }), primitives.end());
+
+    auto& vertexBuffers = asset->mVertexBuffers;
+    vertexBuffers.erase(std::remove_if(vertexBuffers.begin(), vertexBuffers.end(),
+            [&](VertexBuffer* vb) {
+                return replacedVertexBuffers.find(vb) != replacedVertexBuffers.end();
+            }), vertexBuffers.end());
+
+    auto& indexBuffers = asset->mIndexBuffers;
+    indexBuffers.erase(std::remove_if(indexBuffers.begin(), indexBuffers.end(),
+            [&](IndexBuffer* ib) {
+                return replacedIndexBuffers.find(ib) != replacedIndexBuffers.end();
+            }), indexBuffers.end());
+
+    for (VertexBuffer* vb : replacedVertexBuffers) {
+        mEngine->destroy(vb);
+    }
+    for (IndexBuffer* ib : replacedIndexBuffers) {
+        mEngine->destroy(ib);
+    }
+    for (auto pair : replacements) {
+        vertexBuffers.push_back(pair.second.vertices);
+        indexBuffers.push_back(pair.second.indices);
+    }
+}
+
+void ResourceLoader::Impl::createGeometryTasks(FFilamentAsset* asset) {
+    // If the previous asset is still being loaded, finish its geometry first. This also ensures
+    // that the primitives it added to the geometry cache are uploaded before they are shared.
+    finishGeometry();
+    mNumGeometryTasksFinished = 0;
+
+    shareGeometry(asset);
+
+    // Group the primitives by glTF mesh, in the order in which they were created.
+    const cgltf_data* gltf = asset->mSourceAsset;
+    tsl::robin_map<const cgltf_primitive*, const cgltf_mesh*> meshes;
+    for (cgltf_size i = 0; i < gltf->meshes_count; ++i) {
+        const cgltf_mesh& mesh = gltf->meshes[i];
+        for (cgltf_size j = 0; j < mesh.primitives_count; ++j) {
+            meshes[&mesh.primitives[j]] = &mesh;
+        }
+    }
+    tsl::robin_map<const cgltf_mesh*, GeometryTask*> meshTasks;
+    tsl::robin_map<VertexBuffer*, GeometryTask*> vertexBufferTasks;
+    for (auto pair : asset->mPrimitives) {
+        GeometryTask*& task = meshTasks[meshes[pair.first]];
+        if (!task) {
+            mGeometryTasks.emplace_back(new GeometryTask {});
+            task = mGeometryTasks.back().get();
+            task->asset = asset;
+        }
+        task->primitives.push_back(pair);
+        vertexBufferTasks[pair.second] = task;
+    }
+
+    // All the buffer slots of a primitive refer to its vertex buffer, see createPrimitive(). The
+    // slots of the primitives that could not be created have none.
+    for (const BufferSlot& slot : asset->mBufferSlots) {
+        auto iter = vertexBufferTasks.find(slot.vertexBuffer);
+        if (iter != vertexBufferTasks.end()) {
+            iter->second->slots.push_back(slot);
+        }
+    }
+
+    for (auto& task : mGeometryTasks) {
+        task->size = computeGeometrySize(*task);
     }
+    mNumGeometryTasks = int(mGeometryTasks.size());
+}
 
-    // Kick off jobs for computing tangent frames.
+void ResourceLoader::Impl::runGeometryTasks(bool async) {
     JobSystem* js = &mEngine->getJobSystem();
-    JobSystem::Job* parent = js->createJob();
-    for (JobParams& params : jobParams) {
-        JobParams* pptr = &params;
-        js->run(jobs::createJob(*js, parent, [pptr, computeQuats] { computeQuats(pptr); }));
+    const uint32_t runFlags = async ? JobSystem::BACKGROUND : 0;
+    while (mNextGeometryTask < mGeometryTasks.size()) {
+        GeometryTask* task = mGeometryTasks[mNextGeometryTask].get();
+
+        // Stay within the memory budget, but always let at least one task run.
+        const bool idle = mFirstPendingGeometryTask == mNextGeometryTask;
+        if (mMaxPendingGeometrySize && !idle &&
+                mPendingGeometrySize + task->size > mMaxPendingGeometrySize) {
+            break;
+        }
+        mPendingGeometrySize += task->size;
+        mNextGeometryTask++;
+
+        // Without threads, asynchronous loading prepares one mesh per asyncUpdateLoad().
+        if (!UTILS_HAS_THREADING && async) {
+            prepareGeometry(task, runFlags);
+            task->ready = true;
+            break;
+        }
+
+        JobSystem::Job* job = jobs::createJob(*js, nullptr, [task, runFlags] {
+            prepareGeometry(task, runFlags);
+            task->ready.store(true, std::memory_order_release);
+        });
+        task->job = js->runAndRetain(job, runFlags);
     }
-    js->runAndWait(parent);
+}
 
-    // Finally, upload quaternions to the GPU from the main thread.
-    for (JobParams& params : jobParams) {
-        VertexBuffer::BufferDescriptor bd(params.results, params.vertexCount * sizeof(short4),
-                FREE_CALLBACK);
-        params.vb->setBufferAt(*mEngine, params.slot, std::move(bd));
+void ResourceLoader::Impl::uploadGeometry(bool wait) {
+    for (size_t i = mFirstPendingGeometryTask; i < mNextGeometryTask; ++i) {
+        GeometryTask* task = mGeometryTasks[i].get();
+        if (!task->uploaded && (wait || task->ready.load(std::memory_order_acquire))) {
+            uploadGeometry(task);
+        }
+    }
+    while (mFirstPendingGeometryTask < mNextGeometryTask &&
+            mGeometryTasks[mFirstPendingGeometryTask]->uploaded) {
+        mFirstPendingGeometryTask++;
+    }
+    if (mFirstPendingGeometryTask == mGeometryTasks.size()) {
+        mGeometryTasks.clear();
+        mNextGeometryTask = 0;
+        mFirstPendingGeometryTask = 0;
     }
 }
 
-ResourceLoader::Impl::~Impl() {
-    if (mDecoderRootJob) {
-        mEngine->getJobSystem().waitAndRelease(mDecoderRootJob);
+void ResourceLoader::Impl::uploadGeometry(GeometryTask* task) {
+    if (task->job) {
+        mEngine->getJobSystem().waitAndRelease(task->job);
+    }
+    Engine& engine = *mEngine;
+    for (const GeometryUpload& upload : task->uploads) {
+        const BufferSlot& slot = upload.slot;
+        BufferDescriptor bd;
+        if (upload.generated) {
+            bd = BufferDescriptor(upload.data, upload.size, FREE_CALLBACK);
+        } else {
+            mPool->addPendingUpload();
+            bd = BufferDescriptor(upload.data, upload.size, AssetPool::onLoadedResource, mPool);
+        }
+        if (slot.indexBuffer) {
+            slot.indexBuffer->setBuffer(engine, std::move(bd));
+        } else {
+            slot.vertexBuffer->setBufferAt(engine, slot.bufferIndex, std::move(bd));
+        }
+    }
+    GeometryCache* cache = task->asset->mGeometryCache;
+    for (auto pair : task->primitives) {
+        task->asset->mDependencyGraph.markAsReady(pair.second);
+        if (cache) {
+            cache->markAsUploaded(pair.second);
+        }
     }
+    task->uploads = {};
+    task->uploaded = true;
+    mPendingGeometrySize -= task->size;
+    mNumGeometryTasksFinished++;
 }
 
-void ResourceLoader::applySparseData(FFilamentAsset* asset) const {
-    for (auto slot : asset->mBufferSlots) {
-        const cgltf_accessor* accessor = slot.accessor;
-        if (!accessor->is_sparse) {
+void ResourceLoader::Impl::finishGeometry() {
+    while (!mGeometryTasks.empty()) {
+        runGeometryTasks(false);
+        uploadGeometry(true);
+    }
+}
+
+void ResourceLoader::Impl::cancelGeometry() {
+    for (size_t i = mFirstPendingGeometryTask; i < mGeometryTasks.size(); ++i) {
+        GeometryTask* task = mGeometryTasks[i].get();
+        if (task->job) {
+            mEngine->getJobSystem().waitAndRelease(task->job);
+        }
+        if (task->uploaded) {
             continue;
         }
-        cgltf_size numFloats = accessor->count * cgltf_num_components(accessor->type);
-        cgltf_size numBytes = sizeof(float) * numFloats;
-        float* generated = (float*) malloc(numBytes);
-        cgltf_accessor_unpack_floats(accessor, generated, numFloats);
-        VertexBuffer::BufferDescriptor bd(generated, numBytes, FREE_CALLBACK);
-        slot.vertexBuffer->setBufferAt(*pImpl->mEngine, slot.bufferIndex, std::move(bd));
+        // Normally the ownership of the generated data is transferred to BufferDescriptor, but
+        // if uploads have been cancelled then we need to free it explicitly.
+        for (const GeometryUpload& upload : task->uploads) {
+            if (upload.generated) {
+                free((void*) upload.data);
+            }
+        }
+        // The buffers of these primitives will stay empty, they must not be shared.
+        if (GeometryCache* cache = task->asset->mGeometryCache) {
+            for (auto pair : task->primitives) {
+                cache->evict(pair.second);
+            }
+        }
+    }
+    mGeometryTasks.clear();
+    mNextGeometryTask = 0;
+    mFirstPendingGeometryTask = 0;
+    mPendingGeometrySize = 0;
+    mNumGeometryTasks = 0;
+    mNumGeometryTasksFinished = 0;
+}
+
+ResourceLoader::Impl::~Impl() {
+    cancelGeometry();
+    if (mDecoderRootJob) {
+        mEngine->getJobSystem().waitAndRelease(mDecoderRootJob);
     }
 }
 
@@ -0,0 +1,705 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gltfio/Animator.h>
+#include <gltfio/AssetLoader.h>
+#include <gltfio/FilamentAsset.h>
+#include <gltfio/MaterialProvider.h>
+#include <gltfio/ResourceLoader.h>
+
+#include "FFilamentAsset.h"
+#include "GeometryCache.h"
+#include "MappedFile.h"
+
+#include <filament/Engine.h>
+#include <filament/TransformManager.h>
+
+#include <utils/EntityManager.h>
+#include <utils/NameComponentManager.h>
+#include <utils/Path.h>
+
+#include <math/mat4.h>
+#include <math/quat.h>
+#include <math/vec3.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace gltfio;
+using namespace utils;
+
+// An animation of two nodes. Node A has linear translation and rotation channels sharing their
+// keyframe times. Node B has a step scale channel, with different keyframe times.
+static const char* const ANIMATED_GLTF = R"({
+    "asset": { "version": "2.0" },
+    "scene": 0,
+    "scenes": [ { "nodes": [ 0, 1 ] } ],
+    "nodes": [ { "name": "A" }, { "name": "B", "translation": [ 0, 1, 0 ] } ],
+    "buffers": [ { "byteLength": 176 } ],
+    "bufferViews": [
+        { "buffer": 0, "byteOffset": 0, "byteLength": 128 },
+        { "buffer": 0, "byteOffset": 128, "byteLength": 48 }
+    ],
+    "accessors": [
+        { "bufferView": 0, "byteOffset": 0, "componentType": 5126, "count": 4, "type": "SCALAR",
+          "min": [ 0 ], "max": [ 3 ] },
+        { "bufferView": 0, "byteOffset": 16, "componentType": 5126, "count": 4, "type": "VEC3" },
+        { "bufferView": 0, "byteOffset": 64, "componentType": 5126, "count": 4, "type": "VEC4" },
+        { "bufferView": 1, "byteOffset": 0, "componentType": 5126, "count": 3, "type": "SCALAR",
+          "min": [ 0 ], "max": [ 2 ] },
+        { "bufferView": 1, "byteOffset": 12, "componentType": 5126, "count": 3, "type": "VEC3" }
+    ],
+    "animations": [ {
+        "name": "anim",
+        "samplers": [
+            { "input": 0, "output": 1 },
+            { "input": 0, "output": 2 },
+            { "input": 3, "output": 4, "interpolation": "STEP" }
+        ],
+        "channels": [
+            { "sampler": 0, "target": { "node": 0, "path": "translation" } },
+            { "sampler": 1, "target": { "node": 0, "path": "rotation" } },
+            { "sampler": 2, "target": { "node": 1, "path": "scale" } }
+        ]
+    } ]
+})";
+
+static const float TIMES[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+static const float3 TRANSLATIONS[4] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 2, 0 }, { 0, 0, 5 } };
+static const float ROTATIONS[4][4] = {            // x, y, z, w
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+        { 0.0f, 0.0f, 0.70710678f, 0.70710678f },
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.70710678f, 0.0f, 0.0f, 0.70710678f } };
+static const float SCALE_TIMES[3] = { 0.0f, 0.5f, 2.0f };
+static const float3 SCALES[3] = { { 1, 1, 1 }, { 2, 2, 2 }, { 1, 3, 1 } };
+
+// Wraps a glTF and its buffer into a GLB.
+static std::vector<uint8_t> createGlb(std::string json, std::vector<uint8_t> bin) {
+    json.resize((json.size() + 3) & ~3u, ' ');
+    bin.resize((bin.size() + 3) & ~3u, 0);
+
+    std::vector<uint8_t> glb;
+    auto appendWord = [&glb](uint32_t word) {
+        glb.insert(glb.end(), (const uint8_t*) &word, (const uint8_t*) &word + 4);
+    };
+    appendWord(0x46546C67);     // "glTF"
+    appendWord(2);
+    appendWord(uint32_t(12 + 8 + json.size() + 8 + bin.size()));
+    appendWord(uint32_t(json.size()));
+    appendWord(0x4E4F534A);     // "JSON"
+    glb.insert(glb.end(), json.begin(), json.end());
+    appendWord(uint32_t(bin.size()));
+    appendWord(0x004E4942);     // "BIN"
+    glb.insert(glb.end(), bin.begin(), bin.end());
+    return glb;
+}
+
+// Wraps the animated glTF above and its buffer into a GLB.
+static std::vector<uint8_t> createAnimatedGlb() {
+    std::vector<uint8_t> bin;
+    auto append = [&bin](const void* data, size_t size) {
+        const uint8_t* bytes = (const uint8_t*) data;
+        bin.insert(bin.end(), bytes, bytes + size);
+    };
+    append(TIMES, sizeof(TIMES));
+    append(TRANSLATIONS, sizeof(TRANSLATIONS));
+    append(ROTATIONS, sizeof(ROTATIONS));
+    append(SCALE_TIMES, sizeof(SCALE_TIMES));
+    append(SCALES, sizeof(SCALES));
+    EXPECT_EQ(176u, bin.size());
+    return createGlb(ANIMATED_GLTF, bin);
+}
+
+// Finds the keyframes around 'time' and the interpolant between them, the way the Animator
+// always did, with a binary search.
+static void findKeyframes(const float* times, size_t count, float time,
+        size_t* prev, size_t* next, float* t) {
+    const size_t i = std::lower_bound(times, times + count, time) - times;
+    *t = 0.0f;
+    if (i == count) {
+        *prev = *next = count - 1;
+    } else if (i == 0) {
+        *prev = *next = 0;
+    } else {
+        *prev = i - 1;
+        *next = i;
+        *t = (time - times[i - 1]) / (times[i] - times[i - 1]);
+    }
+}
+
+class AnimatorTest : public testing::Test {
+protected:
+    void SetUp() override {
+        engine = Engine::create(Engine::Backend::NOOP);
+        names = new NameComponentManager(EntityManager::get());
+        materials = createUbershaderLoader(engine);
+        loader = AssetLoader::create({ engine, materials, names });
+
+        const std::vector<uint8_t> glb = createAnimatedGlb();
+        asset = loader->createAssetFromBinary(glb.data(), uint32_t(glb.size()));
+        ASSERT_NE(nullptr, asset);
+
+        ResourceConfiguration configuration = {};
+        configuration.engine = engine;
+        ResourceLoader resourceLoader(configuration);
+        ASSERT_TRUE(resourceLoader.loadResources(asset));
+
+        animator = asset->getAnimator();
+        nodeA = asset->getFirstEntityByName("A");
+        nodeB = asset->getFirstEntityByName("B");
+        ASSERT_FALSE(nodeA.isNull());
+        ASSERT_FALSE(nodeB.isNull());
+    }
+
+    void TearDown() override {
+        loader->destroyAsset(asset);
+        materials->destroyMaterials();
+        delete materials;
+        AssetLoader::destroy(&loader);
+        delete names;
+        Engine::destroy(&engine);
+    }
+
+    mat4f getTransform(Entity entity) {
+        TransformManager& tcm = engine->getTransformManager();
+        return tcm.getTransform(tcm.getInstance(entity));
+    }
+
+    // Checks the transforms of both nodes at 'time', given the translation of node B.
+    void expectTransformsAt(float time, float3 translationB = { 0, 1, 0 }) {
+        time = std::fmod(time, TIMES[3]);
+        expectTransformOfA(nodeA, time);
+
+        size_t prev, next;
+        float t;
+        findKeyframes(SCALE_TIMES, 3, time, &prev, &next, &t);
+        expectNear(mat4f::translation(translationB) * mat4f::scaling(SCALES[prev]),
+                getTransform(nodeB), time);
+    }
+
+    // Checks the transform of an instance of node A at 'time'.
+    void expectTransformOfA(Entity entity, float time) {
+        size_t prev, next;
+        float t;
+        findKeyframes(TIMES, 4, time, &prev, &next, &t);
+        const float3 translation = (1 - t) * TRANSLATIONS[prev] + t * TRANSLATIONS[next];
+        const quatf rotation = slerp(*(const quatf*) ROTATIONS[prev],
+                *(const quatf*) ROTATIONS[next], t);
+        expectNear(mat4f::translation(translation) * mat4f(rotation), getTransform(entity), time);
+    }
+
+    static void expectNear(mat4f const& expected, mat4f const& actual, float time) {
+        for (size_t c = 0; c < 4; c++) {
+            for (size_t r = 0; r < 4; r++) {
+                EXPECT_NEAR(expected[c][r], actual[c][r], 1e-5f)
+                        << "at time " << time << ", [" << c << "][" << r << "]";
+            }
+        }
+    }
+
+    Engine* engine = nullptr;
+    NameComponentManager* names = nullptr;
+    MaterialProvider* materials = nullptr;
+    AssetLoader* loader = nullptr;
+    FilamentAsset* asset = nullptr;
+    Animator* animator = nullptr;
+    Entity nodeA;
+    Entity nodeB;
+};
+
+TEST_F(AnimatorTest, Keyframes) {
+    ASSERT_EQ(1u, animator->getAnimationCount());
+    EXPECT_STREQ("anim", animator->getAnimationName(0));
+    EXPECT_EQ(3.0f, animator->getAnimationDuration(0));
+
+    // exactly on each keyframe, and between them
+    for (float time : { 0.0f, 0.25f, 0.5f, 1.0f, 1.5f, 2.0f, 2.75f, 2.999f }) {
+        animator->applyAnimation(0, time);
+        expectTransformsAt(time);
+    }
+}
+
+TEST_F(AnimatorTest, PlayForward) {
+    // small steps, as when playing, where the cursors move by at most one keyframe
+    for (int i = 0; i < 100; i++) {
+        const float time = float(i) * (1.0f / 30.0f);
+        animator->applyAnimation(0, time);
+        expectTransformsAt(time);
+    }
+}
+
+TEST_F(AnimatorTest, Seek) {
+    // large steps in both directions, where the cursors must be searched for
+    for (float time : { 2.5f, 0.1f, 2.9f, 1.2f, 1.2f, 0.0f, 2.1f, 0.6f, 0.4f }) {
+        animator->applyAnimation(0, time);
+        expectTransformsAt(time);
+    }
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> distribution(0.0f, 3.0f);
+    for (int i = 0; i < 200; i++) {
+        const float time = distribution(rng);
+        animator->applyAnimation(0, time);
+        expectTransformsAt(time);
+    }
+}
+
+TEST_F(AnimatorTest, Loop) {
+    // times past the duration wrap around, which moves the cursors back to the start
+    for (int i = 0; i < 200; i++) {
+        const float time = float(i) * 0.07f;
+        animator->applyAnimation(0, time);
+        expectTransformsAt(time);
+    }
+}
+
+TEST_F(AnimatorTest, PreservesClientTransforms) {
+    animator->applyAnimation(0, 0.25f);
+    expectTransformsAt(0.25f);
+
+    // node B's translation isn't animated, so it must survive the next evaluation
+    TransformManager& tcm = engine->getTransformManager();
+    tcm.setTransform(tcm.getInstance(nodeB), mat4f::translation(float3{ 5, 0, 0 }));
+    animator->applyAnimation(0, 1.5f);
+    expectTransformsAt(1.5f, { 5, 0, 0 });
+    animator->applyAnimation(0, 0.1f);
+    expectTransformsAt(0.1f, { 5, 0, 0 });
+}
+
+TEST_F(AnimatorTest, Instances) {
+    // enough instances for their channels to be evaluated in parallel
+    constexpr size_t INSTANCE_COUNT = 100;
+    const std::vector<uint8_t> glb = createAnimatedGlb();
+    std::vector<FilamentInstance*> instances(INSTANCE_COUNT);
+    FilamentAsset* instanced = loader->createInstancedAsset(glb.data(), uint32_t(glb.size()),
+            instances.data(), INSTANCE_COUNT);
+    ASSERT_NE(nullptr, instanced);
+
+    ResourceConfiguration configuration = {};
+    configuration.engine = engine;
+    ResourceLoader resourceLoader(configuration);
+    ASSERT_TRUE(resourceLoader.loadResources(instanced));
+
+    std::vector<Entity> nodes(INSTANCE_COUNT);
+    ASSERT_EQ(INSTANCE_COUNT,
+            instanced->getEntitiesByName("A", nodes.data(), INSTANCE_COUNT));
+
+    // the thread that created the engine is adopted by its JobSystem
+    Animator* instancedAnimator = instanced->getAnimator();
+    instancedAnimator->applyAnimation(0, 0.25f);
+    for (Entity node : nodes) {
+        expectTransformOfA(node, 0.25f);
+    }
+
+    // other threads can't run jobs and must evaluate the instances themselves
+    std::thread thread([instancedAnimator]() {
+        instancedAnimator->applyAnimation(0, 1.5f);
+    });
+    thread.join();
+    for (Entity node : nodes) {
+        expectTransformOfA(node, 1.5f);
+    }
+
+    loader->destroyAsset(instanced);
+}
+
+// A glTF with MESH_COUNT meshes, each instantiated by its own node, which share a triangle with
+// 8-bit indices. The buffer is embedded in the GLB unless a URI is given.
+static constexpr size_t MESH_COUNT = 8;
+
+static std::string createMeshesGltf(const char* bufferUri = nullptr) {
+    std::string meshes, nodes, sceneNodes;
+    for (size_t i = 0; i < MESH_COUNT; ++i) {
+        const char* separator = i ? "," : "";
+        meshes += separator;
+        meshes += R"({"primitives": [{"attributes": {"POSITION": 0}, "indices": 1}]})";
+        nodes += separator;
+        nodes += R"({"mesh": )" + std::to_string(i) + "}";
+        sceneNodes += separator + std::to_string(i);
+    }
+    const std::string uri = bufferUri ? std::string(R"("uri": ")") + bufferUri + "\", " : "";
+    return R"({
+        "asset": {"version": "2.0"},
+        "scene": 0,
+        "scenes": [{"nodes": [)" + sceneNodes + R"(]}],
+        "nodes": [)" + nodes + R"(],
+        "meshes": [)" + meshes + R"(],
+        "accessors": [
+            {"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3",
+                "min": [0, 0, 0], "max": [1, 1, 0]},
+            {"bufferView": 1, "componentType": 5121, "count": 3, "type": "SCALAR"}
+        ],
+        "bufferViews": [
+            {"buffer": 0, "byteOffset": 0, "byteLength": 36},
+            {"buffer": 0, "byteOffset": 36, "byteLength": 3}
+        ],
+        "buffers": [{)" + uri + R"("byteLength": 39}]
+    })";
+}
+
+static std::vector<uint8_t> createTriangleBin() {
+    const float3 positions[3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } };
+    const uint8_t indices[3] = { 0, 1, 2 };
+    std::vector<uint8_t> bin((const uint8_t*) positions, (const uint8_t*) (positions + 3));
+    bin.insert(bin.end(), indices, indices + 3);
+    return bin;
+}
+
+class ResourceLoaderTest : public testing::Test {
+protected:
+    void SetUp() override {
+        engine = Engine::create(Engine::Backend::NOOP);
+        names = new NameComponentManager(EntityManager::get());
+        materials = createUbershaderLoader(engine);
+        loader = AssetLoader::create({ engine, materials, names });
+    }
+
+    void TearDown() override {
+        materials->destroyMaterials();
+        delete materials;
+        AssetLoader::destroy(&loader);
+        delete names;
+        Engine::destroy(&engine);
+    }
+
+    FilamentAsset* createAsset() {
+        const std::vector<uint8_t> glb = createGlb(createMeshesGltf(), createTriangleBin());
+        return loader->createAssetFromBinary(glb.data(), uint32_t(glb.size()));
+    }
+
+    ResourceConfiguration getConfiguration(size_t maxPendingGeometrySize) const {
+        ResourceConfiguration configuration = {};
+        configuration.engine = engine;
+        configuration.maxPendingGeometrySize = maxPendingGeometrySize;
+        return configuration;
+    }
+
+    // Without textures, the progress counts texture decoding as a single finished task, and then
+    // one task per uploaded mesh.
+    static size_t getUploadedMeshCount(const ResourceLoader& resourceLoader) {
+        return size_t(std::lround(resourceLoader.asyncGetLoadProgress() * (MESH_COUNT + 1))) - 1;
+    }
+
+    // Updates the load the way an application does every frame, until all the meshes are uploaded
+    // or it took unreasonably long. The callback gets the number of uploaded meshes.
+    template<typename Callback>
+    static void updateLoad(ResourceLoader& resourceLoader, Callback callback) {
+        size_t uploaded = 0;
+        for (int frame = 0; frame < 10000 && uploaded < MESH_COUNT; ++frame) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            resourceLoader.asyncUpdateLoad();
+            uploaded = getUploadedMeshCount(resourceLoader);
+            callback(uploaded);
+        }
+        EXPECT_EQ(MESH_COUNT, uploaded);
+    }
+
+    Engine* engine;
+    NameComponentManager* names;
+    MaterialProvider* materials;
+    AssetLoader* loader;
+};
+
+TEST_F(ResourceLoaderTest, PopsRenderablesOnceUploaded) {
+    FilamentAsset* asset = createAsset();
+    ASSERT_NE(nullptr, asset);
+    {
+        ResourceLoader resourceLoader(getConfiguration(1));
+        ASSERT_TRUE(resourceLoader.asyncBeginLoad(asset));
+
+        // Nothing is uploaded before the first update.
+        EXPECT_EQ(0u, asset->popRenderables(nullptr, 0));
+
+        // Each mesh has a single renderable, which becomes ready when the mesh is uploaded.
+        size_t popped = 0;
+        updateLoad(resourceLoader, [&](size_t uploaded) {
+            while (asset->popRenderable()) {
+                popped++;
+            }
+            EXPECT_EQ(uploaded, popped);
+        });
+        EXPECT_EQ(MESH_COUNT, popped);
+    }
+    loader->destroyAsset(asset);
+}
+
+TEST_F(ResourceLoaderTest, GeometryBudget) {
+    FilamentAsset* asset = createAsset();
+    ASSERT_NE(nullptr, asset);
+    {
+        // Each mesh needs 6 bytes to widen its indices, so the meshes are prepared one at a time:
+        // the next one starts when the update uploads the previous one.
+        ResourceLoader resourceLoader(getConfiguration(1));
+        ASSERT_TRUE(resourceLoader.asyncBeginLoad(asset));
+        size_t previous = 0;
+        int updates = 0;
+        updateLoad(resourceLoader, [&](size_t uploaded) {
+            EXPECT_LE(uploaded, previous + 1);
+            previous = uploaded;
+            updates++;
+        });
+        EXPECT_GE(updates, int(MESH_COUNT));
+    }
+    loader->destroyAsset(asset);
+}
+
+TEST_F(ResourceLoaderTest, CancelLoad) {
+    FilamentAsset* cancelled = createAsset();
+    FilamentAsset* loaded = createAsset();
+    ASSERT_NE(nullptr, cancelled);
+    ASSERT_NE(nullptr, loaded);
+    {
+        ResourceLoader resourceLoader(getConfiguration(1));
+        ASSERT_TRUE(resourceLoader.asyncBeginLoad(cancelled));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        resourceLoader.asyncUpdateLoad();
+        resourceLoader.asyncCancelLoad();
+        EXPECT_EQ(0.0f, resourceLoader.asyncGetLoadProgress());
+        EXPECT_LE(cancelled->popRenderables(nullptr, 0), 1u);
+
+        // The loader can be used again.
+        ASSERT_TRUE(resourceLoader.loadResources(loaded));
+        EXPECT_EQ(MESH_COUNT, loaded->popRenderables(nullptr, 0));
+    }
+
+    // Once the loader is destroyed and the uploads it started are done, the assets hold the only
+    // references to their source data, so releasing it frees it.
+    engine->flushAndWait();
+    for (FilamentAsset* asset : { cancelled, loaded }) {
+        ASSERT_NE(nullptr, asset->getSourceAsset());
+        asset->releaseSourceData();
+        EXPECT_EQ(nullptr, asset->getSourceAsset());
+        loader->destroyAsset(asset);
+    }
+}
+
+// Loads files that are written to a new temporary directory, which is removed after the test.
+class MemoryMappedLoadTest : public ResourceLoaderTest {
+protected:
+    void SetUp() override {
+        ResourceLoaderTest::SetUp();
+        do {
+            dir = Path::getTemporaryDirectory() + ("gltfio_test_" + std::to_string(rand()));
+        } while (dir.exists());
+        ASSERT_TRUE(dir.mkdirRecursive());
+    }
+
+    void TearDown() override {
+        for (Path file : dir.listContents()) {
+            file.unlinkFile();
+        }
+        std::remove(dir.c_str());
+        ResourceLoaderTest::TearDown();
+    }
+
+    Path writeFile(const char* name, const void* data, size_t size) {
+        const Path path = dir + name;
+        FILE* file = fopen(path.c_str(), "wb");
+        EXPECT_NE(nullptr, file);
+        if (file) {
+            EXPECT_EQ(size, fwrite(data, 1, size, file));
+            fclose(file);
+        }
+        return path;
+    }
+
+    // Loads the asset with its buffers mapped, checks that they point into the given number of
+    // mappings, then destroys it. The mapped data must not be freed like data read by cgltf.
+    void loadMapped(const Path& path, size_t mappedFileCount) {
+        FilamentAsset* asset = loader->createAssetFromFile(path.c_str());
+        ASSERT_NE(nullptr, asset);
+        {
+            ResourceConfiguration configuration = getConfiguration(0);
+            configuration.gltfPath = path.c_str();
+            configuration.memoryMapBuffers = true;
+            ResourceLoader resourceLoader(configuration);
+            ASSERT_TRUE(resourceLoader.loadResources(asset));
+            EXPECT_EQ(MESH_COUNT, asset->popRenderables(nullptr, 0));
+
+            const FFilamentAsset* fasset = upcast(asset);
+            const cgltf_data* gltf = fasset->mSourceAsset;
+            EXPECT_EQ(mappedFileCount, fasset->mMappedFiles.size());
+            ASSERT_EQ(1u, gltf->buffers_count);
+            EXPECT_TRUE(std::any_of(fasset->mMappedFiles.begin(), fasset->mMappedFiles.end(),
+                    [gltf](const MappedFile& file) {
+                        return file.contains(gltf->buffers[0].data);
+                    }));
+        }
+        engine->flushAndWait();
+        asset->releaseSourceData();
+        EXPECT_EQ(nullptr, asset->getSourceAsset());
+        loader->destroyAsset(asset);
+    }
+
+    Path dir;
+};
+
+TEST_F(MemoryMappedLoadTest, Glb) {
+    const std::vector<uint8_t> glb = createGlb(createMeshesGltf(), createTriangleBin());
+    loadMapped(writeFile("meshes.glb", glb.data(), glb.size()), 1);
+}
+
+TEST_F(MemoryMappedLoadTest, ExternalBuffer) {
+    const std::vector<uint8_t> bin = createTriangleBin();
+    const std::string json = createMeshesGltf("meshes.bin");
+    writeFile("meshes.bin", bin.data(), bin.size());
+    loadMapped(writeFile("meshes.gltf", json.data(), json.size()), 2);
+}
+
+// The cache never dereferences the buffers, so these tests make do with fake ones.
+template<typename T>
+static T* fake(uintptr_t address) {
+    return reinterpret_cast<T*>(address);
+}
+
+static GeometryCache::Key makeKey(uint64_t value) {
+    utils::hash::Digest128 digest;
+    digest.update(value);
+    return digest.finish();
+}
+
+TEST(GeometryCacheTest, Acquire) {
+    GeometryCache cache;
+    const auto* assetA = fake<FFilamentAsset>(0x100);
+    const auto* assetB = fake<FFilamentAsset>(0x200);
+    VertexBuffer* vb = fake<VertexBuffer>(0x1000);
+    IndexBuffer* ib = fake<IndexBuffer>(0x2000);
+    VertexBuffer* vertices = nullptr;
+    IndexBuffer* indices = nullptr;
+
+    EXPECT_FALSE(cache.acquire(makeKey(1), assetA, &vertices, &indices));
+    EXPECT_TRUE(cache.add(makeKey(1), assetA, vb, ib, 64));
+    EXPECT_FALSE(cache.acquire(makeKey(2), assetA, &vertices, &indices));
+
+    // not uploaded yet, so only the asset that added the entry can share it
+    EXPECT_TRUE(cache.acquire(makeKey(1), assetA, &vertices, &indices));
+    EXPECT_EQ(vb, vertices);
+    EXPECT_EQ(ib, indices);
+    EXPECT_FALSE(cache.acquire(makeKey(1), assetB, &vertices, &indices));
+    EXPECT_EQ(64u, cache.getSavedSize());
+
+    cache.markAsUploaded(vb);
+    vertices = nullptr;
+    indices = nullptr;
+    EXPECT_TRUE(cache.acquire(makeKey(1), assetB, &vertices, &indices));
+    EXPECT_EQ(vb, vertices);
+    EXPECT_EQ(ib, indices);
+    EXPECT_EQ(128u, cache.getSavedSize());
+}
+
+TEST(GeometryCacheTest, Release) {
+    GeometryCache cache;
+    const auto* asset = fake<FFilamentAsset>(0x100);
+    VertexBuffer* vb = fake<VertexBuffer>(0x1000);
+    IndexBuffer* ib = fake<IndexBuffer>(0x2000);
+    VertexBuffer* vertices;
+    IndexBuffer* indices;
+
+    ASSERT_TRUE(cache.add(makeKey(1), asset, vb, ib, 64));
+    cache.markAsUploaded(vb);
+    ASSERT_TRUE(cache.acquire(makeKey(1), asset, &vertices, &indices));
+    ASSERT_TRUE(cache.acquire(makeKey(1), asset, &vertices, &indices));
+
+    // three references each, only the last release destroys the buffer
+    EXPECT_FALSE(cache.release(vb));
+    EXPECT_FALSE(cache.release(vb));
+    EXPECT_TRUE(cache.release(vb));
+    EXPECT_FALSE(cache.release(ib));
+    EXPECT_FALSE(cache.release(ib));
+    EXPECT_TRUE(cache.release(ib));
+
+    // the entry went away with its buffers
+    EXPECT_FALSE(cache.acquire(makeKey(1), asset, &vertices, &indices));
+    EXPECT_EQ(128u, cache.getSavedSize());
+
+    // buffers that aren't in the cache can always be destroyed
+    EXPECT_TRUE(cache.release(fake<VertexBuffer>(0x3000)));
+    EXPECT_TRUE(cache.release(fake<IndexBuffer>(0x4000)));
+}
+
+TEST(GeometryCacheTest, KeyTaken) {
+    GeometryCache cache;
+    const auto* assetA = fake<FFilamentAsset>(0x100);
+    const auto* assetB = fake<FFilamentAsset>(0x200);
+    VertexBuffer* vb = fake<VertexBuffer>(0x1000);
+    IndexBuffer* ib = fake<IndexBuffer>(0x2000);
+    VertexBuffer* vertices;
+    IndexBuffer* indices;
+
+    ASSERT_TRUE(cache.add(makeKey(1), assetA, vb, ib, 64));
+
+    // asset B missed the entry that A is still uploading, so its own buffers aren't shared
+    VertexBuffer* otherVb = fake<VertexBuffer>(0x3000);
+    IndexBuffer* otherIb = fake<IndexBuffer>(0x4000);
+    EXPECT_FALSE(cache.add(makeKey(1), assetB, otherVb, otherIb, 64));
+    EXPECT_TRUE(cache.release(otherVb));
+    EXPECT_TRUE(cache.release(otherIb));
+
+    // A's entry wasn't disturbed
+    EXPECT_TRUE(cache.acquire(makeKey(1), assetA, &vertices, &indices));
+    EXPECT_EQ(vb, vertices);
+    EXPECT_EQ(ib, indices);
+}
+
+TEST(GeometryCacheTest, Evict) {
+    GeometryCache cache;
+    const auto* asset = fake<FFilamentAsset>(0x100);
+    VertexBuffer* vb = fake<VertexBuffer>(0x1000);
+    IndexBuffer* ib = fake<IndexBuffer>(0x2000);
+    VertexBuffer* vertices;
+    IndexBuffer* indices;
+
+    ASSERT_TRUE(cache.add(makeKey(1), asset, vb, ib, 64));
+    ASSERT_TRUE(cache.acquire(makeKey(1), asset, &vertices, &indices));
+
+    // a cancelled upload, the entry can't be found anymore but its references are still counted
+    cache.evict(vb);
+    EXPECT_FALSE(cache.acquire(makeKey(1), asset, &vertices, &indices));
+    cache.markAsUploaded(vb);
+    EXPECT_FALSE(cache.acquire(makeKey(1), asset, &vertices, &indices));
+
+    // the key can be taken again, and releasing the old buffers doesn't affect the new entry
+    VertexBuffer* newVb = fake<VertexBuffer>(0x3000);
+    IndexBuffer* newIb = fake<IndexBuffer>(0x4000);
+    ASSERT_TRUE(cache.add(makeKey(1), asset, newVb, newIb, 64));
+    EXPECT_FALSE(cache.release(vb));
+    EXPECT_TRUE(cache.release(vb));
+    EXPECT_FALSE(cache.release(ib));
+    EXPECT_TRUE(cache.release(ib));
+    cache.evict(vb);
+
+    EXPECT_TRUE(cache.acquire(makeKey(1), asset, &vertices, &indices));
+    EXPECT_EQ(newVb, vertices);
+    EXPECT_EQ(newIb, indices);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 
 namespace utils {
 namespace hash {
@@ -68,6 +69,68 @@ inline void combine_fast(size_t& seed, const T& v) noexcept {
     seed ^= hasher(v) << 1u;
 }
 
+// A 128-bit digest made of two 64-bit multiplicative hashes with different bases and primes, which
+// consume 8 bytes at a time and are finalized with murmur3's mixer. It isn't cryptographic, but
+// it's good enough to identify contents that aren't adversarial, e.g. to cache what's derived
+// from them. Each update() pads its input to a whole word, so the result depends on how the input
+// is split between calls: always feed the same pieces in the same order.
+class Digest128 {
+public:
+    struct Value {
+        uint64_t hash[2];
+        bool operator==(const Value& rhs) const noexcept {
+            return hash[0] == rhs.hash[0] && hash[1] == rhs.hash[1];
+        }
+        bool operator!=(const Value& rhs) const noexcept {
+            return !operator==(rhs);
+        }
+    };
+
+    void update(const void* data, size_t size) noexcept {
+        const uint8_t* p = (const uint8_t*) data;
+        mSize += size;
+        for (; size >= 8; p += 8, size -= 8) {
+            uint64_t word;
+            memcpy(&word, p, 8);
+            consume(word);
+        }
+        if (size) {
+            uint64_t word = 0;
+            memcpy(&word, p, size);
+            consume(word);
+        }
+    }
+
+    template<typename T>
+    void update(const T& value) noexcept {
+        update(&value, sizeof(value));
+    }
+
+    Value finish() const noexcept {
+        // the total size disambiguates inputs that differ only by trailing zeros
+        return {{ mix(mHash[0] ^ mSize), mix(mHash[1] + mSize) }};
+    }
+
+private:
+    void consume(uint64_t word) noexcept {
+        mHash[0] = (mHash[0] ^ word) * 0x100000001b3ull;
+        mHash[1] = (mHash[1] ^ word) * 0x9e3779b97f4a7c15ull;
+        mHash[1] = (mHash[1] << 31u) | (mHash[1] >> 33u);
+    }
+
+    static uint64_t mix(uint64_t h) noexcept {
+        h ^= h >> 33u;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33u;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33u;
+        return h;
+    }
+
+    uint64_t mHash[2] = { 0xcbf29ce484222325ull, 0x84222325cbf29ce4ull };
+    uint64_t mSize = 0;
+};
+
 } // namespace hash
 } // namespace utils
 
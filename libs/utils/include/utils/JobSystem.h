@@ -39,10 +39,20 @@
 namespace utils {
 
 class JobSystem {
-    static constexpr size_t MAX_JOB_COUNT = 4096;
+    // Storage for MAX_JOB_COUNT jobs is reserved upfront, but jobs are made available
+    // JOB_POOL_GROWTH at a time, as they're needed.
+    static constexpr size_t MAX_JOB_COUNT = 16384;
+    static constexpr size_t JOB_POOL_GROWTH = 4096;
     static_assert(MAX_JOB_COUNT <= 0x7FFE, "MAX_JOB_COUNT must be <= 0x7FFE");
+    static_assert(MAX_JOB_COUNT % JOB_POOL_GROWTH == 0,
+            "MAX_JOB_COUNT must be a multiple of JOB_POOL_GROWTH");
     using WorkQueue = WorkStealingDequeue<uint16_t, MAX_JOB_COUNT>;
 
+    // Jobs run in one of two lanes, frame-critical jobs always run before background jobs.
+    static constexpr uint8_t LANE_CRITICAL = 0;
+    static constexpr uint8_t LANE_BACKGROUND = 1;
+    static constexpr size_t LANE_COUNT = 2;
+
 public:
     class Job;
 
@@ -72,7 +82,8 @@ public:
         uint16_t parent;                                        //  2 |  2
         std::atomic<uint16_t> runningJobCount = { 1 };          //  2 |  2
         mutable std::atomic<uint16_t> refCount = { 1 };         //  2 |  2
-                                                                //  6 |  2 (padding)
+        uint8_t lane = LANE_CRITICAL;                           //  1 |  1
+                                                                //  5 |  1 (padding)
                                                                 // 64 | 64
     };
 
@@ -88,6 +99,10 @@ public:
     // adopt more thread.
     void emancipate();
 
+    // Returns true if the current thread is part of the thread pool, either as one of its
+    // threads or adopted. Only such threads can run and wait for jobs.
+    bool isThreadAdopted() noexcept;
+
 
     // If a parent is not specified when creating a job, that job will automatically take the
     // root job as a parent.
@@ -250,13 +265,17 @@ public:
      * Add job to this thread's execution queue. It's reference will drop automatically.
      * Current thread must be owned by JobSystem's thread pool. See adopt().
      *
+     * Jobs are frame-critical by default, BACKGROUND jobs only run when there are no
+     * frame-critical jobs left to run. Jobs created with a background parent are background jobs
+     * as well. A frame-critical job shouldn't wait on background jobs.
+     *
      * The job can't be used after this call.
      */
-    enum runFlags { DONT_SIGNAL = 0x1 };
+    enum runFlags { DONT_SIGNAL = 0x1, BACKGROUND = 0x2 };
     void run(Job*& job, uint32_t flags = 0) noexcept;
     void run(Job*&& job, uint32_t flags = 0) noexcept { // allows run(createJob(...));
         Job* p = job;
-        run(p);
+        run(p, flags);
     }
 
     void signal() noexcept;
@@ -291,6 +310,13 @@ public:
         runAndWait(p);
     }
 
+    /*
+     * Runs the frame-critical jobs that are waiting, if any. Long background jobs should call
+     * this regularly so they don't hold up frame-critical work when all threads are busy.
+     * Current thread must be owned by JobSystem's thread pool. See adopt().
+     */
+    void yield() noexcept;
+
     // for debugging
     friend utils::io::ostream& operator << (utils::io::ostream& out, JobSystem const& js);
 
@@ -329,7 +355,7 @@ private:
 
     struct alignas(CACHELINE_SIZE) ThreadState {    // this causes 40-bytes padding
         // make sure storage is cache-line aligned
-        WorkQueue workQueue;
+        WorkQueue workQueues[LANE_COUNT];
 
         // these are not accessed by the worker threads
         alignas(CACHELINE_SIZE)     // this causes 56-bytes padding
@@ -354,10 +380,12 @@ private:
     void requestExit() noexcept;
     bool exitRequested() const noexcept;
     bool hasActiveJobs() const noexcept;
+    bool hasActiveJobs(uint8_t lane) const noexcept;
 
     void loop(ThreadState* state) noexcept;
-    bool execute(JobSystem::ThreadState& state) noexcept;
-    Job* steal(JobSystem::ThreadState& state) noexcept;
+    bool execute(JobSystem::ThreadState& state, bool criticalOnly = false) noexcept;
+    Job* steal(JobSystem::ThreadState& state, uint8_t lane) noexcept;
+    Job* growJobPool() noexcept;
     void finish(Job* job) noexcept;
 
     void put(WorkQueue& workQueue, Job* job) noexcept {
@@ -386,8 +414,11 @@ private:
     utils::Condition mWaiterCondition;
     uint32_t mWaiterCount = 0;
 
-    std::atomic<uint32_t> mActiveJobs = { 0 };
-    utils::Arena<utils::ThreadSafeObjectPoolAllocator<Job>, LockingPolicy::NoLock> mJobPool;
+    std::atomic<uint32_t> mActiveJobs[LANE_COUNT] = { 0, 0 };   // # of queued jobs per lane
+    Job* const mJobStorageBase;                         // Base for conversion to indices
+    utils::AtomicFreeList mFreeJobs;
+    uint32_t mJobPoolSize = JOB_POOL_GROWTH;            // # of jobs in use or in mFreeJobs
+    utils::SpinLock mJobPoolLock;                       // only taken to grow the pool
 
     template <typename T>
     using aligned_vector = std::vector<T, utils::STLAlignedAllocator<T>>;
@@ -402,7 +433,6 @@ private:
     aligned_vector<ThreadState> mThreadStates;          // actual data is stored offline
     std::atomic<bool> mExitRequested = { false };       // this one is almost never written
     std::atomic<uint16_t> mAdoptedThreads = { 0 };      // this one is almost never written
-    Job* const mJobStorageBase;                         // Base for conversion to indices
     uint16_t mThreadCount = 0;                          // total # of threads in the pool
     uint8_t mParallelSplitCount = 0;                    // # of split allowable in parallel_for
     Job* mRootJob = nullptr;
@@ -28,6 +28,9 @@
 namespace utils {
 namespace io {
 
+/*
+ * LogStream can be used from any thread, each thread formats its messages in its own buffer.
+ */
 class UTILS_PUBLIC LogStream : public ostream {
 public:
 
@@ -39,8 +42,24 @@ public:
 
     ostream& flush() noexcept override;
 
+    /*
+     * Appends the messages flushed by the calling thread, at any priority, to 'log' rather than
+     * writing them to the system log, until redirect() is called again. Passing nullptr restores
+     * the system log. Returns the previous redirection, so that it can be restored.
+     */
+    static std::string* redirect(std::string* log) noexcept;
+
 private:
+    struct ThreadBuffers {
+        Buffer buffers[4];
+    };
+
+    Buffer& getBuffer() noexcept override;
+
     Priority mPriority;
+
+    static UTILS_DECLARE_TLS(ThreadBuffers) sThreadBuffers;
+    static UTILS_DECLARE_TLS(std::string*) sRedirect;
 };
 
 } // namespace io
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_UTILS_SYSTRACERECORDER_H
+#define TNT_UTILS_SYSTRACERECORDER_H
+
+#include <utils/compiler.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+
+namespace io {
+class ostream;
+} // namespace io
+
+/**
+ * An in-process recorder of trace events, for platforms without a system tracer.
+ *
+ * When filament is built with FILAMENT_ENABLE_SYSTRACE_RECORDER (desktop Linux only), the
+ * SYSTRACE_ macros record their events here, and the recording can be exported in the Chrome
+ * trace event format, which can be opened with chrome://tracing or https://ui.perfetto.dev.
+ * Setting the UTILS_SYSTRACE_OUTPUT environment variable to a file name exports the recording
+ * to that file when the process exits.
+ *
+ * Each thread records into its own ring buffer, so recording never takes a lock. When a buffer
+ * is full, the oldest events of that thread are overwritten.
+ *
+ * Event names are not copied, they must outlive the recording (string literals and
+ * __FUNCTION__ are fine).
+ */
+class UTILS_PUBLIC SystraceRecorder {
+public:
+    enum class Type : uint8_t {
+        BEGIN,          //!< beginning of a synchronous scope
+        END,            //!< end of the innermost synchronous scope of the thread
+        ASYNC_BEGIN,    //!< beginning of an asynchronous event, value is the cookie
+        ASYNC_END,      //!< end of an asynchronous event, value is the cookie
+        COUNTER         //!< counter value
+    };
+
+    struct Event {
+        uint64_t timestamp; // in nanoseconds, from a monotonic clock
+        const char* name;
+        int64_t value;
+        uint32_t job;       // JobSystem job running on the thread when recorded, 0 if none
+        Type type;
+    };
+
+    //! Number of events kept per thread.
+    static constexpr size_t CAPACITY = 65536;
+
+    //! Records an event on the calling thread's buffer. This never blocks.
+    static void record(Type type, const char* name, int64_t value = 0) noexcept;
+
+    //! Sets the JobSystem job attached to the events recorded by the calling thread.
+    static void setCurrentJob(uint32_t job) noexcept;
+
+    //! Discards all the events recorded so far.
+    static void clear() noexcept;
+
+    //! Returns the number of events currently held by all buffers.
+    static size_t getEventCount() noexcept;
+
+    /**
+     * Writes all the recorded events in the Chrome trace event (JSON) format. This can be
+     * called while other threads are recording, events that are overwritten while they're
+     * being exported are skipped.
+     */
+    static void exportChromeJson(io::ostream& out) noexcept;
+
+    //! Writes all the recorded events to a file, returns false if the file can't be written.
+    static bool exportChromeJson(const char* path) noexcept;
+};
+
+} // namespace utils
+
+#endif // TNT_UTILS_SYSTRACERECORDER_H
@@ -81,7 +81,7 @@ protected:
     };
 
     Buffer mData;
-    Buffer& getBuffer() noexcept { return mData; }
+    virtual Buffer& getBuffer() noexcept { return mData; }
 
 private:
     virtual ostream& flush() noexcept = 0;
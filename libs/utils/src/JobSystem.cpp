@@ -104,8 +104,9 @@ void JobSystem::setThreadAffinityById(size_t id) noexcept {
 }
 
 JobSystem::JobSystem(const size_t userThreadCount, const size_t adoptableThreadsCount) noexcept
-    : mJobPool("JobSystem Job pool", MAX_JOB_COUNT * sizeof(Job)),
-      mJobStorageBase(static_cast<Job *>(mJobPool.getAllocator().getCurrent()))
+    : mJobStorageBase(static_cast<Job *>(
+            utils::aligned_alloc(MAX_JOB_COUNT * sizeof(Job), alignof(Job)))),
+      mFreeJobs(mJobStorageBase, mJobStorageBase + JOB_POOL_GROWTH, sizeof(Job), alignof(Job), 0)
 {
     SYSTRACE_ENABLE();
 
@@ -161,6 +162,8 @@ JobSystem::~JobSystem() {
             state.thread.join();
         }
     }
+
+    utils::aligned_free(mJobStorageBase);
 }
 
 inline void JobSystem::incRef(Job const* job) noexcept {
@@ -184,7 +187,8 @@ void JobSystem::decRef(Job const* job) noexcept {
     assert(c > 0);
     if (c == 1) {
         // This was the last reference, it's safe to destroy the job.
-        mJobPool.destroy(job);
+        job->~Job();
+        mFreeJobs.push(const_cast<Job*>(job));
     }
 }
 
@@ -201,7 +205,12 @@ inline bool JobSystem::exitRequested() const noexcept {
 }
 
 inline bool JobSystem::hasActiveJobs() const noexcept {
-    return mActiveJobs.load(std::memory_order_relaxed) > 0;
+    return mActiveJobs[LANE_CRITICAL].load(std::memory_order_relaxed) > 0 ||
+           mActiveJobs[LANE_BACKGROUND].load(std::memory_order_relaxed) > 0;
+}
+
+inline bool JobSystem::hasActiveJobs(uint8_t lane) const noexcept {
+    return mActiveJobs[lane].load(std::memory_order_relaxed) > 0;
 }
 
 inline bool JobSystem::hasJobCompleted(JobSystem::Job const* job) noexcept {
@@ -230,7 +239,30 @@ inline JobSystem::ThreadState& JobSystem::getState() noexcept {
 }
 
 JobSystem::Job* JobSystem::allocateJob() noexcept {
-    return mJobPool.make<Job>();
+    void* p = mFreeJobs.pop();
+    if (UTILS_UNLIKELY(!p)) {
+        p = growJobPool();
+    }
+    return p ? new(p) Job : nullptr;
+}
+
+UTILS_NOINLINE
+JobSystem::Job* JobSystem::growJobPool() noexcept {
+    std::lock_guard<utils::SpinLock> lock(mJobPoolLock);
+
+    // another thread might have grown the pool while we were waiting for the lock
+    void* p = mFreeJobs.pop();
+    if (p || mJobPoolSize == MAX_JOB_COUNT) {
+        return static_cast<Job*>(p);
+    }
+
+    // keep the first new job for ourselves, and add the others to the free-list
+    Job* const jobs = mJobStorageBase + mJobPoolSize;
+    for (size_t i = JOB_POOL_GROWTH - 1; i > 0; i--) {
+        mFreeJobs.push(jobs + i);
+    }
+    mJobPoolSize += JOB_POOL_GROWTH;
+    return jobs;
 }
 
 inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadState& state) noexcept {
@@ -255,38 +287,57 @@ inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadS
     return stateToStealFrom;
 }
 
-JobSystem::Job* JobSystem::steal(JobSystem::ThreadState& state) noexcept {
+JobSystem::Job* JobSystem::steal(JobSystem::ThreadState& state, uint8_t lane) noexcept {
     HEAVY_SYSTRACE_CALL();
     Job* job = nullptr;
     do {
         ThreadState* const stateToStealFrom = getStateToStealFrom(state);
         if (UTILS_LIKELY(stateToStealFrom)) {
-            job = steal(stateToStealFrom->workQueue);
+            job = steal(stateToStealFrom->workQueues[lane]);
         }
         // nullptr -> nothing to steal in that queue either, if there are active jobs,
-        // continue to try stealing one.
-    } while (!job && hasActiveJobs());
+        // continue to try stealing one. We give up on background jobs as soon as a
+        // frame-critical job shows up.
+    } while (!job && hasActiveJobs(lane) &&
+            (lane == LANE_CRITICAL || !hasActiveJobs(LANE_CRITICAL)));
     return job;
 }
 
-bool JobSystem::execute(JobSystem::ThreadState& state) noexcept {
+bool JobSystem::execute(JobSystem::ThreadState& state, bool criticalOnly) noexcept {
     HEAVY_SYSTRACE_CALL();
 
-    Job* job = pop(state.workQueue);
+    // frame-critical jobs always come first
+    uint8_t lane = LANE_CRITICAL;
+    Job* job = pop(state.workQueues[LANE_CRITICAL]);
     if (UTILS_UNLIKELY(job == nullptr)) {
         // our queue is empty, try to steal a job
-        job = steal(state);
+        job = steal(state, LANE_CRITICAL);
+    }
+
+    if (job == nullptr && !criticalOnly) {
+        lane = LANE_BACKGROUND;
+        job = pop(state.workQueues[LANE_BACKGROUND]);
+        if (job == nullptr) {
+            job = steal(state, LANE_BACKGROUND);
+        }
     }
 
     if (job) {
         UTILS_UNUSED_IN_RELEASE
-        uint32_t activeJobs = mActiveJobs.fetch_sub(1, std::memory_order_relaxed);
+        uint32_t activeJobs = mActiveJobs[lane].fetch_sub(1, std::memory_order_relaxed);
         assert(activeJobs); // whoops, we were already at 0
         HEAVY_SYSTRACE_VALUE32("JobSystem::activeJobs", activeJobs - 1);
 
         if (UTILS_LIKELY(job->function)) {
             HEAVY_SYSTRACE_NAME("job->function");
+#if defined(UTILS_SYSTRACE_RECORDER)
+            // tag the events recorded by this job with its id (its index in the storage)
+            SystraceRecorder::setCurrentJob(uint32_t(job - mJobStorageBase) + 1);
+#endif
             job->function(job->storage, *this, job);
+#if defined(UTILS_SYSTRACE_RECORDER)
+            SystraceRecorder::setCurrentJob(0);
+#endif
         }
         finish(job);
     }
@@ -373,6 +424,8 @@ JobSystem::Job* JobSystem::create(JobSystem::Job* parent, JobFunc func) noexcept
         }
         job->function = func;
         job->parent = uint16_t(index);
+        // children of background jobs are background jobs
+        job->lane = parent ? parent->lane : LANE_CRITICAL;
     }
     return job;
 }
@@ -405,9 +458,13 @@ void JobSystem::run(JobSystem::Job*& job, uint32_t flags) noexcept {
     // increase the active job count before we add the job to the queue, because otherwise
     // the job could run and finish before the counter is incremented, which would trigger
     // an assert() in execute(). Either way, it's not "wrong", but the assert() is useful.
-    uint32_t activeJobs = mActiveJobs.fetch_add(1, std::memory_order_relaxed);
+    if (flags & BACKGROUND) {
+        job->lane = LANE_BACKGROUND;
+    }
+    const uint8_t lane = job->lane;
+    uint32_t activeJobs = mActiveJobs[lane].fetch_add(1, std::memory_order_relaxed);
 
-    put(state.workQueue, job);
+    put(state.workQueues[lane], job);
 
     HEAVY_SYSTRACE_VALUE32("JobSystem::activeJobs", activeJobs + 1);
 
@@ -434,9 +491,14 @@ void JobSystem::waitAndRelease(Job*& job) noexcept {
     assert(job);
     assert(job->refCount.load(std::memory_order_relaxed) >= 1);
 
+    // While waiting on a frame-critical job, we don't pick-up background jobs, which could take
+    // much longer than the job we're waiting for. This is only possible when there are other
+    // threads to run the background jobs.
+    const bool criticalOnly = job->lane == LANE_CRITICAL && mThreadCount > 0;
+
     ThreadState& state(getState());
     do {
-        if (!execute(state)) {
+        if (!execute(state, criticalOnly)) {
             // test if job has completed first, to possibly avoid taking the lock
             if (hasJobCompleted(job)) {
                 break;
@@ -452,7 +514,9 @@ void JobSystem::waitAndRelease(Job*& job) noexcept {
             // continue to handle more jobs, as they get added.
 
             std::unique_lock<Mutex> lock(mWaiterLock);
-            if (!hasJobCompleted(job) && !hasActiveJobs() && !exitRequested()) {
+            const bool hasActiveJobsToRun = criticalOnly ?
+                    hasActiveJobs(LANE_CRITICAL) : hasActiveJobs();
+            if (!hasJobCompleted(job) && !hasActiveJobsToRun && !exitRequested()) {
                 wait(lock);
             }
         }
@@ -470,6 +534,13 @@ void JobSystem::runAndWait(JobSystem::Job*& job) noexcept {
     waitAndRelease(job);
 }
 
+void JobSystem::yield() noexcept {
+    HEAVY_SYSTRACE_CALL();
+    ThreadState& state(getState());
+    while (execute(state, true)) {
+    }
+}
+
 void JobSystem::adopt() {
     const auto tid = std::this_thread::get_id();
 
@@ -514,9 +585,17 @@ void JobSystem::emancipate() {
     mThreadMap.erase(iter);
 }
 
+bool JobSystem::isThreadAdopted() noexcept {
+    std::lock_guard<utils::SpinLock> lock(mThreadMapLock);
+    auto iter = mThreadMap.find(std::this_thread::get_id());
+    return iter != mThreadMap.end() && iter->second->js == this;
+}
+
 io::ostream& operator<<(io::ostream& out, JobSystem const& js) {
     for (auto const& item : js.mThreadStates) {
-        out << size_t(item.id) << ": " << item.workQueue.getCount() << io::endl;
+        out << size_t(item.id) << ": " << item.workQueues[JobSystem::LANE_CRITICAL].getCount()
+            << " (background: " << item.workQueues[JobSystem::LANE_BACKGROUND].getCount() << ")"
+            << io::endl;
     }
     return out;
 }
@@ -17,6 +17,7 @@
 #include <utils/Log.h>
 
 #include <string>
+
 #include <utils/compiler.h>
 
 #ifdef ANDROID
@@ -30,8 +31,28 @@ namespace utils {
 
 namespace io {
 
+UTILS_DEFINE_TLS(LogStream::ThreadBuffers) LogStream::sThreadBuffers;
+UTILS_DEFINE_TLS(std::string*) LogStream::sRedirect;
+
+ostream::Buffer& LogStream::getBuffer() noexcept {
+    ThreadBuffers& threadBuffers = sThreadBuffers;
+    return threadBuffers.buffers[mPriority];
+}
+
+std::string* LogStream::redirect(std::string* log) noexcept {
+    std::string* const previous = sRedirect;
+    sRedirect = log;
+    return previous;
+}
+
 ostream& LogStream::flush() noexcept {
     Buffer& buf = getBuffer();
+    std::string* const log = sRedirect;
+    if (log) {
+        log->append(buf.get(), buf.curr - buf.buffer);
+        buf.reset();
+        return *this;
+    }
 #if ANDROID
     switch (mPriority) {
         case LOG_DEBUG:
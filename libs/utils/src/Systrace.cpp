@@ -138,4 +138,47 @@ void Systrace::init(uint32_t tag) noexcept {
 } // namespace details
 } // namespace utils
 
+#elif defined(UTILS_SYSTRACE_RECORDER)
+
+#include <mutex>
+
+#include <stdlib.h>
+
+namespace utils {
+namespace details {
+
+std::atomic<uint32_t> Systrace::sIsTracingEnabled = { 0 };
+
+static void exportAtExit() noexcept {
+    const char* path = getenv("UTILS_SYSTRACE_OUTPUT");
+    if (!SystraceRecorder::exportChromeJson(path)) {
+        slog.e << "Error writing trace file " << path << io::endl;
+    }
+}
+
+void Systrace::enable(uint32_t tags) noexcept {
+    // when UTILS_SYSTRACE_OUTPUT is set, the recording is exported when the process exits
+    static std::once_flag once;
+    std::call_once(once, []() {
+        if (getenv("UTILS_SYSTRACE_OUTPUT")) {
+            atexit(exportAtExit);
+        }
+    });
+    sIsTracingEnabled.fetch_or(tags, std::memory_order_relaxed);
+}
+
+void Systrace::disable(uint32_t tags) noexcept {
+    sIsTracingEnabled.fetch_and(~tags, std::memory_order_relaxed);
+}
+
+bool Systrace::isTracingEnabled(uint32_t tag) noexcept {
+    if (tag) {
+        return bool((sIsTracingEnabled.load(std::memory_order_relaxed) | SYSTRACE_TAG_ALWAYS) & tag);
+    }
+    return false;
+}
+
+} // namespace details
+} // namespace utils
+
 #endif // ANDROID
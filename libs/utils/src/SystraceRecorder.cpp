@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utils/SystraceRecorder.h>
+
+#include <utils/ostream.h>
+#include <utils/sstream.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cinttypes>
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#elif defined(WIN32)
+#   include <process.h>
+#else
+#   include <unistd.h>
+#endif
+
+namespace utils {
+
+using Event = SystraceRecorder::Event;
+using Type = SystraceRecorder::Type;
+
+namespace {
+
+// The ring buffer of a thread. Only its thread writes events, head is published with release
+// semantics so that other threads can read the events below it.
+struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t tid) noexcept : tid(tid) { }
+    std::atomic<uint64_t> head{ 0 };    // index of the next event to write
+    std::atomic<uint64_t> begin{ 0 };   // index of the first event to export, set by clear()
+    const uint32_t tid;
+    Event events[SystraceRecorder::CAPACITY];
+};
+
+static_assert((SystraceRecorder::CAPACITY & (SystraceRecorder::CAPACITY - 1)) == 0,
+        "CAPACITY must be a power of two");
+
+// Buffers are never freed, they're still needed after their thread exits to export its events.
+struct Registry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Registry& getRegistry() noexcept {
+    static Registry* const registry = new Registry; // leaked, so it's usable from atexit()
+    return *registry;
+}
+
+thread_local ThreadBuffer* tBuffer = nullptr;
+thread_local uint32_t tCurrentJob = 0;
+
+uint32_t getThreadId() noexcept {
+#if defined(__linux__)
+    return uint32_t(syscall(SYS_gettid));
+#else
+    return uint32_t(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+#endif
+}
+
+uint32_t getProcessId() noexcept {
+#if defined(WIN32)
+    return uint32_t(_getpid());
+#else
+    return uint32_t(getpid());
+#endif
+}
+
+UTILS_NOINLINE
+ThreadBuffer* createThreadBuffer() noexcept {
+    // this happens once per thread, so it's okay to take a lock here
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    registry.buffers.emplace_back(new ThreadBuffer(getThreadId()));
+    tBuffer = registry.buffers.back().get();
+    return tBuffer;
+}
+
+// Copies the events of a buffer that are still valid, returns the number of events copied.
+size_t snapshot(ThreadBuffer const& buffer, std::vector<Event>& events) noexcept {
+    constexpr size_t CAPACITY = SystraceRecorder::CAPACITY;
+    const uint64_t head = buffer.head.load(std::memory_order_acquire);
+    uint64_t first = buffer.begin.load(std::memory_order_relaxed);
+    if (head - first > CAPACITY) {
+        first = head - CAPACITY;
+    }
+    events.resize(head - first);
+    for (uint64_t i = first; i < head; i++) {
+        events[i - first] = buffer.events[i & (CAPACITY - 1)];
+    }
+    // events that were overwritten while we copied them can't be trusted, drop them. This
+    // includes the slot of event "after", which the writer may be filling right now.
+    const uint64_t after = buffer.head.load(std::memory_order_acquire);
+    if (after - first + 1 > CAPACITY) {
+        const size_t dropped = std::min(size_t(after - first - CAPACITY + 1), events.size());
+        events.erase(events.begin(), events.begin() + dropped);
+    }
+    return events.size();
+}
+
+void writeString(io::ostream& out, const char* s) noexcept {
+    char buf[256];
+    size_t n = 0;
+    out << "\"";
+    for (; *s; s++) {
+        if (n + 2 >= sizeof(buf) - 1) {
+            buf[n] = 0;
+            out << buf;
+            n = 0;
+        }
+        const char c = *s;
+        if (c == '"' || c == '\\') {
+            buf[n++] = '\\';
+            buf[n++] = c;
+        } else if ((unsigned char)c >= 0x20) {
+            buf[n++] = c;
+        }
+    }
+    buf[n] = 0;
+    out << buf << "\"";
+}
+
+void writeEvent(io::ostream& out, Event const& e, uint32_t pid, uint32_t tid) noexcept {
+    static const char* const phases[] = { "B", "E", "b", "e", "C" };
+    char buf[128];
+
+    // chrome expects timestamps in microseconds, we keep the nanoseconds as a fraction
+    snprintf(buf, sizeof(buf), "{\"ph\":\"%s\",\"ts\":%" PRIu64 ".%03u,\"pid\":%u,\"tid\":%u",
+            phases[size_t(e.type)], e.timestamp / 1000u, unsigned(e.timestamp % 1000u),
+            pid, tid);
+    out << buf;
+
+    if (e.type != Type::END) {
+        out << ",\"cat\":\"systrace\",\"name\":";
+        writeString(out, e.name);
+    }
+
+    switch (e.type) {
+        case Type::BEGIN:
+        case Type::END:
+            if (e.job) {
+                snprintf(buf, sizeof(buf), ",\"args\":{\"job\":%u}", e.job);
+                out << buf;
+            }
+            break;
+        case Type::ASYNC_BEGIN:
+        case Type::ASYNC_END:
+            snprintf(buf, sizeof(buf), ",\"id\":%" PRId64, e.value);
+            out << buf;
+            break;
+        case Type::COUNTER:
+            snprintf(buf, sizeof(buf), ",\"args\":{\"value\":%" PRId64 "}", e.value);
+            out << buf;
+            break;
+    }
+    out << "}";
+}
+
+} // anonymous namespace
+
+void SystraceRecorder::record(Type type, const char* name, int64_t value) noexcept {
+    ThreadBuffer* buffer = tBuffer;
+    if (UTILS_UNLIKELY(!buffer)) {
+        buffer = createThreadBuffer();
+    }
+    const uint64_t now = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head & (CAPACITY - 1)] = { now, name, value, tCurrentJob, type };
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void SystraceRecorder::setCurrentJob(uint32_t job) noexcept {
+    tCurrentJob = job;
+}
+
+void SystraceRecorder::clear() noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    for (auto const& buffer : registry.buffers) {
+        buffer->begin.store(buffer->head.load(std::memory_order_acquire),
+                std::memory_order_relaxed);
+    }
+}
+
+size_t SystraceRecorder::getEventCount() noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    size_t count = 0;
+    for (auto const& buffer : registry.buffers) {
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        const uint64_t begin = buffer->begin.load(std::memory_order_relaxed);
+        count += size_t(std::min(head - begin, uint64_t(CAPACITY)));
+    }
+    return count;
+}
+
+void SystraceRecorder::exportChromeJson(io::ostream& out) noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+
+    const uint32_t pid = getProcessId();
+    std::vector<Event> events;
+    bool first = true;
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (auto const& buffer : registry.buffers) {
+        snapshot(*buffer, events);
+        // if the ring buffer wrapped around, it may start with the end of scopes that have
+        // been overwritten, drop them so the trace stays well nested.
+        size_t depth = 0;
+        for (Event const& e : events) {
+            if (e.type == Type::BEGIN) {
+                depth++;
+            } else if (e.type == Type::END) {
+                if (!depth) {
+                    continue;
+                }
+                depth--;
+            }
+            out << (first ? "\n" : ",\n");
+            writeEvent(out, e, pid, buffer->tid);
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    out << io::flush;
+}
+
+bool SystraceRecorder::exportChromeJson(const char* path) noexcept {
+    io::sstream json;
+    exportChromeJson(json);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    const char* data = json.c_str();
+    const size_t size = strlen(data);
+    const bool success = fwrite(data, 1, size, file) == size;
+    return (fclose(file) == 0) && success;
+}
+
+} // namespace utils
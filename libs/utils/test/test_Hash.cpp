@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utils/Hash.h>
+
+#include <vector>
+
+using namespace utils::hash;
+
+static Digest128::Value digest(const void* data, size_t size) {
+    Digest128 d;
+    d.update(data, size);
+    return d.finish();
+}
+
+TEST(HashTest, Digest128) {
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = uint8_t(i * 7);
+    }
+    const Digest128::Value reference = digest(data.data(), data.size());
+    EXPECT_EQ(reference, digest(data.data(), data.size()));
+
+    // pieces that are whole words are the same as a single update
+    Digest128 pieces;
+    pieces.update(data.data(), 8);
+    pieces.update(data.data() + 8, 992);
+    EXPECT_EQ(reference, pieces.finish());
+
+    // every byte counts
+    for (size_t i : { size_t(0), size_t(7), size_t(8), size_t(999) }) {
+        std::vector<uint8_t> copy = data;
+        copy[i] ^= 1u;
+        EXPECT_NE(reference, digest(copy.data(), copy.size()));
+    }
+
+    // the size counts too, including trailing zeros
+    const uint8_t zeros[16] = {};
+    EXPECT_NE(digest(zeros, 1), digest(zeros, 2));
+    EXPECT_NE(digest(zeros, 8), digest(zeros, 16));
+    EXPECT_NE(digest(zeros, 0), digest(zeros, 1));
+}
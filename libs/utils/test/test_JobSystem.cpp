@@ -219,6 +219,67 @@ TEST(JobSystem, JobSystemParallelChildren) {
 }
 
 
+TEST(JobSystem, JobSystemGrowPool) {
+    v = 0;
+
+    JobSystem js;
+    js.adopt();
+
+    struct User {
+        void func(JobSystem&, JobSystem::Job*) {
+            v++;
+        };
+    } j;
+
+    // more jobs than the initial pool size are alive at the same time
+    std::vector<JobSystem::Job*> jobs(10000);
+    JobSystem::Job* root = js.createJob<User, &User::func>(nullptr, &j);
+    for (auto& job : jobs) {
+        job = js.createJob<User, &User::func>(root, &j);
+        ASSERT_NE(nullptr, job);
+    }
+    for (auto& job : jobs) {
+        js.run(job, JobSystem::DONT_SIGNAL);
+    }
+    js.runAndWait(root);
+
+    EXPECT_EQ(10001, v.load());
+
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemBackgroundLane) {
+    JobSystem js;
+    js.adopt();
+
+    std::atomic_int background = { 0 };
+    std::atomic_int critical = { 0 };
+
+    // a background job, which splits its work in (background) children
+    JobSystem::Job* job = js.createJob(nullptr, [&background](JobSystem& js, JobSystem::Job* parent) {
+        for (int i = 0; i < 64; i++) {
+            js.run(js.createJob(parent, [&background](JobSystem& js, JobSystem::Job*) {
+                background++;
+                js.yield();
+            }));
+        }
+    });
+    job = js.runAndRetain(job, JobSystem::BACKGROUND);
+
+    // frame-critical work doesn't wait for the background job
+    for (int i = 0; i < 16; i++) {
+        js.runAndWait(js.createJob(nullptr, [&critical](JobSystem&, JobSystem::Job*) {
+            critical++;
+        }));
+    }
+    EXPECT_EQ(16, critical.load());
+
+    js.waitAndRelease(job);
+    EXPECT_EQ(64, background.load());
+
+    js.emancipate();
+}
+
 TEST(JobSystem, JobSystemSequentialChildren) {
     JobSystem js;
     js.adopt();
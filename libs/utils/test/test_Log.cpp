@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utils/Log.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace utils;
+
+TEST(Log, Redirect) {
+    std::string log;
+    EXPECT_EQ(nullptr, io::LogStream::redirect(&log));
+    slog.e << "error " << 1 << io::endl;
+    slog.i << "info" << io::endl;
+    slog.w << "unflushed";
+    EXPECT_EQ(&log, io::LogStream::redirect(nullptr));
+    EXPECT_EQ("error 1\ninfo\n", log);
+
+    // what wasn't flushed stays in the buffer of the stream
+    std::string next;
+    io::LogStream::redirect(&next);
+    slog.w << io::endl;
+    io::LogStream::redirect(nullptr);
+    EXPECT_EQ("unflushed\n", next);
+}
+
+TEST(Log, Threads) {
+    constexpr size_t THREAD_COUNT = 8;
+    constexpr size_t LINE_COUNT = 1000;
+    std::vector<std::string> logs(THREAD_COUNT);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        threads.emplace_back([&log = logs[i], i]() {
+            io::LogStream::redirect(&log);
+            for (size_t j = 0; j < LINE_COUNT; j++) {
+                slog.e << "thread " << i << ", line " << j << io::endl;
+            }
+            io::LogStream::redirect(nullptr);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // the messages of each thread must be intact
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        std::string expected;
+        for (size_t j = 0; j < LINE_COUNT; j++) {
+            expected += "thread " + std::to_string(i) + ", line " + std::to_string(j) + "\n";
+        }
+        EXPECT_EQ(expected, logs[i]);
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utils/SystraceRecorder.h>
+#include <utils/sstream.h>
+
+#include <string>
+#include <thread>
+
+using namespace utils;
+
+using Type = SystraceRecorder::Type;
+
+static std::string exportJson() {
+    io::sstream ss;
+    SystraceRecorder::exportChromeJson(ss);
+    return ss.c_str();
+}
+
+static size_t count(std::string const& s, const char* pattern) {
+    size_t n = 0;
+    for (size_t p = s.find(pattern); p != std::string::npos; p = s.find(pattern, p + 1)) {
+        n++;
+    }
+    return n;
+}
+
+TEST(SystraceRecorder, Events) {
+    SystraceRecorder::clear();
+    EXPECT_EQ(0u, SystraceRecorder::getEventCount());
+
+    SystraceRecorder::setCurrentJob(7);
+    SystraceRecorder::record(Type::BEGIN, "outer");
+    SystraceRecorder::record(Type::COUNTER, "counter", 42);
+    SystraceRecorder::record(Type::ASYNC_BEGIN, "async", 3);
+    SystraceRecorder::record(Type::END, nullptr);
+    SystraceRecorder::setCurrentJob(0);
+    SystraceRecorder::record(Type::ASYNC_END, "async", 3);
+    EXPECT_EQ(5u, SystraceRecorder::getEventCount());
+
+    std::string json = exportJson();
+    EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    EXPECT_EQ(1u, count(json, "\"ph\":\"B\""));
+    EXPECT_EQ(1u, count(json, "\"ph\":\"E\""));
+    EXPECT_EQ(1u, count(json, "\"ph\":\"b\""));
+    EXPECT_EQ(1u, count(json, "\"ph\":\"e\""));
+    EXPECT_EQ(1u, count(json, "\"ph\":\"C\""));
+    EXPECT_EQ(1u, count(json, "\"name\":\"outer\""));
+    EXPECT_EQ(1u, count(json, "\"args\":{\"value\":42}"));
+    EXPECT_EQ(2u, count(json, "\"id\":3"));
+    EXPECT_EQ(2u, count(json, "\"args\":{\"job\":7}"));
+
+    SystraceRecorder::clear();
+    EXPECT_EQ(0u, SystraceRecorder::getEventCount());
+    EXPECT_EQ(0u, count(exportJson(), "\"ph\""));
+}
+
+TEST(SystraceRecorder, Threads) {
+    SystraceRecorder::clear();
+
+    auto work = []() {
+        for (size_t i = 0; i < 100; i++) {
+            SystraceRecorder::record(Type::BEGIN, "work");
+            SystraceRecorder::record(Type::END, nullptr);
+        }
+    };
+    std::thread t0(work);
+    std::thread t1(work);
+    t0.join();
+    t1.join();
+
+    EXPECT_EQ(400u, SystraceRecorder::getEventCount());
+    EXPECT_EQ(200u, count(exportJson(), "\"name\":\"work\""));
+    SystraceRecorder::clear();
+}
+
+TEST(SystraceRecorder, WrapAround) {
+    SystraceRecorder::clear();
+
+    // the ring buffer drops the oldest events, including the beginning of this scope
+    SystraceRecorder::record(Type::BEGIN, "overwritten");
+    for (size_t i = 0; i < SystraceRecorder::CAPACITY; i++) {
+        SystraceRecorder::record(Type::COUNTER, "counter", int64_t(i));
+    }
+    SystraceRecorder::record(Type::END, nullptr);
+    EXPECT_EQ(SystraceRecorder::CAPACITY, SystraceRecorder::getEventCount());
+
+    // the unmatched end of scope isn't exported, and neither is the oldest event, whose slot
+    // is the next one to be written
+    std::string json = exportJson();
+    EXPECT_EQ(0u, count(json, "\"name\":\"overwritten\""));
+    EXPECT_EQ(0u, count(json, "\"ph\":\"E\""));
+    EXPECT_EQ(SystraceRecorder::CAPACITY - 2, count(json, "\"ph\":\"C\""));
+    SystraceRecorder::clear();
+}
@@ -203,6 +203,8 @@ int main(int argc, char** argv) {
         configuration.gltfPath = gltfPath.c_str();
         configuration.normalizeSkinningWeights = true;
         configuration.recomputeBoundingBoxes = false;
+        configuration.memoryMapBuffers = false;
+        configuration.maxPendingGeometrySize = 0;
         if (!app.resourceLoader) {
             app.resourceLoader = new gltfio::ResourceLoader(configuration);
         }
@@ -624,32 +624,11 @@ int main(int argc, char** argv) {
     }
 
     auto loadAsset = [&app](utils::Path filename) {
-        // Peek at the file size to allow pre-allocation.
-        long contentSize = static_cast<long>(getFileSize(filename.c_str()));
-        if (contentSize <= 0) {
-            std::cerr << "Unable to open " << filename << std::endl;
-            exit(1);
-        }
-
-        // Consume the glTF file.
-        std::ifstream in(filename.c_str(), std::ifstream::binary | std::ifstream::in);
-        std::vector<uint8_t> buffer(static_cast<unsigned long>(contentSize));
-        if (!in.read((char*) buffer.data(), contentSize)) {
-            std::cerr << "Unable to read " << filename << std::endl;
-            exit(1);
-        }
-
-        // Parse the glTF file and create Filament entities.
-        if (filename.getExtension() == "glb") {
-            app.asset = app.loader->createAssetFromBinary(buffer.data(), buffer.size());
-        } else {
-            app.asset = app.loader->createAssetFromJson(buffer.data(), buffer.size());
-        }
-        buffer.clear();
-        buffer.shrink_to_fit();
-
+        // Map the glTF file into memory and create Filament entities, this avoids copying large
+        // GLB files.
+        app.asset = app.loader->createAssetFromFile(filename.c_str());
         if (!app.asset) {
-            std::cerr << "Unable to parse " << filename << std::endl;
+            std::cerr << "Unable to load " << filename << std::endl;
             exit(1);
         }
     };
@@ -662,6 +641,7 @@ int main(int argc, char** argv) {
         configuration.gltfPath = gltfPath.c_str();
         configuration.recomputeBoundingBoxes = app.recomputeAabb;
         configuration.normalizeSkinningWeights = true;
+        configuration.memoryMapBuffers = true;
         if (!app.resourceLoader) {
             app.resourceLoader = new gltfio::ResourceLoader(configuration);
         }
@@ -5,6 +5,7 @@ void materialVertex(inout MaterialVertexInputs m) { }
 // NOTE: This shader is only used when the user's material does not have custom vertex code.
 //       There is no need to check anything related to material inputs in this file.
 void main() {
+    vertex_instanceIndex = INSTANCE_INDEX;
 
 // World position is used to compute gl_Position, except for vertices already in the device domain.
 // Regardless of vertex domain, if VSM is turned on, then we need to compute world position to pass
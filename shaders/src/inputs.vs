@@ -66,6 +66,8 @@ LAYOUT_LOCATION(6) SHADING_INTERPOLATION out mediump vec4 vertex_worldTangent;
 
 LAYOUT_LOCATION(7) out highp vec4 vertex_position;
 
+LAYOUT_LOCATION(8) flat out highp int vertex_instanceIndex;
+
 #if defined(HAS_ATTRIBUTE_COLOR)
 LAYOUT_LOCATION(9) out mediump vec4 vertex_color;
 #endif
@@ -1,4 +1,7 @@
 void main() {
+    // the fragment shader needs the instance index to access objectUniforms
+    vertex_instanceIndex = INSTANCE_INDEX;
+
     // Initialize the inputs to sensible default values, see material_inputs.vs
     MaterialVertexInputs material;
     initMaterialVertex(material);
@@ -22,6 +22,7 @@
 
 #include <utils/Path.h>
 
+#include <algorithm>
 #include <istream>
 #include <sstream>
 #include <string>
@@ -36,6 +37,7 @@ static void usage(char* name) {
             "MATC is a command-line tool to compile material definition.\n"
             "Usages:\n"
             "    MATC [options] <input-file>\n"
+            "    MATC [options] --batch <manifest-file or input-directory>\n"
             "\n"
             "Supported input formats:\n"
             "    Filament material definition (.mat)\n"
@@ -46,7 +48,12 @@ static void usage(char* name) {
             "   --license\n"
             "       Print copyright and license information\n\n"
             "   --output, -o\n"
-            "       Specify path to output file\n\n"
+            "       Specify path to output file, or to the output directory in batch mode\n\n"
+            "   --batch, -b\n"
+            "       Compile many materials concurrently. The input is either a directory, whose\n"
+            "       .mat files are compiled, or a manifest file listing one material per line,\n"
+            "       relative to the manifest. Each material is compiled to the output directory,\n"
+            "       along with a Makefile dependency file (.d) listing its includes\n\n"
             "   --platform, -p\n"
             "       Shader family to generate: desktop, mobile or all (default)\n\n"
             "   --optimize-size, -S\n"
@@ -65,6 +72,9 @@ static void usage(char* name) {
             "       Filter out specified comma-separated variants:\n"
             "           directionalLighting, dynamicLighting, shadowReceiver, skinning, vsm\n"
             "       This variant filter is merged with the filter from the material, if any\n\n"
+            "   --cache-dir=<dir>, -c <dir>\n"
+            "       Reuse the shaders compiled by previous runs, and store the new ones, in the\n"
+            "       given directory. It can be shared by concurrent runs\n\n"
             "   --version, -v\n"
             "       Print the material version number\n\n"
             "Internal use and debugging only:\n"
@@ -149,7 +159,7 @@ static void parseDefine(std::string defineString,
 }
 
 bool CommandlineConfig::parse() {
-    static constexpr const char* OPTSTR = "hlxo:f:dm:a:p:D:OSEr:vV:gt";
+    static constexpr const char* OPTSTR = "hlxo:f:dm:a:p:D:OSEr:vV:gtc:b";
     static const struct option OPTIONS[] = {
             { "help",                    no_argument, nullptr, 'h' },
             { "license",                 no_argument, nullptr, 'l' },
@@ -168,11 +178,18 @@ bool CommandlineConfig::parse() {
             { "reflect",           required_argument, nullptr, 'r' },
             { "print",                   no_argument, nullptr, 't' },
             { "version",                 no_argument, nullptr, 'v' },
+            { "cache-dir",         required_argument, nullptr, 'c' },
+            { "batch",                   no_argument, nullptr, 'b' },
             { nullptr, 0, nullptr, 0 }  // termination of the option list
     };
 
     int opt;
     int option_index = 0;
+    std::string output;
+
+    // getopt's state is global, start over in case another command line was parsed before.
+    optind = 1;
+    optreset = 1;
 
     while ((opt = getopt_long(mArgc, mArgv, OPTSTR, OPTIONS, &option_index)) >= 0) {
         std::string arg(optarg ? optarg : "");
@@ -187,7 +204,7 @@ bool CommandlineConfig::parse() {
                 exit(0);
                 break;
             case 'o':
-                mOutput = new FilesystemOutput(arg.c_str());
+                output = arg;
                 break;
             case 'f':
                 if (arg == "blob") {
@@ -263,6 +280,12 @@ bool CommandlineConfig::parse() {
             case 't':
                 mPrintShaders = true;
                 break;
+            case 'c':
+                mCacheDirectory = arg;
+                break;
+            case 'b':
+                mBatch = true;
+                break;
         }
     }
 
@@ -270,6 +293,14 @@ bool CommandlineConfig::parse() {
         std::cerr << "Only one input file should be specified on the command line." << std::endl;
         return false;
     }
+    if (mBatch) {
+        mBatchOutputDirectory = output;
+        return mArgc - optind == 0 || parseBatchInputs(mArgv[optind]);
+    }
+
+    if (!output.empty()) {
+        mOutput = new FilesystemOutput(output.c_str());
+    }
     if (mArgc - optind > 0) {
         mInput = new FilesystemInput(mArgv[optind]);
     }
@@ -277,4 +308,38 @@ bool CommandlineConfig::parse() {
     return true;
 }
 
+bool CommandlineConfig::parseBatchInputs(const char* path) {
+    const Path input(path);
+    if (input.isDirectory()) {
+        for (const Path& file : input.listContents()) {
+            if (file.isFile() && file.getExtension() == "mat") {
+                mBatchInputs.push_back(file.getPath());
+            }
+        }
+        // listContents() doesn't guarantee any order
+        std::sort(mBatchInputs.begin(), mBatchInputs.end());
+        return true;
+    }
+
+    std::ifstream manifest(input.getPath());
+    if (!manifest) {
+        std::cerr << "Unable to open batch manifest '" << input << "'" << std::endl;
+        return false;
+    }
+    // Materials are listed one per line, empty lines and lines starting with # are ignored.
+    const Path root = input.getAbsolutePath().getParent();
+    std::string line;
+    while (std::getline(manifest, line)) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        const size_t last = line.find_last_not_of(" \t\r");
+        const Path material(line.substr(first, last - first + 1));
+        mBatchInputs.push_back(material.isAbsolute() ?
+                material.getPath() : root.concat(material).getPath());
+    }
+    return true;
+}
+
 } // namespace matc
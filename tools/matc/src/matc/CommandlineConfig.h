@@ -125,6 +125,7 @@ public:
 
 private:
     bool parse();
+    bool parseBatchInputs(const char* path);
 
     int mArgc = 0;
     char** mArgv = nullptr;
@@ -133,6 +134,40 @@ private:
     FilesystemOutput* mOutput = nullptr;
 };
 
+// The configuration of one material of a batch, all its settings are the batch's.
+class BatchItemConfig : public Config {
+public:
+    BatchItemConfig(const Config& parent, const std::string& input, const std::string& output)
+            : Config(parent), mParent(parent), mOutputPath(output),
+              mInput(input.c_str()), mOutput(output.c_str()) {
+        mBatch = false;
+        mBatchInputs.clear();
+        mBatchOutputDirectory.clear();
+    }
+
+    Output* getOutput() const noexcept override {
+        return &mOutput;
+    }
+
+    Input* getInput() const noexcept override {
+        return &mInput;
+    }
+
+    std::string toString() const noexcept override {
+        return mParent.toString();
+    }
+
+    const std::string& getOutputPath() const noexcept {
+        return mOutputPath;
+    }
+
+private:
+    const Config& mParent;
+    const std::string mOutputPath;
+    mutable FilesystemInput mInput;
+    mutable FilesystemOutput mOutput;
+};
+
 } // namespace matc
 
 #endif //TNT_COMPILERPARAMETERS_H
@@ -25,6 +25,8 @@
 #include <memory>
 #include <unordered_map>
 #include <ostream>
+#include <string>
+#include <vector>
 
 #include <utils/compiler.h>
 
@@ -114,6 +116,24 @@ public:
         return mDefines;
     }
 
+    const std::string& getCacheDirectory() const noexcept {
+        return mCacheDirectory;
+    }
+
+    // In batch mode, getInput() and getOutput() are unused, each of the batch's inputs is
+    // compiled to the batch's output directory.
+    bool isBatch() const noexcept {
+        return mBatch;
+    }
+
+    const std::vector<std::string>& getBatchInputs() const noexcept {
+        return mBatchInputs;
+    }
+
+    const std::string& getBatchOutputDirectory() const noexcept {
+        return mBatchOutputDirectory;
+    }
+
 protected:
     bool mDebug = false;
     bool mIsValid = true;
@@ -125,6 +145,10 @@ protected:
     TargetApi mTargetApi = (TargetApi) 0;
     std::unordered_map<std::string, std::string> mDefines;
     uint8_t mVariantFilter = 0;
+    std::string mCacheDirectory;
+    bool mBatch = false;
+    std::vector<std::string> mBatchInputs;
+    std::string mBatchOutputDirectory;
 };
 
 }
@@ -18,6 +18,7 @@
 
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <fstream>
 
 namespace matc {
@@ -63,6 +64,11 @@ bool DirIncluder::operator()(const utils::CString& includedBy, filamat::IncludeR
     result.text = utils::CString(contents.c_str());
     result.name = utils::CString(headerPath.c_str());
 
+    if (std::find(mIncludedFiles.begin(), mIncludedFiles.end(), headerPath) ==
+            mIncludedFiles.end()) {
+        mIncludedFiles.push_back(headerPath);
+    }
+
     return true;
 }
 
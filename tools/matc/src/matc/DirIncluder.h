@@ -21,6 +21,8 @@
 
 #include <utils/Path.h>
 
+#include <vector>
+
 namespace matc {
 
 // Functor callback handler used to resolve includes relative to a root include directory.
@@ -33,8 +35,14 @@ public:
 
     bool operator()(const utils::CString& includedBy, filamat::IncludeResult& result);
 
+    // Returns the files included so far, each one once, in the order they were first included.
+    const std::vector<utils::Path>& getIncludedFiles() const noexcept {
+        return mIncludedFiles;
+    }
+
 private:
     utils::Path mIncludeDirectory;
+    std::vector<utils::Path> mIncludedFiles;
 
 };
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DirShaderCache.h"
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+
+namespace matc {
+
+utils::Path DirShaderCache::getEntryPath(const char* key) const noexcept {
+    return mCacheDirectory.concat(std::string(key, 2)).concat(key);
+}
+
+bool DirShaderCache::get(const char* key, std::vector<uint8_t>& blob) noexcept {
+    std::ifstream stream(getEntryPath(key).getPath(), std::ios::binary);
+    if (stream) {
+        stream.seekg(0, std::ios::end);
+        const std::streamoff size = stream.tellg();
+        stream.seekg(0, std::ios::beg);
+        if (size >= 0) {
+            blob.resize(size_t(size));
+            if (stream.read((char*)blob.data(), size)) {
+                mHits++;
+                return true;
+            }
+        }
+    }
+    mMisses++;
+    return false;
+}
+
+void DirShaderCache::put(const char* key, const uint8_t* data, size_t size) noexcept {
+    const utils::Path path = getEntryPath(key);
+    const utils::Path dir = path.getParent();
+    if (!dir.isDirectory() && !dir.mkdirRecursive() && !dir.isDirectory()) {
+        return;
+    }
+
+    // The temporary name must be unique across the threads and processes sharing the cache.
+    const size_t unique = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+            size_t(std::chrono::steady_clock::now().time_since_epoch().count());
+    const std::string temporary = path.getPath() + "." + std::to_string(unique) + "." +
+            std::to_string(mTemporaryCount++) + ".tmp";
+
+    std::ofstream stream(temporary, std::ios::binary);
+    const bool written = bool(stream.write((const char*)data, std::streamsize(size)));
+    stream.close();
+
+    // If the entry was already added by someone else, the rename fails on some platforms, but
+    // since it's content-addressed, it's the same entry.
+    if (!written || !stream || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+    }
+}
+
+} // namespace matc
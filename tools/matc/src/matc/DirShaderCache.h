@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_DIRSHADERCACHE_H_
+#define TNT_DIRSHADERCACHE_H_
+
+#include <filamat/ShaderCache.h>
+
+#include <utils/Path.h>
+
+#include <atomic>
+#include <utility>
+
+namespace matc {
+
+// Shader cache storing each compiled shader in its own file, named after its key, in a cache
+// directory. Files are written to a temporary name and then renamed, so the directory can be
+// shared by concurrent matc processes.
+class DirShaderCache : public filamat::ShaderCache {
+public:
+    explicit DirShaderCache(utils::Path dir) noexcept : mCacheDirectory(std::move(dir)) { }
+
+    bool get(const char* key, std::vector<uint8_t>& blob) noexcept override;
+    void put(const char* key, const uint8_t* data, size_t size) noexcept override;
+
+    size_t getHitCount() const noexcept { return mHits; }
+    size_t getMissCount() const noexcept { return mMisses; }
+
+private:
+    // Entries are spread over 256 sub-directories, named after the first two digits of the key.
+    utils::Path getEntryPath(const char* key) const noexcept;
+
+    utils::Path mCacheDirectory;
+    std::atomic<size_t> mHits{ 0 };
+    std::atomic<size_t> mMisses{ 0 };
+    std::atomic<uint32_t> mTemporaryCount{ 0 };
+};
+
+} // namespace matc
+
+#endif
@@ -16,15 +16,24 @@
 
 #include "MaterialCompiler.h"
 
+#include <algorithm>
+#include <fstream>
 #include <functional>
 #include <memory>
 #include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
 
 #include <filamat/MaterialBuilder.h>
 
 #include <filamat/Enums.h>
 
+#include <utils/JobSystem.h>
+#include <utils/Log.h>
+
 #include "DirIncluder.h"
+#include "DirShaderCache.h"
 #include "MaterialLexeme.h"
 #include "MaterialLexer.h"
 #include "JsonishLexer.h"
@@ -251,6 +260,32 @@ bool MaterialCompiler::isValidJsonStart(const char* buffer, size_t size) const n
 }
 
 bool MaterialCompiler::run(const Config& config) {
+    std::unique_ptr<DirShaderCache> cache;
+    if (!config.getCacheDirectory().empty()) {
+        cache.reset(new DirShaderCache(utils::Path(config.getCacheDirectory())));
+    }
+
+    // Compile the shaders, and the materials of a batch, on all cores.
+    MaterialBuilder::init();
+    utils::JobSystem jobSystem;
+    jobSystem.adopt();
+    const bool success = config.isBatch() ?
+            compileBatch(config, jobSystem, cache.get()) :
+            compileMaterial(config, jobSystem, cache.get(), nullptr);
+    jobSystem.emancipate();
+    MaterialBuilder::shutdown();
+
+    if (cache) {
+        const size_t hits = cache->getHitCount();
+        const size_t lookups = hits + cache->getMissCount();
+        std::cout << "Shader cache: " << hits << "/" << lookups << " hits ("
+                << (lookups ? hits * 100 / lookups : 0) << "%)" << std::endl;
+    }
+    return success;
+}
+
+bool MaterialCompiler::compileMaterial(const Config& config, utils::JobSystem& jobSystem,
+        ShaderCache* cache, std::vector<utils::Path>* includedFiles) {
     Config::Input* input = config.getInput();
     ssize_t size = input->open();
     if (size <= 0) {
@@ -258,7 +293,6 @@ bool MaterialCompiler::run(const Config& config) {
     }
     auto buffer = input->read();
 
-    MaterialBuilder::init();
     MaterialBuilder builder;
     // Before attempting an expensive lex, let's find out if we were sent pure JSON.
     bool parsed;
@@ -286,13 +320,14 @@ bool MaterialCompiler::run(const Config& config) {
     includer.setIncludeDirectory(materialFilePath.getParent());
 
     builder
-        .includeCallback(includer)
+        .includeCallback(std::ref(includer))
         .fileName(materialFilePath.getName().c_str())
         .platform(config.getPlatform())
         .targetApi(config.getTargetApi())
         .optimization(config.getOptimizationLevel())
         .printShaders(config.printShaders())
         .generateDebugInfo(config.isDebug())
+        .shaderCache(cache)
         .variantFilter(config.getVariantFilter() | builder.getVariantFilter());
 
     for (const auto& define : config.getDefines()) {
@@ -300,16 +335,180 @@ bool MaterialCompiler::run(const Config& config) {
     }
 
     // Write builder.build() to output.
-    Package package = builder.build();
-    MaterialBuilder::shutdown();
+    Package package = builder.build(jobSystem);
     if (!package.isValid()) {
         std::cerr << "Could not compile material " << input->getName() << std::endl;
         return false;
     }
+    if (includedFiles) {
+        *includedFiles = includer.getIncludedFiles();
+    }
     return writePackage(package, config);
 }
 
+bool MaterialCompiler::writeDependencies(const std::string& path, const std::string& target,
+        const std::vector<utils::Path>& dependencies) {
+    auto escape = [](const std::string& s) {
+        std::string escaped;
+        for (char c : s) {
+            if (c == ' ' || c == '#') {
+                escaped += '\\';
+            } else if (c == '$') {
+                escaped += '$';
+            }
+            escaped += c;
+        }
+        return escaped;
+    };
+
+    std::ofstream file(path);
+    file << escape(target) << ":";
+    for (const utils::Path& dependency : dependencies) {
+        file << " \\\n    " << escape(dependency.getPath());
+    }
+    file << std::endl;
+    file.close();
+    return !file.fail();
+}
+
+// The output of the batch item being compiled by the calling thread, if any.
+struct BatchLog {
+    std::string out;
+    std::string err;
+};
+static thread_local BatchLog* tCurrentBatchLog = nullptr;
+
+// Replaces the buffer of a standard stream, for as long as it lives, to append what is written
+// by a thread compiling a batch item to the item's log, so that the output of concurrently
+// compiled materials doesn't interleave.
+class BatchLogBuffer : public std::streambuf {
+public:
+    BatchLogBuffer(std::ostream& stream, std::string BatchLog::* log)
+            : mStream(stream), mLog(log), mBuffer(stream.rdbuf(this)) {
+    }
+
+    ~BatchLogBuffer() override {
+        mStream.rdbuf(mBuffer);
+    }
+
+protected:
+    int overflow(int c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        if (tCurrentBatchLog) {
+            (tCurrentBatchLog->*mLog) += traits_type::to_char_type(c);
+            return c;
+        }
+        return mBuffer->sputc(traits_type::to_char_type(c));
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override {
+        if (tCurrentBatchLog) {
+            (tCurrentBatchLog->*mLog).append(s, size_t(count));
+            return count;
+        }
+        return mBuffer->sputn(s, count);
+    }
+
+    int sync() override {
+        return tCurrentBatchLog ? 0 : mBuffer->pubsync();
+    }
+
+private:
+    std::ostream& mStream;
+    std::string BatchLog::* const mLog;
+    std::streambuf* const mBuffer;
+};
+
+bool MaterialCompiler::compileBatch(const Config& config, utils::JobSystem& jobSystem,
+        ShaderCache* cache) {
+    const std::vector<std::string>& inputs = config.getBatchInputs();
+    const utils::Path outputDirectory(config.getBatchOutputDirectory());
+    const char* extension =
+            config.getOutputFormat() == Config::OutputFormat::BLOB ? ".filamat" : ".inc";
+
+    std::vector<std::unique_ptr<BatchItemConfig>> items;
+    std::unordered_map<std::string, std::string> inputForOutput;
+    for (const std::string& input : inputs) {
+        const std::string name = utils::Path(input).getNameWithoutExtension() + extension;
+        auto pos = inputForOutput.emplace(name, input);
+        if (!pos.second) {
+            std::cerr << "Materials " << pos.first->second << " and " << input
+                    << " would both be compiled to " << name << std::endl;
+            return false;
+        }
+        items.emplace_back(new BatchItemConfig(config, input,
+                outputDirectory.concat(name).getPath()));
+    }
+
+    // Each material is a job, its shaders are compiled by nested jobs. A thread waiting for the
+    // shaders of a material may compile another material meanwhile, hence the log is restored.
+    // filamat logs with utils::slog, which is redirected to the error log of the item as well.
+    std::vector<uint8_t> success(items.size(), false);
+    std::vector<BatchLog> logs(items.size());
+    auto compile = [&](uint32_t first, uint32_t count) {
+        for (uint32_t i = first, e = first + count; i != e; i++) {
+            BatchLog* const previousLog = tCurrentBatchLog;
+            std::string* const previousSlog = utils::io::LogStream::redirect(&logs[i].err);
+            tCurrentBatchLog = &logs[i];
+            BatchItemConfig const& item = *items[i];
+            const std::string output = item.getOutputPath();
+            std::vector<utils::Path> dependencies;
+            if (compileMaterial(item, jobSystem, cache, &dependencies)) {
+                dependencies.insert(dependencies.begin(),
+                        utils::Path(item.getInput()->getName()).getAbsolutePath());
+                success[i] = writeDependencies(output + ".d", output, dependencies);
+                if (!success[i]) {
+                    std::cerr << "Unable to write dependency file " << output << ".d" << std::endl;
+                }
+            }
+            tCurrentBatchLog = previousLog;
+            utils::io::LogStream::redirect(previousSlog);
+        }
+    };
+    {
+        BatchLogBuffer out(std::cout, &BatchLog::out);
+        BatchLogBuffer err(std::cerr, &BatchLog::err);
+        auto* job = jobs::parallel_for(jobSystem, nullptr, 0, uint32_t(items.size()),
+                std::cref(compile), jobs::CountSplitter<1>());
+        jobSystem.runAndWait(job);
+    }
+    for (const BatchLog& log : logs) {
+        std::cout << log.out << std::flush;
+        std::cerr << log.err << std::flush;
+    }
+
+    const size_t failures = std::count(success.begin(), success.end(), false);
+    if (failures) {
+        std::cerr << failures << " of " << items.size() << " materials could not be compiled"
+                << std::endl;
+        return false;
+    }
+    return true;
+}
+
 bool MaterialCompiler::checkParameters(const Config& config) {
+    if (config.isBatch()) {
+        if (config.getBatchInputs().empty()) {
+            std::cerr << "Missing batch inputs." << std::endl;
+            return false;
+        }
+        if (config.getBatchOutputDirectory().empty()) {
+            std::cerr << "Missing output directory." << std::endl;
+            return false;
+        }
+        if (config.getReflectionTarget() != Config::Metadata::NONE) {
+            std::cerr << "Reflection is not supported in batch mode." << std::endl;
+            return false;
+        }
+        if (!utils::Path(config.getBatchOutputDirectory()).mkdirRecursive()) {
+            std::cerr << "Unable to create output directory." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
     // Check for input file.
     if (config.getInput() == nullptr) {
         std::cerr << "Missing input filename." << std::endl;
@@ -25,8 +25,15 @@
 #include "Compiler.h"
 #include "MaterialLexeme.h"
 
+#include <utils/Path.h>
+
 namespace filamat {
 class MaterialBuilder;
+class ShaderCache;
+}
+
+namespace utils {
+class JobSystem;
 }
 class TestMaterialCompiler;
 
@@ -44,6 +51,20 @@ public:
 private:
     friend class ::TestMaterialCompiler;
 
+    // Compiles the material of config, and returns the files it includes if includedFiles
+    // isn't null.
+    bool compileMaterial(const Config& config, utils::JobSystem& jobSystem,
+            filamat::ShaderCache* cache, std::vector<utils::Path>* includedFiles);
+
+    // Compiles the materials of a batch concurrently, each with its dependency file. The output
+    // of each material is buffered and printed once all are compiled, in the batch's order.
+    bool compileBatch(const Config& config, utils::JobSystem& jobSystem,
+            filamat::ShaderCache* cache);
+
+    // Writes a Makefile rule stating that target depends on the given files.
+    static bool writeDependencies(const std::string& path, const std::string& target,
+            const std::vector<utils::Path>& dependencies);
+
     bool parseMaterial(const char* buffer, size_t size,
             filamat::MaterialBuilder& builder) const noexcept;
     bool processMaterial(const MaterialLexeme&,
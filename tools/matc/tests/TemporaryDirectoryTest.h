@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_TEMPORARYDIRECTORYTEST_H
+#define TNT_TEMPORARYDIRECTORYTEST_H
+
+#include <gtest/gtest.h>
+
+#include <utils/Path.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// A fixture that gives each test a new, empty directory, which is removed with all its contents
+// after the test.
+class TemporaryDirectoryTest : public testing::Test {
+protected:
+    void SetUp() override {
+        do {
+            dir = utils::Path::getTemporaryDirectory() + ("matc_test_" + std::to_string(rand()));
+        } while (dir.exists());
+        ASSERT_TRUE(dir.mkdirRecursive());
+    }
+
+    void TearDown() override {
+        remove(dir);
+    }
+
+    utils::Path dir;
+
+private:
+    static void remove(utils::Path path) {
+        if (path.isDirectory()) {
+            for (const utils::Path& child : path.listContents()) {
+                remove(child);
+            }
+        }
+        std::remove(path.c_str());
+    }
+};
+
+#endif // TNT_TEMPORARYDIRECTORYTEST_H
@@ -17,12 +17,21 @@
 #include <gtest/gtest.h>
 
 #include "MockConfig.h"
+#include "TemporaryDirectoryTest.h"
 
+#include <matc/CommandlineConfig.h>
 #include <matc/MaterialCompiler.h>
 #include <matc/MaterialLexer.h>
 #include <matc/JsonishLexer.h>
 #include <matc/JsonishParser.h>
 
+#include <utils/Path.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
 class MaterialLexer: public ::testing::Test {
 protected:
     MaterialLexer() = default;
@@ -44,6 +53,11 @@ public:
         return mMaterialCompiler.parseMaterialAsJSON(buffer, size, builder);
     }
 
+    static bool writeDependencies(const std::string& path, const std::string& target,
+            const std::vector<utils::Path>& dependencies) {
+        return matc::MaterialCompiler::writeDependencies(path, target, dependencies);
+    }
+
 private:
     const matc::MaterialCompiler& mMaterialCompiler;
 };
@@ -301,6 +315,179 @@ TEST_F(MaterialLexer, JsonMaterialCompiler) {
   EXPECT_EQ(result, true);
 }
 
+// The command line of a batch, kept alive for as long as the config referencing it.
+class BatchCommandLine {
+public:
+    BatchCommandLine(const std::string& output, const std::string& input)
+            : mArgs{ "matc", "--batch", "-o", output, input } {
+        for (std::string& arg : mArgs) {
+            mArgv.push_back(&arg[0]);
+        }
+        mConfig.reset(new matc::CommandlineConfig(int(mArgv.size()), mArgv.data()));
+    }
+
+    const matc::CommandlineConfig& getConfig() const noexcept { return *mConfig; }
+
+private:
+    std::vector<std::string> mArgs;
+    std::vector<char*> mArgv;
+    std::unique_ptr<matc::CommandlineConfig> mConfig;
+};
+
+static void writeFile(const utils::Path& path, const std::string& contents) {
+    std::ofstream file(path.getPath());
+    file << contents;
+}
+
+static std::string readFile(const utils::Path& path) {
+    std::ifstream file(path.getPath());
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+class MaterialCompilerBatch : public TemporaryDirectoryTest {
+};
+
+TEST_F(MaterialCompilerBatch, DirectoryInputs) {
+    writeFile(dir + "b.mat", "");
+    writeFile(dir + "a.mat", "");
+    writeFile(dir + "notes.txt", "");
+
+    BatchCommandLine commandLine((dir + "out").getPath(), dir.getPath());
+    const matc::Config& config = commandLine.getConfig();
+    EXPECT_TRUE(config.isValid());
+    EXPECT_TRUE(config.isBatch());
+    EXPECT_EQ((dir + "out").getPath(), config.getBatchOutputDirectory());
+
+    // only the materials, sorted
+    const std::vector<std::string> expected = { (dir + "a.mat").getPath(), (dir + "b.mat").getPath() };
+    EXPECT_EQ(expected, config.getBatchInputs());
+}
+
+TEST_F(MaterialCompilerBatch, ManifestInputs) {
+    writeFile(dir + "manifest.txt",
+            "# materials\n"
+            "b.mat\n"
+            "\n"
+            "  sub/a.mat \t\r\n"
+            "   # indented comment\n"
+            "/absolute/c.mat");
+
+    BatchCommandLine commandLine((dir + "out").getPath(), (dir + "manifest.txt").getPath());
+    const matc::Config& config = commandLine.getConfig();
+    EXPECT_TRUE(config.isValid());
+
+    // in the manifest's order, relative to the manifest
+    const utils::Path root = dir.getAbsolutePath();
+    const std::vector<std::string> expected = {
+            (root + "b.mat").getPath(), (root + "sub/a.mat").getPath(), "/absolute/c.mat" };
+    EXPECT_EQ(expected, config.getBatchInputs());
+}
+
+TEST_F(MaterialCompilerBatch, MissingManifest) {
+    testing::internal::CaptureStderr();
+    BatchCommandLine commandLine((dir + "out").getPath(), (dir + "missing.txt").getPath());
+    testing::internal::GetCapturedStderr();
+    EXPECT_FALSE(commandLine.getConfig().isValid());
+}
+
+TEST_F(MaterialCompilerBatch, OutputNameCollision) {
+    writeFile(dir + "manifest.txt", "x/foo.mat\ny/foo.mat\nbar.mat\n");
+
+    BatchCommandLine commandLine((dir + "out").getPath(), (dir + "manifest.txt").getPath());
+    matc::MaterialCompiler compiler;
+    ASSERT_TRUE(compiler.checkParameters(commandLine.getConfig()));
+
+    // nothing is compiled when two materials would overwrite each other
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(compiler.run(commandLine.getConfig()));
+    const std::string log = testing::internal::GetCapturedStderr();
+    EXPECT_NE(std::string::npos, log.find("would both be compiled to foo.filamat")) << log;
+    EXPECT_EQ(std::string::npos, log.find("bar.mat")) << log;
+}
+
+TEST_F(MaterialCompilerBatch, WriteDependencies) {
+    utils::Path path = dir + "out.filamat.d";
+
+    EXPECT_TRUE(TestMaterialCompiler::writeDependencies(path.getPath(), "out dir/out.filamat",
+            { utils::Path("/src/out.mat"), utils::Path("/src/#inc/$common.h") }));
+
+    // spaces and # are escaped with a backslash, $ with another $
+    EXPECT_EQ("out\\ dir/out.filamat: \\\n"
+              "    /src/out.mat \\\n"
+              "    /src/\\#inc/$$common.h\n", readFile(path));
+
+    EXPECT_TRUE(TestMaterialCompiler::writeDependencies(path.getPath(), "out.filamat", {}));
+    EXPECT_EQ("out.filamat:\n", readFile(path));
+}
+
+TEST_F(MaterialCompilerBatch, LogsInOrder) {
+    std::string manifest;
+    for (int i = 0; i < 16; i++) {
+        manifest += "missing" + std::to_string(i) + ".mat\n";
+    }
+    writeFile(dir + "manifest.txt", manifest);
+
+    BatchCommandLine commandLine((dir + "out").getPath(), (dir + "manifest.txt").getPath());
+    matc::MaterialCompiler compiler;
+    ASSERT_TRUE(compiler.checkParameters(commandLine.getConfig()));
+
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(compiler.run(commandLine.getConfig()));
+    const std::string log = testing::internal::GetCapturedStderr();
+
+    // the materials are compiled concurrently, but their logs are printed whole, in order
+    std::string expected;
+    for (const std::string& input : commandLine.getConfig().getBatchInputs()) {
+        expected += "Unable to open material source file '" + input + "'\n";
+    }
+    expected += "16 of 16 materials could not be compiled\n";
+    EXPECT_EQ(expected, log);
+}
+
+TEST_F(MaterialCompilerBatch, LogsDiagnostics) {
+    std::string manifest;
+    for (int i = 0; i < 8; i++) {
+        // filamat reports the undefined function
+        const std::string index = std::to_string(i);
+        writeFile(dir + ("invalid" + index + ".mat"),
+                "material { name : invalid" + index + " }\n"
+                "fragment {\n"
+                "    void material(inout MaterialInputs material) {\n"
+                "        prepareMaterial(material);\n"
+                "        undefined" + index + "();\n"
+                "    }\n"
+                "}\n");
+        manifest += "invalid" + index + ".mat\n";
+    }
+    writeFile(dir + "manifest.txt", manifest);
+
+    BatchCommandLine commandLine((dir + "out").getPath(), (dir + "manifest.txt").getPath());
+    matc::MaterialCompiler compiler;
+    ASSERT_TRUE(compiler.checkParameters(commandLine.getConfig()));
+
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(compiler.run(commandLine.getConfig()));
+    const std::string log = testing::internal::GetCapturedStderr();
+
+    // the diagnostics of filamat are part of the log of their material
+    size_t start = 0;
+    const std::vector<std::string>& inputs = commandLine.getConfig().getBatchInputs();
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const std::string last = "Could not compile material " + inputs[i] + "\n";
+        const size_t end = log.find(last, start);
+        ASSERT_NE(std::string::npos, end) << log;
+        const std::string itemLog = log.substr(start, end - start);
+        for (size_t j = 0; j < inputs.size(); j++) {
+            const bool found = itemLog.find("undefined" + std::to_string(j)) != std::string::npos;
+            EXPECT_EQ(i == j, found) << itemLog;
+        }
+        start = end + last.size();
+    }
+    EXPECT_EQ("8 of 8 materials could not be compiled\n", log.substr(start));
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
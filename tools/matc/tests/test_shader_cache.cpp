@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <matc/DirShaderCache.h>
+
+#include "TemporaryDirectoryTest.h"
+
+#include <string>
+
+using namespace utils;
+
+class DirShaderCache : public TemporaryDirectoryTest {
+};
+
+TEST_F(DirShaderCache, PutAndGet) {
+    matc::DirShaderCache cache(dir + "cache");
+
+    std::vector<uint8_t> blob;
+    EXPECT_FALSE(cache.get("0123456789abcdef", blob));
+
+    const uint8_t data[] = { 1, 2, 3, 4 };
+    cache.put("0123456789abcdef", data, sizeof(data));
+    EXPECT_TRUE((dir + "cache/01/0123456789abcdef").isFile());
+
+    // a new cache on the same directory sees the entries of the previous one
+    matc::DirShaderCache other(dir + "cache");
+    ASSERT_TRUE(other.get("0123456789abcdef", blob));
+    EXPECT_EQ(std::vector<uint8_t>(data, data + sizeof(data)), blob);
+    EXPECT_FALSE(other.get("fedcba9876543210", blob));
+
+    EXPECT_EQ(0u, cache.getHitCount());
+    EXPECT_EQ(1u, cache.getMissCount());
+    EXPECT_EQ(1u, other.getHitCount());
+    EXPECT_EQ(1u, other.getMissCount());
+}